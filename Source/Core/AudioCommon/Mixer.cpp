@@ -3,10 +3,14 @@
 // Refer to the license.txt file included.
 // Modified For Ishiiruka By Tino
 
+#include <algorithm>
+#include <cmath>
+
 #include "AudioCommon/AudioCommon.h"
 #include "AudioCommon/Mixer.h"
 #include "Common/Atomic.h"
 #include "Common/CPUDetect.h"
+#include "Common/Intrinsics.h"
 #include "Common/MathUtil.h"
 #include "Core/ConfigManager.h"
 #include "Core/Core.h"
@@ -26,26 +30,53 @@ const float CMixer::CONTROL_FACTOR = 0.2f;
 const float CMixer::CONTROL_AVG = 32;
 
 CMixer::CMixer(u32 BackendSampleRate)
-	: m_dma_mixer(this, 32000)
-	, m_streaming_mixer(this, 48000)
-	, m_wiimote_speaker_mixer(this, 3000)
+	: m_wiimote_speaker_mixer(this, 3000)
 	, m_sample_rate(BackendSampleRate)
 	, m_log_dtk_audio(0)
 	, m_log_dsp_audio(0)
 	, m_speed(0)
 {
+	if (SConfig::GetInstance().m_SincResampling)
+	{
+		m_dma_mixer = std::make_unique<SincMixerFifo>(this, 32000);
+		m_streaming_mixer = std::make_unique<SincMixerFifo>(this, 48000);
+	}
+	else
+	{
+		m_dma_mixer = std::make_unique<CubicMixerFifo>(this, 32000);
+		m_streaming_mixer = std::make_unique<CubicMixerFifo>(this, 48000);
+	}
 	INFO_LOG(AUDIO_INTERFACE, "Mixer is initialized");
 }
 
-void CMixer::LinearMixerFifo::Interpolate(u32 left_input_index, float* left_output, float* right_output)
+void CMixer::LinearMixerFifo::Interpolate(const u32* indices, const float* fractions, u32 count, float* output)
 {
-	*left_output = (1 - m_fraction) * m_float_buffer[left_input_index & INDEX_MASK]
-		+ m_fraction * m_float_buffer[(left_input_index + 2) & INDEX_MASK];
-	*right_output = (1 - m_fraction) * m_float_buffer[(left_input_index + 1) & INDEX_MASK]
-		+ m_fraction * m_float_buffer[(left_input_index + 3) & INDEX_MASK];
+	u32 i = 0;
+#ifdef _M_X86
+	// Two frames per vector: [L R] of the first frame in the low half, [L R]
+	// of the second frame in the high half.
+	const __m128 one = _mm_set1_ps(1.0f);
+	for (; i + 2 <= count; i += 2)
+	{
+		__m128 a = _mm_loadu_ps(&m_float_buffer[indices[i]]);
+		__m128 b = _mm_loadu_ps(&m_float_buffer[indices[i + 1]]);
+		__m128 s0 = _mm_movelh_ps(a, b);
+		__m128 s1 = _mm_movehl_ps(b, a);
+		__m128 frac = _mm_setr_ps(fractions[i], fractions[i], fractions[i + 1], fractions[i + 1]);
+		__m128 result = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(one, frac), s0), _mm_mul_ps(frac, s1));
+		_mm_storeu_ps(output + i * 2, result);
+	}
+#endif
+	for (; i < count; ++i)
+	{
+		const float* in = &m_float_buffer[indices[i]];
+		const float frac = fractions[i];
+		output[i * 2] = (1 - frac) * in[0] + frac * in[2];
+		output[i * 2 + 1] = (1 - frac) * in[1] + frac * in[3];
+	}
 }
 
-void CMixer::CubicMixerFifo::Interpolate(u32 left_input_index, float* left_output, float* right_output)
+void CMixer::CubicMixerFifo::Interpolate(const u32* indices, const float* fractions, u32 count, float* output)
 {
 	static const float cubic_coef[] =
 	{
@@ -55,23 +86,140 @@ void CMixer::CubicMixerFifo::Interpolate(u32 left_input_index, float* left_outpu
 	  0.5f, -0.5f, 0.0f, 0.0f
 	};
 
-	const float x2 = m_fraction;		// x
-	const float x1 = x2*x2;          // x^2
-	const float x0 = x1*x2;          // x^3
-
-	float y0 = cubic_coef[0] * x0 + cubic_coef[1] * x1 + cubic_coef[2] * x2 + cubic_coef[3];
-	float y1 = cubic_coef[4] * x0 + cubic_coef[5] * x1 + cubic_coef[6] * x2 + cubic_coef[7];
-	float y2 = cubic_coef[8] * x0 + cubic_coef[9] * x1 + cubic_coef[10] * x2 + cubic_coef[11];
-	float y3 = cubic_coef[12] * x0 + cubic_coef[13] * x1 + cubic_coef[14] * x2 + cubic_coef[15];
-
-	*left_output = y0 * m_float_buffer[left_input_index & INDEX_MASK]
-		+ y1 * m_float_buffer[(left_input_index + 2) & INDEX_MASK]
-		+ y2 * m_float_buffer[(left_input_index + 4) & INDEX_MASK]
-		+ y3 * m_float_buffer[(left_input_index + 6) & INDEX_MASK];
-	*right_output = y0 * m_float_buffer[(left_input_index + 1) & INDEX_MASK]
-		+ y1 * m_float_buffer[(left_input_index + 3) & INDEX_MASK]
-		+ y2 * m_float_buffer[(left_input_index + 5) & INDEX_MASK]
-		+ y3 * m_float_buffer[(left_input_index + 7) & INDEX_MASK];
+	u32 i = 0;
+#ifdef _M_X86
+	if (count == FRAMES_PER_BLOCK)
+	{
+		// Compute the four weights of all four frames at once.
+		const __m128 x2 = _mm_loadu_ps(fractions); // x
+		const __m128 x1 = _mm_mul_ps(x2, x2);      // x^2
+		const __m128 x0 = _mm_mul_ps(x1, x2);      // x^3
+		__m128 y[4];
+		for (int k = 0; k < 4; ++k)
+		{
+			y[k] = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(_mm_set1_ps(cubic_coef[k * 4 + 0]), x0),
+				_mm_mul_ps(_mm_set1_ps(cubic_coef[k * 4 + 1]), x1)),
+				_mm_mul_ps(_mm_set1_ps(cubic_coef[k * 4 + 2]), x2)),
+				_mm_set1_ps(cubic_coef[k * 4 + 3]));
+		}
+
+		for (; i < FRAMES_PER_BLOCK; i += 2)
+		{
+			const float* a = &m_float_buffer[indices[i]];
+			const float* b = &m_float_buffer[indices[i + 1]];
+			__m128 a01 = _mm_loadu_ps(a), a23 = _mm_loadu_ps(a + 4);
+			__m128 b01 = _mm_loadu_ps(b), b23 = _mm_loadu_ps(b + 4);
+
+			// Spread the weights of frames i and i + 1 as [w w w' w'].
+			__m128 result;
+			if (i == 0)
+			{
+				result = _mm_mul_ps(_mm_unpacklo_ps(y[0], y[0]), _mm_movelh_ps(a01, b01));
+				result = _mm_add_ps(result, _mm_mul_ps(_mm_unpacklo_ps(y[1], y[1]), _mm_movehl_ps(b01, a01)));
+				result = _mm_add_ps(result, _mm_mul_ps(_mm_unpacklo_ps(y[2], y[2]), _mm_movelh_ps(a23, b23)));
+				result = _mm_add_ps(result, _mm_mul_ps(_mm_unpacklo_ps(y[3], y[3]), _mm_movehl_ps(b23, a23)));
+			}
+			else
+			{
+				result = _mm_mul_ps(_mm_unpackhi_ps(y[0], y[0]), _mm_movelh_ps(a01, b01));
+				result = _mm_add_ps(result, _mm_mul_ps(_mm_unpackhi_ps(y[1], y[1]), _mm_movehl_ps(b01, a01)));
+				result = _mm_add_ps(result, _mm_mul_ps(_mm_unpackhi_ps(y[2], y[2]), _mm_movelh_ps(a23, b23)));
+				result = _mm_add_ps(result, _mm_mul_ps(_mm_unpackhi_ps(y[3], y[3]), _mm_movehl_ps(b23, a23)));
+			}
+			_mm_storeu_ps(output + i * 2, result);
+		}
+	}
+#endif
+	for (; i < count; ++i)
+	{
+		const float x2 = fractions[i];  // x
+		const float x1 = x2*x2;         // x^2
+		const float x0 = x1*x2;         // x^3
+
+		float y0 = cubic_coef[0] * x0 + cubic_coef[1] * x1 + cubic_coef[2] * x2 + cubic_coef[3];
+		float y1 = cubic_coef[4] * x0 + cubic_coef[5] * x1 + cubic_coef[6] * x2 + cubic_coef[7];
+		float y2 = cubic_coef[8] * x0 + cubic_coef[9] * x1 + cubic_coef[10] * x2 + cubic_coef[11];
+		float y3 = cubic_coef[12] * x0 + cubic_coef[13] * x1 + cubic_coef[14] * x2 + cubic_coef[15];
+
+		const float* in = &m_float_buffer[indices[i]];
+		output[i * 2] = y0 * in[0] + y1 * in[2] + y2 * in[4] + y3 * in[6];
+		output[i * 2 + 1] = y0 * in[1] + y1 * in[3] + y2 * in[5] + y3 * in[7];
+	}
+}
+
+const float* CMixer::SincMixerFifo::GetCoefficients()
+{
+	// Cutoff relative to the input Nyquist frequency. Slightly below 1 so that
+	// the transition band of the short filter does not alias.
+	static const double CUTOFF = 0.9;
+
+	static const std::vector<float> table = [] {
+		std::vector<float> coefs((NUM_PHASES + 1) * NUM_TAPS);
+		const double half = NUM_TAPS / 2;
+		for (u32 phase = 0; phase <= NUM_PHASES; ++phase)
+		{
+			// Output position lies between taps NUM_TAPS / 2 - 1 and NUM_TAPS / 2.
+			const double frac = (double)phase / NUM_PHASES;
+			float* row = &coefs[phase * NUM_TAPS];
+			double sum = 0;
+			for (u32 tap = 0; tap < NUM_TAPS; ++tap)
+			{
+				const double x = tap - (half - 1) - frac;
+				const double sinc = x == 0 ? 1.0 : sin(M_PI * CUTOFF * x) / (M_PI * CUTOFF * x);
+				const double window = std::abs(x) >= half ? 0.0 :
+					0.42 + 0.5 * cos(M_PI * x / half) + 0.08 * cos(2 * M_PI * x / half);
+				row[tap] = (float)(sinc * window);
+				sum += row[tap];
+			}
+			// Normalize for unity gain at DC.
+			for (u32 tap = 0; tap < NUM_TAPS; ++tap)
+				row[tap] = (float)(row[tap] / sum);
+		}
+		return coefs;
+	}();
+
+	return table.data();
+}
+
+void CMixer::SincMixerFifo::Interpolate(const u32* indices, const float* fractions, u32 count, float* output)
+{
+	const float* table = GetCoefficients();
+
+	for (u32 i = 0; i < count; ++i)
+	{
+		const float* in = &m_float_buffer[indices[i]];
+		const float position = fractions[i] * NUM_PHASES;
+		const u32 phase = std::min((u32)position, NUM_PHASES - 1);
+		const float t = position - phase;
+		const float* c0 = table + phase * NUM_TAPS;
+		const float* c1 = c0 + NUM_TAPS;
+
+#ifdef _M_X86
+		const __m128 vt = _mm_set1_ps(t);
+		__m128 acc = _mm_setzero_ps();
+		for (u32 tap = 0; tap < NUM_TAPS; tap += 4)
+		{
+			__m128 lo = _mm_loadu_ps(c0 + tap);
+			__m128 c = _mm_add_ps(lo, _mm_mul_ps(vt, _mm_sub_ps(_mm_loadu_ps(c1 + tap), lo)));
+			// Each input vector holds two stereo frames.
+			acc = _mm_add_ps(acc, _mm_mul_ps(_mm_unpacklo_ps(c, c), _mm_loadu_ps(in + tap * 2)));
+			acc = _mm_add_ps(acc, _mm_mul_ps(_mm_unpackhi_ps(c, c), _mm_loadu_ps(in + tap * 2 + 4)));
+		}
+		acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+		_mm_storel_pi(reinterpret_cast<__m64*>(output + i * 2), acc);
+#else
+		float left = 0, right = 0;
+		for (u32 tap = 0; tap < NUM_TAPS; ++tap)
+		{
+			const float c = c0[tap] + t * (c1[tap] - c0[tap]);
+			left += c * in[tap * 2];
+			right += c * in[tap * 2 + 1];
+		}
+		output[i * 2] = left;
+		output[i * 2 + 1] = right;
+#endif
+	}
 }
 
 void CMixer::MixerFifo::Mix(float* samples, u32 numSamples, bool consider_framelimit)
@@ -104,15 +252,46 @@ void CMixer::MixerFifo::Mix(float* samples, u32 numSamples, bool consider_framel
 	// increment input sample position by ratio, store fraction
 	// QUESTION: do we need to check for NUM_CROSSINGS samples before we interpolate?
 	// seems to work fine as is
-	for (; current_sample < numSamples * 2 && ((write_index - read_index) & INDEX_MASK) > GetWindowSize(); current_sample += 2)
+	// Input positions are gathered for a block of frames first so that the
+	// interpolation and volume can be applied to the whole block at once.
+	u32 indices[FRAMES_PER_BLOCK];
+	float fractions[FRAMES_PER_BLOCK];
+	float frames[FRAMES_PER_BLOCK * 2];
+	while (current_sample < numSamples * 2)
 	{
-		float l_output, r_output;
-		Interpolate(read_index, &l_output, &r_output);
-		samples[current_sample + 1] += l_volume * l_output;
-		samples[current_sample] += r_volume * r_output;
-		m_fraction += ratio;
-		read_index += 2 * (s32)m_fraction;
-		m_fraction = m_fraction - (s32)m_fraction;
+		u32 count = 0;
+		for (; count < FRAMES_PER_BLOCK && current_sample + count * 2 < numSamples * 2 &&
+		       ((write_index - read_index) & INDEX_MASK) > GetWindowSize(); ++count)
+		{
+			indices[count] = read_index & INDEX_MASK;
+			fractions[count] = m_fraction;
+			m_fraction += ratio;
+			read_index += 2 * (s32)m_fraction;
+			m_fraction = m_fraction - (s32)m_fraction;
+		}
+		if (count == 0)
+			break;
+
+		Interpolate(indices, fractions, count, frames);
+
+		// The interpolated frames are in input order, the output is swapped.
+		u32 i = 0;
+#ifdef _M_X86
+		const __m128 volume = _mm_setr_ps(r_volume, l_volume, r_volume, l_volume);
+		for (; i + 2 <= count; i += 2)
+		{
+			__m128 in = _mm_loadu_ps(frames + i * 2);
+			in = _mm_shuffle_ps(in, in, _MM_SHUFFLE(2, 3, 0, 1));
+			float* out = samples + current_sample + i * 2;
+			_mm_storeu_ps(out, _mm_add_ps(_mm_loadu_ps(out), _mm_mul_ps(volume, in)));
+		}
+#endif
+		for (; i < count; ++i)
+		{
+			samples[current_sample + i * 2 + 1] += l_volume * frames[i * 2];
+			samples[current_sample + i * 2] += r_volume * frames[i * 2 + 1];
+		}
+		current_sample += count * 2;
 	}
 	// pad output if not enough input samples
 	float s[2];
@@ -134,10 +313,10 @@ u32 CMixer::MixerFifo::AvailableSamples()
 
 u32 CMixer::AvailableSamples()
 {
-	u32 samples = m_dma_mixer.AvailableSamples();
+	u32 samples = m_dma_mixer->AvailableSamples();
 	if (samples == 0)
 	{
-		samples = m_streaming_mixer.AvailableSamples();
+		samples = m_streaming_mixer->AvailableSamples();
 	}
 	if (samples == 0)
 	{
@@ -160,11 +339,26 @@ u32 CMixer::Mix(s16* samples, u32 num_samples, bool consider_framelimit)
 	// reset float output buffer
 	m_output_buffer.resize(num_samples * 2);
 	std::fill_n(m_output_buffer.begin(), num_samples * 2, 0.f);
-	m_dma_mixer.Mix(m_output_buffer.data(), num_samples, consider_framelimit);
-	m_streaming_mixer.Mix(m_output_buffer.data(), num_samples, consider_framelimit);
+	m_dma_mixer->Mix(m_output_buffer.data(), num_samples, consider_framelimit);
+	m_streaming_mixer->Mix(m_output_buffer.data(), num_samples, consider_framelimit);
 	m_wiimote_speaker_mixer.Mix(m_output_buffer.data(), num_samples, consider_framelimit);
 	// dither and clamp
-	for (u32 i = 0; i < num_samples * 2; i += 2)
+	u32 i = 0;
+#ifdef _M_X86
+	const __m128 scale = _mm_set1_ps(32768.0f);
+	const __m128 clamp_min = _mm_set1_ps(-32768.f);
+	const __m128 clamp_max = _mm_set1_ps(32767.f);
+	for (; i + 8 <= num_samples * 2; i += 8)
+	{
+		__m128 lo = _mm_loadu_ps(&m_output_buffer[i]);
+		__m128 hi = _mm_loadu_ps(&m_output_buffer[i + 4]);
+		lo = _mm_min_ps(_mm_max_ps(_mm_mul_ps(lo, scale), clamp_min), clamp_max);
+		hi = _mm_min_ps(_mm_max_ps(_mm_mul_ps(hi, scale), clamp_min), clamp_max);
+		__m128i packed = _mm_packs_epi32(_mm_cvttps_epi32(lo), _mm_cvttps_epi32(hi));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(samples + i), packed);
+	}
+#endif
+	for (; i < num_samples * 2; i += 2)
 	{
 		float r_output = m_output_buffer[i] * 32768.0f;
 		float l_output = m_output_buffer[i + 1] * 32768.0f;
@@ -187,8 +381,8 @@ u32 CMixer::Mix(float* samples, u32 num_samples, bool consider_framelimit)
 		// Silence		
 		return num_samples;
 	}
-	m_dma_mixer.Mix(samples, num_samples, consider_framelimit);
-	m_streaming_mixer.Mix(samples, num_samples, consider_framelimit);
+	m_dma_mixer->Mix(samples, num_samples, consider_framelimit);
+	m_streaming_mixer->Mix(samples, num_samples, consider_framelimit);
 	m_wiimote_speaker_mixer.Mix(samples, num_samples, consider_framelimit);
 	return num_samples;
 }
@@ -209,7 +403,10 @@ void CMixer::MixerFifo::PushSamples(const s16* samples, u32 num_samples)
 	// convert to float while copying to buffer
 	for (u32 i = 0; i < num_samples * 2; ++i)
 	{
-		m_float_buffer[(current_write_index + i) & INDEX_MASK] = Signed16ToFloat(Common::swap16(samples[i]));
+		const u32 index = (current_write_index + i) & INDEX_MASK;
+		m_float_buffer[index] = Signed16ToFloat(Common::swap16(samples[i]));
+		if (index < WINDOW_PAD)
+			m_float_buffer[index + MAX_SAMPLES * 2] = m_float_buffer[index];
 	}
 	m_write_index.fetch_add(num_samples * 2);
 	return;
@@ -217,14 +414,14 @@ void CMixer::MixerFifo::PushSamples(const s16* samples, u32 num_samples)
 
 void CMixer::PushSamples(const s16 *samples, u32 num_samples)
 {
-	m_dma_mixer.PushSamples(samples, num_samples);
+	m_dma_mixer->PushSamples(samples, num_samples);
 	if (m_log_dsp_audio)
 		g_wave_writer_dsp.AddStereoSamplesBE(samples, num_samples);
 }
 
 void CMixer::PushStreamingSamples(const s16 *samples, u32 num_samples)
 {
-	m_streaming_mixer.PushSamples(samples, num_samples);
+	m_streaming_mixer->PushSamples(samples, num_samples);
 	if (m_log_dtk_audio)
 		g_wave_writer_dtk.AddStereoSamplesBE(samples, num_samples);
 }
@@ -249,17 +446,17 @@ void CMixer::PushWiimoteSpeakerSamples(const s16 *samples, u32 num_samples, u32
 
 void CMixer::SetDMAInputSampleRate(u32 rate)
 {
-	m_dma_mixer.SetInputSampleRate(rate);
+	m_dma_mixer->SetInputSampleRate(rate);
 }
 
 void CMixer::SetStreamInputSampleRate(u32 rate)
 {
-	m_streaming_mixer.SetInputSampleRate(rate);
+	m_streaming_mixer->SetInputSampleRate(rate);
 }
 
 void CMixer::SetStreamingVolume(u32 lvolume, u32 rvolume)
 {
-	m_streaming_mixer.SetVolume(lvolume, rvolume);
+	m_streaming_mixer->SetVolume(lvolume, rvolume);
 }
 
 void CMixer::SetWiimoteSpeakerVolume(u32 lvolume, u32 rvolume)
@@ -7,6 +7,7 @@
 #include <atomic>
 #include <cstring>
 #include <array>
+#include <memory>
 #include <mutex>
 #include <vector>
 
@@ -25,6 +26,11 @@ public:
 
 	static const u32 MAX_SAMPLES = 2048;
 	static const u32 INDEX_MASK = MAX_SAMPLES * 2 - 1;
+	// Largest interpolation window, in floats. The FIFO buffers keep a copy of
+	// their first WINDOW_PAD floats past the end so windows never wrap around.
+	static const u32 WINDOW_PAD = 32;
+	// Number of output frames interpolated per call.
+	static const u32 FRAMES_PER_BLOCK = 4;
 	static const float LOW_WATERMARK;
 	static const float MAX_FREQ_SHIFT;
 	static const float CONTROL_FACTOR;
@@ -75,8 +81,12 @@ protected:
 			srand((u32)time(nullptr));
 			m_float_buffer.fill(0.0f);
 		}
+		virtual ~MixerFifo() {}
 		virtual u32 GetWindowSize() = 0;
-		virtual void Interpolate(u32 left_input_index, float* left_output, float* right_output) = 0;
+		// Interpolates count (at most FRAMES_PER_BLOCK) output frames. Frame i
+		// starts at input index indices[i] with fractional position fractions[i],
+		// and is written to output[2 * i] and output[2 * i + 1] in input order.
+		virtual void Interpolate(const u32* indices, const float* fractions, u32 count, float* output) = 0;
 		void PushSamples(const s16* samples, u32 num_samples);
 		void Mix(float* samples, u32 numSamples, bool consider_framelimit = true);
 		void SetInputSampleRate(u32 rate);
@@ -87,7 +97,7 @@ protected:
 		CMixer *m_mixer;
 		unsigned m_input_sample_rate;
 
-		std::array<float, MAX_SAMPLES * 2> m_float_buffer;
+		std::array<float, MAX_SAMPLES * 2 + WINDOW_PAD> m_float_buffer;
 
 		std::atomic<u32> m_write_index;
 		std::atomic<u32> m_read_index;
@@ -104,7 +114,7 @@ protected:
 	{
 	public:
 		LinearMixerFifo(CMixer* mixer, u32 sample_rate) : MixerFifo(mixer, sample_rate) {}
-		void Interpolate(u32 left_input_index, float* left_output, float* right_output) override;
+		void Interpolate(const u32* indices, const float* fractions, u32 count, float* output) override;
 		u32 GetWindowSize() override { return 4; };
 	};
 
@@ -112,12 +122,29 @@ protected:
 	{
 	public:
 		CubicMixerFifo(CMixer* mixer, u32 sample_rate) : MixerFifo(mixer, sample_rate) {}
-		void Interpolate(u32 left_input_index, float* left_output, float* right_output) override;
+		void Interpolate(const u32* indices, const float* fractions, u32 count, float* output) override;
 		u32 GetWindowSize() override { return 8; };
 	};
 
-	CubicMixerFifo m_dma_mixer;
-	CubicMixerFifo m_streaming_mixer;
+	// Blackman-windowed sinc interpolation. The filter is stored as a table of
+	// NUM_PHASES + 1 sets of coefficients, and the coefficients for a given
+	// fractional position are linearly interpolated between the two nearest.
+	class SincMixerFifo : public MixerFifo
+	{
+	public:
+		static const u32 NUM_TAPS = 16;
+		static const u32 NUM_PHASES = 256;
+
+		SincMixerFifo(CMixer* mixer, u32 sample_rate) : MixerFifo(mixer, sample_rate) {}
+		void Interpolate(const u32* indices, const float* fractions, u32 count, float* output) override;
+		u32 GetWindowSize() override { return NUM_TAPS * 2; };
+
+	private:
+		static const float* GetCoefficients();
+	};
+
+	std::unique_ptr<MixerFifo> m_dma_mixer;
+	std::unique_ptr<MixerFifo> m_streaming_mixer;
 
 	// Linear interpolation seems to be the best for Wiimote 3khz -> 48khz, for now.
 	// TODO: figure out why and make it work with the above FIR
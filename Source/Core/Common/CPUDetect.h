@@ -60,7 +60,7 @@ struct CPUInfo
 	bool bFP    = false;
 	bool bASIMD = false;
 	bool bCRC32 = false;
-	bool bSHA1  = false;
+	bool bSHA1  = false; // Also set for the x86 SHA extensions
 	bool bSHA2  = false;
 
 	// Call Detect()
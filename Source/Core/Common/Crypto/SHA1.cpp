@@ -0,0 +1,213 @@
+// Copyright 2016 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cstring>
+#include <mbedtls/sha1.h>
+
+#include "Common/CommonTypes.h"
+#include "Common/CPUDetect.h"
+#include "Common/Intrinsics.h"
+#include "Common/Crypto/SHA1.h"
+
+#if defined(_M_X86_64) && !defined(_M_GENERIC)
+#define HAVE_SHA_INTRINSICS 1
+// GCC and Clang refuse to emit the SHA instructions unless the function is
+// explicitly marked as targeting them. MSVC accepts them anywhere.
+#if defined(__GNUC__)
+#define SHA_TARGET __attribute__((target("sha,ssse3,sse4.1")))
+#else
+#define SHA_TARGET
+#endif
+#endif
+
+namespace Common
+{
+namespace SHA1
+{
+
+#ifdef HAVE_SHA_INTRINSICS
+
+// Each group of four rounds feeds the previous group's E value through
+// sha1nexte. E0/E1 alternate as "current" and "saved" registers.
+#define ROUNDS4(E_CUR, E_NEXT, MSG, F) \
+	E_CUR = _mm_sha1nexte_epu32(E_CUR, MSG); \
+	E_NEXT = abcd; \
+	abcd = _mm_sha1rnds4_epu32(abcd, E_CUR, F)
+
+SHA_TARGET static void ProcessBlocksSHANI(u32 state[5], const u8* data, size_t blocks)
+{
+	const __m128i mask = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+
+	__m128i abcd = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state));
+	__m128i e0 = _mm_set_epi32(state[4], 0, 0, 0);
+	abcd = _mm_shuffle_epi32(abcd, 0x1B);
+
+	for (; blocks > 0; --blocks, data += 64)
+	{
+		const __m128i abcd_save = abcd;
+		const __m128i e0_save = e0;
+		__m128i e1;
+
+		__m128i msg0 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0)), mask);
+		__m128i msg1 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16)), mask);
+		__m128i msg2 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 32)), mask);
+		__m128i msg3 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 48)), mask);
+
+		// Rounds 0-3
+		e0 = _mm_add_epi32(e0, msg0);
+		e1 = abcd;
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+
+		// Rounds 4-15
+		ROUNDS4(e1, e0, msg1, 0);
+		msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+		ROUNDS4(e0, e1, msg2, 0);
+		msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+		msg0 = _mm_xor_si128(msg0, msg2);
+		ROUNDS4(e1, e0, msg3, 0);
+		msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+		msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+		msg1 = _mm_xor_si128(msg1, msg3);
+
+		// Rounds 16-67 follow a fixed message schedule rotation.
+#define SCHEDULE(E_CUR, E_NEXT, M0, M1, M2, M3, F) \
+		ROUNDS4(E_CUR, E_NEXT, M0, F); \
+		M1 = _mm_sha1msg2_epu32(M1, M0); \
+		M3 = _mm_sha1msg1_epu32(M3, M0); \
+		M2 = _mm_xor_si128(M2, M0)
+
+		SCHEDULE(e0, e1, msg0, msg1, msg2, msg3, 0);
+		SCHEDULE(e1, e0, msg1, msg2, msg3, msg0, 1);
+		SCHEDULE(e0, e1, msg2, msg3, msg0, msg1, 1);
+		SCHEDULE(e1, e0, msg3, msg0, msg1, msg2, 1);
+		SCHEDULE(e0, e1, msg0, msg1, msg2, msg3, 1);
+		SCHEDULE(e1, e0, msg1, msg2, msg3, msg0, 1);
+		SCHEDULE(e0, e1, msg2, msg3, msg0, msg1, 2);
+		SCHEDULE(e1, e0, msg3, msg0, msg1, msg2, 2);
+		SCHEDULE(e0, e1, msg0, msg1, msg2, msg3, 2);
+		SCHEDULE(e1, e0, msg1, msg2, msg3, msg0, 2);
+		SCHEDULE(e0, e1, msg2, msg3, msg0, msg1, 2);
+		SCHEDULE(e1, e0, msg3, msg0, msg1, msg2, 3);
+		SCHEDULE(e0, e1, msg0, msg1, msg2, msg3, 3);
+#undef SCHEDULE
+
+		// Rounds 68-79
+		ROUNDS4(e1, e0, msg1, 3);
+		msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+		msg3 = _mm_xor_si128(msg3, msg1);
+		ROUNDS4(e0, e1, msg2, 3);
+		msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+		ROUNDS4(e1, e0, msg3, 3);
+
+		e0 = _mm_sha1nexte_epu32(e0, e0_save);
+		abcd = _mm_add_epi32(abcd, abcd_save);
+	}
+
+	abcd = _mm_shuffle_epi32(abcd, 0x1B);
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(state), abcd);
+	state[4] = _mm_extract_epi32(e0, 3);
+}
+
+#undef ROUNDS4
+
+#endif
+
+bool HasHardwareSupport()
+{
+#ifdef HAVE_SHA_INTRINSICS
+	return cpu_info.bSHA1 && cpu_info.bSSE4_1;
+#else
+	return false;
+#endif
+}
+
+Context::Context() : m_hardware(HasHardwareSupport())
+{
+	if (m_hardware)
+	{
+		m_state[0] = 0x67452301;
+		m_state[1] = 0xEFCDAB89;
+		m_state[2] = 0x98BADCFE;
+		m_state[3] = 0x10325476;
+		m_state[4] = 0xC3D2E1F0;
+	}
+	else
+	{
+		mbedtls_sha1_init(&m_mbedtls);
+		mbedtls_sha1_starts(&m_mbedtls);
+	}
+}
+
+Context::~Context()
+{
+	if (!m_hardware)
+		mbedtls_sha1_free(&m_mbedtls);
+}
+
+void Context::Update(const u8* data, size_t length)
+{
+#ifdef HAVE_SHA_INTRINSICS
+	if (m_hardware)
+	{
+		size_t buffered = m_length % 64;
+		m_length += length;
+
+		if (buffered != 0)
+		{
+			const size_t fill = std::min<size_t>(64 - buffered, length);
+			memcpy(m_buffer + buffered, data, fill);
+			data += fill;
+			length -= fill;
+			if (buffered + fill < 64)
+				return;
+			ProcessBlocksSHANI(m_state, m_buffer, 1);
+		}
+
+		ProcessBlocksSHANI(m_state, data, length / 64);
+		memcpy(m_buffer, data + (length & ~size_t(63)), length % 64);
+		return;
+	}
+#endif
+	mbedtls_sha1_update(&m_mbedtls, data, length);
+}
+
+void Context::Finish(u8 hash[20])
+{
+#ifdef HAVE_SHA_INTRINSICS
+	if (m_hardware)
+	{
+		// Pad the tail: 0x80, zeroes, then the bit length as a big-endian u64.
+		u8 tail[128] = {};
+		const size_t remaining = m_length % 64;
+		memcpy(tail, m_buffer, remaining);
+		tail[remaining] = 0x80;
+		const size_t tail_blocks = remaining < 56 ? 1 : 2;
+		const u64 bit_length = m_length * 8;
+		for (int i = 0; i < 8; ++i)
+			tail[tail_blocks * 64 - 1 - i] = static_cast<u8>(bit_length >> (i * 8));
+		ProcessBlocksSHANI(m_state, tail, tail_blocks);
+
+		for (int i = 0; i < 5; ++i)
+		{
+			hash[i * 4 + 0] = static_cast<u8>(m_state[i] >> 24);
+			hash[i * 4 + 1] = static_cast<u8>(m_state[i] >> 16);
+			hash[i * 4 + 2] = static_cast<u8>(m_state[i] >> 8);
+			hash[i * 4 + 3] = static_cast<u8>(m_state[i]);
+		}
+		return;
+	}
+#endif
+	mbedtls_sha1_finish(&m_mbedtls, hash);
+}
+
+void Digest(const u8* data, size_t length, u8 hash[20])
+{
+	Context context;
+	context.Update(data, length);
+	context.Finish(hash);
+}
+
+}  // namespace SHA1
+}  // namespace Common
@@ -0,0 +1,43 @@
+// Copyright 2016 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <cstddef>
+#include <mbedtls/sha1.h>
+
+#include "Common/CommonTypes.h"
+
+namespace Common
+{
+namespace SHA1
+{
+
+// Incremental SHA-1. Uses the x86 SHA extensions when the host has them
+// and falls back to mbed TLS otherwise.
+class Context
+{
+public:
+	Context();
+	~Context();
+
+	void Update(const u8* data, size_t length);
+	void Finish(u8 hash[20]);
+
+private:
+	bool m_hardware;
+	u32 m_state[5];
+	u64 m_length = 0;
+	u8 m_buffer[64];
+	mbedtls_sha1_context m_mbedtls;
+};
+
+// Computes the SHA-1 digest of a buffer in one shot.
+void Digest(const u8* data, size_t length, u8 hash[20]);
+
+// Returns true if Digest() will use the hardware-accelerated path.
+bool HasHardwareSupport();
+
+}  // namespace SHA1
+}  // namespace Common
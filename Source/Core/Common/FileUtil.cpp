@@ -403,6 +403,24 @@ u64 GetSize(const std::string &filename)
 	return 0;
 }
 
+bool GetSizeAndModificationTime(const std::string &filename, u64 *size, u64 *mtime)
+{
+	struct stat64 buf;
+#ifdef _WIN32
+	if (_tstat64(UTF8ToTStr(filename).c_str(), &buf) != 0)
+#else
+	if (stat64(filename.c_str(), &buf) != 0)
+#endif
+		return false;
+
+	if (S_ISDIR(buf.st_mode))
+		return false;
+
+	*size = buf.st_size;
+	*mtime = buf.st_mtime;
+	return true;
+}
+
 // Overloaded GetSize, accepts file descriptor
 u64 GetSize(const int fd)
 {
@@ -83,6 +83,10 @@ u64 GetSize(const int fd);
 // Overloaded GetSize, accepts FILE*
 u64 GetSize(FILE *f);
 
+// Gets the size and the last modification time (seconds since 1970) of a file
+// with a single stat. Returns false if it doesn't exist or is a directory.
+bool GetSizeAndModificationTime(const std::string &filename, u64 *size, u64 *mtime);
+
 // Returns true if successful, or path already exists.
 bool CreateDir(const std::string &filename);
 
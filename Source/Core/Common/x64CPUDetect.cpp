@@ -152,6 +152,8 @@ void CPUInfo::Detect()
 				bBMI1 = true;
 			if ((cpu_id[1] >> 8) & 1)
 				bBMI2 = true;
+			if ((cpu_id[1] >> 29) & 1)
+				bSHA1 = true;
 		}
 	}
 
@@ -234,6 +236,7 @@ std::string CPUInfo::Summarize()
 	if (bBMI2) sum += ", BMI2";
 	if (bFMA) sum += ", FMA";
 	if (bAES) sum += ", AES";
+	if (bSHA1) sum += ", SHA";
 	if (bMOVBE) sum += ", MOVBE";
 	if (bLongMode) sum += ", 64-bit support";
 	return sum;
@@ -36,7 +36,7 @@ SConfig::SConfig()
   bJITBranchOff(false),
   bJITILTimeProfiling(false), bJITILOutputIR(false),
   bFPRF(false), bAccurateNaNs(false),
-  bCPUThread(true), bDSPThread(false), bDSPHLE(true),
+  bCPUThread(true), bDSPThread(false), bNetPlayVerifyRollback(false), bDSPHLE(true),
   bSkipIdle(true), bSyncGPUOnSkipIdleHack(true), bNTSC(false), bForceNTSCJ(false),
   bHLE_BS2(true), bEnableCheats(false),
   bEnableMemcardSdWriting(true),
@@ -225,6 +225,7 @@ void SConfig::SaveCoreSettings(IniFile& ini)
 	core->Set("Fastmem", bFastmem);
 	core->Set("CPUThread", bCPUThread);
 	core->Set("DSPHLE", bDSPHLE);
+	core->Set("NetPlayVerifyRollback", bNetPlayVerifyRollback);
 	core->Set("SkipIdle", bSkipIdle);
 	core->Set("SyncOnSkipIdle", bSyncGPUOnSkipIdleHack);
 	core->Set("SyncGPU", bSyncGPU);
@@ -255,6 +256,7 @@ void SConfig::SaveCoreSettings(IniFile& ini)
 	}
 	core->Set("WiiSDCard", m_WiiSDCard);
 	core->Set("WiiKeyboard", m_WiiKeyboard);
+	core->Set("WiiNANDDeferWrites", m_WiiNANDDeferWrites);
 	core->Set("WiimoteContinuousScanning", m_WiimoteContinuousScanning);
 	core->Set("WiimoteEnableSpeaker", m_WiimoteEnableSpeaker);
 	core->Set("RunCompareServer", bRunCompareServer);
@@ -279,6 +281,7 @@ void SConfig::SaveMovieSettings(IniFile& ini)
 	movie->Set("DumpFrames", m_DumpFrames);
 	movie->Set("DumpFramesSilent", m_DumpFramesSilent);
 	movie->Set("ShowInputDisplay", m_ShowInputDisplay);
+	movie->Set("StateHashInterval", m_MovieStateHashInterval);
 }
 
 void SConfig::SaveDSPSettings(IniFile& ini)
@@ -287,10 +290,12 @@ void SConfig::SaveDSPSettings(IniFile& ini)
 
 	dsp->Set("EnableJIT", m_DSPEnableJIT);
 	dsp->Set("DumpAudio", m_DumpAudio);
+	dsp->Set("SincResampling", m_SincResampling);
 	dsp->Set("DumpUCode", m_DumpUCode);
 	dsp->Set("Backend", sBackend);
 	dsp->Set("Volume", m_Volume);
 	dsp->Set("CaptureLog", m_DSPCaptureLog);
+	dsp->Set("HLEParallelVoices", m_DSPHLEParallelVoices);
 }
 
 void SConfig::SaveInputSettings(IniFile& ini)
@@ -510,6 +515,7 @@ void SConfig::LoadCoreSettings(IniFile& ini)
 	}
 	core->Get("WiiSDCard",                 &m_WiiSDCard,                                   false);
 	core->Get("WiiKeyboard",               &m_WiiKeyboard,                                 false);
+	core->Get("WiiNANDDeferWrites",        &m_WiiNANDDeferWrites,                          false);
 	core->Get("WiimoteContinuousScanning", &m_WiimoteContinuousScanning,                   false);
 	core->Get("WiimoteEnableSpeaker",      &m_WiimoteEnableSpeaker,                        false);
 	core->Get("RunCompareServer",          &bRunCompareServer, false);
@@ -521,6 +527,7 @@ void SConfig::LoadCoreSettings(IniFile& ini)
 	core->Get("SyncGpuMinDistance",        &iSyncGpuMinDistance, -200000);
 	core->Get("SyncGpuOverclock",          &fSyncGpuOverclock, 1.0);
 	core->Get("FastDiscSpeed",             &bFastDiscSpeed,    false);
+	core->Get("NetPlayVerifyRollback",     &bNetPlayVerifyRollback, false);
 	core->Get("DCBZ",                      &bDCBZOFF,          false);
 	core->Get("FrameLimit",                &m_Framelimit,                                  1); // auto frame limit by default
 	core->Get("Overclock",                 &m_OCFactor,                                    1.0f);
@@ -542,6 +549,7 @@ void SConfig::LoadMovieSettings(IniFile& ini)
 	movie->Get("DumpFrames", &m_DumpFrames, false);
 	movie->Get("DumpFramesSilent", &m_DumpFramesSilent, false);
 	movie->Get("ShowInputDisplay", &m_ShowInputDisplay, false);
+	movie->Get("StateHashInterval", &m_MovieStateHashInterval, 0);
 }
 
 void SConfig::LoadDSPSettings(IniFile& ini)
@@ -550,6 +558,7 @@ void SConfig::LoadDSPSettings(IniFile& ini)
 
 	dsp->Get("EnableJIT", &m_DSPEnableJIT, true);
 	dsp->Get("DumpAudio", &m_DumpAudio, false);
+	dsp->Get("SincResampling", &m_SincResampling, false);
 	dsp->Get("DumpUCode", &m_DumpUCode, false);
 #if defined __linux__ && HAVE_ALSA
 	dsp->Get("Backend", &sBackend, BACKEND_ALSA);
@@ -564,6 +573,7 @@ void SConfig::LoadDSPSettings(IniFile& ini)
 #endif
 	dsp->Get("Volume", &m_Volume, 100);
 	dsp->Get("CaptureLog", &m_DSPCaptureLog, false);
+	dsp->Get("HLEParallelVoices", &m_DSPHLEParallelVoices, false);
 
 	m_IsMuted = false;
 }
@@ -610,6 +620,7 @@ void SConfig::LoadDefaults()
 	bDoubleVideoRate = false;
 	bSyncGPU = false;
 	bFastDiscSpeed = false;
+	bNetPlayVerifyRollback = false;
 	bEnableMemcardSdWriting = true;
 	SelectedLanguage = 0;
 	bOverrideGCLanguage = false;
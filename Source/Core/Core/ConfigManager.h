@@ -39,6 +39,10 @@ struct SConfig : NonCopyable
 	// Wii Devices
 	bool m_WiiSDCard;
 	bool m_WiiKeyboard;
+	// Keep NAND files cached after they are closed, and only write them back
+	// when something needs the host files or emulation stops. The files are
+	// still paged in from the host as they are used.
+	bool m_WiiNANDDeferWrites;
 	bool m_WiimoteContinuousScanning;
 	bool m_WiimoteEnableSpeaker;
 
@@ -82,6 +86,8 @@ struct SConfig : NonCopyable
 
 	bool bCPUThread;
 	bool bDSPThread;
+	// Replay every netplay rollback snapshot once more and compare the state hashes
+	bool bNetPlayVerifyRollback;
 	bool bDSPHLE;
 	bool bSkipIdle;
 	bool bSyncGPUOnSkipIdleHack;
@@ -253,13 +259,17 @@ struct SConfig : NonCopyable
 	bool m_DumpFrames;
 	bool m_DumpFramesSilent;
 	bool m_ShowInputDisplay;
+	// Hash the emulated state every this many inputs while recording (0 = off)
+	unsigned int m_MovieStateHashInterval;
 
 	bool m_PauseOnFocusLost;
 
 	// DSP settings
 	bool m_DSPEnableJIT;
 	bool m_DSPCaptureLog;
+	bool m_DSPHLEParallelVoices;
 	bool m_DumpAudio;
+	bool m_SincResampling;
 	bool m_IsMuted;
 	bool m_DumpUCode;
 	int m_Volume;
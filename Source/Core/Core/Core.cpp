@@ -134,6 +134,18 @@ void FrameUpdateOnCPUThread()
 		NetPlayClient::SendTimeBase();
 }
 
+void FieldUpdateOnCPUThread()
+{
+	if (NetPlay::IsNetPlayRunning())
+		NetPlayClient::RequestRollbackUpdate();
+}
+
+void SafePointOnCPUThread()
+{
+	if (NetPlay::IsNetPlayRunning())
+		NetPlayClient::UpdateRollback();
+}
+
 // Display messages and return values
 
 // Formatted stop message
@@ -407,6 +419,19 @@ void EmuThread()
 	// For a time this acts as the CPU thread...
 	DeclareAsCPUThread();
 
+	// Netplay peers and movie playback have to agree on the DSP thread setting,
+	// since the lockstep DSP thread raises interrupts at different (but still
+	// reproducible) times than the DSP running on the CPU thread. Movies that
+	// don't say otherwise were recorded with the DSP on the CPU thread. Other
+	// deterministic runs use the DSP thread like any other run; it switches to
+	// lockstep by itself.
+	if (NetPlay::IsNetPlayRunning())
+		SConfig::GetInstance().bDSPThread = g_NetPlaySettings.m_DSPThread;
+	else if (Movie::IsPlayingInput())
+		SConfig::GetInstance().bDSPThread = Movie::IsConfigSaved() && Movie::IsDSPThread();
+	else
+		SConfig::GetInstance().bDSPThread = ShouldUseDSPThread();
+
 	Movie::Init();
 
 	HW::Init();
@@ -420,11 +445,6 @@ void EmuThread()
 
 	OSD::AddMessage("Dolphin " + video_backend->GetName() + " Video Backend.", 5000);
 
-	if (cpu_info.HTT)
-		SConfig::GetInstance().bDSPThread = cpu_info.num_cores > 4;
-	else
-		SConfig::GetInstance().bDSPThread = cpu_info.num_cores > 2;
-
 	if (!DSP::GetDSPEmulator()->Initialize(core_parameter.bWii, core_parameter.bDSPThread))
 	{
 		HW::Shutdown();
@@ -709,6 +729,10 @@ bool PauseAndLock(bool doLock, bool unpauseOnUnlock)
 	bool wasUnpaused = CPU::PauseAndLock(doLock, unpauseOnUnlock);
 	ExpansionInterface::PauseAndLock(doLock, unpauseOnUnlock);
 
+	// The socket thread writes replies to guest memory and schedules events.
+	if (SConfig::GetInstance().bWii)
+		WiiSockMan::GetInstance().PauseAndLock(doLock);
+
 	// audio has to come after CPU, because CPU thread can wait for audio thread (m_throttle).
 	DSP::GetDSPEmulator()->PauseAndLock(doLock, unpauseOnUnlock);
 
@@ -847,6 +871,13 @@ void SetOnStoppedCallback(StoppedCallbackFunc callback)
 	s_on_stopped_callback = callback;
 }
 
+bool ShouldUseDSPThread()
+{
+	if (cpu_info.HTT)
+		return cpu_info.num_cores > 4;
+	return cpu_info.num_cores > 2;
+}
+
 void UpdateWantDeterminism(bool initial)
 {
 	// For now, this value is not itself configurable.  Instead, individual
@@ -64,6 +64,10 @@ void SetStateFileName(const std::string& val);
 void SetBlockStart(u32 addr);
 
 void FrameUpdateOnCPUThread();
+void FieldUpdateOnCPUThread();
+// Called from CPU::Run after PowerPC::RequestSafePoint, outside any timing
+// slice. Savestates can be taken and loaded here.
+void SafePointOnCPUThread();
 
 bool ShouldSkipFrame(int skipped);
 void VideoThrottle();
@@ -84,4 +88,7 @@ void SetOnStoppedCallback(StoppedCallbackFunc callback);
 // Run on the GUI thread when the factors change.
 void UpdateWantDeterminism(bool initial = false);
 
+// Whether the DSP LLE should get its own thread on this machine.
+bool ShouldUseDSPThread();
+
 }  // namespace
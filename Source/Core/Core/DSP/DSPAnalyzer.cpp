@@ -62,11 +62,97 @@ const u16 idle_skip_sigs[NUM_IDLE_SIGS][MAX_IDLE_SIG_SIZE + 1] =
 	  0, 0 }
 };
 
+// Longest loop body (in words, including the closing branch) that
+// FindPollingLoops will consider.
+#define MAX_POLLING_LOOP_SIZE 8
+
 static void Reset()
 {
 	code_flags.fill(0);
 }
 
+static bool IsMailboxHigh(u16 addr)
+{
+	// Reading the high halves has no side effects. Reading a low half
+	// acknowledges the mail, so loops doing that can't be skipped.
+	return addr == (0xff00 | DSP_DMBH) || addr == (0xff00 | DSP_CMBH);
+}
+
+// Returns 1 if the instruction is a side effect free mailbox read, 0 if it
+// only updates $sr from a register test, and -1 for anything else.
+static int ClassifyPollingInstruction(u16 addr, UDSPInstruction inst, const DSPOPCTemplate* opcode)
+{
+	if (opcode->extended && (inst & 0xff) != 0)
+		return -1;
+
+	switch (opcode->opcode)
+	{
+	case 0x2000: // LRS
+		return IsMailboxHigh(0xff00 | (inst & 0xff)) ? 1 : -1;
+	case 0x00c0: // LR
+	{
+		// Writes to the stack registers push.
+		const u16 reg = inst & 0x1f;
+		if (reg >= DSP_REG_ST0 && reg <= DSP_REG_ST3)
+			return -1;
+		return IsMailboxHigh(dsp_imem_read(addr + 1)) ? 1 : -1;
+	}
+	case 0x0280: // CMPI
+	case 0x02a0: // ANDF
+	case 0x02c0: // ANDCF
+	case 0x0600: // CMPIS
+	case 0x8600: // TSTAXH
+	case 0xb100: // TST
+		return 0;
+	default:
+		return -1;
+	}
+}
+
+// Finds loops that do nothing but poll a mailbox: a conditional jump back to
+// a short, straight-line body that reads the high half of a mailbox and only
+// tests it. Such a body is idempotent, so while the mailbox doesn't change,
+// skipping iterations gives the same state as running them.
+static void FindPollingLoops(int start_addr, int end_addr)
+{
+	for (int addr = start_addr; addr < end_addr; addr++)
+	{
+		if (!(code_flags[addr] & CODE_START_OF_INST))
+			continue;
+
+		const UDSPInstruction inst = dsp_imem_read(addr);
+		// Jcc, excluding the unconditional JMP.
+		if ((inst & 0xfff0) != 0x0290 || inst == 0x029f)
+			continue;
+
+		const u16 target = dsp_imem_read(addr + 1);
+		if (target >= addr || addr - target > MAX_POLLING_LOOP_SIZE - 2 ||
+		    !(code_flags[target] & CODE_START_OF_INST))
+		{
+			continue;
+		}
+
+		bool reads_mailbox = false;
+		u16 i = target;
+		while (i < addr)
+		{
+			const UDSPInstruction body = dsp_imem_read(i);
+			const DSPOPCTemplate* opcode = GetOpTemplate(body);
+			const int kind = opcode ? ClassifyPollingInstruction(i, body, opcode) : -1;
+			if (kind < 0)
+				break;
+			reads_mailbox |= kind > 0;
+			i += opcode->size;
+		}
+
+		if (i == addr && reads_mailbox)
+		{
+			INFO_LOG(DSPLLE, "Mailbox polling loop found at %04x", target);
+			code_flags[target] |= CODE_IDLE_SKIP;
+		}
+	}
+}
+
 static void AnalyzeRange(int start_addr, int end_addr)
 {
 	// First we run an extremely simplified version of a disassembler to find
@@ -149,6 +235,8 @@ static void AnalyzeRange(int start_addr, int end_addr)
 			}
 		}
 	}
+	FindPollingLoops(start_addr, end_addr);
+
 	INFO_LOG(DSPLLE, "Finished analysis.");
 }
 
@@ -12,7 +12,6 @@
 #include "Core/DSP/DSPMemoryMap.h"
 
 #define MAX_BLOCK_SIZE 250
-#define DSP_IDLE_SKIP_CYCLES 0x1000
 
 using namespace Gen;
 
@@ -218,6 +217,7 @@ void DSPEmitter::Compile(u16 start_addr)
 	gpr.LoadRegs();
 
 	blockLinkEntry = GetCodePtr();
+	selfLinkCycleChecks.clear();
 
 	compilePC = start_addr;
 	bool fixup_pc = false;
@@ -231,9 +231,11 @@ void DSPEmitter::Compile(u16 start_addr)
 		UDSPInstruction inst = dsp_imem_read(compilePC);
 		const DSPOPCTemplate *opcode = GetOpTemplate(inst);
 
+		// Count the instruction before emitting it, so that the exits written by
+		// branch instructions charge for the branch itself.
+		blockSize[start_addr]++;
 		EmitInstruction(inst);
 
-		blockSize[start_addr]++;
 		compilePC += opcode->size;
 
 		// If the block was trying to link into itself, remove the link
@@ -264,14 +266,7 @@ void DSPEmitter::Compile(u16 start_addr)
 			DSPJitRegCache c(gpr);
 			HandleLoop();
 			gpr.SaveRegs();
-			if (!DSPHost::OnThread() && DSPAnalyzer::code_flags[start_addr] & DSPAnalyzer::CODE_IDLE_SKIP)
-			{
-				MOV(16, R(EAX), Imm16(DSP_IDLE_SKIP_CYCLES));
-			}
-			else
-			{
-				MOV(16, R(EAX), Imm16(blockSize[start_addr]));
-			}
+			MOV(16, R(EAX), Imm16(blockSize[start_addr]));
 			JMP(returnDispatcher, true);
 			gpr.LoadRegs(false);
 			gpr.FlushRegs(c,false);
@@ -298,14 +293,7 @@ void DSPEmitter::Compile(u16 start_addr)
 				DSPJitRegCache c(gpr);
 				//don't update g_dsp.pc -- the branch insn already did
 				gpr.SaveRegs();
-				if (!DSPHost::OnThread() && DSPAnalyzer::code_flags[start_addr] & DSPAnalyzer::CODE_IDLE_SKIP)
-				{
-					MOV(16, R(EAX), Imm16(DSP_IDLE_SKIP_CYCLES));
-				}
-				else
-				{
-					MOV(16, R(EAX), Imm16(blockSize[start_addr]));
-				}
+				MOV(16, R(EAX), Imm16(blockSize[start_addr]));
 				JMP(returnDispatcher, true);
 				gpr.LoadRegs(false);
 				gpr.FlushRegs(c,false);
@@ -360,15 +348,11 @@ void DSPEmitter::Compile(u16 start_addr)
 		blockSize[start_addr] = 1;
 	}
 
+	for (u16* check : selfLinkCycleChecks)
+		*check += blockSize[start_addr];
+
 	gpr.SaveRegs();
-	if (!DSPHost::OnThread() && DSPAnalyzer::code_flags[start_addr] & DSPAnalyzer::CODE_IDLE_SKIP)
-	{
-		MOV(16, R(EAX), Imm16(DSP_IDLE_SKIP_CYCLES));
-	}
-	else
-	{
-		MOV(16, R(EAX), Imm16(blockSize[start_addr]));
-	}
+	MOV(16, R(EAX), Imm16(blockSize[start_addr]));
 	JMP(returnDispatcher, true);
 }
 
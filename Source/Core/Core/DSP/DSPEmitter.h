@@ -5,6 +5,7 @@
 #pragma once
 
 #include <list>
+#include <vector>
 
 #include "Common/x64ABI.h"
 #include "Common/x64Emitter.h"
@@ -246,13 +247,17 @@ public:
 	u16 compilePC;
 	u16 startAddr;
 	Block *blockLinks;
+	// Entry of the block being compiled, past the register loads.
+	Block blockLinkEntry;
+	// Cycle limits of the links back to blockLinkEntry; the size of the block
+	// is added to them once it is known.
+	std::vector<u16*> selfLinkCycleChecks;
 	u16 *blockSize;
 	std::list<u16> unresolvedJumps[MAX_BLOCKS];
 
 	DSPJitRegCache gpr;
 private:
 	DSPCompiledCode *blocks;
-	Block blockLinkEntry;
 	u16 compileSR;
 
 	// The index of the last stored ext value (compile time).
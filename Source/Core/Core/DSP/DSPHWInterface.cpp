@@ -315,6 +315,8 @@ static void gdsp_do_dma()
 	DEBUG_LOG(DSPLLE, "DMA pc: %04x, Control: %04x, Address: %08x, DSP Address: %04x, Size: %04x", g_dsp.pc, ctl, addr, dsp_addr, len);
 #endif
 
+	DSPHost::AcquireHostMemory();
+
 	const u8* copied_data_ptr = nullptr;
 	switch (ctl & 0x3)
 	{
@@ -17,6 +17,8 @@ namespace DSPHost
 {
 u8 ReadHostMemory(u32 addr);
 void WriteHostMemory(u8 value, u32 addr);
+// Called before the DSP DMAs to or from CPU memory.
+void AcquireHostMemory();
 void OSD_AddMessage(const std::string& str, u32 ms);
 bool OnThread();
 bool IsWiiHost();
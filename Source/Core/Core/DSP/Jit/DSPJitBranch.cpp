@@ -4,6 +4,7 @@
 
 #include "Core/DSP/DSPAnalyzer.h"
 #include "Core/DSP/DSPEmitter.h"
+#include "Core/DSP/DSPHost.h"
 #include "Core/DSP/DSPMemoryMap.h"
 #include "Core/DSP/DSPStacks.h"
 
@@ -77,43 +78,87 @@ static void WriteBranchExit(DSPEmitter& emitter)
 {
 	DSPJitRegCache c(emitter.gpr);
 	emitter.gpr.SaveRegs();
-	if (DSPAnalyzer::code_flags[emitter.startAddr] & DSPAnalyzer::CODE_IDLE_SKIP)
-	{
-		emitter.MOV(16, R(EAX), Imm16(0x1000));
-	}
-	else
-	{
-		emitter.MOV(16, R(EAX), Imm16(emitter.blockSize[emitter.startAddr]));
-	}
+	emitter.MOV(16, R(EAX), Imm16(emitter.blockSize[emitter.startAddr]));
+	emitter.JMP(emitter.returnDispatcher, true);
+	emitter.gpr.LoadRegs(false);
+	emitter.gpr.FlushRegs(c,false);
+}
+
+// Taking the backward branch of a mailbox polling loop (see DSPAnalyzer)
+// means the mailbox hasn't changed. Nothing can change it before the CPU
+// runs again, so the loop would spin for the rest of the slice anyway: give
+// up all remaining cycles at once. This doesn't hold on the DSP thread, where
+// the CPU can write the mailbox in the middle of a slice.
+static bool IsIdleLoopBranch(DSPEmitter& emitter, u16 dest)
+{
+	return !DSPHost::OnThread() &&
+	       (DSPAnalyzer::code_flags[emitter.startAddr] & DSPAnalyzer::CODE_IDLE_SKIP) &&
+	       dest >= emitter.startAddr && dest <= emitter.compilePC;
+}
+
+static void WriteIdleExit(DSPEmitter& emitter)
+{
+	DSPJitRegCache c(emitter.gpr);
+	emitter.gpr.SaveRegs();
+	emitter.MOVZX(32, 16, EAX, M(&cyclesLeft));
 	emitter.JMP(emitter.returnDispatcher, true);
 	emitter.gpr.LoadRegs(false);
 	emitter.gpr.FlushRegs(c,false);
 }
 
-static void WriteBlockLink(DSPEmitter& emitter, u16 dest)
+// If wait_for_dest is set and the destination hasn't been compiled yet, this
+// block is recompiled once it is. Conditional branches don't wait, since
+// loops spanning several blocks would then keep each other unresolved.
+static void WriteBlockLink(DSPEmitter& emitter, u16 dest, bool wait_for_dest)
 {
+	Block target;
+	u16 dest_size = 0;
+	const bool self_link = dest == emitter.startAddr;
+	if (self_link)
+	{
+		// Branch back to the start of this block, whose size isn't known yet.
+		target = emitter.blockLinkEntry;
+	}
+	else if (dest > emitter.startAddr && dest <= emitter.compilePC)
+	{
+		// No entry point in the middle of a block.
+		return;
+	}
+	else
+	{
+		target = emitter.blockLinks[dest];
+		dest_size = emitter.blockSize[dest];
+	}
+
 	// Jump directly to the called block if it has already been compiled.
-	if (!(dest >= emitter.startAddr && dest <= emitter.compilePC))
+	if (target != nullptr)
 	{
-		if (emitter.blockLinks[dest] != nullptr )
+		emitter.gpr.FlushRegs();
+		// Check if we have enough cycles to execute the next block
+		emitter.MOV(16, R(ECX), M(&cyclesLeft));
+		if (self_link)
 		{
-			emitter.gpr.FlushRegs();
-			// Check if we have enough cycles to execute the next block
-			emitter.MOV(16, R(ECX), M(&cyclesLeft));
-			emitter.CMP(16, R(ECX), Imm16(emitter.blockSize[emitter.startAddr] + emitter.blockSize[dest]));
-			FixupBranch notEnoughCycles = emitter.J_CC(CC_BE);
-
-			emitter.SUB(16, R(ECX), Imm16(emitter.blockSize[emitter.startAddr]));
-			emitter.MOV(16, M(&cyclesLeft), R(ECX));
-			emitter.JMP(emitter.blockLinks[dest], true);
-			emitter.SetJumpTarget(notEnoughCycles);
+			// A MOV keeps the full 16 bit immediate to patch.
+			emitter.MOV(16, R(EDX), Imm16(emitter.blockSize[emitter.startAddr]));
+			emitter.selfLinkCycleChecks.push_back((u16*)(emitter.GetWritableCodePtr() - 2));
+			emitter.CMP(16, R(ECX), R(EDX));
 		}
 		else
 		{
-			// The destination has not been compiled yet.  Add it to the list
-			// of blocks that this block is waiting on.
-			emitter.unresolvedJumps[emitter.startAddr].push_back(dest);
+			emitter.CMP(16, R(ECX), Imm16(emitter.blockSize[emitter.startAddr] + dest_size));
 		}
+		FixupBranch notEnoughCycles = emitter.J_CC(CC_BE);
+
+		emitter.SUB(16, R(ECX), Imm16(emitter.blockSize[emitter.startAddr]));
+		emitter.MOV(16, M(&cyclesLeft), R(ECX));
+		emitter.JMP(target, true);
+		emitter.SetJumpTarget(notEnoughCycles);
+	}
+	else if (wait_for_dest)
+	{
+		// The destination has not been compiled yet.  Add it to the list
+		// of blocks that this block is waiting on.
+		emitter.unresolvedJumps[emitter.startAddr].push_back(dest);
 	}
 }
 
@@ -122,9 +167,16 @@ static void r_jcc(const UDSPInstruction opc, DSPEmitter& emitter)
 	u16 dest = dsp_imem_read(emitter.compilePC + 1);
 	const DSPOPCTemplate *opcode = GetOpTemplate(opc);
 
-	// If the block is unconditional, attempt to link block
-	if (opcode->uncond_branch)
-		WriteBlockLink(emitter, dest);
+	if (IsIdleLoopBranch(emitter, dest))
+	{
+		emitter.MOV(16, M(&(g_dsp.pc)), Imm16(dest));
+		WriteIdleExit(emitter);
+		return;
+	}
+
+	// This code only runs if the branch is taken, so conditional branches
+	// can be linked too.
+	WriteBlockLink(emitter, dest, opcode->uncond_branch);
 	emitter.MOV(16, M(&(g_dsp.pc)), Imm16(dest));
 	WriteBranchExit(emitter);
 }
@@ -168,9 +220,7 @@ static void r_call(const UDSPInstruction opc, DSPEmitter& emitter)
 	u16 dest = dsp_imem_read(emitter.compilePC + 1);
 	const DSPOPCTemplate *opcode = GetOpTemplate(opc);
 
-	// If the block is unconditional, attempt to link block
-	if (opcode->uncond_branch)
-		WriteBlockLink(emitter, dest);
+	WriteBlockLink(emitter, dest, opcode->uncond_branch);
 	emitter.MOV(16, M(&(g_dsp.pc)), Imm16(dest));
 	WriteBranchExit(emitter);
 }
@@ -30,6 +30,10 @@ public:
 	virtual void DSP_Update(int cycles) = 0;
 	virtual void DSP_StopSoundStream() = 0;
 	virtual u32 DSP_UpdateRate() = 0;
+
+	// Waits until the DSP has caught up with the CPU. Called before the CPU
+	// touches state that a threaded DSP may be using, such as ARAM.
+	virtual void DSP_Sync() {}
 };
 
 DSPEmulator *CreateDSPEmulator(bool HLE);
@@ -6,8 +6,11 @@
 
 #include "Core/ConfigManager.h"
 #include "Core/Core.h"
+#include "Core/Movie.h"
+#include "Core/NetPlayProto.h"
 #include "Core/Debugger/Debugger_SymbolMap.h"
 #include "Core/HLE/HLE.h"
+#include "Core/HLE/HLE_Lib.h"
 #include "Core/HLE/HLE_Misc.h"
 #include "Core/HLE/HLE_OS.h"
 #include "Core/HW/Memmap.h"
@@ -59,6 +62,23 @@ static const SPatch OSPatches[] =
 	{ "___blank",             HLE_OS::HLE_GeneralDebugPrint,   HLE_HOOK_REPLACE, HLE_TYPE_DEBUG },
 	{ "__write_console",      HLE_OS::HLE_write_console,       HLE_HOOK_REPLACE, HLE_TYPE_DEBUG }, // used by sysmenu (+more?)
 	{ "GeckoCodehandler",     HLE_Misc::HLEGeckoCodehandler,   HLE_HOOK_START,   HLE_TYPE_GENERIC },
+
+	// Hot library routines
+	{ "memcpy",               HLE_Lib::HLE_memcpy,             HLE_HOOK_REPLACE, HLE_TYPE_LIBRARY },
+	{ "memset",               HLE_Lib::HLE_memset,             HLE_HOOK_REPLACE, HLE_TYPE_LIBRARY },
+	{ "DCFlushRange",         HLE_Lib::HLE_DCFlushRange,       HLE_HOOK_REPLACE, HLE_TYPE_LIBRARY },
+	{ "DCStoreRange",         HLE_Lib::HLE_DCStoreRange,       HLE_HOOK_REPLACE, HLE_TYPE_LIBRARY },
+	{ "ICInvalidateRange",    HLE_Lib::HLE_ICInvalidateRange,  HLE_HOOK_REPLACE, HLE_TYPE_LIBRARY },
+	{ "OSDisableInterrupts",  HLE_Lib::HLE_OSDisableInterrupts, HLE_HOOK_REPLACE, HLE_TYPE_LIBRARY },
+	{ "OSEnableInterrupts",   HLE_Lib::HLE_OSEnableInterrupts, HLE_HOOK_REPLACE, HLE_TYPE_LIBRARY },
+	{ "OSRestoreInterrupts",  HLE_Lib::HLE_OSRestoreInterrupts, HLE_HOOK_REPLACE, HLE_TYPE_LIBRARY },
+	{ "PSMTXIdentity",        HLE_Lib::HLE_PSMTXIdentity,      HLE_HOOK_REPLACE, HLE_TYPE_LIBRARY },
+	{ "PSMTXCopy",            HLE_Lib::HLE_PSMTXCopy,          HLE_HOOK_REPLACE, HLE_TYPE_LIBRARY },
+	{ "PSMTXTrans",           HLE_Lib::HLE_PSMTXTrans,         HLE_HOOK_REPLACE, HLE_TYPE_LIBRARY },
+	{ "PSMTXScale",           HLE_Lib::HLE_PSMTXScale,         HLE_HOOK_REPLACE, HLE_TYPE_LIBRARY },
+	{ "PSVECAdd",             HLE_Lib::HLE_PSVECAdd,           HLE_HOOK_REPLACE, HLE_TYPE_LIBRARY },
+	{ "PSVECSubtract",        HLE_Lib::HLE_PSVECSubtract,      HLE_HOOK_REPLACE, HLE_TYPE_LIBRARY },
+	{ "PSVECScale",           HLE_Lib::HLE_PSVECScale,         HLE_HOOK_REPLACE, HLE_TYPE_LIBRARY },
 };
 
 static const SPatch OSBreakPoints[] =
@@ -146,6 +166,15 @@ bool IsEnabled(int flags)
 	if (flags == HLE::HLE_TYPE_DEBUG && !SConfig::GetInstance().bEnableDebugging && PowerPC::GetMode() != MODE_INTERPRETER)
 		return false;
 
+	// The library replacements skip breakpoints inside the routines and don't
+	// raise DSIs halfway through like the originals would under the MMU. They
+	// also only charge an estimate of the cycles, so they stay off where the
+	// timing has to match other peers or the recording.
+	if (flags == HLE::HLE_TYPE_LIBRARY &&
+	    (SConfig::GetInstance().bEnableDebugging || SConfig::GetInstance().bMMU ||
+	     NetPlay::IsNetPlayRunning() || Movie::IsMovieActive()))
+		return false;
+
 	return true;
 }
 
@@ -22,6 +22,7 @@ namespace HLE
 	{
 		HLE_TYPE_GENERIC = 0,    // Miscellaneous function
 		HLE_TYPE_DEBUG   = 1,    // Debug output function
+		HLE_TYPE_LIBRARY = 2,    // Native replacement of an SDK library routine
 	};
 
 	void PatchFunctions();
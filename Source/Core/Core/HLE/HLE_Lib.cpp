@@ -0,0 +1,326 @@
+// Copyright 2016 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <cstring>
+
+#include "Common/CommonTypes.h"
+#include "Core/HLE/HLE_Lib.h"
+#include "Core/HW/Memmap.h"
+#include "Core/PowerPC/JitInterface.h"
+#include "Core/PowerPC/PowerPC.h"
+#include "Core/PowerPC/Interpreter/Interpreter_FPUtils.h"
+
+namespace HLE_Lib
+{
+
+// The JITs charge every retired instruction against the downcount; the
+// replacements charge what the guest loops would have retired instead.
+static void Charge(u32 cycles)
+{
+	PowerPC::ppcState.downcount -= cycles;
+}
+
+// Returns a host pointer to [address, address + size) if the whole range is
+// BAT-mapped RAM, or nullptr if it has to go through the regular accessors.
+static u8* GetRAMRange(u32 address, u32 size)
+{
+	if (!UReg_MSR(MSR).DR)
+		return nullptr;
+
+	const u32 segment = address >> 28;
+	const u64 end = static_cast<u64>(address & 0x0FFFFFFF) + size;
+
+	if ((segment == 0x8 || segment == 0xC) && end <= Memory::REALRAM_SIZE)
+		return Memory::m_pRAM + (address & 0x0FFFFFFF);
+	if (Memory::m_pEXRAM && (segment == 0x9 || segment == 0xD) && end <= Memory::EXRAM_SIZE)
+		return Memory::m_pEXRAM + (address & 0x0FFFFFFF);
+
+	return nullptr;
+}
+
+static u32 CacheLines(u32 address, u32 size)
+{
+	return ((address & 31) + size + 31) / 32;
+}
+
+static float ReadFloat(u32 address)
+{
+	const u32 bits = PowerPC::Read_U32(address);
+	float value;
+	std::memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+static void WriteFloat(float value, u32 address)
+{
+	u32 bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	PowerPC::Write_U32(bits, address);
+}
+
+// Stores the single-precision value of ps0 of an FPR argument, like stfs.
+static void WriteFloatArg(int reg, u32 address)
+{
+	PowerPC::Write_U32(ConvertToSingle(PowerPC::ppcState.ps[reg][0]), address);
+}
+
+// memcpy(dst, src, n). The SDK's version copies backwards when the
+// destination is above the source, so this is really a memmove.
+void HLE_memcpy()
+{
+	const u32 dst = GPR(3);
+	const u32 src = GPR(4);
+	const u32 size = GPR(5);
+
+	u8* host_dst = GetRAMRange(dst, size);
+	const u8* host_src = GetRAMRange(src, size);
+	if (host_dst && host_src)
+	{
+		std::memmove(host_dst, host_src, size);
+	}
+	else if (dst <= src)
+	{
+		for (u32 i = 0; i < size; ++i)
+			PowerPC::Write_U8(PowerPC::Read_U8(src + i), dst + i);
+	}
+	else
+	{
+		for (u32 i = size; i > 0; --i)
+			PowerPC::Write_U8(PowerPC::Read_U8(src + i - 1), dst + i - 1);
+	}
+
+	// Word-aligned copies go through an unrolled 32-byte loop, anything else
+	// is copied one byte at a time.
+	if (((dst ^ src) & 3) == 0)
+		Charge(20 + size / 2);
+	else
+		Charge(20 + size * 3);
+
+	NPC = LR;
+}
+
+// memset(dst, c, n)
+void HLE_memset()
+{
+	const u32 dst = GPR(3);
+	const u8 value = static_cast<u8>(GPR(4));
+	const u32 size = GPR(5);
+
+	u8* host_dst = GetRAMRange(dst, size);
+	if (host_dst)
+	{
+		std::memset(host_dst, value, size);
+	}
+	else
+	{
+		for (u32 i = 0; i < size; ++i)
+			PowerPC::Write_U8(value, dst + i);
+	}
+
+	Charge(20 + size / 2);
+	NPC = LR;
+}
+
+// DCFlushRange(addr, n): dcbf on every line, then sync.
+void HLE_DCFlushRange()
+{
+	const u32 address = GPR(3);
+	const u32 size = GPR(4);
+
+	if (size != 0)
+	{
+		const u32 lines = CacheLines(address, size);
+		JitInterface::InvalidateICache(address & ~0x1f, lines * 32, false);
+		Charge(8 + lines * 3);
+	}
+
+	NPC = LR;
+}
+
+// DCStoreRange(addr, n): dcbst on every line, then sync.
+void HLE_DCStoreRange()
+{
+	HLE_DCFlushRange();
+}
+
+// ICInvalidateRange(addr, n): icbi on every line, then sync and isync.
+void HLE_ICInvalidateRange()
+{
+	const u32 address = GPR(3);
+	const u32 size = GPR(4);
+
+	if (size != 0)
+	{
+		const u32 lines = CacheLines(address, size);
+		for (u32 i = 0; i < lines; ++i)
+			PowerPC::ppcState.iCache.Invalidate((address & ~0x1f) + i * 32);
+		Charge(9 + lines * 3);
+	}
+
+	NPC = LR;
+}
+
+// Returns the previous MSR.EE in r3.
+void HLE_OSDisableInterrupts()
+{
+	GPR(3) = (MSR >> 15) & 1;
+	MSR &= ~0x8000;
+
+	Charge(5);
+	NPC = LR;
+}
+
+void HLE_OSEnableInterrupts()
+{
+	GPR(3) = (MSR >> 15) & 1;
+	MSR |= 0x8000;
+
+	Charge(5);
+	NPC = LR;
+
+	// Like mtmsr, take anything that was held back right away.
+	PowerPC::CheckExternalExceptions();
+}
+
+// OSRestoreInterrupts(level): sets MSR.EE to level, returns the previous one.
+void HLE_OSRestoreInterrupts()
+{
+	const u32 level = GPR(3);
+	GPR(3) = (MSR >> 15) & 1;
+	if (level)
+		MSR |= 0x8000;
+	else
+		MSR &= ~0x8000;
+
+	Charge(7);
+	NPC = LR;
+
+	if (level)
+		PowerPC::CheckExternalExceptions();
+}
+
+// Matrices are 3x4 row-major arrays of floats. Only the routines whose
+// results do not depend on the order of the SDK's paired-single fused
+// multiply-adds are replaced, so the output is bit-identical.
+
+// PSMTXIdentity(m)
+void HLE_PSMTXIdentity()
+{
+	const u32 m = GPR(3);
+	for (u32 i = 0; i < 12; ++i)
+		WriteFloat((i % 5) == 0 ? 1.0f : 0.0f, m + i * 4);
+
+	Charge(16);
+	NPC = LR;
+}
+
+// PSMTXCopy(src, dst)
+void HLE_PSMTXCopy()
+{
+	const u32 src = GPR(3);
+	const u32 dst = GPR(4);
+
+	const u8* host_src = GetRAMRange(src, 48);
+	u8* host_dst = GetRAMRange(dst, 48);
+	if (host_src && host_dst)
+	{
+		std::memmove(host_dst, host_src, 48);
+	}
+	else
+	{
+		u32 words[12];
+		for (u32 i = 0; i < 12; ++i)
+			words[i] = PowerPC::Read_U32(src + i * 4);
+		for (u32 i = 0; i < 12; ++i)
+			PowerPC::Write_U32(words[i], dst + i * 4);
+	}
+
+	Charge(13);
+	NPC = LR;
+}
+
+// PSMTXTrans(m, x, y, z)
+void HLE_PSMTXTrans()
+{
+	const u32 m = GPR(3);
+	for (u32 i = 0; i < 12; ++i)
+	{
+		if ((i & 3) == 3)
+			WriteFloatArg(1 + i / 4, m + i * 4);
+		else
+			WriteFloat((i % 5) == 0 ? 1.0f : 0.0f, m + i * 4);
+	}
+
+	Charge(16);
+	NPC = LR;
+}
+
+// PSMTXScale(m, x, y, z)
+void HLE_PSMTXScale()
+{
+	const u32 m = GPR(3);
+	for (u32 i = 0; i < 12; ++i)
+	{
+		if ((i % 5) == 0)
+			WriteFloatArg(1 + i / 5, m + i * 4);
+		else
+			WriteFloat(0.0f, m + i * 4);
+	}
+
+	Charge(16);
+	NPC = LR;
+}
+
+// PSVECAdd(a, b, ab)
+void HLE_PSVECAdd()
+{
+	const u32 a = GPR(3);
+	const u32 b = GPR(4);
+	const u32 ab = GPR(5);
+
+	float result[3];
+	for (u32 i = 0; i < 3; ++i)
+		result[i] = ReadFloat(a + i * 4) + ReadFloat(b + i * 4);
+	for (u32 i = 0; i < 3; ++i)
+		WriteFloat(result[i], ab + i * 4);
+
+	Charge(9);
+	NPC = LR;
+}
+
+// PSVECSubtract(a, b, a_b)
+void HLE_PSVECSubtract()
+{
+	const u32 a = GPR(3);
+	const u32 b = GPR(4);
+	const u32 a_b = GPR(5);
+
+	float result[3];
+	for (u32 i = 0; i < 3; ++i)
+		result[i] = ReadFloat(a + i * 4) - ReadFloat(b + i * 4);
+	for (u32 i = 0; i < 3; ++i)
+		WriteFloat(result[i], a_b + i * 4);
+
+	Charge(9);
+	NPC = LR;
+}
+
+// PSVECScale(src, dst, scale)
+void HLE_PSVECScale()
+{
+	const u32 src = GPR(3);
+	const u32 dst = GPR(4);
+	const float scale = static_cast<float>(rPS0(1));
+
+	float result[3];
+	for (u32 i = 0; i < 3; ++i)
+		result[i] = ReadFloat(src + i * 4) * scale;
+	for (u32 i = 0; i < 3; ++i)
+		WriteFloat(result[i], dst + i * 4);
+
+	Charge(8);
+	NPC = LR;
+}
+
+}
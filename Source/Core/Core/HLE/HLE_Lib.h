@@ -0,0 +1,30 @@
+// Copyright 2016 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+// Native replacements for hot SDK library routines. Each one has the same
+// effect on guest state as the original and charges roughly the cycles the
+// original would have retired.
+namespace HLE_Lib
+{
+	void HLE_memcpy();
+	void HLE_memset();
+
+	void HLE_DCFlushRange();
+	void HLE_DCStoreRange();
+	void HLE_ICInvalidateRange();
+
+	void HLE_OSDisableInterrupts();
+	void HLE_OSEnableInterrupts();
+	void HLE_OSRestoreInterrupts();
+
+	void HLE_PSMTXIdentity();
+	void HLE_PSMTXCopy();
+	void HLE_PSMTXTrans();
+	void HLE_PSMTXScale();
+	void HLE_PSVECAdd();
+	void HLE_PSVECSubtract();
+	void HLE_PSVECScale();
+}
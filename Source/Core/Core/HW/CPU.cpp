@@ -53,6 +53,14 @@ void Run()
 			PowerPC::RunLoop();
 			break;
 
+		case PowerPC::CPU_SAFE_POINT:
+			//1: do what had to wait until the end of the timing slice
+			Core::SafePointOnCPUThread();
+
+			//2: go back to the runloop, unless someone paused or stopped us meanwhile
+			PowerPC::LeaveSafePoint();
+			break;
+
 		case PowerPC::CPU_STEPPING:
 			m_csCpuOccupied.unlock();
 
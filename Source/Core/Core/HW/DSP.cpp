@@ -542,6 +542,9 @@ void UpdateAudioDMA()
 
 static void Do_ARAM_DMA()
 {
+	// A threaded DSP may be reading ARAM through the accelerator.
+	dsp_emulator->DSP_Sync();
+
 	g_dspState.DMAState = 1;
 
 	// ARAM DMA transfer rate has been measured on real hw
@@ -2,13 +2,17 @@
 // Licensed under GPLv2+
 // Refer to the license.txt file included.
 
+#include <algorithm>
+
 #include "Common/CommonFuncs.h"
+#include "Common/CPUDetect.h"
 #include "Common/FileUtil.h"
 #include "Common/MathUtil.h"
 
 #include "Core/ConfigManager.h"
 #include "Core/HW/DSP.h"
 #include "Core/HW/DSPHLE/UCodes/AX.h"
+#include "Core/HW/DSPHLE/UCodes/VoiceWorkers.h"
 
 #define AX_GC
 #include "Core/HW/DSPHLE/UCodes/AXVoice.h"
@@ -16,6 +20,7 @@
 AXUCode::AXUCode(DSPHLE* dsphle, u32 crc)
 	: UCodeInterface(dsphle, crc)
 	, m_cmdlist_size(0)
+	, m_parallel_voices(SConfig::GetInstance().m_DSPHLEParallelVoices && cpu_info.num_cores > 1)
 {
 	WARN_LOG(DSPHLE, "Instantiating AXUCode: crc=%08x", crc);
 	m_mail_handler.PushMail(DSP_INIT);
@@ -381,49 +386,149 @@ void AXUCode::DownloadAndMixWithVolume(u32 addr, u16 vol_main, u16 vol_auxa, u16
 	}
 }
 
-void AXUCode::ProcessPBList(u32 pb_addr)
+void AXUCode::ProcessPB(AXPB& pb, int* const* buffer_ptrs)
 {
 	// Samples per millisecond. In theory DSP sampling rate can be changed from
 	// 32KHz to 48KHz, but AX always process at 32KHz.
 	const u32 spms = 32;
 
+	AXBuffers buffers;
+	std::copy(buffer_ptrs, buffer_ptrs + ArraySize(buffers.ptrs), buffers.ptrs);
+
+	u32 updates_addr = HILO_TO_32(pb.updates.data);
+	u16* updates = (u16*)HLEMemory_Get_Pointer(updates_addr);
+
+	for (int curr_ms = 0; curr_ms < 5; ++curr_ms)
+	{
+		ApplyUpdatesForMs(curr_ms, (u16*)&pb, pb.updates.num_updates, updates);
+
+		ProcessVoice(pb, buffers, spms, ConvertMixerControl(pb.mixer_control),
+		             m_coeffs_available ? m_coeffs : nullptr);
+
+		// Forward the buffers
+		for (size_t i = 0; i < ArraySize(buffers.ptrs); ++i)
+			buffers.ptrs[i] += spms;
+	}
+}
+
+void AXUCode::ProcessPBList(u32 pb_addr)
+{
+	if (m_parallel_voices && ProcessPBListParallel(pb_addr))
+		return;
+
+	int* const buffers[] = {
+		m_samples_left,
+		m_samples_right,
+		m_samples_surround,
+		m_samples_auxA_left,
+		m_samples_auxA_right,
+		m_samples_auxA_surround,
+		m_samples_auxB_left,
+		m_samples_auxB_right,
+		m_samples_auxB_surround
+	};
+
 	AXPB pb;
 
 	while (pb_addr)
 	{
-		AXBuffers buffers = {{
-			m_samples_left,
-			m_samples_right,
-			m_samples_surround,
-			m_samples_auxA_left,
-			m_samples_auxA_right,
-			m_samples_auxA_surround,
-			m_samples_auxB_left,
-			m_samples_auxB_right,
-			m_samples_auxB_surround
-		}};
+		if (!ReadPB(pb_addr, pb))
+			break;
+
+		ProcessPB(pb, buffers);
+
+		WritePB(pb_addr, pb);
+		pb_addr = HILO_TO_32(pb.next_pb);
+	}
+}
+
+bool AXUCode::ProcessPBListParallel(u32 pb_addr)
+{
+	// Longer chains are most likely looping back on themselves. Let the serial
+	// path deal with them the way it always did.
+	const size_t MAX_PARALLEL_VOICES = 1024;
+
+	int* const buffers[] = {
+		m_samples_left,
+		m_samples_right,
+		m_samples_surround,
+		m_samples_auxA_left,
+		m_samples_auxA_right,
+		m_samples_auxA_surround,
+		m_samples_auxB_left,
+		m_samples_auxB_right,
+		m_samples_auxB_surround
+	};
+	const size_t num_buffers = ArraySize(buffers);
+	const size_t buffer_size = ArraySize(m_samples_left);
 
+	// First read the whole chain. The next PB address can be changed by the
+	// updates, so apply those to a scratch copy to find it.
+	m_pbs.clear();
+	m_pb_addrs.clear();
+	AXPB pb;
+	while (pb_addr && m_pbs.size() <= MAX_PARALLEL_VOICES)
+	{
 		if (!ReadPB(pb_addr, pb))
 			break;
 
-		u32 updates_addr = HILO_TO_32(pb.updates.data);
-		u16* updates = (u16*)HLEMemory_Get_Pointer(updates_addr);
+		m_pbs.push_back(pb);
+		m_pb_addrs.push_back(pb_addr);
 
+		u16* updates = (u16*)HLEMemory_Get_Pointer(HILO_TO_32(pb.updates.data));
 		for (int curr_ms = 0; curr_ms < 5; ++curr_ms)
-		{
 			ApplyUpdatesForMs(curr_ms, (u16*)&pb, pb.updates.num_updates, updates);
+		pb_addr = HILO_TO_32(pb.next_pb);
+	}
+
+	if (m_pbs.size() > MAX_PARALLEL_VOICES)
+		return false;
 
-			ProcessVoice(pb, buffers, spms, ConvertMixerControl(pb.mixer_control),
-			             m_coeffs_available ? m_coeffs : nullptr);
+	// Voices are only independent if no two PBs overlap in memory. Otherwise
+	// the serial path, which writes each PB back before reading the next one,
+	// is the only correct order.
+	std::vector<u32> sorted_addrs = m_pb_addrs;
+	std::sort(sorted_addrs.begin(), sorted_addrs.end());
+	for (size_t i = 1; i < sorted_addrs.size(); ++i)
+	{
+		if (sorted_addrs[i] - sorted_addrs[i - 1] < sizeof(AXPB))
+			return false;
+	}
+
+	if (!m_voice_workers)
+	{
+		m_voice_workers = std::make_unique<VoiceWorkers>(std::min(cpu_info.num_cores - 1, 3));
+		m_worker_samples.resize((m_voice_workers->NumWorkers() - 1) * num_buffers * buffer_size);
+	}
+	std::fill(m_worker_samples.begin(), m_worker_samples.end(), 0);
 
-			// Forward the buffers
-			for (size_t i = 0; i < ArraySize(buffers.ptrs); ++i)
-				buffers.ptrs[i] += spms;
+	m_voice_workers->Run((u32)m_pbs.size(), [&](u32 worker, u32 item) {
+		if (worker == 0)
+		{
+			ProcessPB(m_pbs[item], buffers);
+			return;
 		}
 
-		WritePB(pb_addr, pb);
-		pb_addr = HILO_TO_32(pb.next_pb);
+		int* worker_buffers[num_buffers];
+		int* base = &m_worker_samples[(worker - 1) * num_buffers * buffer_size];
+		for (size_t i = 0; i < num_buffers; ++i)
+			worker_buffers[i] = base + i * buffer_size;
+		ProcessPB(m_pbs[item], worker_buffers);
+	});
+
+	// Deterministic reduction into the main buffers.
+	for (u32 worker = 1; worker < m_voice_workers->NumWorkers(); ++worker)
+	{
+		const int* base = &m_worker_samples[(worker - 1) * num_buffers * buffer_size];
+		for (size_t i = 0; i < num_buffers; ++i)
+			for (size_t j = 0; j < buffer_size; ++j)
+				buffers[i][j] += base[i * buffer_size + j];
 	}
+
+	for (size_t i = 0; i < m_pbs.size(); ++i)
+		WritePB(m_pb_addrs[i], m_pbs[i]);
+
+	return true;
 }
 
 void AXUCode::MixAUXSamples(int aux_id, u32 write_addr, u32 read_addr)
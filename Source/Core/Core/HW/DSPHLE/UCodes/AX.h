@@ -12,9 +12,14 @@
 
 #pragma once
 
+#include <memory>
+#include <vector>
+
 #include "Core/HW/DSPHLE/UCodes/AXStructs.h"
 #include "Core/HW/DSPHLE/UCodes/UCodes.h"
 
+class VoiceWorkers;
+
 // We can't directly use the mixer_control field from the PB because it does
 // not mean the same in all AX versions. The AX UCode converts the
 // mixer_control value to an AXMixControl bitfield.
@@ -111,6 +116,10 @@ protected:
 	void SetupProcessing(u32 init_addr);
 	void DownloadAndMixWithVolume(u32 addr, u16 vol_main, u16 vol_auxa, u16 vol_auxb);
 	void ProcessPBList(u32 pb_addr);
+	// Returns false without processing anything if the voices in the list
+	// can't be processed independently.
+	bool ProcessPBListParallel(u32 pb_addr);
+	void ProcessPB(AXPB& pb, int* const* buffers);
 	void MixAUXSamples(int aux_id, u32 write_addr, u32 read_addr);
 	void UploadLRS(u32 dst_addr);
 	void SetMainLR(u32 src_addr);
@@ -124,6 +133,16 @@ protected:
 	void DoAXState(PointerWrap& p);
 
 private:
+	// Parallel voice processing. Voices are mixed into per-worker buffers by
+	// helper threads, then summed into the main buffers in worker order. The
+	// mixing is done on integers, so the result is the same as processing
+	// voices one by one.
+	bool m_parallel_voices;
+	std::unique_ptr<VoiceWorkers> m_voice_workers;
+	std::vector<int> m_worker_samples;
+	std::vector<AXPB> m_pbs;
+	std::vector<u32> m_pb_addrs;
+
 	enum CmdType
 	{
 		CMD_SETUP                 = 0x00,
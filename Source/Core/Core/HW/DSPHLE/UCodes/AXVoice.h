@@ -12,7 +12,8 @@
 #error AXVoice.h included without specifying version
 #endif
 
-#include <functional>
+#include <algorithm>
+#include <cstring>
 
 #include "Common/CommonTypes.h"
 #include "Common/MathUtil.h"
@@ -20,6 +21,7 @@
 #include "Core/HW/Memmap.h"
 #include "Core/HW/DSPHLE/UCodes/AX.h"
 #include "Core/HW/DSPHLE/UCodes/AXStructs.h"
+#include "Core/HW/DSPHLE/UCodes/Mixing.h"
 
 #ifdef AX_GC
 # define PB_TYPE AXPB
@@ -127,91 +129,95 @@ void DumpPB(const PB_TYPE& pb)
 }
 #endif
 
-// Simulated accelerator state.
-static u32 acc_loop_addr, acc_end_addr;
-static u32* acc_cur_addr;
-static PB_TYPE* acc_pb;
-static bool acc_end_reached;
+// Simulated accelerator state. Kept per voice rather than global so that
+// several voices can be processed at the same time.
+struct AcceleratorState
+{
+	u32 loop_addr, end_addr;
+	u32* cur_addr;
+	PB_TYPE* pb;
+	bool end_reached;
+};
 
 // Sets up the simulated accelerator.
-void AcceleratorSetup(PB_TYPE* pb, u32* cur_addr)
+void AcceleratorSetup(AcceleratorState& acc, PB_TYPE* pb, u32* cur_addr)
 {
-	acc_pb = pb;
-	acc_loop_addr = HILO_TO_32(pb->audio_addr.loop_addr);
-	acc_end_addr = HILO_TO_32(pb->audio_addr.end_addr);
-	acc_cur_addr = cur_addr;
-	acc_end_reached = false;
+	acc.pb = pb;
+	acc.loop_addr = HILO_TO_32(pb->audio_addr.loop_addr);
+	acc.end_addr = HILO_TO_32(pb->audio_addr.end_addr);
+	acc.cur_addr = cur_addr;
+	acc.end_reached = false;
 }
 
 // Reads a sample from the simulated accelerator. Also handles looping and
 // disabling streams that reached the end (this is done by an exception raised
 // by the accelerator on real hardware).
-u16 AcceleratorGetSample()
+u16 AcceleratorGetSample(AcceleratorState& acc)
 {
 	u16 ret;
 	u8 step_size_bytes = 0;
 
-	// See below for explanations about acc_end_reached.
-	if (acc_end_reached)
+	// See below for explanations about end_reached.
+	if (acc.end_reached)
 		return 0;
 
-	switch (acc_pb->audio_addr.sample_format)
+	switch (acc.pb->audio_addr.sample_format)
 	{
 		case 0x00: // ADPCM
 		{
 			// ADPCM decoding, not much to explain here.
-			if ((*acc_cur_addr & 15) == 0)
+			if ((*acc.cur_addr & 15) == 0)
 			{
-				acc_pb->adpcm.pred_scale = DSP::ReadARAM((*acc_cur_addr & ~15) >> 1);
-				*acc_cur_addr += 2;
+				acc.pb->adpcm.pred_scale = DSP::ReadARAM((*acc.cur_addr & ~15) >> 1);
+				*acc.cur_addr += 2;
 			}
 
-			if ((acc_end_addr & 15) == 0)
+			if ((acc.end_addr & 15) == 0)
 				step_size_bytes = 1;
 			else
 				step_size_bytes = 2;
 
-			int scale = 1 << (acc_pb->adpcm.pred_scale & 0xF);
-			int coef_idx = (acc_pb->adpcm.pred_scale >> 4) & 0x7;
+			int scale = 1 << (acc.pb->adpcm.pred_scale & 0xF);
+			int coef_idx = (acc.pb->adpcm.pred_scale >> 4) & 0x7;
 
-			s32 coef1 = acc_pb->adpcm.coefs[coef_idx * 2 + 0];
-			s32 coef2 = acc_pb->adpcm.coefs[coef_idx * 2 + 1];
+			s32 coef1 = acc.pb->adpcm.coefs[coef_idx * 2 + 0];
+			s32 coef2 = acc.pb->adpcm.coefs[coef_idx * 2 + 1];
 
-			int temp = (*acc_cur_addr & 1) ?
-					(DSP::ReadARAM(*acc_cur_addr >> 1) & 0xF) :
-					(DSP::ReadARAM(*acc_cur_addr >> 1) >> 4);
+			int temp = (*acc.cur_addr & 1) ?
+					(DSP::ReadARAM(*acc.cur_addr >> 1) & 0xF) :
+					(DSP::ReadARAM(*acc.cur_addr >> 1) >> 4);
 
 			if (temp >= 8)
 				temp -= 16;
 
-			int val = (scale * temp) + ((0x400 + coef1 * acc_pb->adpcm.yn1 + coef2 * acc_pb->adpcm.yn2) >> 11);
+			int val = (scale * temp) + ((0x400 + coef1 * acc.pb->adpcm.yn1 + coef2 * acc.pb->adpcm.yn2) >> 11);
 			val = MathUtil::Clamp(val, -0x7FFF, 0x7FFF);
 
-			acc_pb->adpcm.yn2 = acc_pb->adpcm.yn1;
-			acc_pb->adpcm.yn1 = val;
-			*acc_cur_addr += 1;
+			acc.pb->adpcm.yn2 = acc.pb->adpcm.yn1;
+			acc.pb->adpcm.yn1 = val;
+			*acc.cur_addr += 1;
 			ret = val;
 			break;
 		}
 
 		case 0x0A: // 16-bit PCM audio
-			ret = (DSP::ReadARAM(*acc_cur_addr * 2) << 8) | DSP::ReadARAM(*acc_cur_addr * 2 + 1);
-			acc_pb->adpcm.yn2 = acc_pb->adpcm.yn1;
-			acc_pb->adpcm.yn1 = ret;
+			ret = (DSP::ReadARAM(*acc.cur_addr * 2) << 8) | DSP::ReadARAM(*acc.cur_addr * 2 + 1);
+			acc.pb->adpcm.yn2 = acc.pb->adpcm.yn1;
+			acc.pb->adpcm.yn1 = ret;
 			step_size_bytes = 2;
-			*acc_cur_addr += 1;
+			*acc.cur_addr += 1;
 			break;
 
 		case 0x19: // 8-bit PCM audio
-			ret = DSP::ReadARAM(*acc_cur_addr) << 8;
-			acc_pb->adpcm.yn2 = acc_pb->adpcm.yn1;
-			acc_pb->adpcm.yn1 = ret;
+			ret = DSP::ReadARAM(*acc.cur_addr) << 8;
+			acc.pb->adpcm.yn2 = acc.pb->adpcm.yn1;
+			acc.pb->adpcm.yn1 = ret;
 			step_size_bytes = 2;
-			*acc_cur_addr += 1;
+			*acc.cur_addr += 1;
 			break;
 
 		default:
-			ERROR_LOG(DSPHLE, "Unknown sample format: %d", acc_pb->audio_addr.sample_format);
+			ERROR_LOG(DSPHLE, "Unknown sample format: %d", acc.pb->audio_addr.sample_format);
 			return 0;
 	}
 
@@ -219,29 +225,29 @@ u16 AcceleratorGetSample()
 	//
 	// On real hardware, this would raise an interrupt that is handled by the
 	// UCode. We simulate what this interrupt does here.
-	if (*acc_cur_addr == (acc_end_addr + step_size_bytes - 1))
+	if (*acc.cur_addr == (acc.end_addr + step_size_bytes - 1))
 	{
 		// loop back to loop_addr.
-		*acc_cur_addr = acc_loop_addr;
+		*acc.cur_addr = acc.loop_addr;
 
-		if (acc_pb->audio_addr.looping)
+		if (acc.pb->audio_addr.looping)
 		{
 			// Set the ADPCM infos to continue processing at loop_addr.
 			//
 			// For some reason, yn1 and yn2 aren't set if the voice is not of
 			// stream type. This is what the AX UCode does and I don't really
 			// know why.
-			acc_pb->adpcm.pred_scale = acc_pb->adpcm_loop_info.pred_scale;
-			if (!acc_pb->is_stream)
+			acc.pb->adpcm.pred_scale = acc.pb->adpcm_loop_info.pred_scale;
+			if (!acc.pb->is_stream)
 			{
-				acc_pb->adpcm.yn1 = acc_pb->adpcm_loop_info.yn1;
-				acc_pb->adpcm.yn2 = acc_pb->adpcm_loop_info.yn2;
+				acc.pb->adpcm.yn1 = acc.pb->adpcm_loop_info.yn1;
+				acc.pb->adpcm.yn2 = acc.pb->adpcm_loop_info.yn2;
 			}
 		}
 		else
 		{
 			// Non looping voice reached the end -> running = 0.
-			acc_pb->running = 0;
+			acc.pb->running = 0;
 
 #ifdef AX_WII
 			// One of the few meaningful differences between AXGC and AXWii:
@@ -249,7 +255,7 @@ u16 AcceleratorGetSample()
 			// samples at the loop address, AXWii has the 0000 samples
 			// internally in DRAM and use an internal pointer to it (loop addr
 			// does not contain 0000 samples on AXWii!).
-			acc_end_reached = true;
+			acc.end_reached = true;
 #endif
 		}
 	}
@@ -257,9 +263,65 @@ u16 AcceleratorGetSample()
 	return ret;
 }
 
-// Reads samples from the input callback, resamples them to <count> samples at
+// Reads <count> samples from the simulated accelerator into a buffer.
+void AcceleratorGetSamples(AcceleratorState& acc, s16* out, u32 count)
+{
+	for (u32 i = 0; i < count; ++i)
+		out[i] = (s16)AcceleratorGetSample(acc);
+}
+
+// Input sources for ResampleAudio. They are called with a destination buffer
+// and a number of samples, and must write exactly that many samples.
+struct AcceleratorInput
+{
+	AcceleratorState* acc;
+
+	void operator()(s16* out, u32 count) const
+	{
+		AcceleratorGetSamples(*acc, out, count);
+	}
+};
+
+struct BufferInput
+{
+	const s16* src;
+
+	void operator()(s16* out, u32 count)
+	{
+		memcpy(out, src, count * sizeof (s16));
+		src += count;
+	}
+};
+
+// Maximum number of input samples pulled from the input source at once.
+static const u32 RESAMPLE_BLOCK_SIZE = 256;
+
+// 4-tap polyphase filter over in[offset] .. in[offset + 3], using one of the
+// 128 coefficient phases selected by the fractional position.
+void InterpolatePolyphase(const s16* in, const u32* offsets, const u16* fracs, s16* output, u32 count,
+                          const s16* coeffs)
+{
+	for (u32 i = 0; i < count; ++i)
+	{
+		const s16* t = in + offsets[i];
+		const s16* c = &coeffs[(fracs[i] >> 9) << 2];
+
+		s64 samp = ((s64)t[0] * c[0] + (s64)t[1] * c[1] + (s64)t[2] * c[2] + (s64)t[3] * c[3]) >> 15;
+
+		// Some phases of the DROM filters have a gain above 1. Without the clamp
+		// loud input wraps around and produces the glitches which kept this path
+		// disabled in the past.
+		output[i] = (s16)MathUtil::Clamp<s64>(samp, -32767, 32767);
+	}
+}
+
+// Reads samples from an input source, resamples them to <count> samples at
 // the wanted sample rate (computed from the ratio, see below).
 //
+// The input source is a functor taking (s16* out, u32 count). It is pulled in
+// blocks, which lets the compiler inline it instead of going through an
+// indirect call per sample.
+//
 // If srctype is SRCTYPE_POLYPHASE, coefficients need to be provided as well
 // (or the srctype will automatically be changed to LINEAR).
 //
@@ -277,119 +339,89 @@ u16 AcceleratorGetSample()
 // We start getting samples not from sample 0, but 0.<curr_pos_frac>. This
 // avoids discontinuities in the audio stream, especially with very low ratios
 // which interpolate a lot of values between two "real" samples.
-u32 ResampleAudio(std::function<s16(u32)> input_callback, s16* output, u32 count,
+template <typename InputSource>
+u32 ResampleAudio(InputSource&& input, s16* output, u32 count,
                   s16* last_samples, u32 curr_pos, u32 ratio, int srctype,
                   const s16* coeffs)
 {
-	int read_samples_count = 0;
-
-	// TODO(delroth): find out why the polyphase resampling algorithm causes
-	// audio glitches in Wii games with non integral ratios.
-
-	// If DSP DROM coefficients are available, support polyphase resampling.
-	if (0) // if (coeffs && srctype == SRCTYPE_POLYPHASE)
+	if (srctype != SRCTYPE_LINEAR && srctype != SRCTYPE_POLYPHASE) // SRCTYPE_NEAREST
 	{
-		s16 temp[4];
-		u32 idx = 0;
-
-		temp[idx++ & 3] = last_samples[0];
-		temp[idx++ & 3] = last_samples[1];
-		temp[idx++ & 3] = last_samples[2];
-		temp[idx++ & 3] = last_samples[3];
-
-		for (u32 i = 0; i < count; ++i)
-		{
-			curr_pos += ratio;
-			while (curr_pos >= 0x10000)
-			{
-				temp[idx++ & 3] = input_callback(read_samples_count++);
-				curr_pos -= 0x10000;
-			}
-
-			u16 curr_pos_frac = ((curr_pos & 0xFFFF) >> 9) << 2;
-			const s16* c = &coeffs[curr_pos_frac];
+		// No sample rate conversion here: simply read samples from the
+		// input to the output buffer.
+		input(output, count);
+		memcpy(last_samples, output + count - 4, 4 * sizeof (u16));
+		return curr_pos;
+	}
 
-			s64 t0 = temp[idx++ & 3];
-			s64 t1 = temp[idx++ & 3];
-			s64 t2 = temp[idx++ & 3];
-			s64 t3 = temp[idx++ & 3];
+	const bool polyphase = coeffs && srctype == SRCTYPE_POLYPHASE;
 
-			s64 samp = (t0 * c[0] + t1 * c[1] + t2 * c[2] + t3 * c[3]) >> 15;
+	// in[0..3] holds the four most recent samples (initialized from the PB,
+	// oldest first) and the new input block is appended right after them.
+	// After consuming n new samples, the four most recent ones are
+	// in[n..n+3]; the linear path interpolates between the two oldest of
+	// these, the polyphase path filters all four.
+	s16 in[4 + RESAMPLE_BLOCK_SIZE];
+	memcpy(in, last_samples, 4 * sizeof (s16));
 
-			output[i] = (s16)samp;
-		}
+	u32 offsets[MAX_SAMPLES_PER_FRAME];
+	u16 fracs[MAX_SAMPLES_PER_FRAME];
 
-		last_samples[3] = temp[--idx & 3];
-		last_samples[2] = temp[--idx & 3];
-		last_samples[1] = temp[--idx & 3];
-		last_samples[0] = temp[--idx & 3];
-	}
-	else if (srctype == SRCTYPE_LINEAR || srctype == SRCTYPE_POLYPHASE)
+	curr_pos &= 0xFFFF;
+	for (u32 done = 0; done < count;)
 	{
-		// This is the circular buffer containing samples to use for the
-		// interpolation. It is initialized with the values from the PB, and it
-		// will be stored back to the PB at the end.
-		s16 temp[4];
-		u32 idx = 0;
-
-		temp[idx++ & 3] = last_samples[0];
-		temp[idx++ & 3] = last_samples[1];
-		temp[idx++ & 3] = last_samples[2];
-		temp[idx++ & 3] = last_samples[3];
-
-		for (u32 i = 0; i < count; ++i)
+		// Produce as many output samples as the input block allows.
+		u32 out_count = std::min<u32>(count - done, MAX_SAMPLES_PER_FRAME);
+		if (ratio != 0)
 		{
-			curr_pos += ratio;
+			u64 max_pos = ((u64)(RESAMPLE_BLOCK_SIZE + 1) << 16) - 1 - curr_pos;
+			out_count = (u32)std::min<u64>(out_count, max_pos / ratio);
+		}
 
-			// While our current position is >= 1.0, push new samples to the
-			// circular buffer.
-			while (curr_pos >= 0x10000)
+		u32 consumed = 0;
+		if (out_count == 0)
+		{
+			// A single step needs more than a full block of input. Only the
+			// last four samples matter, so stream the rest through the buffer.
+			u64 pos = (u64)curr_pos + ratio;
+			u64 remaining = pos >> 16;
+			curr_pos = (u32)(pos & 0xFFFF);
+			while (remaining > 0)
 			{
-				temp[idx++ & 3] = input_callback(read_samples_count++);
-				curr_pos -= 0x10000;
+				u32 n = (u32)std::min<u64>(remaining, RESAMPLE_BLOCK_SIZE);
+				input(in + 4, n);
+				memmove(in, in + n, 4 * sizeof (s16));
+				remaining -= n;
 			}
-
-			// Get our current fractional position, used to know how much of
-			// curr0 and how much of curr1 the output sample should be.
-			u16 curr_frac = curr_pos & 0xFFFF;
-			u16 inv_curr_frac = -curr_frac;
-
-			// Interpolate! If curr_frac is 0, we can simply take the last
-			// sample without any multiplying.
-			s16 sample;
-			if (curr_frac)
+			offsets[0] = 0;
+			fracs[0] = (u16)curr_pos;
+			out_count = 1;
+		}
+		else
+		{
+			for (u32 i = 0; i < out_count; ++i)
 			{
-				s32 s0 = temp[idx++ & 3];
-				s32 s1 = temp[idx++ & 3];
+				curr_pos += ratio;
+				consumed += curr_pos >> 16;
+				curr_pos &= 0xFFFF;
 
-				sample = ((s0 * inv_curr_frac) + (s1 * curr_frac)) >> 16;
-				idx += 2;
+				offsets[i] = consumed;
+				fracs[i] = (u16)curr_pos;
 			}
-			else
-			{
-				sample = temp[idx++ & 3];
-				idx += 3;
-			}
-
-			output[i] = sample;
+			input(in + 4, consumed);
 		}
 
-		// Update the four last_samples values.
-		last_samples[3] = temp[--idx & 3];
-		last_samples[2] = temp[--idx & 3];
-		last_samples[1] = temp[--idx & 3];
-		last_samples[0] = temp[--idx & 3];
-	}
-	else // SRCTYPE_NEAREST
-	{
-		// No sample rate conversion here: simply read samples from the
-		// accelerator to the output buffer.
-		for (u32 i = 0; i < count; ++i)
-			output[i] = input_callback(i);
+		if (polyphase)
+			InterpolatePolyphase(in, offsets, fracs, output + done, out_count, coeffs);
+		else
+			Mixing::InterpolateLinear(in, offsets, fracs, output + done, out_count);
 
-		memcpy(last_samples, output + count - 4, 4 * sizeof (u16));
+		memmove(in, in + consumed, 4 * sizeof (s16));
+		done += out_count;
 	}
 
+	// Update the four last_samples values.
+	memcpy(last_samples, in, 4 * sizeof (s16));
+
 	return curr_pos;
 }
 
@@ -398,11 +430,12 @@ u32 ResampleAudio(std::function<s16(u32)> input_callback, s16* output, u32 count
 void GetInputSamples(PB_TYPE& pb, s16* samples, u16 count, const s16* coeffs)
 {
 	u32 cur_addr = HILO_TO_32(pb.audio_addr.cur_addr);
-	AcceleratorSetup(&pb, &cur_addr);
+	AcceleratorState acc;
+	AcceleratorSetup(acc, &pb, &cur_addr);
 
 	if (coeffs)
 		coeffs += pb.coef_select * 0x200;
-	u32 curr_pos = ResampleAudio([](u32) { return AcceleratorGetSample(); },
+	u32 curr_pos = ResampleAudio(AcceleratorInput{ &acc },
 	                             samples, count, pb.src.last_samples,
 	                             pb.src.cur_addr_frac, HILO_TO_32(pb.src.ratio),
 	                             pb.src_type, coeffs);
@@ -413,30 +446,12 @@ void GetInputSamples(PB_TYPE& pb, s16* samples, u16 count, const s16* coeffs)
 	pb.audio_addr.cur_addr_lo = (u16)(cur_addr & 0xFFFF);
 }
 
-// Add samples to an output buffer, with optional volume ramping.
-void MixAdd(int* out, const s16* input, u32 count, u16* pvol, s16* dpop, bool ramp)
+// Describes an output buffer that samples should be added to, with optional
+// volume ramping. If volume ramping is disabled, volume_delta is set to 0 so
+// the mixing loop does not need to test for it at each step.
+Mixing::AXDestination MixDest(int* out, u16* pvol, s16* dpop, bool ramp)
 {
-	u16& volume = pvol[0];
-	u16 volume_delta = pvol[1];
-
-	// If volume ramping is disabled, set volume_delta to 0. That way, the
-	// mixing loop can avoid testing if volume ramping is enabled at each step,
-	// and just add volume_delta.
-	if (!ramp)
-		volume_delta = 0;
-
-	for (u32 i = 0; i < count; ++i)
-	{
-		s64 sample = input[i];
-		sample *= volume;
-		sample >>= 15;
-		sample = MathUtil::Clamp((s32)sample, -32767, 32767);	// -32768 ?
-
-		out[i] += (s16)sample;
-		volume += volume_delta;
-
-		*dpop = (s16)sample;
-	}
+	return { out, &pvol[0], ramp ? pvol[1] : (u16)0, dpop };
 }
 
 // Execute a low pass filter on the samples using one history value. Returns
@@ -481,36 +496,42 @@ void ProcessVoice(PB_TYPE& pb, const AXBuffers& buffers, u16 count, AXMixControl
 #define MIX_ON(C) (0 != (mctrl & MIX_##C))
 #define RAMP_ON(C) (0 != (mctrl & MIX_##C##_RAMP))
 
+	Mixing::AXDestination dests[12];
+	u32 num_dests = 0;
+
 	if (MIX_ON(L))
-		MixAdd(buffers.left, samples, count, &pb.mixer.left, &pb.dpop.left, RAMP_ON(L));
+		dests[num_dests++] = MixDest(buffers.left, &pb.mixer.left, &pb.dpop.left, RAMP_ON(L));
 	if (MIX_ON(R))
-		MixAdd(buffers.right, samples, count, &pb.mixer.right, &pb.dpop.right, RAMP_ON(R));
+		dests[num_dests++] = MixDest(buffers.right, &pb.mixer.right, &pb.dpop.right, RAMP_ON(R));
 	if (MIX_ON(S))
-		MixAdd(buffers.surround, samples, count, &pb.mixer.surround, &pb.dpop.surround, RAMP_ON(S));
+		dests[num_dests++] = MixDest(buffers.surround, &pb.mixer.surround, &pb.dpop.surround, RAMP_ON(S));
 
 	if (MIX_ON(AUXA_L))
-		MixAdd(buffers.auxA_left, samples, count, &pb.mixer.auxA_left, &pb.dpop.auxA_left, RAMP_ON(AUXA_L));
+		dests[num_dests++] = MixDest(buffers.auxA_left, &pb.mixer.auxA_left, &pb.dpop.auxA_left, RAMP_ON(AUXA_L));
 	if (MIX_ON(AUXA_R))
-		MixAdd(buffers.auxA_right, samples, count, &pb.mixer.auxA_right, &pb.dpop.auxA_right, RAMP_ON(AUXA_R));
+		dests[num_dests++] = MixDest(buffers.auxA_right, &pb.mixer.auxA_right, &pb.dpop.auxA_right, RAMP_ON(AUXA_R));
 	if (MIX_ON(AUXA_S))
-		MixAdd(buffers.auxA_surround, samples, count, &pb.mixer.auxA_surround, &pb.dpop.auxA_surround, RAMP_ON(AUXA_S));
+		dests[num_dests++] = MixDest(buffers.auxA_surround, &pb.mixer.auxA_surround, &pb.dpop.auxA_surround, RAMP_ON(AUXA_S));
 
 	if (MIX_ON(AUXB_L))
-		MixAdd(buffers.auxB_left, samples, count, &pb.mixer.auxB_left, &pb.dpop.auxB_left, RAMP_ON(AUXB_L));
+		dests[num_dests++] = MixDest(buffers.auxB_left, &pb.mixer.auxB_left, &pb.dpop.auxB_left, RAMP_ON(AUXB_L));
 	if (MIX_ON(AUXB_R))
-		MixAdd(buffers.auxB_right, samples, count, &pb.mixer.auxB_right, &pb.dpop.auxB_right, RAMP_ON(AUXB_R));
+		dests[num_dests++] = MixDest(buffers.auxB_right, &pb.mixer.auxB_right, &pb.dpop.auxB_right, RAMP_ON(AUXB_R));
 	if (MIX_ON(AUXB_S))
-		MixAdd(buffers.auxB_surround, samples, count, &pb.mixer.auxB_surround, &pb.dpop.auxB_surround, RAMP_ON(AUXB_S));
+		dests[num_dests++] = MixDest(buffers.auxB_surround, &pb.mixer.auxB_surround, &pb.dpop.auxB_surround, RAMP_ON(AUXB_S));
 
 #ifdef AX_WII
 	if (MIX_ON(AUXC_L))
-		MixAdd(buffers.auxC_left, samples, count, &pb.mixer.auxC_left, &pb.dpop.auxC_left, RAMP_ON(AUXC_L));
+		dests[num_dests++] = MixDest(buffers.auxC_left, &pb.mixer.auxC_left, &pb.dpop.auxC_left, RAMP_ON(AUXC_L));
 	if (MIX_ON(AUXC_R))
-		MixAdd(buffers.auxC_right, samples, count, &pb.mixer.auxC_right, &pb.dpop.auxC_right, RAMP_ON(AUXC_R));
+		dests[num_dests++] = MixDest(buffers.auxC_right, &pb.mixer.auxC_right, &pb.dpop.auxC_right, RAMP_ON(AUXC_R));
 	if (MIX_ON(AUXC_S))
-		MixAdd(buffers.auxC_surround, samples, count, &pb.mixer.auxC_surround, &pb.dpop.auxC_surround, RAMP_ON(AUXC_S));
+		dests[num_dests++] = MixDest(buffers.auxC_surround, &pb.mixer.auxC_surround, &pb.dpop.auxC_surround, RAMP_ON(AUXC_S));
 #endif
 
+	// Mix the voice into all enabled buffers in a single pass over the samples.
+	Mixing::AXMixAddMulti(samples, count, dests, num_dests);
+
 #undef MIX_ON
 #undef RAMP_ON
 
@@ -532,32 +553,40 @@ void ProcessVoice(PB_TYPE& pb, const AXBuffers& buffers, u16 count, AXMixControl
 
 		// We use ratio 0x55555 == (5 * 65536 + 21845) / 65536 == 5.3333 which
 		// is the nearest we can get to 96/18
-		u32 curr_pos = ResampleAudio([&samples](u32 i) { return samples[i]; },
+		//
+		// The speaker path has always been linear; the DROM filters were never
+		// checked against its 5.33 ratio, so keep it that way.
+		u32 curr_pos = ResampleAudio(BufferInput{ samples },
 		                             wm_samples, wm_count, pb.remote_src.last_samples,
 		                             pb.remote_src.cur_addr_frac, 0x55555,
-		                             SRCTYPE_POLYPHASE, coeffs);
+		                             SRCTYPE_LINEAR, nullptr);
 		pb.remote_src.cur_addr_frac = curr_pos & 0xFFFF;
 
 		// Mix to main[0-3] and aux[0-3]
 #define WMCHAN_MIX_ON(n) (0 != ((pb.remote_mixer_control >> (2 * n)) & 3))
 #define WMCHAN_MIX_RAMP(n) (0 != ((pb.remote_mixer_control >> (2 * n)) & 2))
 
+		Mixing::AXDestination wm_dests[8];
+		u32 num_wm_dests = 0;
+
 		if (WMCHAN_MIX_ON(0))
-			MixAdd(buffers.wm_main0, wm_samples, wm_count, &pb.remote_mixer.main0, &pb.remote_dpop.main0, WMCHAN_MIX_RAMP(0));
+			wm_dests[num_wm_dests++] = MixDest(buffers.wm_main0, &pb.remote_mixer.main0, &pb.remote_dpop.main0, WMCHAN_MIX_RAMP(0));
 		if (WMCHAN_MIX_ON(1))
-			MixAdd(buffers.wm_aux0, wm_samples, wm_count, &pb.remote_mixer.aux0, &pb.remote_dpop.aux0, WMCHAN_MIX_RAMP(1));
+			wm_dests[num_wm_dests++] = MixDest(buffers.wm_aux0, &pb.remote_mixer.aux0, &pb.remote_dpop.aux0, WMCHAN_MIX_RAMP(1));
 		if (WMCHAN_MIX_ON(2))
-			MixAdd(buffers.wm_main1, wm_samples, wm_count, &pb.remote_mixer.main1, &pb.remote_dpop.main1, WMCHAN_MIX_RAMP(2));
+			wm_dests[num_wm_dests++] = MixDest(buffers.wm_main1, &pb.remote_mixer.main1, &pb.remote_dpop.main1, WMCHAN_MIX_RAMP(2));
 		if (WMCHAN_MIX_ON(3))
-			MixAdd(buffers.wm_aux1, wm_samples, wm_count, &pb.remote_mixer.aux1, &pb.remote_dpop.aux1, WMCHAN_MIX_RAMP(3));
+			wm_dests[num_wm_dests++] = MixDest(buffers.wm_aux1, &pb.remote_mixer.aux1, &pb.remote_dpop.aux1, WMCHAN_MIX_RAMP(3));
 		if (WMCHAN_MIX_ON(4))
-			MixAdd(buffers.wm_main2, wm_samples, wm_count, &pb.remote_mixer.main2, &pb.remote_dpop.main2, WMCHAN_MIX_RAMP(4));
+			wm_dests[num_wm_dests++] = MixDest(buffers.wm_main2, &pb.remote_mixer.main2, &pb.remote_dpop.main2, WMCHAN_MIX_RAMP(4));
 		if (WMCHAN_MIX_ON(5))
-			MixAdd(buffers.wm_aux2, wm_samples, wm_count, &pb.remote_mixer.aux2, &pb.remote_dpop.aux2, WMCHAN_MIX_RAMP(5));
+			wm_dests[num_wm_dests++] = MixDest(buffers.wm_aux2, &pb.remote_mixer.aux2, &pb.remote_dpop.aux2, WMCHAN_MIX_RAMP(5));
 		if (WMCHAN_MIX_ON(6))
-			MixAdd(buffers.wm_main3, wm_samples, wm_count, &pb.remote_mixer.main3, &pb.remote_dpop.main3, WMCHAN_MIX_RAMP(6));
+			wm_dests[num_wm_dests++] = MixDest(buffers.wm_main3, &pb.remote_mixer.main3, &pb.remote_dpop.main3, WMCHAN_MIX_RAMP(6));
 		if (WMCHAN_MIX_ON(7))
-			MixAdd(buffers.wm_aux3, wm_samples, wm_count, &pb.remote_mixer.aux3, &pb.remote_dpop.aux3, WMCHAN_MIX_RAMP(7));
+			wm_dests[num_wm_dests++] = MixDest(buffers.wm_aux3, &pb.remote_mixer.aux3, &pb.remote_dpop.aux3, WMCHAN_MIX_RAMP(7));
+
+		Mixing::AXMixAddMulti(wm_samples, wm_count, wm_dests, num_wm_dests);
 	}
 #undef WMCHAN_MIX_RAMP
 #undef WMCHAN_MIX_ON
@@ -0,0 +1,309 @@
+// Copyright 2016 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include "Common/CommonTypes.h"
+#include "Common/CPUDetect.h"
+#include "Common/Intrinsics.h"
+#include "Common/MathUtil.h"
+#include "Core/HW/DSPHLE/UCodes/Mixing.h"
+
+#ifdef HAVE_SIMD_MIXING
+// GCC and Clang only emit SSE4.1 instructions in functions that are marked as
+// targeting it, since the rest of the build only assumes SSE2. MSVC accepts
+// them anywhere.
+#if defined(__GNUC__)
+#define SSE41_TARGET __attribute__((target("sse4.1")))
+#else
+#define SSE41_TARGET
+#endif
+#endif
+
+namespace Mixing
+{
+
+// All the SIMD loops below process this many samples per iteration.
+static const u32 BLOCK = 8;
+
+static void AXMixAddScalar(const s16* input, u32 begin, u32 end, const AXDestination& dest)
+{
+	u16& volume = *dest.volume;
+	for (u32 i = begin; i < end; ++i)
+	{
+		s64 sample = input[i];
+		sample *= volume;
+		sample >>= 15;
+		sample = MathUtil::Clamp((s32)sample, -32767, 32767);	// -32768 ?
+
+		dest.out[i] += (s16)sample;
+		volume += dest.volume_delta;
+
+		*dest.dpop = (s16)sample;
+	}
+}
+
+#ifdef HAVE_SIMD_MIXING
+// Mixes samples [i, i + 8) into one destination. The ramp is computed for
+// all lanes at once: lane n gets volume + n * delta (mod 2^16).
+SSE41_TARGET static inline void AXMixAddBlockSSE4(const __m128i& samples_lo, const __m128i& samples_hi, u32 i,
+                                     const AXDestination& dest)
+{
+	static const __m128i lane_index = _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7);
+	const __m128i min = _mm_set1_epi32(-32767);
+	const __m128i max = _mm_set1_epi32(32767);
+
+	u16& volume = *dest.volume;
+	__m128i volumes = _mm_add_epi16(_mm_set1_epi16((s16)volume),
+	                                _mm_mullo_epi16(lane_index, _mm_set1_epi16((s16)dest.volume_delta)));
+
+	__m128i lo = _mm_mullo_epi32(samples_lo, _mm_cvtepu16_epi32(volumes));
+	__m128i hi = _mm_mullo_epi32(samples_hi, _mm_cvtepu16_epi32(_mm_srli_si128(volumes, 8)));
+	lo = _mm_min_epi32(_mm_max_epi32(_mm_srai_epi32(lo, 15), min), max);
+	hi = _mm_min_epi32(_mm_max_epi32(_mm_srai_epi32(hi, 15), min), max);
+
+	__m128i* out = (__m128i*)(dest.out + i);
+	_mm_storeu_si128(out, _mm_add_epi32(_mm_loadu_si128(out), lo));
+	_mm_storeu_si128(out + 1, _mm_add_epi32(_mm_loadu_si128(out + 1), hi));
+
+	volume += BLOCK * dest.volume_delta;
+	*dest.dpop = (s16)_mm_extract_epi32(hi, 3);
+}
+#endif
+
+bool HasSIMD()
+{
+#ifdef HAVE_SIMD_MIXING
+	return cpu_info.bSSE4_1;
+#else
+	return false;
+#endif
+}
+
+void AXMixAdd(const s16* input, u32 count, const AXDestination& dest)
+{
+	AXMixAddMulti(input, count, &dest, 1);
+}
+
+void AXMixAddMulti(const s16* input, u32 count, const AXDestination* dests, u32 num_dests)
+{
+#ifdef HAVE_SIMD_MIXING
+	if (HasSIMD())
+	{
+		SIMD::AXMixAddMulti(input, count, dests, num_dests);
+		return;
+	}
+#endif
+
+	for (u32 d = 0; d < num_dests; ++d)
+		AXMixAddScalar(input, 0, count, dests[d]);
+}
+
+static s32 ZeldaAddWithVolumeRampScalar(s16* dst, const s16* src, size_t begin, size_t count,
+                                        s32 vol, s32 step)
+{
+	for (size_t i = begin; i < count; ++i)
+	{
+		dst[i] += ((vol >> 16) * src[i]) >> 16;
+		vol += step;
+	}
+
+	return vol;
+}
+
+s32 ZeldaAddWithVolumeRamp(s16* dst, const s16* src, size_t count, s32 vol, s32 step)
+{
+	if (!vol && !step)
+		return vol;
+
+#ifdef HAVE_SIMD_MIXING
+	if (HasSIMD())
+		return SIMD::ZeldaAddWithVolumeRamp(dst, src, count, vol, step);
+#endif
+
+	return ZeldaAddWithVolumeRampScalar(dst, src, 0, count, vol, step);
+}
+
+static void ZeldaAddWithVolumeScalar(s16* dst, const s16* src, size_t begin, size_t count, u16 vol)
+{
+	for (size_t i = begin; i < count; ++i)
+	{
+		s32 vol_src = ((s32)src[i] * (s32)vol) >> 15;
+		dst[i] += MathUtil::Clamp(vol_src, -0x8000, 0x7FFF);
+	}
+}
+
+void ZeldaAddWithVolume(s16* dst, const s16* src, size_t count, u16 vol)
+{
+#ifdef HAVE_SIMD_MIXING
+	if (HasSIMD())
+	{
+		SIMD::ZeldaAddWithVolume(dst, src, count, vol);
+		return;
+	}
+#endif
+
+	ZeldaAddWithVolumeScalar(dst, src, 0, count, vol);
+}
+
+static void ZeldaApplyVolumeScalar(s16* buf, size_t begin, size_t count, u16 vol, int shift)
+{
+	for (size_t i = begin; i < count; ++i)
+	{
+		s32 tmp = (u32)buf[i] * (u32)vol;
+		tmp >>= shift;
+		buf[i] = (s16)MathUtil::Clamp(tmp, -0x8000, 0x7FFF);
+	}
+}
+
+void ZeldaApplyVolume(s16* buf, size_t count, u16 vol, int shift)
+{
+#ifdef HAVE_SIMD_MIXING
+	if (HasSIMD())
+	{
+		SIMD::ZeldaApplyVolume(buf, count, vol, shift);
+		return;
+	}
+#endif
+
+	ZeldaApplyVolumeScalar(buf, 0, count, vol, shift);
+}
+
+static void InterpolateLinearScalar(const s16* in, const u32* offsets, const u16* fracs, s16* output,
+                                    u32 begin, u32 count)
+{
+	for (u32 i = begin; i < count; ++i)
+	{
+		s32 s0 = in[offsets[i]];
+		s32 s1 = in[offsets[i] + 1];
+		s32 frac = fracs[i];
+		output[i] = (s16)((s0 * (0x10000 - frac) + s1 * frac) >> 16);
+	}
+}
+
+void InterpolateLinear(const s16* in, const u32* offsets, const u16* fracs, s16* output, u32 count)
+{
+#ifdef HAVE_SIMD_MIXING
+	if (HasSIMD())
+	{
+		SIMD::InterpolateLinear(in, offsets, fracs, output, count);
+		return;
+	}
+#endif
+
+	InterpolateLinearScalar(in, offsets, fracs, output, 0, count);
+}
+
+#ifdef HAVE_SIMD_MIXING
+namespace SIMD
+{
+
+SSE41_TARGET void AXMixAddMulti(const s16* input, u32 count, const AXDestination* dests, u32 num_dests)
+{
+	u32 i = 0;
+	for (; i + BLOCK <= count; i += BLOCK)
+	{
+		__m128i samples = _mm_loadu_si128((const __m128i*)(input + i));
+		__m128i samples_lo = _mm_cvtepi16_epi32(samples);
+		__m128i samples_hi = _mm_cvtepi16_epi32(_mm_srli_si128(samples, 8));
+
+		for (u32 d = 0; d < num_dests; ++d)
+			AXMixAddBlockSSE4(samples_lo, samples_hi, i, dests[d]);
+	}
+
+	if (i < count)
+	{
+		for (u32 d = 0; d < num_dests; ++d)
+			AXMixAddScalar(input, i, count, dests[d]);
+	}
+}
+
+s32 ZeldaAddWithVolumeRamp(s16* dst, const s16* src, size_t count, s32 vol, s32 step)
+{
+	if (!vol && !step)
+		return vol;
+
+	size_t i = 0;
+
+	// Lane n uses vol + n * step; only the upper 16 bits of the volume are
+	// used, and (a * b) >> 16 is exactly what pmulhw computes.
+	const __m128i lane_steps_lo = _mm_setr_epi32(0, step, 2 * step, 3 * step);
+	const __m128i lane_steps_hi = _mm_add_epi32(lane_steps_lo, _mm_set1_epi32(4 * step));
+	for (; i + BLOCK <= count; i += BLOCK)
+	{
+		__m128i vol_lo = _mm_add_epi32(_mm_set1_epi32(vol), lane_steps_lo);
+		__m128i vol_hi = _mm_add_epi32(_mm_set1_epi32(vol), lane_steps_hi);
+		__m128i volumes = _mm_packs_epi32(_mm_srai_epi32(vol_lo, 16), _mm_srai_epi32(vol_hi, 16));
+
+		__m128i samples = _mm_loadu_si128((const __m128i*)(src + i));
+		__m128i* out = (__m128i*)(dst + i);
+		_mm_storeu_si128(out, _mm_add_epi16(_mm_loadu_si128(out), _mm_mulhi_epi16(volumes, samples)));
+
+		vol += BLOCK * step;
+	}
+
+	return ZeldaAddWithVolumeRampScalar(dst, src, i, count, vol, step);
+}
+
+SSE41_TARGET void ZeldaAddWithVolume(s16* dst, const s16* src, size_t count, u16 vol)
+{
+	// The volume can exceed 0x7FFF, so the products need 32-bit lanes.
+	// packs saturates to [-0x8000, 0x7FFF], which is the clamp we need.
+	const __m128i volume = _mm_set1_epi32(vol);
+	size_t i = 0;
+	for (; i + BLOCK <= count; i += BLOCK)
+	{
+		__m128i samples = _mm_loadu_si128((const __m128i*)(src + i));
+		__m128i lo = _mm_mullo_epi32(_mm_cvtepi16_epi32(samples), volume);
+		__m128i hi = _mm_mullo_epi32(_mm_cvtepi16_epi32(_mm_srli_si128(samples, 8)), volume);
+		__m128i scaled = _mm_packs_epi32(_mm_srai_epi32(lo, 15), _mm_srai_epi32(hi, 15));
+
+		__m128i* out = (__m128i*)(dst + i);
+		_mm_storeu_si128(out, _mm_add_epi16(_mm_loadu_si128(out), scaled));
+	}
+
+	ZeldaAddWithVolumeScalar(dst, src, i, count, vol);
+}
+
+SSE41_TARGET void ZeldaApplyVolume(s16* buf, size_t count, u16 vol, int shift)
+{
+	const __m128i volume = _mm_set1_epi32(vol);
+	const __m128i shift_count = _mm_cvtsi32_si128(shift);
+	size_t i = 0;
+	for (; i + BLOCK <= count; i += BLOCK)
+	{
+		__m128i* ptr = (__m128i*)(buf + i);
+		__m128i samples = _mm_loadu_si128(ptr);
+		__m128i lo = _mm_mullo_epi32(_mm_cvtepi16_epi32(samples), volume);
+		__m128i hi = _mm_mullo_epi32(_mm_cvtepi16_epi32(_mm_srli_si128(samples, 8)), volume);
+		_mm_storeu_si128(ptr, _mm_packs_epi32(_mm_sra_epi32(lo, shift_count), _mm_sra_epi32(hi, shift_count)));
+	}
+
+	ZeldaApplyVolumeScalar(buf, i, count, vol, shift);
+}
+
+SSE41_TARGET void InterpolateLinear(const s16* in, const u32* offsets, const u16* fracs, s16* output, u32 count)
+{
+	// Four samples per iteration: the offsets are arbitrary, so the inputs are
+	// gathered one by one, but the multiplies and the narrowing are shared.
+	const __m128i one = _mm_set1_epi32(0x10000);
+	u32 i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		const u32* o = offsets + i;
+		__m128i s0 = _mm_setr_epi32(in[o[0]], in[o[1]], in[o[2]], in[o[3]]);
+		__m128i s1 = _mm_setr_epi32(in[o[0] + 1], in[o[1] + 1], in[o[2] + 1], in[o[3] + 1]);
+		__m128i frac = _mm_setr_epi32(fracs[i], fracs[i + 1], fracs[i + 2], fracs[i + 3]);
+		__m128i inv_frac = _mm_sub_epi32(one, frac);
+
+		__m128i sample = _mm_add_epi32(_mm_mullo_epi32(s0, inv_frac), _mm_mullo_epi32(s1, frac));
+		sample = _mm_srai_epi32(sample, 16);
+		_mm_storel_epi64((__m128i*)(output + i), _mm_packs_epi32(sample, sample));
+	}
+
+	InterpolateLinearScalar(in, offsets, fracs, output, i, count);
+}
+
+}  // namespace SIMD
+#endif
+
+}  // namespace Mixing
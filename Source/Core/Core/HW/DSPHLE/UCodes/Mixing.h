@@ -0,0 +1,70 @@
+// Copyright 2016 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+// Sample mixing kernels shared by the HLE audio UCodes. Each function has an
+// SSE4.1 path, picked at runtime, and a scalar fallback that produce
+// bit-identical results, so the HLE output does not depend on the host CPU.
+
+#pragma once
+
+#include <cstddef>
+
+#include "Common/CommonTypes.h"
+
+#if defined(_M_X86) && !defined(_M_GENERIC)
+#define HAVE_SIMD_MIXING 1
+#endif
+
+namespace Mixing
+{
+
+// AX mixing destination: one of the main/aux buffers together with the
+// volume state from the PB.
+struct AXDestination
+{
+	int* out;
+	u16* volume;      // Current volume (1.15), updated in place.
+	u16 volume_delta; // Per-sample ramp step, 0 when ramping is disabled.
+	s16* dpop;        // Receives the last mixed sample.
+};
+
+// out[i] += clamp((input[i] * volume) >> 15), with volume += delta per sample.
+void AXMixAdd(const s16* input, u32 count, const AXDestination& dest);
+
+// Same as AXMixAdd, but mixes each block of input samples into all of the
+// destinations before moving on to the next block.
+void AXMixAddMulti(const s16* input, u32 count, const AXDestination* dests, u32 num_dests);
+
+// dst[i] += ((vol >> 16) * src[i]) >> 16, with vol += step per sample.
+// Returns the final volume (1.31).
+s32 ZeldaAddWithVolumeRamp(s16* dst, const s16* src, size_t count, s32 vol, s32 step);
+
+// dst[i] += clamp((src[i] * vol) >> 15). Volume is in 1.15 format.
+void ZeldaAddWithVolume(s16* dst, const s16* src, size_t count, u16 vol);
+
+// buf[i] = clamp((buf[i] * vol) >> shift).
+void ZeldaApplyVolume(s16* buf, size_t count, u16 vol, int shift);
+
+// Linear interpolation between in[offsets[i]] and in[offsets[i] + 1], with
+// fracs[i] as the 0.16 position between them. A fraction of 0 returns the
+// first sample unchanged.
+void InterpolateLinear(const s16* in, const u32* offsets, const u16* fracs, s16* output, u32 count);
+
+// Returns true if the functions above use the SIMD kernels on this host.
+bool HasSIMD();
+
+#ifdef HAVE_SIMD_MIXING
+// The SIMD kernels behind the functions above, exposed so that tests can
+// check them directly. Only call them when HasSIMD() is true.
+namespace SIMD
+{
+void AXMixAddMulti(const s16* input, u32 count, const AXDestination* dests, u32 num_dests);
+s32 ZeldaAddWithVolumeRamp(s16* dst, const s16* src, size_t count, s32 vol, s32 step);
+void ZeldaAddWithVolume(s16* dst, const s16* src, size_t count, u16 vol);
+void ZeldaApplyVolume(s16* buf, size_t count, u16 vol, int shift);
+void InterpolateLinear(const s16* in, const u32* offsets, const u16* fracs, s16* output, u32 count);
+}
+#endif
+
+}  // namespace Mixing
@@ -0,0 +1,83 @@
+// Copyright 2016 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include "Common/Thread.h"
+#include "Core/HW/DSPHLE/UCodes/VoiceWorkers.h"
+
+VoiceWorkers::VoiceWorkers(u32 num_threads)
+	: m_next_item(0)
+{
+	for (u32 i = 0; i < num_threads; ++i)
+		m_threads.emplace_back(&VoiceWorkers::ThreadLoop, this, i + 1);
+}
+
+VoiceWorkers::~VoiceWorkers()
+{
+	{
+		std::lock_guard<std::mutex> lk(m_mutex);
+		m_quit = true;
+	}
+	m_work_cv.notify_all();
+
+	for (std::thread& thread : m_threads)
+		thread.join();
+}
+
+void VoiceWorkers::Run(u32 num_items, const Job& job)
+{
+	if (m_threads.empty() || num_items <= 1)
+	{
+		for (u32 i = 0; i < num_items; ++i)
+			job(0, i);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lk(m_mutex);
+		m_job = &job;
+		m_num_items = num_items;
+		m_next_item.store(0);
+		m_pending_threads = (u32)m_threads.size();
+		++m_generation;
+	}
+	m_work_cv.notify_all();
+
+	ProcessItems(0);
+
+	// The job object lives on the caller's stack, so wait for every helper
+	// thread to be done with it, not just for the items to be claimed.
+	std::unique_lock<std::mutex> lk(m_mutex);
+	m_done_cv.wait(lk, [&] { return m_pending_threads == 0; });
+	m_job = nullptr;
+}
+
+void VoiceWorkers::ProcessItems(u32 worker)
+{
+	u32 item;
+	while ((item = m_next_item.fetch_add(1)) < m_num_items)
+		(*m_job)(worker, item);
+}
+
+void VoiceWorkers::ThreadLoop(u32 worker)
+{
+	Common::SetCurrentThreadName("DSPHLE voice worker");
+
+	u32 seen_generation = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lk(m_mutex);
+			m_work_cv.wait(lk, [&] { return m_quit || m_generation != seen_generation; });
+			if (m_quit)
+				return;
+			seen_generation = m_generation;
+		}
+
+		ProcessItems(worker);
+
+		std::lock_guard<std::mutex> lk(m_mutex);
+		if (--m_pending_threads == 0)
+			m_done_cv.notify_one();
+	}
+}
@@ -0,0 +1,52 @@
+// Copyright 2016 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+// Small pool of persistent threads used by the HLE audio UCodes to process
+// independent voices concurrently. The thread calling Run() takes part in the
+// work as worker 0, and Run() only returns once every item has been handled.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Common/NonCopyable.h"
+
+class VoiceWorkers : NonCopyable
+{
+public:
+	// Called once per item with the index of the worker running it, in
+	// [0, NumWorkers()), and the index of the item.
+	typedef std::function<void(u32 worker, u32 item)> Job;
+
+	// Spawns num_threads helper threads in addition to the calling thread.
+	explicit VoiceWorkers(u32 num_threads);
+	~VoiceWorkers();
+
+	u32 NumWorkers() const { return (u32)m_threads.size() + 1; }
+
+	void Run(u32 num_items, const Job& job);
+
+private:
+	void ThreadLoop(u32 worker);
+	void ProcessItems(u32 worker);
+
+	std::vector<std::thread> m_threads;
+
+	std::mutex m_mutex;
+	std::condition_variable m_work_cv;
+	std::condition_variable m_done_cv;
+	u32 m_generation = 0;
+	u32 m_pending_threads = 0;
+	bool m_quit = false;
+
+	const Job* m_job = nullptr;
+	u32 m_num_items = 0;
+	std::atomic<u32> m_next_item;
+};
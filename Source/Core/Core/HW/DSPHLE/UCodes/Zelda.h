@@ -6,6 +6,7 @@
 
 #include "Common/CommonTypes.h"
 #include "Common/MathUtil.h"
+#include "Core/HW/DSPHLE/UCodes/Mixing.h"
 #include "Core/HW/DSPHLE/UCodes/UCodes.h"
 
 class ZeldaAudioRenderer
@@ -42,13 +43,7 @@ private:
 	template <size_t N, size_t B>
 	void ApplyVolumeInPlace(std::array<s16, N>* buf, u16 vol)
 	{
-		for (size_t i = 0; i < N; ++i)
-		{
-			s32 tmp = (u32)(*buf)[i] * (u32)vol;
-			tmp >>= 16 - B;
-
-			(*buf)[i] = (s16)MathUtil::Clamp(tmp, -0x8000, 0x7FFF);
-		}
+		Mixing::ZeldaApplyVolume(buf->data(), N, vol, 16 - B);
 	}
 	template <size_t N>
 	void ApplyVolumeInPlace_1_15(std::array<s16, N>* buf, u16 vol)
@@ -71,27 +66,14 @@ private:
 	                             const std::array<s16, N>& src,
 	                             s32 vol, s32 step)
 	{
-		if (!vol && !step)
-			return vol;
-
-		for (size_t i = 0; i < N; ++i)
-		{
-			(*dst)[i] += ((vol >> 16) * src[i]) >> 16;
-			vol += step;
-		}
-
-		return vol;
+		return Mixing::ZeldaAddWithVolumeRamp(dst->data(), src.data(), N, vol, step);
 	}
 
 	// Does not use std::array because it needs to be able to process partial
 	// buffers. Volume is in 1.15 format.
 	void AddBuffersWithVolume(s16* dst, const s16* src, size_t count, u16 vol)
 	{
-		while (count--)
-		{
-			s32 vol_src = ((s32)*src++ * (s32)vol) >> 15;
-			*dst++ += MathUtil::Clamp(vol_src, -0x8000, 0x7FFF);
-		}
+		Mixing::ZeldaAddWithVolume(dst, src, count, vol);
 	}
 
 	// Whether the frame needs to be prepared or not.
@@ -11,6 +11,7 @@
 #include "Core/DSP/DSPCore.h"
 #include "Core/DSP/DSPHost.h"
 #include "Core/HW/DSP.h"
+#include "Core/HW/DSPLLE/DSPLLE.h"
 #include "Core/HW/DSPLLE/DSPLLETools.h"
 #include "Core/HW/DSPLLE/DSPSymbols.h"
 #include "Core/PowerPC/PowerPC.h"
@@ -26,14 +27,25 @@ namespace DSPHost
 
 u8 ReadHostMemory(u32 addr)
 {
+	// On the Wii the accelerator reads from memory the CPU writes directly.
+	// GameCube ARAM is only modified by ARAM DMA, which syncs with the DSP.
+	if (SConfig::GetInstance().bWii)
+		DSPLLE::AcquireHostMemory();
 	return DSP::ReadARAM(addr);
 }
 
 void WriteHostMemory(u8 value, u32 addr)
 {
+	if (SConfig::GetInstance().bWii)
+		DSPLLE::AcquireHostMemory();
 	DSP::WriteARAM(value, addr);
 }
 
+void AcquireHostMemory()
+{
+	DSPLLE::AcquireHostMemory();
+}
+
 void OSD_AddMessage(const std::string& str, u32 ms)
 {
 	OSD::AddMessage(str, ms);
@@ -51,6 +63,9 @@ bool IsWiiHost()
 
 void InterruptRequest()
 {
+	if (DSPLLE::DeferInterruptRequest())
+		return;
+
 	// Fire an interrupt on the PPC ASAP.
 	DSP::GenerateDSPInterruptFromDSPEmu(DSP::INT_DSP);
 }
@@ -2,6 +2,7 @@
 // Licensed under GPLv2+
 // Refer to the license.txt file included.
 
+#include <condition_variable>
 #include <mutex>
 #include <thread>
 
@@ -28,6 +29,7 @@
 #include "Core/DSP/DSPInterpreter.h"
 #include "Core/DSP/DSPTables.h"
 #include "Core/HW/AudioInterface.h"
+#include "Core/HW/DSP.h"
 #include "Core/HW/Memmap.h"
 
 #include "Core/HW/DSPLLE/DSPLLE.h"
@@ -48,6 +50,29 @@ static Common::Event dspEvent;
 static Common::Event ppcEvent;
 static bool requestDisableThread;
 
+// Lockstep threading is used instead of the free-running DSP thread whenever
+// the emulation has to be deterministic (netplay, movies). It is deterministic,
+// but not cycle-identical to running the DSP on the CPU thread, so netplay and
+// movies record which of the two they use. DSP_Update hands
+// the DSP thread exactly one quantum and returns; the CPU only waits for that
+// quantum at its next interaction with the DSP (mailboxes, control register,
+// ARAM DMA, the next DSP_Update). DMA to main RAM and interrupts raised by the
+// quantum are deferred to that sync point, so they happen at a time that only
+// depends on emulated CPU execution, not on host thread scheduling.
+static bool s_lockstep;
+static std::mutex s_lockstep_mutex;
+static std::condition_variable s_lockstep_cv;
+static int s_lockstep_cycles;       // Quantum being run by the DSP thread, 0 when idle
+static bool s_lockstep_quit;
+static bool s_lockstep_host_waiting; // The CPU is parked in DSP_Sync
+static bool s_lockstep_interrupt;    // Interrupt raised during the current quantum
+static bool s_lockstep_memory_held;  // Only touched by the DSP thread
+
+static bool WantsLockstep()
+{
+	return NetPlay::IsNetPlayRunning() || Movie::IsMovieActive() || Core::g_want_determinism;
+}
+
 void DSPLLE::DoState(PointerWrap &p)
 {
 	bool is_hle = false;
@@ -86,6 +111,7 @@ void DSPLLE::DoState(PointerWrap &p)
 	p.Do(cyclesLeft);
 	p.Do(init_hax);
 	p.Do(m_cycle_count);
+	p.Do(s_lockstep_interrupt);
 }
 
 // Regular thread
@@ -117,6 +143,52 @@ void DSPLLE::DSPThread(DSPLLE* dsp_lle)
 	}
 }
 
+// Lockstep thread
+void DSPLLE::DSPLockstepThread(DSPLLE* dsp_lle)
+{
+	Common::SetCurrentThreadName("DSP thread");
+
+	std::unique_lock<std::mutex> lk(s_lockstep_mutex);
+	while (true)
+	{
+		s_lockstep_cv.wait(lk, [] { return s_lockstep_cycles != 0 || s_lockstep_quit; });
+		if (s_lockstep_quit)
+			break;
+
+		const int cycles = s_lockstep_cycles;
+		lk.unlock();
+		{
+			std::lock_guard<std::mutex> dsp_thread_lock(dsp_lle->m_csDSPThreadActive);
+			DSPCore_RunCycles(cycles);
+		}
+		s_lockstep_memory_held = false;
+		lk.lock();
+
+		s_lockstep_cycles = 0;
+		s_lockstep_cv.notify_all();
+	}
+}
+
+void DSPLLE::AcquireHostMemory()
+{
+	if (!s_lockstep || s_lockstep_memory_held || Core::IsCPUThread())
+		return;
+
+	std::unique_lock<std::mutex> lk(s_lockstep_mutex);
+	s_lockstep_cv.wait(lk, [] { return s_lockstep_host_waiting || s_lockstep_quit; });
+	s_lockstep_memory_held = true;
+}
+
+bool DSPLLE::DeferInterruptRequest()
+{
+	if (!s_lockstep || Core::IsCPUThread())
+		return false;
+
+	std::lock_guard<std::mutex> lk(s_lockstep_mutex);
+	s_lockstep_interrupt = true;
+	return true;
+}
+
 static bool LoadDSPRom(u16* rom, const std::string& filename, u32 size_in_bytes)
 {
 	std::string bytes;
@@ -175,13 +247,11 @@ bool DSPLLE::Initialize(bool bWii, bool bDSPThread)
 		return false;
 
 	// needs to be after DSPCore_Init for the dspjit ptr
-	if (NetPlay::IsNetPlayRunning() || Movie::IsMovieActive() ||
-	    Core::g_want_determinism    || !dspjit)
-	{
+	if (!dspjit)
 		bDSPThread = false;
-	}
 	m_bWii = bWii;
 	m_bDSPThread = bDSPThread;
+	s_lockstep_interrupt = false;
 
 	// DSPLLE directly accesses the fastmem arena.
 	// TODO: The fastmem arena is only supposed to be used by the JIT:
@@ -192,18 +262,47 @@ bool DSPLLE::Initialize(bool bWii, bool bDSPThread)
 	InitInstructionTable();
 
 	if (bDSPThread)
+		StartDSPThread(WantsLockstep());
+
+	Host_RefreshDSPDebuggerWindow();
+	return true;
+}
+
+void DSPLLE::StartDSPThread(bool lockstep)
+{
+	s_lockstep = lockstep;
+	if (lockstep)
+	{
+		s_lockstep_cycles = 0;
+		s_lockstep_quit = false;
+		s_lockstep_host_waiting = false;
+		s_lockstep_memory_held = false;
+		m_hDSPThread = std::thread(DSPLockstepThread, this);
+	}
+	else
 	{
 		m_bIsRunning.Set(true);
 		m_hDSPThread = std::thread(DSPThread, this);
 	}
-
-	Host_RefreshDSPDebuggerWindow();
-	return true;
 }
 
 void DSPLLE::DSP_StopSoundStream()
 {
-	if (m_bDSPThread)
+	if (!m_bDSPThread)
+		return;
+
+	if (s_lockstep)
+	{
+		DSP_Sync();
+		{
+			std::lock_guard<std::mutex> lk(s_lockstep_mutex);
+			s_lockstep_quit = true;
+		}
+		s_lockstep_cv.notify_all();
+		m_hDSPThread.join();
+		s_lockstep = false;
+	}
+	else
 	{
 		m_bIsRunning.Clear();
 		ppcEvent.Set();
@@ -212,6 +311,34 @@ void DSPLLE::DSP_StopSoundStream()
 	}
 }
 
+void DSPLLE::DSP_Sync()
+{
+	if (!s_lockstep)
+		return;
+
+	bool interrupt;
+	{
+		std::unique_lock<std::mutex> lk(s_lockstep_mutex);
+		if (s_lockstep_cycles != 0)
+		{
+			s_lockstep_host_waiting = true;
+			s_lockstep_cv.notify_all();
+			s_lockstep_cv.wait(lk, [] { return s_lockstep_cycles == 0; });
+			s_lockstep_host_waiting = false;
+		}
+
+		// Pausing syncs from the host thread; the interrupt then stays pending
+		// until the CPU itself gets here, so that its timing is reproducible.
+		if (!Core::IsCPUThread())
+			return;
+		interrupt = s_lockstep_interrupt;
+		s_lockstep_interrupt = false;
+	}
+
+	if (interrupt)
+		DSP::GenerateDSPInterruptFromDSPEmu(DSP::INT_DSP);
+}
+
 void DSPLLE::Shutdown()
 {
 	DSPCore_Shutdown();
@@ -219,11 +346,13 @@ void DSPLLE::Shutdown()
 
 u16 DSPLLE::DSP_WriteControlRegister(u16 _uFlag)
 {
+	DSP_Sync();
 	DSPInterpreter::WriteCR(_uFlag);
 
 	if (_uFlag & 2)
 	{
-		if (!m_bDSPThread)
+		// In lockstep mode the DSP thread is idle after DSP_Sync.
+		if (!m_bDSPThread || s_lockstep)
 		{
 			DSPCore_CheckExternalInterrupt();
 			DSPCore_CheckExceptions();
@@ -244,21 +373,25 @@ u16 DSPLLE::DSP_WriteControlRegister(u16 _uFlag)
 
 u16 DSPLLE::DSP_ReadControlRegister()
 {
+	DSP_Sync();
 	return DSPInterpreter::ReadCR();
 }
 
 u16 DSPLLE::DSP_ReadMailBoxHigh(bool _CPUMailbox)
 {
+	DSP_Sync();
 	return gdsp_mbox_read_h(_CPUMailbox ? MAILBOX_CPU : MAILBOX_DSP);
 }
 
 u16 DSPLLE::DSP_ReadMailBoxLow(bool _CPUMailbox)
 {
+	DSP_Sync();
 	return gdsp_mbox_read_l(_CPUMailbox ? MAILBOX_CPU : MAILBOX_DSP);
 }
 
 void DSPLLE::DSP_WriteMailBoxHigh(bool _CPUMailbox, u16 _uHighMail)
 {
+	DSP_Sync();
 	if (_CPUMailbox)
 	{
 		if (gdsp_mbox_peek(MAILBOX_CPU) & 0x80000000)
@@ -283,6 +416,7 @@ void DSPLLE::DSP_WriteMailBoxHigh(bool _CPUMailbox, u16 _uHighMail)
 
 void DSPLLE::DSP_WriteMailBoxLow(bool _CPUMailbox, u16 _uLowMail)
 {
+	DSP_Sync();
 	if (_CPUMailbox)
 	{
 		gdsp_mbox_write_l(MAILBOX_CPU, _uLowMail);
@@ -319,13 +453,19 @@ void DSPLLE::DSP_Update(int cycles)
 */
 	if (m_bDSPThread)
 	{
-		if (requestDisableThread || NetPlay::IsNetPlayRunning() || Movie::IsMovieActive() || Core::g_want_determinism)
+		if (requestDisableThread)
 		{
 			DSP_StopSoundStream();
 			m_bDSPThread = false;
 			requestDisableThread = false;
 			SConfig::GetInstance().bDSPThread = false;
 		}
+		else if (s_lockstep != WantsLockstep())
+		{
+			// A movie or netplay session started or ended: switch threading modes.
+			DSP_StopSoundStream();
+			StartDSPThread(WantsLockstep());
+		}
 	}
 
 	// If we're not on a thread, run cycles here.
@@ -334,6 +474,15 @@ void DSPLLE::DSP_Update(int cycles)
 		// ~1/6th as many cycles as the period PPC-side.
 		DSPCore_RunCycles(dsp_cycles);
 	}
+	else if (s_lockstep)
+	{
+		DSP_Sync();
+		{
+			std::lock_guard<std::mutex> lk(s_lockstep_mutex);
+			s_lockstep_cycles = dsp_cycles;
+		}
+		s_lockstep_cv.notify_all();
+	}
 	else
 	{
 		// Wait for DSP thread to complete its cycle. Note: this logic should be thought through.
@@ -351,7 +500,10 @@ u32 DSPLLE::DSP_UpdateRate()
 void DSPLLE::PauseAndLock(bool doLock, bool unpauseOnUnlock)
 {
 	if (doLock)
+	{
+		DSP_Sync();
 		m_csDSPThreadActive.lock();
+	}
 	else
 		m_csDSPThreadActive.unlock();
 }
@@ -34,9 +34,19 @@ public:
 	void DSP_Update(int cycles) override;
 	void DSP_StopSoundStream() override;
 	u32 DSP_UpdateRate() override;
+	void DSP_Sync() override;
+
+	// Hooks for DSPHost. In lockstep mode they make the DSP thread wait for
+	// the CPU before touching emulated memory, and hold back interrupts until
+	// the CPU next syncs with the DSP.
+	static void AcquireHostMemory();
+	static bool DeferInterruptRequest();
 
 private:
 	static void DSPThread(DSPLLE* lpParameter);
+	static void DSPLockstepThread(DSPLLE* dsp_lle);
+
+	void StartDSPThread(bool lockstep);
 
 	std::thread m_hDSPThread;
 	std::mutex m_csDSPThreadActive;
@@ -319,6 +319,10 @@ public:
 	std::vector<u16> m_used_blocks;
 	int UsesBlock(u16 blocknum);
 	bool m_dirty;
+	// Blocks written since the last flush, indexed like m_save_data. Only
+	// these and the header get written back, unless m_rewrite is set.
+	std::vector<bool> m_dirty_blocks;
+	bool m_rewrite;
 	std::string m_filename;
 };
 
@@ -3,6 +3,7 @@
 // Refer to the license.txt file included.
 
 #include <cinttypes>
+#include <cstring>
 #include <memory>
 
 #include "Common/ChunkFile.h"
@@ -17,15 +18,121 @@
 
 const int NO_INDEX = -1;
 static const char *MC_HDR = "MC_SYSTEM_AREA";
+static const char *JOURNAL_EXTENSION = ".journal";
+
+// Patches the header and blocks of an existing GCI in place. The changes go to
+// a journal first, so that a crash halfway through can be finished on the next
+// load instead of leaving a save that is half old and half new.
+//
+// Journal layout: header, u32 block count, u16 block indices, block data.
+static bool PatchGCI(const GCIFlush& flush)
+{
+	const std::string journal_name = flush.filename + JOURNAL_EXTENSION;
+	{
+		File::IOFile journal(journal_name, "wb");
+		const u32 count = (u32)flush.indices.size();
+		if (!journal.WriteBytes(&flush.header, DENTRY_SIZE) || !journal.WriteArray(&count, 1) ||
+		    !journal.WriteArray(flush.indices.data(), count) ||
+		    !journal.WriteBytes(flush.blocks.data(), BLOCK_SIZE * count) || !journal.Flush())
+		{
+			journal.Close();
+			File::Delete(journal_name);
+			return false;
+		}
+	}
+
+	File::IOFile GCI(flush.filename, "r+b");
+	bool good = GCI && GCI.WriteBytes(&flush.header, DENTRY_SIZE);
+	for (size_t i = 0; good && i < flush.indices.size(); ++i)
+	{
+		good = GCI.Seek(DENTRY_SIZE + (u64)flush.indices[i] * BLOCK_SIZE, SEEK_SET) &&
+		       GCI.WriteBytes(&flush.blocks[i], BLOCK_SIZE);
+	}
+	good = GCI.Close() && good;
+
+	// A failed patch is followed by a full rewrite, which replaying the journal
+	// on the next load would partially undo.
+	File::Delete(journal_name);
+	return good;
+}
+
+bool WriteGCI(const GCIFlush& flush)
+{
+	if (!flush.rewrite)
+		return PatchGCI(flush);
+
+	File::IOFile GCI(flush.filename, "wb");
+	if (!GCI.WriteBytes(&flush.header, DENTRY_SIZE) ||
+	    !GCI.WriteBytes(flush.blocks.data(), BLOCK_SIZE * flush.blocks.size()) || !GCI.Close())
+		return false;
+
+	// Left behind by a patch that couldn't be replayed; it is older than
+	// everything that was just written.
+	const std::string journal_name = flush.filename + JOURNAL_EXTENSION;
+	if (File::Exists(journal_name))
+		File::Delete(journal_name);
+	return true;
+}
+
+// A journal is stale if the GCI was written after it, unless it was written by
+// the patch itself: a patch writes the header first.
+static bool IsJournalStale(const std::string& fileName, const std::string& journal_name, const DEntry& header)
+{
+	u64 size, gci_mtime, journal_mtime;
+	if (!File::GetSizeAndModificationTime(fileName, &size, &gci_mtime) ||
+	    !File::GetSizeAndModificationTime(journal_name, &size, &journal_mtime) ||
+	    journal_mtime >= gci_mtime)
+		return false;
+
+	DEntry gci_header;
+	File::IOFile GCI(fileName, "rb");
+	return !GCI.ReadBytes(&gci_header, DENTRY_SIZE) || memcmp(&gci_header, &header, DENTRY_SIZE) != 0;
+}
+
+// Finishes a patch that was interrupted. A journal that was not fully written
+// means the GCI itself was never touched, so it is simply dropped.
+void ReplayGCIJournal(const std::string& fileName)
+{
+	const std::string journal_name = fileName + JOURNAL_EXTENSION;
+	if (!File::Exists(journal_name))
+		return;
+
+	File::IOFile journal(journal_name, "rb");
+	GCIFlush flush;
+	flush.filename = fileName;
+	flush.remove = false;
+	flush.rewrite = false;
+	u32 count = 0;
+	if (journal.ReadBytes(&flush.header, DENTRY_SIZE) && journal.ReadArray(&count, 1) &&
+	    journal.GetSize() == DENTRY_SIZE + sizeof(count) + count * (sizeof(u16) + BLOCK_SIZE) &&
+	    !IsJournalStale(fileName, journal_name, flush.header))
+	{
+		flush.indices.resize(count);
+		flush.blocks.resize(count);
+		if (journal.ReadArray(flush.indices.data(), count) && journal.ReadBytes(flush.blocks.data(), BLOCK_SIZE * count))
+		{
+			journal.Close();
+			NOTICE_LOG(EXPANSIONINTERFACE, "Finishing interrupted write to %s", fileName.c_str());
+			if (!PatchGCI(flush))
+				ERROR_LOG(EXPANSIONINTERFACE, "Failed to replay the journal of %s", fileName.c_str());
+			return;
+		}
+	}
+	journal.Close();
+	File::Delete(journal_name);
+}
 
 int GCMemcardDirectory::LoadGCI(const std::string& fileName, DiscIO::IVolume::ECountry card_region, bool currentGameOnly)
 {
+	ReplayGCIJournal(fileName);
+
 	File::IOFile gcifile(fileName, "rb");
 	if (gcifile)
 	{
 		GCIFile gci;
 		gci.m_filename = fileName;
 		gci.m_dirty = false;
+		gci.m_rewrite = false;
 		if (!gcifile.ReadBytes(&(gci.m_gci_header), DENTRY_SIZE))
 		{
 			ERROR_LOG(EXPANSIONINTERFACE, "%s failed to read header", fileName.c_str());
@@ -413,6 +520,8 @@ inline void GCMemcardDirectory::SyncSaves()
 			while (i >= m_saves.size())
 			{
 				GCIFile temp;
+				temp.m_dirty = false;
+				temp.m_rewrite = true;
 				m_saves.push_back(temp);
 				added = true;
 			}
@@ -431,12 +540,15 @@ inline void GCMemcardDirectory::SyncSaves()
 					PanicAlertT("Game overwrote with another games save. Data corruption ahead 0x%x, 0x%x",
 						BE32(m_saves[i].m_gci_header.Gamecode), BE32(current->Dir[i].Gamecode));
 				}
+				if (BE16(m_saves[i].m_gci_header.BlockCount) != BE16(current->Dir[i].BlockCount))
+					m_saves[i].m_rewrite = true;
 				memcpy((u8 *)&(m_saves[i].m_gci_header), (u8 *)&(current->Dir[i]), DENTRY_SIZE);
 				if (old_start != new_start)
 				{
 					INFO_LOG(EXPANSIONINTERFACE, "Save moved from 0x%x to 0x%x", old_start, new_start);
 					m_saves[i].m_used_blocks.clear();
 					m_saves[i].m_save_data.clear();
+					m_saves[i].m_rewrite = true;
 				}
 				if (m_saves[i].m_used_blocks.size() == 0)
 				{
@@ -477,11 +589,14 @@ inline s32 GCMemcardDirectory::SaveAreaRW(u32 block, bool writing)
 						m_saves[i].m_save_data.emplace_back();
 						num_blocks--;
 					}
+					m_saves[i].m_rewrite = true;
 				}
 
 				if (writing)
 				{
 					m_saves[i].m_dirty = true;
+					m_saves[i].m_dirty_blocks.resize(m_saves[i].m_save_data.size());
+					m_saves[i].m_dirty_blocks[idx] = true;
 				}
 
 				m_LastBlock = block;
@@ -547,89 +662,139 @@ bool GCMemcardDirectory::SetUsedBlocks(int saveIndex)
 
 void GCMemcardDirectory::FlushToFile()
 {
-	std::unique_lock<std::mutex> l(m_write_mutex);
-	int errors = 0;
-	DEntry invalid;
-	for (u16 i = 0; i < m_saves.size(); ++i)
+	// Take a snapshot of what changed while holding the lock, then write it
+	// out without the lock so that Write() on the CPU thread never waits on disk.
+	std::vector<GCIFlush> flushes;
 	{
-		if (m_saves[i].m_dirty)
+		std::unique_lock<std::mutex> l(m_write_mutex);
+		for (u16 i = 0; i < m_saves.size(); ++i)
 		{
-			if (BE32(m_saves[i].m_gci_header.Gamecode) != 0xFFFFFFFF)
+			GCIFile& save = m_saves[i];
+			if (save.m_dirty)
 			{
-				m_saves[i].m_dirty = false;
-				if (m_saves[i].m_save_data.size() == 0)
-				{
-					// The save's header has been changed but the actual save blocks haven't been read/written to
-					// skip flushing this file until actual save data is modified
-					ERROR_LOG(EXPANSIONINTERFACE, "GCI header modified without corresponding save data changes");
-					continue;
-				}
-				if (m_saves[i].m_filename.empty())
+				if (BE32(save.m_gci_header.Gamecode) != 0xFFFFFFFF)
 				{
-					std::string defaultSaveName = m_SaveDirectory + m_saves[i].m_gci_header.GCI_FileName();
-
-					// Check to see if another file is using the same name
-					// This seems unlikely except in the case of file corruption
-					// otherwise what user would name another file this way?
-					for (int j = 0; File::Exists(defaultSaveName) && j < 10; ++j)
+					save.m_dirty = false;
+					if (save.m_save_data.size() == 0)
 					{
-						defaultSaveName.insert(defaultSaveName.end() - 4, '0');
+						// The save's header has been changed but the actual save blocks haven't been read/written to
+						// skip flushing this file until actual save data is modified
+						ERROR_LOG(EXPANSIONINTERFACE, "GCI header modified without corresponding save data changes");
+						continue;
+					}
+					if (save.m_filename.empty())
+					{
+						std::string defaultSaveName = m_SaveDirectory + save.m_gci_header.GCI_FileName();
+
+						// Check to see if another file is using the same name
+						// This seems unlikely except in the case of file corruption
+						// otherwise what user would name another file this way?
+						for (int j = 0; File::Exists(defaultSaveName) && j < 10; ++j)
+						{
+							defaultSaveName.insert(defaultSaveName.end() - 4, '0');
+						}
+						if (File::Exists(defaultSaveName))
+							PanicAlertT("Failed to find new filename.\n%s\n will be overwritten", defaultSaveName.c_str());
+						save.m_filename = defaultSaveName;
+						save.m_rewrite = true;
 					}
-					if (File::Exists(defaultSaveName))
-						PanicAlertT("Failed to find new filename.\n%s\n will be overwritten", defaultSaveName.c_str());
-					m_saves[i].m_filename = defaultSaveName;
-				}
-				File::IOFile GCI(m_saves[i].m_filename, "wb");
-				if (GCI)
-				{
-					GCI.WriteBytes(&m_saves[i].m_gci_header, DENTRY_SIZE);
-					GCI.WriteBytes(m_saves[i].m_save_data.data(), BLOCK_SIZE * m_saves[i].m_save_data.size());
 
-					if (GCI.IsGood())
+					GCIFlush flush;
+					flush.filename = save.m_filename;
+					flush.remove = false;
+					flush.rewrite = save.m_rewrite || save.m_dirty_blocks.size() != save.m_save_data.size();
+					flush.header = save.m_gci_header;
+					if (flush.rewrite)
 					{
-						Core::DisplayMessage(
-							StringFromFormat("Wrote save contents to %s", m_saves[i].m_filename.c_str()), 4000);
+						flush.blocks = save.m_save_data;
 					}
 					else
 					{
-						++errors;
-						Core::DisplayMessage(
-							StringFromFormat("Failed to write save contents to %s", m_saves[i].m_filename.c_str()),
-							4000);
-						ERROR_LOG(EXPANSIONINTERFACE, "Failed to save data to %s", m_saves[i].m_filename.c_str());
+						for (u16 idx = 0; idx < save.m_dirty_blocks.size(); ++idx)
+						{
+							if (save.m_dirty_blocks[idx])
+							{
+								flush.indices.push_back(idx);
+								flush.blocks.push_back(save.m_save_data[idx]);
+							}
+						}
 					}
+					save.m_rewrite = false;
+					save.m_dirty_blocks.assign(save.m_save_data.size(), false);
+					flushes.push_back(std::move(flush));
+				}
+				else if (save.m_filename.length() != 0)
+				{
+					save.m_dirty = false;
+					GCIFlush flush;
+					flush.filename = save.m_filename;
+					flush.remove = true;
+					flushes.push_back(std::move(flush));
+					save.m_filename.clear();
+					save.m_save_data.clear();
+					save.m_used_blocks.clear();
+					save.m_dirty_blocks.clear();
 				}
 			}
-			else if (m_saves[i].m_filename.length() != 0)
+
+			// Unload the save data for any game that is not running
+			// we could use !m_dirty, but some games have multiple gci files and may not write to them simultaneously
+			// this ensures that the save data for all of the current games gci files are stored in the savestate
+			u32 gamecode = BE32(save.m_gci_header.Gamecode);
+			if (gamecode != m_GameId && gamecode != 0xFFFFFFFF && save.m_save_data.size())
 			{
-				m_saves[i].m_dirty = false;
-				std::string &oldname = m_saves[i].m_filename;
-				std::string deletedname = oldname + ".deleted";
-				if (File::Exists(deletedname))
-					File::Delete(deletedname);
-				File::Rename(oldname, deletedname);
-				m_saves[i].m_filename.clear();
-				m_saves[i].m_save_data.clear();
-				m_saves[i].m_used_blocks.clear();
+				INFO_LOG(EXPANSIONINTERFACE, "Flushing savedata to disk for %s", save.m_filename.c_str());
+				save.m_save_data.clear();
+				save.m_dirty_blocks.clear();
 			}
 		}
+#if _WRITE_MC_HEADER
+		u8 mc[BLOCK_SIZE * MC_FST_BLOCKS];
+		Read(0, BLOCK_SIZE * MC_FST_BLOCKS, mc);
+		File::IOFile hdrfile(m_SaveDirectory + MC_HDR, "wb");
+		hdrfile.WriteBytes(mc, BLOCK_SIZE * MC_FST_BLOCKS);
+#endif
+	}
 
-		// Unload the save data for any game that is not running
-		// we could use !m_dirty, but some games have multiple gci files and may not write to them simultaneously
-		// this ensures that the save data for all of the current games gci files are stored in the savestate
-		u32 gamecode = BE32(m_saves[i].m_gci_header.Gamecode);
-		if (gamecode != m_GameId && gamecode != 0xFFFFFFFF && m_saves[i].m_save_data.size())
+	for (const GCIFlush& flush : flushes)
+	{
+		if (flush.remove)
 		{
-			INFO_LOG(EXPANSIONINTERFACE, "Flushing savedata to disk for %s", m_saves[i].m_filename.c_str());
-			m_saves[i].m_save_data.clear();
+			std::string deletedname = flush.filename + ".deleted";
+			if (File::Exists(deletedname))
+				File::Delete(deletedname);
+			File::Rename(flush.filename, deletedname);
+			continue;
+		}
+
+		if (WriteGCI(flush))
+		{
+			Core::DisplayMessage(
+				StringFromFormat("Wrote save contents to %s", flush.filename.c_str()), 4000);
+		}
+		else
+		{
+			Core::DisplayMessage(
+				StringFromFormat("Failed to write save contents to %s", flush.filename.c_str()),
+				4000);
+			ERROR_LOG(EXPANSIONINTERFACE, "Failed to save data to %s", flush.filename.c_str());
+			// The file on disk may be partially updated now, so patching it later is not enough.
+			MarkForRewrite(flush.filename);
+		}
+	}
+}
+
+void GCMemcardDirectory::MarkForRewrite(const std::string& filename)
+{
+	std::unique_lock<std::mutex> l(m_write_mutex);
+	for (GCIFile& save : m_saves)
+	{
+		if (save.m_filename == filename && BE32(save.m_gci_header.Gamecode) != 0xFFFFFFFF)
+		{
+			save.m_dirty = true;
+			save.m_rewrite = true;
 		}
 	}
-#if _WRITE_MC_HEADER
-	u8 mc[BLOCK_SIZE * MC_FST_BLOCKS];
-	Read(0, BLOCK_SIZE * MC_FST_BLOCKS, mc);
-	File::IOFile hdrfile(m_SaveDirectory + MC_HDR, "wb");
-	hdrfile.WriteBytes(mc, BLOCK_SIZE * MC_FST_BLOCKS);
-#endif
 }
 
 void GCMemcardDirectory::DoState(PointerWrap &p)
@@ -700,6 +865,14 @@ void GCIFile::DoState(PointerWrap &p)
 		p.DoPOD<GCMBlock>(*itr);
 	}
 	p.Do(m_used_blocks);
+
+	// Which blocks changed isn't tracked across savestates, so anything
+	// unflushed is written out whole.
+	if (p.GetMode() == PointerWrap::MODE_READ)
+	{
+		m_rewrite = m_dirty;
+		m_dirty_blocks.clear();
+	}
 }
 
 void MigrateFromMemcardFile(const std::string& strDirectoryName, int card_index)
@@ -20,6 +20,25 @@
 //#define _WRITE_MC_HEADER 1
 void MigrateFromMemcardFile(const std::string& strDirectoryName, int card_index);
 
+// The changes to a save that the flush thread writes out, copied while holding
+// the write lock so that the file I/O itself happens without it.
+struct GCIFlush
+{
+	std::string filename;
+	bool remove;
+	bool rewrite;
+	DEntry header;
+	// Indices into the save's blocks; all of them when rewriting.
+	std::vector<u16> indices;
+	std::vector<GCMBlock> blocks;
+};
+
+// Writes the changes to the GCI, either patching it through its journal or
+// rewriting it whole. Returns false if the file may be partially written.
+bool WriteGCI(const GCIFlush& flush);
+// Finishes a patch of the GCI that was interrupted, if its journal is valid.
+void ReplayGCIJournal(const std::string& filename);
+
 class GCMemcardDirectory : public MemoryCardBase, NonCopyable
 {
 public:
@@ -41,6 +60,7 @@ private:
 	s32 DirectoryWrite(u32 destaddress, u32 length, u8 *srcaddress);
 	inline void SyncSaves();
 	bool SetUsedBlocks(int saveIndex);
+	void MarkForRewrite(const std::string& filename);
 
 	u32 m_GameId;
 	s32 m_LastBlock;
@@ -604,6 +604,7 @@ static void EndField()
 {
 	g_video_backend->Video_EndField();
 	Core::VideoThrottle();
+	Core::FieldUpdateOnCPUThread();
 }
 
 // Purpose: Send VI interrupt when triggered
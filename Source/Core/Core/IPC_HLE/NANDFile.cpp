@@ -0,0 +1,171 @@
+// Copyright 2016 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cstring>
+
+#include "Common/Logging/Log.h"
+#include "Core/IPC_HLE/NANDFile.h"
+
+NANDFile::NANDFile(const std::string& path)
+	: m_path(path)
+{
+	Open();
+}
+
+NANDFile::~NANDFile()
+{
+	Flush();
+}
+
+void NANDFile::Open()
+{
+	m_file.Open(m_path, "r+b");
+	m_size = m_disk_size = m_file.IsOpen() ? m_file.GetSize() : 0;
+}
+
+// Until the host file is back, handles see a file that isn't there.
+void NANDFile::Revalidate()
+{
+	if (!m_invalidated)
+		return;
+	Open();
+	m_invalidated = !m_file.IsOpen();
+}
+
+bool NANDFile::IsOpen()
+{
+	Revalidate();
+	return m_file.IsOpen();
+}
+
+u64 NANDFile::GetSize()
+{
+	Revalidate();
+	return m_size;
+}
+
+bool NANDFile::Read(u64 offset, u8* data, u32 size, u32* bytes_read)
+{
+	Revalidate();
+	*bytes_read = 0;
+	if (offset >= m_size)
+		return true;
+	size = static_cast<u32>(std::min<u64>(size, m_size - offset));
+
+	while (*bytes_read < size)
+	{
+		const u64 position = offset + *bytes_read;
+		const u32 page_offset = static_cast<u32>(position % PAGE_SIZE);
+		const u32 count = std::min(size - *bytes_read, PAGE_SIZE - page_offset);
+		const std::vector<u8>* page = GetPage(static_cast<u32>(position / PAGE_SIZE));
+		if (!page)
+			return false;
+		memcpy(data + *bytes_read, page->data() + page_offset, count);
+		*bytes_read += count;
+	}
+	return true;
+}
+
+bool NANDFile::Write(u64 offset, const u8* data, u32 size)
+{
+	Revalidate();
+	u32 written = 0;
+	while (written < size)
+	{
+		const u64 position = offset + written;
+		const u32 index = static_cast<u32>(position / PAGE_SIZE);
+		const u32 page_offset = static_cast<u32>(position % PAGE_SIZE);
+		const u32 count = std::min(size - written, PAGE_SIZE - page_offset);
+		std::vector<u8>* page = GetPage(index);
+		if (!page)
+			return false;
+		memcpy(page->data() + page_offset, data + written, count);
+		m_dirty.insert(index);
+		written += count;
+	}
+	m_size = std::max<u64>(m_size, offset + size);
+	return true;
+}
+
+bool NANDFile::Flush()
+{
+	if (m_dirty.empty())
+		return true;
+
+	std::vector<u32> written;
+	for (u32 index : m_dirty)
+	{
+		const u64 position = static_cast<u64>(index) * PAGE_SIZE;
+		const size_t count = static_cast<size_t>(std::min<u64>(PAGE_SIZE, m_size - position));
+		if (m_file.Seek(position, SEEK_SET) && m_file.WriteBytes(m_pages[index].data(), count))
+			written.push_back(index);
+		else
+			m_file.Clear();
+	}
+	// Nothing is known to be on disk if the buffered writes can't be flushed.
+	if (!m_file.Flush())
+	{
+		m_file.Clear();
+		written.clear();
+	}
+
+	for (u32 index : written)
+	{
+		const u64 position = static_cast<u64>(index) * PAGE_SIZE;
+		m_disk_size = std::max<u64>(m_disk_size, std::min<u64>(position + PAGE_SIZE, m_size));
+		m_dirty.erase(index);
+	}
+
+	if (!m_dirty.empty())
+		ERROR_LOG(WII_IPC_FILEIO, "FileIO: Failed to write back a cached NAND file");
+	TrimPages();
+	return m_dirty.empty();
+}
+
+void NANDFile::Invalidate()
+{
+	if (!Flush())
+		ERROR_LOG(WII_IPC_FILEIO, "FileIO: Dropping unwritten data of %s", m_path.c_str());
+	m_file.Close();
+	m_pages.clear();
+	m_dirty.clear();
+	m_size = m_disk_size = 0;
+	m_invalidated = true;
+}
+
+std::vector<u8>* NANDFile::GetPage(u32 index)
+{
+	auto it = m_pages.find(index);
+	if (it != m_pages.end())
+		return &it->second;
+
+	TrimPages();
+
+	std::vector<u8>& page = m_pages[index];
+	page.resize(PAGE_SIZE);
+	const u64 position = static_cast<u64>(index) * PAGE_SIZE;
+	if (position < m_disk_size)
+	{
+		const size_t count = static_cast<size_t>(std::min<u64>(PAGE_SIZE, m_disk_size - position));
+		if (!m_file.Seek(position, SEEK_SET) || !m_file.ReadBytes(page.data(), count))
+		{
+			m_file.Clear();
+			m_pages.erase(index);
+			return nullptr;
+		}
+	}
+	return &page;
+}
+
+void NANDFile::TrimPages()
+{
+	for (auto it = m_pages.begin(); it != m_pages.end() && m_pages.size() > MAX_CLEAN_PAGES + m_dirty.size();)
+	{
+		if (m_dirty.count(it->first))
+			++it;
+		else
+			it = m_pages.erase(it);
+	}
+}
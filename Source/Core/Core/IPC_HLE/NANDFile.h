@@ -0,0 +1,57 @@
+// Copyright 2016 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Common/FileUtil.h"
+
+// A NAND file shared by all the handles that have it open, with its contents
+// cached in NAND cluster sized pages. Writes stay in memory until Flush().
+class NANDFile
+{
+public:
+	static const u32 PAGE_SIZE = 0x4000;
+	// Clean pages kept per file; big files like cdb.vff are mostly read once.
+	static const size_t MAX_CLEAN_PAGES = 256;
+
+	explicit NANDFile(const std::string& path);
+	~NANDFile();
+
+	bool IsOpen();
+	bool IsDirty() const { return !m_dirty.empty(); }
+	u64 GetSize();
+	size_t GetCachedPages() const { return m_pages.size(); }
+
+	// Returns false on a host error. Reads past the end are cut short.
+	bool Read(u64 offset, u8* data, u32 size, u32* bytes_read);
+	bool Write(u64 offset, const u8* data, u32 size);
+
+	// Pages that couldn't be written stay dirty, and are tried again on the
+	// next flush.
+	bool Flush();
+
+	// Writes back and closes the host file, for when it is about to be
+	// deleted or replaced. It is opened again on the next use.
+	void Invalidate();
+
+private:
+	void Open();
+	void Revalidate();
+	std::vector<u8>* GetPage(u32 index);
+	void TrimPages();
+
+	std::string m_path;
+	File::IOFile m_file;
+	bool m_invalidated = false;
+	u64 m_size;
+	u64 m_disk_size;
+	std::map<u32, std::vector<u8>> m_pages;
+	std::set<u32> m_dirty;
+};
@@ -20,9 +20,14 @@ in case of success they are
 They will also generate a true or false return for UpdateInterrupts() in WII_IPC.cpp.
 */
 
+#include <algorithm>
+#include <array>
+#include <cinttypes>
 #include <list>
 #include <map>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "Common/ChunkFile.h"
 #include "Common/CommonPaths.h"
@@ -63,6 +68,8 @@ namespace WII_IPC_HLE_Interface
 
 typedef std::map<u32, std::shared_ptr<IWII_IPC_HLE_Device>> TDeviceMap;
 static TDeviceMap g_DeviceMap;
+// The devices that need IWII_IPC_HLE_Device::Update() called periodically.
+static std::vector<std::shared_ptr<IWII_IPC_HLE_Device>> g_UpdateDevices;
 
 // STATE_TO_SAVE
 #define IPC_MAX_FDS 0x18
@@ -79,7 +86,26 @@ static ipc_msg_queue ack_queue;   // arm -> ppc
 
 static int event_enqueue;
 
-static u64 last_reply_time;
+// When the last reply on each fd is due. IOS runs every resource manager in
+// its own thread, so only replies on the same fd have to stay in order; a
+// slow /dev/di read does not hold up /dev/fs. The last entry is for commands
+// without a valid fd.
+static std::array<u64, IPC_MAX_FDS + 1> last_reply_time;
+
+// Time from executing a command to delivering its reply, per device.
+struct DeviceLatency
+{
+	u64 count;
+	u64 total_ticks;
+	u64 max_ticks;
+};
+struct PendingCommand
+{
+	u64 start_ticks;
+	DeviceLatency* latency;
+};
+static std::map<std::string, DeviceLatency> s_device_latency;
+static std::unordered_map<u32, PendingCommand> s_pending_commands;
 
 static const u64 ENQUEUE_REQUEST_FLAG = 0x100000000ULL;
 static const u64 ENQUEUE_ACKNOWLEDGEMENT_FLAG = 0x200000000ULL;
@@ -111,6 +137,15 @@ std::shared_ptr<T> AddDevice(const char* deviceName)
 	return device;
 }
 
+// For devices that override IWII_IPC_HLE_Device::Update().
+template <typename T>
+std::shared_ptr<T> AddUpdateDevice(const char* deviceName)
+{
+	auto device = AddDevice<T>(deviceName);
+	g_UpdateDevices.push_back(device);
+	return device;
+}
+
 void Init()
 {
 	bool Wee_speeak_support = SConfig::GetInstance().bWiiSpeakSupport;
@@ -127,7 +162,7 @@ void Init()
 		AddDevice<CWII_IPC_HLE_Device_usb_oh0_57e_308>("/dev/usb/oh0/57e/308");
 		AddDevice<CWII_IPC_HLE_Device_usb_oh0_46d_a03>("/dev/usb/oh0/46d/a03");
 	}
-	AddDevice<CWII_IPC_HLE_Device_usb_oh1_57e_305>("/dev/usb/oh1/57e/305");
+	AddUpdateDevice<CWII_IPC_HLE_Device_usb_oh1_57e_305>("/dev/usb/oh1/57e/305");
 	AddDevice<CWII_IPC_HLE_Device_stm_immediate>("/dev/stm/immediate");
 	AddDevice<CWII_IPC_HLE_Device_stm_eventhook>("/dev/stm/eventhook");
 	AddDevice<CWII_IPC_HLE_Device_fs>("/dev/fs");
@@ -146,7 +181,7 @@ void Init()
 	AddDevice<CWII_IPC_HLE_Device_net_wd_command>("/dev/net/wd/command");
 	AddDevice<CWII_IPC_HLE_Device_net_ip_top>("/dev/net/ip/top");
 	AddDevice<CWII_IPC_HLE_Device_net_ssl>("/dev/net/ssl");
-	AddDevice<CWII_IPC_HLE_Device_usb_kbd>("/dev/usb/kbd");
+	AddUpdateDevice<CWII_IPC_HLE_Device_usb_kbd>("/dev/usb/kbd");
 	AddDevice<CWII_IPC_HLE_Device_sdio_slot0>("/dev/sdio/slot0");
 	AddDevice<CWII_IPC_HLE_Device_stub>("/dev/sdio/slot1");
 	#if defined(__LIBUSB__) || defined(_WIN32)
@@ -180,6 +215,8 @@ void Reset(bool _bHard)
 		in_use = false;
 	}
 
+	HLE_IPC_FlushNANDCache(true);
+
 	for (const auto& entry : g_DeviceMap)
 	{
 		if (entry.second)
@@ -192,15 +229,31 @@ void Reset(bool _bHard)
 	if (_bHard)
 	{
 		g_DeviceMap.clear();
+		g_UpdateDevices.clear();
 	}
 	request_queue.clear();
 	reply_queue.clear();
 
-	last_reply_time = 0;
+	last_reply_time.fill(0);
+	s_pending_commands.clear();
 }
 
 void Shutdown()
 {
+	for (const auto& entry : s_device_latency)
+	{
+		// Devices get an entry when a command is sent, even if it never replied.
+		const DeviceLatency& latency = entry.second;
+		if (latency.count == 0)
+			continue;
+
+		NOTICE_LOG(WII_IPC_HLE, "%s: %" PRIu64 " replies, %" PRIu64 " us average, %" PRIu64 " us max",
+		         entry.first.c_str(), latency.count,
+		         latency.total_ticks * 1000000 / latency.count / SystemTimers::GetTicksPerSecond(),
+		         latency.max_ticks * 1000000 / SystemTimers::GetTicksPerSecond());
+	}
+	s_device_latency.clear();
+
 	Reset(true);
 }
 
@@ -276,7 +329,7 @@ void DoState(PointerWrap &p)
 {
 	p.Do(request_queue);
 	p.Do(reply_queue);
-	p.Do(last_reply_time);
+	p.DoArray(last_reply_time);
 
 	for (const auto& entry : g_DeviceMap)
 	{
@@ -521,11 +574,15 @@ void ExecuteCommand(u32 _Address)
 	}
 	}
 
-	// Ensure replies happen in order
-	const s64 ticks_until_last_reply = last_reply_time - CoreTiming::GetTicks();
+	// Ensure replies on the same fd happen in order
+	u64& fd_last_reply_time = last_reply_time[(DeviceID >= 0 && DeviceID < IPC_MAX_FDS) ? DeviceID : IPC_MAX_FDS];
+	const s64 ticks_until_last_reply = fd_last_reply_time - CoreTiming::GetTicks();
 	if (ticks_until_last_reply > 0)
 		result.reply_delay_ticks += ticks_until_last_reply;
-	last_reply_time = CoreTiming::GetTicks() + result.reply_delay_ticks;
+	fd_last_reply_time = CoreTiming::GetTicks() + result.reply_delay_ticks;
+
+	if (pDevice)
+		s_pending_commands[_Address] = {CoreTiming::GetTicks(), &s_device_latency[pDevice->GetDeviceName()]};
 
 	if (result.send_reply)
 	{
@@ -590,6 +647,18 @@ void Update()
 	{
 		WII_IPCInterface::GenerateReply(reply_queue.front());
 		INFO_LOG(WII_IPC_HLE, "<<-- Reply to IPC Request @ 0x%08x", reply_queue.front());
+
+		auto pending = s_pending_commands.find(reply_queue.front());
+		if (pending != s_pending_commands.end())
+		{
+			const u64 ticks = CoreTiming::GetTicks() - pending->second.start_ticks;
+			DeviceLatency* latency = pending->second.latency;
+			latency->count++;
+			latency->total_ticks += ticks;
+			latency->max_ticks = std::max(latency->max_ticks, ticks);
+			s_pending_commands.erase(pending);
+		}
+
 		reply_queue.pop_front();
 		return;
 	}
@@ -605,12 +674,14 @@ void Update()
 
 void UpdateDevices()
 {
+	HLE_IPC_UpdateNANDCache();
+
 	// Check if a hardware device must be updated
-	for (const auto& entry : g_DeviceMap)
+	for (const auto& device : g_UpdateDevices)
 	{
-		if (entry.second->IsOpened())
+		if (device->IsOpened())
 		{
-			entry.second->Update();
+			device->Update();
 		}
 	}
 }
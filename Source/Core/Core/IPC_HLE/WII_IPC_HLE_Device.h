@@ -146,6 +146,7 @@ public:
 	virtual IPCCommandResult IOCtlV(u32) { UNIMPLEMENTED_CMD(IOCtlV) }
 #undef UNIMPLEMENTED_CMD
 
+	// Only called for devices registered with AddUpdateDevice() in WII_IPC_HLE.cpp.
 	virtual u32 Update() { return 0; }
 
 	virtual bool IsHardware() { return m_Hardware; }
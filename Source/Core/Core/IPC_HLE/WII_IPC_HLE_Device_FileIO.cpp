@@ -3,6 +3,7 @@
 // Refer to the license.txt file included.
 
 #include <algorithm>
+#include <map>
 
 #include "Common/ChunkFile.h"
 #include "Common/CommonPaths.h"
@@ -11,15 +12,83 @@
 #include "Common/NandPaths.h"
 #include "Common/StringUtil.h"
 
+#include "Core/ConfigManager.h"
 #include "Core/Core.h"
+#include "Core/CoreTiming.h"
+#include "Core/HW/SystemTimers.h"
+#include "Core/IPC_HLE/NANDFile.h"
 #include "Core/IPC_HLE/WII_IPC_HLE.h"
 #include "Core/IPC_HLE/WII_IPC_HLE_Device_FileIO.h"
 #include "Core/IPC_HLE/WII_IPC_HLE_Device_fs.h"
 
-
 static Common::replace_v replacements;
 
-static std::map <std::string, std::weak_ptr<File::IOFile>> openFiles;
+// On the wii, all file operations are strongly ordered, so every handle to a
+// file shares one NANDFile. Entries with no handles left are only kept
+// around when writes are deferred.
+static std::map<std::string, std::shared_ptr<NANDFile>> openFiles;
+// When the oldest unflushed write happened, or 0 if nothing is dirty.
+static u64 s_dirty_since;
+
+// Emulated time dirty data may stay in memory, unless writes are deferred.
+static u64 GetFlushInterval()
+{
+	return SystemTimers::GetTicksPerSecond();
+}
+
+static bool IsAtOrBelow(const std::string& path, const std::string& wii_path)
+{
+	return path.compare(0, wii_path.size(), wii_path) == 0 &&
+	       (path.size() == wii_path.size() || wii_path.back() == '/' || path[wii_path.size()] == '/');
+}
+
+void HLE_IPC_FlushNANDCache(bool invalidate)
+{
+	HLE_IPC_FlushNANDPath("/", invalidate);
+}
+
+void HLE_IPC_FlushNANDPath(const std::string& wii_path, bool invalidate)
+{
+	bool dirty = false;
+	for (auto it = openFiles.begin(); it != openFiles.end();)
+	{
+		if (IsAtOrBelow(it->first, wii_path))
+		{
+			// Files that are still open stay in the map, so that their handles and
+			// new ones keep sharing them; they are reloaded from the host instead.
+			if (invalidate && it->second.use_count() == 1)
+			{
+				it->second->Flush();
+				it = openFiles.erase(it);
+				continue;
+			}
+			if (invalidate)
+				it->second->Invalidate();
+			else
+				it->second->Flush();
+		}
+		dirty |= it->second->IsDirty();
+		++it;
+	}
+	if (!dirty)
+		s_dirty_since = 0;
+}
+
+void HLE_IPC_UpdateNANDCache()
+{
+	if (s_dirty_since && !SConfig::GetInstance().m_WiiNANDDeferWrites &&
+	    CoreTiming::GetTicks() - s_dirty_since >= GetFlushInterval())
+	{
+		bool dirty = false;
+		for (auto& entry : openFiles)
+		{
+			entry.second->Flush();
+			dirty |= entry.second->IsDirty();
+		}
+		// Try failed writes again after another interval.
+		s_dirty_since = dirty ? std::max<u64>(CoreTiming::GetTicks(), 1) : 0;
+	}
+}
 
 // This is used by several of the FileIO and /dev/fs functions
 std::string HLE_IPC_BuildFilename(std::string path_wii)
@@ -89,7 +158,14 @@ IPCCommandResult CWII_IPC_HLE_Device_FileIO::Close(u32 _CommandAddress, bool _bF
 	INFO_LOG(WII_IPC_FILEIO, "FileIO: Close %s (DeviceID=%08x)", m_Name.c_str(), m_DeviceID);
 	m_Mode = 0;
 
-	// Let go of our pointer to the file, it will automatically close if we are the last handle accessing it.
+	// Let go of our pointer to the file. If we were the last handle accessing it, it gets written
+	// back and closed, unless writes are deferred.
+	if (m_file && m_file.use_count() == 2 && !SConfig::GetInstance().m_WiiNANDDeferWrites)
+	{
+		auto search = openFiles.find(m_Name);
+		if (search != openFiles.end() && search->second == m_file)
+			openFiles.erase(search);
+	}
 	m_file.reset();
 
 	// Close always return 0 for success
@@ -146,6 +222,8 @@ void CWII_IPC_HLE_Device_FileIO::OpenFile()
 
 	// So we fix this by catching any attempts to open the same file twice and
 	// only opening one file. Accesses to a single file handle are ordered.
+	// The file's contents are cached in memory, which also makes titles that
+	// keep reopening and polling the same files cheap.
 	//
 	// Hall of Shame:
 	//    - PokePark Wii (gets stuck on the loading screen of Pikachu falling)
@@ -157,23 +235,13 @@ void CWII_IPC_HLE_Device_FileIO::OpenFile()
 	auto search = openFiles.find(m_Name);
 	if (search != openFiles.end())
 	{
-		m_file = search->second.lock(); // Lock a shared pointer to use.
+		m_file = search->second;
 	}
 	else
 	{
-		std::string path = m_Name;
-		// This code will be called when all references to the shared pointer below have been removed.
-		auto deleter = [path](File::IOFile* ptr)
-		{
-			delete ptr; // IOFile's deconstructor closes the file.
-			openFiles.erase(path); // erase the weak pointer from the list of open files.
-		};
-
 		// All files are opened read/write. Actual access rights will be controlled per handle by the read/write functions below
-		m_file = std::shared_ptr<File::IOFile>(new File::IOFile(m_filepath, "r+b"), deleter); // Use the custom deleter from above.
-
-		// Store a weak pointer to our newly opened file in the cache.
-		openFiles[path] = std::weak_ptr<File::IOFile>(m_file);
+		m_file = std::make_shared<NANDFile>(m_filepath);
+		openFiles[m_Name] = m_file;
 	}
 }
 
@@ -257,9 +325,7 @@ IPCCommandResult CWII_IPC_HLE_Device_FileIO::Read(u32 _CommandAddress)
 		else
 		{
 			INFO_LOG(WII_IPC_FILEIO, "FileIO: Read 0x%x bytes to 0x%08x from %s", Size, Address, m_Name.c_str());
-			m_file->Seek(m_SeekPos, SEEK_SET); // File might be opened twice, need to seek before we read
-			ReturnValue = (u32)fread(Memory::GetPointer(Address), 1, Size, m_file->GetHandle());
-			if (ReturnValue != Size && ferror(m_file->GetHandle()))
+			if (!m_file->Read(m_SeekPos, Memory::GetPointer(Address), Size, &ReturnValue))
 			{
 				ReturnValue = FS_EACCESS;
 			}
@@ -295,11 +361,12 @@ IPCCommandResult CWII_IPC_HLE_Device_FileIO::Write(u32 _CommandAddress)
 		else
 		{
 			INFO_LOG(WII_IPC_FILEIO, "FileIO: Write 0x%04x bytes from 0x%08x to %s", Size, Address, m_Name.c_str());
-			m_file->Seek(m_SeekPos, SEEK_SET); // File might be opened twice, need to seek before we write
-			if (m_file->WriteBytes(Memory::GetPointer(Address), Size))
+			if (m_file->Write(m_SeekPos, Memory::GetPointer(Address), Size))
 			{
 				ReturnValue = Size;
 				m_SeekPos += Size;
+				if (!s_dirty_since)
+					s_dirty_since = std::max<u64>(CoreTiming::GetTicks(), 1);
 			}
 		}
 	}
@@ -4,15 +4,27 @@
 
 #pragma once
 
+#include <memory>
 #include <string>
 #include "Core/IPC_HLE/WII_IPC_HLE_Device.h"
 
 class PointerWrap;
-namespace File { class IOFile; }
+class NANDFile;
 
 std::string HLE_IPC_BuildFilename(std::string _pFilename);
 void HLE_IPC_CreateVirtualFATFilesystem();
 
+// NAND files opened through FileIO are cached in memory and written back to
+// the host later. Anything that looks at the host files directly has to
+// flush first. With invalidate, the cached files are closed too, for when the
+// host files are about to be deleted or replaced; open ones are reloaded from
+// the host on their next use.
+void HLE_IPC_FlushNANDCache(bool invalidate = false);
+// The same, for the cached files at or below a NAND path only.
+void HLE_IPC_FlushNANDPath(const std::string& wii_path, bool invalidate = false);
+// Writes back data that has been dirty for a while. Called periodically.
+void HLE_IPC_UpdateNANDCache();
+
 class CWII_IPC_HLE_Device_FileIO : public IWII_IPC_HLE_Device
 {
 public:
@@ -75,5 +87,5 @@ private:
 	u32 m_SeekPos;
 
 	std::string m_filepath;
-	std::shared_ptr<File::IOFile> m_file;
+	std::shared_ptr<NANDFile> m_file;
 };
@@ -164,6 +164,8 @@ IPCCommandResult CWII_IPC_HLE_Device_fs::IOCtlV(u32 _CommandAddress)
 			// It should be correct, but don't count on it...
 			std::string relativepath = Memory::GetString(CommandBuffer.InBuffer[0].m_Address, CommandBuffer.InBuffer[0].m_Size);
 			std::string path(HLE_IPC_BuildFilename(relativepath));
+			// The sizes come from the host files.
+			HLE_IPC_FlushNANDPath(relativepath);
 			u32 fsBlocks = 0;
 			u32 iNodes = 0;
 
@@ -324,6 +326,7 @@ s32 CWII_IPC_HLE_Device_fs::ExecuteCommand(u32 _Parameter, u32 _BufferIn, u32 _B
 			u8 GroupPerm = 0x3;   // read/write
 			u8 OtherPerm = 0x3;   // read/write
 			u8 Attributes = 0x00; // no attributes
+			HLE_IPC_FlushNANDPath(Memory::GetString(_BufferIn, 64));
 			if (File::IsDirectory(Filename))
 			{
 				INFO_LOG(WII_IPC_FILEIO, "FS: GET_ATTR Directory %s - all permission flags are set", Filename.c_str());
@@ -365,6 +368,7 @@ s32 CWII_IPC_HLE_Device_fs::ExecuteCommand(u32 _Parameter, u32 _BufferIn, u32 _B
 			int Offset = 0;
 
 			std::string Filename = HLE_IPC_BuildFilename(Memory::GetString(_BufferIn+Offset, 64));
+			HLE_IPC_FlushNANDPath(Memory::GetString(_BufferIn+Offset, 64), true);
 			Offset += 64;
 			if (File::Delete(Filename))
 			{
@@ -389,9 +393,11 @@ s32 CWII_IPC_HLE_Device_fs::ExecuteCommand(u32 _Parameter, u32 _BufferIn, u32 _B
 			int Offset = 0;
 
 			std::string Filename = HLE_IPC_BuildFilename(Memory::GetString(_BufferIn+Offset, 64));
+			HLE_IPC_FlushNANDPath(Memory::GetString(_BufferIn+Offset, 64), true);
 			Offset += 64;
 
 			std::string FilenameRename = HLE_IPC_BuildFilename(Memory::GetString(_BufferIn+Offset, 64));
+			HLE_IPC_FlushNANDPath(Memory::GetString(_BufferIn+Offset, 64), true);
 			Offset += 64;
 
 			// try to make the basis directory
@@ -477,6 +483,10 @@ s32 CWII_IPC_HLE_Device_fs::ExecuteCommand(u32 _Parameter, u32 _BufferIn, u32 _B
 
 void CWII_IPC_HLE_Device_fs::DoState(PointerWrap& p)
 {
+	// /tmp is the only part of the NAND that is in the state. Write back its cached
+	// files before it gets saved, and drop them when it gets replaced.
+	HLE_IPC_FlushNANDPath("/tmp", p.GetMode() == PointerWrap::MODE_READ);
+
 	DoStateShared(p);
 
 	// handle /tmp
@@ -135,6 +135,7 @@ IPCCommandResult CWII_IPC_HLE_Device_net_kd_request::IOCtl(u32 _CommandAddress)
 		if (config.CreationStage() == nwc24_config_t::NWC24_IDCS_INITIAL)
 		{
 			std::string settings_Filename(Common::GetTitleDataPath(TITLEID_SYSMENU, Common::FROM_SESSION_ROOT) + WII_SETTING);
+			HLE_IPC_FlushNANDPath("/title/00000001/00000002/data/" WII_SETTING);
 			SettingsHandler gen;
 			std::string area, model;
 			bool _GotSettings = false;
@@ -564,6 +565,8 @@ CWII_IPC_HLE_Device_net_ip_top::CWII_IPC_HLE_Device_net_ip_top(u32 _DeviceID, co
 
 CWII_IPC_HLE_Device_net_ip_top::~CWII_IPC_HLE_Device_net_ip_top()
 {
+	// The socket thread has to be gone before Winsock is.
+	WiiSockMan::GetInstance().Clean();
 #ifdef _WIN32
 	WSACleanup();
 #endif
@@ -723,6 +726,7 @@ IPCCommandResult CWII_IPC_HLE_Device_net_ip_top::IOCtl(u32 _CommandAddress)
 		u32 how = Memory::Read_U32(BufferIn+4);
 		int ret = shutdown(fd, how);
 		ReturnValue = WiiSockMan::GetNetErrorCode(ret, "SO_SHUTDOWN", false);
+		WiiSockMan::GetInstance().SetLastNetError(fd, ReturnValue);
 		break;
 	}
 	case IOCTL_SO_LISTEN:
@@ -732,6 +736,7 @@ IPCCommandResult CWII_IPC_HLE_Device_net_ip_top::IOCtl(u32 _CommandAddress)
 		u32 BACKLOG = Memory::Read_U32(BufferIn + 0x04);
 		u32 ret = listen(fd, BACKLOG);
 		ReturnValue = WiiSockMan::GetNetErrorCode(ret, "SO_LISTEN", false);
+		WiiSockMan::GetInstance().SetLastNetError(fd, ReturnValue);
 		INFO_LOG(WII_IPC_NET, "IOCTL_SO_LISTEN = %d "
 			"BufferIn: (%08x, %i), BufferOut: (%08x, %i)",
 			ReturnValue, BufferIn, BufferInSize, BufferOut, BufferOutSize);
@@ -769,13 +774,17 @@ IPCCommandResult CWII_IPC_HLE_Device_net_ip_top::IOCtl(u32 _CommandAddress)
 		Memory::Write_U32(optlen, BufferOut + 0xC);
 		Memory::CopyToEmu(BufferOut + 0x10, optval, optlen);
 
+		WiiSockMan& sm = WiiSockMan::GetInstance();
 		if (optname == SO_ERROR)
 		{
-			s32 last_error = WiiSockMan::GetInstance().GetLastNetError();
+			// Operations complete on the network thread, so this is the result of
+			// the last one on this socket rather than whatever ran last anywhere.
+			s32 last_error = sm.GetLastNetError(fd);
 
 			Memory::Write_U32(sizeof(s32), BufferOut + 0xC);
 			Memory::Write_U32(last_error, BufferOut + 0x10);
 		}
+		sm.SetLastNetError(fd, ReturnValue);
 		break;
 	}
 
@@ -825,6 +834,7 @@ IPCCommandResult CWII_IPC_HLE_Device_net_ip_top::IOCtl(u32 _CommandAddress)
 
 		int ret = setsockopt(fd, nat_level, nat_optname, (char*)optval, optlen);
 		ReturnValue = WiiSockMan::GetNetErrorCode(ret, "SO_SETSOCKOPT", false);
+		WiiSockMan::GetInstance().SetLastNetError(fd, ReturnValue);
 		break;
 	}
 	case IOCTL_SO_GETSOCKNAME:
@@ -1534,9 +1544,3 @@ IPCCommandResult CWII_IPC_HLE_Device_net_ip_top::IOCtlV(u32 CommandAddress)
 	Memory::Write_U32(ReturnValue, CommandAddress + 4);
 	return GetDefaultReply();
 }
-
-u32 CWII_IPC_HLE_Device_net_ip_top::Update()
-{
-	WiiSockMan::GetInstance().Update();
-	return 0;
-}
@@ -11,6 +11,7 @@
 
 #include "Core/HW/EXI_DeviceIPL.h"
 #include "Core/IPC_HLE/WII_IPC_HLE_Device.h"
+#include "Core/IPC_HLE/WII_IPC_HLE_Device_FileIO.h"
 
 #ifdef _WIN32
 #include <ws2tcpip.h>
@@ -180,6 +181,7 @@ public:
 
 	void ResetConfig()
 	{
+		HLE_IPC_FlushNANDPath("/" WII_WC24CONF_DIR "/nwc24msg.cfg", true);
 		if (File::Exists(path))
 			File::Delete(path);
 
@@ -211,6 +213,7 @@ public:
 
 	void WriteConfig()
 	{
+		HLE_IPC_FlushNANDPath("/" WII_WC24CONF_DIR "/nwc24msg.cfg", true);
 		if (!File::Exists(path))
 		{
 			if (!File::CreateFullPath(File::GetUserPath(D_SESSION_WIIROOT_IDX) + "/" WII_WC24CONF_DIR))
@@ -225,6 +228,7 @@ public:
 
 	void ReadConfig()
 	{
+		HLE_IPC_FlushNANDPath("/" WII_WC24CONF_DIR "/nwc24msg.cfg");
 		if (File::Exists(path))
 		{
 			if (!File::IOFile(path, "rb").ReadBytes((void*)&config, sizeof(config)))
@@ -330,6 +334,7 @@ public:
 
 	void ResetConfig()
 	{
+		HLE_IPC_FlushNANDPath("/" WII_SYSCONF_DIR "/net/02/config.dat", true);
 		if (File::Exists(path))
 			File::Delete(path);
 
@@ -347,6 +352,7 @@ public:
 
 	void WriteConfig()
 	{
+		HLE_IPC_FlushNANDPath("/" WII_SYSCONF_DIR "/net/02/config.dat", true);
 		if (!File::Exists(path))
 		{
 			if (!File::CreateFullPath(std::string(File::GetUserPath(D_SESSION_WIIROOT_IDX) + "/" WII_SYSCONF_DIR "/net/02/")))
@@ -370,6 +376,7 @@ public:
 
 	void ReadConfig()
 	{
+		HLE_IPC_FlushNANDPath("/" WII_SYSCONF_DIR "/net/02/config.dat");
 		if (File::Exists(path))
 		{
 			if (!File::IOFile(path, "rb").ReadBytes((void*)&config, sizeof(config)))
@@ -606,8 +613,6 @@ public:
 	IPCCommandResult IOCtl(u32 _CommandAddress) override;
 	IPCCommandResult IOCtlV(u32 _CommandAddress) override;
 
-	u32 Update() override;
-
 private:
 #ifdef _WIN32
 	WSADATA InitData;
@@ -24,6 +24,7 @@ CWII_IPC_HLE_Device_net_ssl::CWII_IPC_HLE_Device_net_ssl(u32 _DeviceID, const st
 CWII_IPC_HLE_Device_net_ssl::~CWII_IPC_HLE_Device_net_ssl()
 {
 	// Cleanup sessions
+	std::lock_guard<std::recursive_mutex> lk(WiiSockMan::GetInstance().GetSSLMutex());
 	for (WII_SSL& ssl : _SSL)
 	{
 		if (ssl.active)
@@ -138,6 +139,10 @@ IPCCommandResult CWII_IPC_HLE_Device_net_ssl::IOCtlV(u32 _CommandAddress)
 		return GetDefaultReply();
 	}
 
+	// Handshakes, reads and writes run on the network thread.
+	WiiSockMan& sm = WiiSockMan::GetInstance();
+	std::lock_guard<std::recursive_mutex> lk(sm.GetSSLMutex());
+
 	switch (CommandBuffer.Parameter)
 	{
 	case IOCTLV_NET_SSL_NEW:
@@ -206,6 +211,7 @@ _SSL_NEW_ERROR:
 		if (SSLID_VALID(sslID))
 		{
 			WII_SSL* ssl = &_SSL[sslID];
+			sm.AbortSSLOps(sslID);
 			mbedtls_ssl_close_notify(&ssl->ctx);
 			mbedtls_ssl_session_free(&ssl->session);
 			mbedtls_ssl_free(&ssl->ctx);
@@ -402,7 +408,6 @@ _SSL_NEW_ERROR:
 		int sslID = Memory::Read_U32(BufferOut) - 1;
 		if (SSLID_VALID(sslID))
 		{
-			WiiSockMan &sm = WiiSockMan::GetInstance();
 			sm.DoSock(_SSL[sslID].sockfd, _CommandAddress, IOCTLV_NET_SSL_DOHANDSHAKE);
 			return GetNoReply();
 		}
@@ -417,7 +422,6 @@ _SSL_NEW_ERROR:
 		int sslID = Memory::Read_U32(BufferOut) - 1;
 		if (SSLID_VALID(sslID))
 		{
-			WiiSockMan &sm = WiiSockMan::GetInstance();
 			sm.DoSock(_SSL[sslID].sockfd, _CommandAddress, IOCTLV_NET_SSL_WRITE);
 			return GetNoReply();
 		}
@@ -442,7 +446,6 @@ _SSL_NEW_ERROR:
 		int sslID = Memory::Read_U32(BufferOut) - 1;
 		if (SSLID_VALID(sslID))
 		{
-			WiiSockMan &sm = WiiSockMan::GetInstance();
 			sm.DoSock(_SSL[sslID].sockfd, _CommandAddress, IOCTLV_NET_SSL_READ);
 			return GetNoReply();
 		}
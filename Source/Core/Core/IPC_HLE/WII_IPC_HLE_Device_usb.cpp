@@ -13,6 +13,7 @@
 #include "Core/HW/WII_IPC.h"
 #include "Core/HW/Wiimote.h"
 #include "Core/IPC_HLE/WII_IPC_HLE.h"
+#include "Core/IPC_HLE/WII_IPC_HLE_Device_FileIO.h"
 #include "Core/IPC_HLE/WII_IPC_HLE_Device_usb.h"
 #include "Core/IPC_HLE/WII_IPC_HLE_WiiMote.h"
 #include "InputCommon/ControllerInterface/ControllerInterface.h"
@@ -37,6 +38,9 @@ CWII_IPC_HLE_Device_usb_oh1_57e_305::CWII_IPC_HLE_Device_usb_oh1_57e_305(u32 _De
 	, m_ACLEndpoint(0)
 	, m_last_ticks(0)
 {
+	// The SYSCONF is rewritten below, from the host file.
+	HLE_IPC_FlushNANDPath("/" WII_SYSCONF_DIR "/" WII_SYSCONF, true);
+
 	SysConf* sysconf;
 	std::unique_ptr<SysConf> owned_sysconf;
 	if (Core::g_want_determinism)
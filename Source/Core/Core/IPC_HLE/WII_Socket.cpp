@@ -3,11 +3,16 @@
 // Refer to the license.txt file included.
 
 #include <algorithm>
+#include <vector>
 #ifndef _WIN32
 #include <unistd.h>
 #endif
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
 
 #include "Common/FileUtil.h"
+#include "Common/Thread.h"
 #include "Core/Core.h"
 #include "Core/IPC_HLE/WII_IPC_HLE.h"
 #include "Core/IPC_HLE/WII_IPC_HLE_Device.h"
@@ -91,18 +96,12 @@ s32 WiiSockMan::GetNetErrorCode(s32 ret, const char* caller, bool isRW)
 #endif
 
 	if (ret >= 0)
-	{
-		WiiSockMan::GetInstance().SetLastNetError(ret);
 		return ret;
-	}
 
 	INFO_LOG(WII_IPC_NET, "%s failed with error %d: %s, ret= %d",
 		caller, errorCode, DecodeError(errorCode), ret);
 
-	s32 ReturnValue = TranslateErrorCode(errorCode, isRW);
-	WiiSockMan::GetInstance().SetLastNetError(ReturnValue);
-
-	return ReturnValue;
+	return TranslateErrorCode(errorCode, isRW);
 }
 
 WiiSocket::~WiiSocket()
@@ -178,7 +177,7 @@ s32 WiiSocket::FCntl(u32 cmd, u32 arg)
 	return ret;
 }
 
-void WiiSocket::Update(bool read, bool write, bool except)
+void WiiSocket::Update()
 {
 	auto it = pending_sockops.begin();
 	while (it != pending_sockops.end())
@@ -518,6 +517,8 @@ void WiiSocket::Update(bool read, bool write, bool except)
 				}
 			}
 		}
+		if (!it->is_ssl)
+			last_error = ReturnValue;
 
 		if (nonBlock ||
 			forceNonBlock ||
@@ -537,15 +538,73 @@ void WiiSocket::Update(bool read, bool write, bool except)
 		}
 		else
 		{
+			if (it->is_ssl)
+				it->wait_write = ReturnValue == SSL_ERR_WAGAIN;
+			else
+				it->wait_write = it->net_type == IOCTL_SO_CONNECT || it->net_type == IOCTLV_SO_SENDTO;
 			++it;
 		}
 	}
 }
 
+// Completes pending operations with an error instead of trying them again:
+// the ones on the SSL context ssl_id, or all of them if ssl_id is -1.
+void WiiSocket::AbortPendingOps(int ssl_id)
+{
+	auto it = pending_sockops.begin();
+	while (it != pending_sockops.end())
+	{
+		IPCCommandType ct = static_cast<IPCCommandType>(Memory::Read_U32(it->_CommandAddress));
+		s32 ReturnValue = -SO_ECONNRESET;
+		if (it->is_ssl)
+		{
+			SIOCtlVBuffer CommandBuffer(it->_CommandAddress);
+			u32 BufferIn = 0, BufferOut = 0;
+			if (CommandBuffer.InBuffer.size() > 0)
+				BufferIn = CommandBuffer.InBuffer.at(0).m_Address;
+			if (CommandBuffer.PayloadBuffer.size() > 0)
+				BufferOut = CommandBuffer.PayloadBuffer.at(0).m_Address;
+
+			if (ssl_id != -1 && static_cast<int>(Memory::Read_U32(BufferOut)) - 1 != ssl_id)
+			{
+				++it;
+				continue;
+			}
+
+			Memory::Write_U32(SSL_ERR_FAILED, BufferIn);
+			ReturnValue = 0;
+		}
+		else if (ssl_id != -1)
+		{
+			++it;
+			continue;
+		}
+
+		DEBUG_LOG(WII_IPC_NET, "IOCTL(V) Sock: %08x ioctl/v: %d aborted",
+		          fd, it->is_ssl ? (int) it->ssl_type : (int) it->net_type);
+		WiiSockMan::EnqueueReply(it->_CommandAddress, ReturnValue, ct);
+		it = pending_sockops.erase(it);
+	}
+}
+
+void WiiSocket::GetWantedEvents(bool* read, bool* write) const
+{
+	*read = false;
+	*write = false;
+	for (const sockop& op : pending_sockops)
+	{
+		if (op.wait_write)
+			*write = true;
+		else
+			*read = true;
+	}
+}
+
 void WiiSocket::DoSock(u32 _CommandAddress, NET_IOCTL type)
 {
 	sockop so = {_CommandAddress, false};
 	so.net_type = type;
+	so.wait_write = false;
 	pending_sockops.push_back(so);
 }
 
@@ -553,9 +612,291 @@ void WiiSocket::DoSock(u32 _CommandAddress, SSL_IOCTL type)
 {
 	sockop so = {_CommandAddress, true};
 	so.ssl_type = type;
+	so.wait_write = false;
 	pending_sockops.push_back(so);
 }
 
+// Waits until one of the watched sockets is ready, using epoll where it is
+// available and poll() everywhere else. Wake() interrupts Wait() from any
+// thread, through a pipe (a loopback socket on Windows) that is always watched.
+class WiiSockMan::Poller
+{
+public:
+	Poller()
+	{
+#ifdef _WIN32
+		s32 s = (s32)socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+		sockaddr_in addr = {};
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		int addrlen = sizeof(addr);
+		bind(s, (sockaddr*)&addr, sizeof(addr));
+		getsockname(s, (sockaddr*)&addr, &addrlen);
+		connect(s, (sockaddr*)&addr, sizeof(addr));
+		u_long iMode = 1;
+		ioctlsocket(s, FIONBIO, &iMode);
+		m_wake_fds[0] = m_wake_fds[1] = s;
+#else
+		int fds[2];
+		if (pipe(fds) != 0)
+		{
+			fds[0] = -1;
+			fds[1] = -1;
+		}
+		else
+		{
+			fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL, 0) | O_NONBLOCK);
+		}
+		m_wake_fds[0] = fds[0];
+		m_wake_fds[1] = fds[1];
+#endif
+
+#ifdef __linux__
+		m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+		epoll_event ev = {};
+		ev.events = EPOLLIN;
+		ev.data.fd = m_wake_fds[0];
+		epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, m_wake_fds[0], &ev);
+#endif
+	}
+
+	~Poller()
+	{
+#ifdef __linux__
+		close(m_epoll_fd);
+#endif
+#ifdef _WIN32
+		closesocket(m_wake_fds[0]);
+#else
+		close(m_wake_fds[0]);
+		close(m_wake_fds[1]);
+#endif
+	}
+
+	// Sets what to wait for on the socket. Nothing stops watching it.
+	void Watch(s32 fd, bool read, bool write)
+	{
+		short events = (read ? POLLIN : 0) | (write ? POLLOUT : 0);
+
+		std::lock_guard<std::mutex> lk(m_watched_lock);
+		auto it = m_watched.find(fd);
+		short old_events = it == m_watched.end() ? 0 : it->second;
+		if (events == old_events)
+			return;
+
+		if (events)
+			m_watched[fd] = events;
+		else
+			m_watched.erase(it);
+
+#ifdef __linux__
+		epoll_event ev = {};
+		ev.events = (read ? EPOLLIN : 0) | (write ? EPOLLOUT : 0);
+		ev.data.fd = fd;
+		if (!events)
+			epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, fd, &ev);
+		else if (!old_events || (epoll_ctl(m_epoll_fd, EPOLL_CTL_MOD, fd, &ev) != 0 && errno == ENOENT))
+			epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+#endif
+	}
+
+	void Wake()
+	{
+		const char c = 0;
+#ifdef _WIN32
+		send(m_wake_fds[1], &c, 1, 0);
+#else
+		if (write(m_wake_fds[1], &c, 1) < 0)
+			ERROR_LOG(WII_IPC_NET, "Failed to wake the socket thread: %s", strerror(errno));
+#endif
+	}
+
+	// Blocks until a watched socket is ready or Wake() is called, and returns
+	// the ready sockets. Sockets with an error or a hangup are in both lists.
+	void Wait(std::vector<s32>* ready, std::vector<s32>* failed)
+	{
+		ready->clear();
+		failed->clear();
+
+#ifdef __linux__
+		epoll_event events[64];
+		int count = epoll_wait(m_epoll_fd, events, 64, -1);
+		for (int i = 0; i < count; i++)
+		{
+			if (events[i].data.fd == m_wake_fds[0])
+			{
+				DrainWakeups();
+				continue;
+			}
+
+			ready->push_back(events[i].data.fd);
+			if (events[i].events & (EPOLLERR | EPOLLHUP))
+				failed->push_back(events[i].data.fd);
+		}
+#else
+		{
+			std::lock_guard<std::mutex> lk(m_watched_lock);
+			m_pollfds.clear();
+			m_pollfds.push_back({m_wake_fds[0], POLLIN, 0});
+			for (const auto& watched : m_watched)
+				m_pollfds.push_back({watched.first, watched.second, 0});
+		}
+
+		if (poll(m_pollfds.data(), (unsigned long)m_pollfds.size(), -1) <= 0)
+			return;
+
+		if (m_pollfds[0].revents)
+			DrainWakeups();
+		for (size_t i = 1; i < m_pollfds.size(); i++)
+		{
+			if (m_pollfds[i].revents)
+				ready->push_back(m_pollfds[i].fd);
+			if (m_pollfds[i].revents & (POLLERR | POLLHUP | POLLNVAL))
+				failed->push_back(m_pollfds[i].fd);
+		}
+#endif
+	}
+
+private:
+	void DrainWakeups()
+	{
+		char buffer[64];
+#ifdef _WIN32
+		while (recv(m_wake_fds[0], buffer, sizeof(buffer), 0) > 0) {}
+#else
+		while (read(m_wake_fds[0], buffer, sizeof(buffer)) > 0) {}
+#endif
+	}
+
+	s32 m_wake_fds[2]; // read end, write end
+	std::mutex m_watched_lock;
+	std::unordered_map<s32, short> m_watched;
+#ifdef __linux__
+	int m_epoll_fd;
+#else
+	std::vector<pollfd_t> m_pollfds;
+#endif
+};
+
+WiiSockMan::WiiSockMan()
+{
+}
+
+WiiSockMan::~WiiSockMan()
+{
+	Clean();
+}
+
+void WiiSockMan::Clean()
+{
+	if (m_thread_running.TestAndClear())
+	{
+		{
+			std::lock_guard<std::recursive_mutex> lk(m_mutex);
+			m_pause_cv.notify_all();
+		}
+		m_poller->Wake();
+		m_thread.join();
+	}
+
+	std::lock_guard<std::recursive_mutex> lk(m_mutex);
+	WiiSockets.clear();
+	m_sockets_to_update.clear();
+	m_poller.reset();
+}
+
+void WiiSockMan::StartNetworkThread()
+{
+	if (m_thread_running.IsSet())
+		return;
+
+	m_poller.reset(new Poller());
+	m_thread_running.Set();
+	m_thread = std::thread(&WiiSockMan::NetworkThread, this);
+}
+
+void WiiSockMan::WakeNetworkThread()
+{
+	if (m_poller)
+		m_poller->Wake();
+}
+
+void WiiSockMan::NetworkThread()
+{
+	Common::SetCurrentThreadName("Wii Socket Thread");
+
+	std::vector<s32> ready, failed;
+	while (m_thread_running.IsSet())
+	{
+		{
+			std::unique_lock<std::recursive_mutex> lk(m_mutex);
+			m_pause_cv.wait(lk, [this] { return !m_paused || !m_thread_running.IsSet(); });
+		}
+
+		m_poller->Wait(&ready, &failed);
+
+		std::lock_guard<std::recursive_mutex> lk(m_mutex);
+		// Paused while waiting. The poller still reports the ready sockets after
+		// the pause, so they can be left for then.
+		if (m_paused)
+			continue;
+
+		m_sockets_to_update.insert(ready.begin(), ready.end());
+		for (s32 fd : m_sockets_to_update)
+		{
+			auto socket_entry = WiiSockets.find(fd);
+			if (socket_entry != WiiSockets.end())
+				UpdateSocket(socket_entry->second);
+		}
+		m_sockets_to_update.clear();
+
+		// An error or a hangup keeps the socket ready, so operations that still
+		// didn't complete above would be retried forever. Fail them instead.
+		for (s32 fd : failed)
+		{
+			auto socket_entry = WiiSockets.find(fd);
+			if (socket_entry == WiiSockets.end())
+				continue;
+
+			socket_entry->second.AbortPendingOps();
+			m_poller->Watch(fd, false, false);
+		}
+	}
+}
+
+void WiiSockMan::AbortSSLOps(int ssl_id)
+{
+	// The network thread runs the operations with the lock held, so once it is
+	// taken none of them is using the context anymore.
+	std::lock_guard<std::recursive_mutex> lk(m_mutex);
+	for (auto& socket_entry : WiiSockets)
+	{
+		if (socket_entry.second.pending_sockops.empty())
+			continue;
+
+		// Let the network thread stop watching for the aborted operations.
+		socket_entry.second.AbortPendingOps(ssl_id);
+		m_sockets_to_update.insert(socket_entry.first);
+	}
+	WakeNetworkThread();
+}
+
+// Tries the socket's pending operations, and waits for it to become ready
+// again if some of them are still blocked.
+void WiiSockMan::UpdateSocket(WiiSocket& sock)
+{
+	if (!sock.IsValid())
+		return;
+
+	sock.Update();
+
+	bool read, write;
+	sock.GetWantedEvents(&read, &write);
+	m_poller->Watch(sock.fd, read, write);
+}
+
+// Called with m_mutex held: from NewSocket, or from the network thread when
+// a socket accepts a connection.
 void WiiSockMan::AddSocket(s32 fd)
 {
 	if (fd >= 0)
@@ -569,67 +910,56 @@ s32 WiiSockMan::NewSocket(s32 af, s32 type, s32 protocol)
 {
 	s32 fd = (s32)socket(af, type, protocol);
 	s32 ret = GetNetErrorCode(fd, "NewSocket", false);
+
+	std::lock_guard<std::recursive_mutex> lk(m_mutex);
+	StartNetworkThread();
 	AddSocket(ret);
 	return ret;
 }
 
 s32 WiiSockMan::DeleteSocket(s32 s)
 {
+	std::lock_guard<std::recursive_mutex> lk(m_mutex);
 	auto socket_entry = WiiSockets.find(s);
+	if (socket_entry == WiiSockets.end())
+		return -SO_EBADF;
+
+	// Stop watching before the descriptor can be reused.
+	if (m_poller)
+	{
+		m_poller->Watch(s, false, false);
+		m_poller->Wake();
+	}
 	s32 ReturnValue = socket_entry->second.CloseFd();
 	WiiSockets.erase(socket_entry);
 	return ReturnValue;
 }
 
-void WiiSockMan::Update()
+s32 WiiSockMan::GetLastNetError(s32 sock)
 {
-	s32 nfds = 0;
-	fd_set read_fds, write_fds, except_fds;
-	struct timeval t = {0,0};
-	FD_ZERO(&read_fds);
-	FD_ZERO(&write_fds);
-	FD_ZERO(&except_fds);
-
-	auto socket_iter = WiiSockets.begin();
-	auto end_socks = WiiSockets.end();
+	std::lock_guard<std::recursive_mutex> lk(m_mutex);
+	auto socket_entry = WiiSockets.find(sock);
+	return socket_entry != WiiSockets.end() ? socket_entry->second.last_error : -SO_EBADF;
+}
 
-	while (socket_iter != end_socks)
-	{
-		WiiSocket& sock = socket_iter->second;
-		if (sock.IsValid())
-		{
-			FD_SET(sock.fd, &read_fds);
-			FD_SET(sock.fd, &write_fds);
-			FD_SET(sock.fd, &except_fds);
-			nfds = std::max(nfds, sock.fd+1);
-			++socket_iter;
-		}
-		else
-		{
-			// Good time to clean up invalid sockets.
-			socket_iter = WiiSockets.erase(socket_iter);
-		}
-	}
-	s32 ret = select(nfds, &read_fds, &write_fds, &except_fds, &t);
+void WiiSockMan::SetLastNetError(s32 sock, s32 error)
+{
+	std::lock_guard<std::recursive_mutex> lk(m_mutex);
+	auto socket_entry = WiiSockets.find(sock);
+	if (socket_entry != WiiSockets.end())
+		socket_entry->second.last_error = error;
+}
 
-	if (ret >= 0)
-	{
-		for (auto& pair : WiiSockets)
-		{
-			WiiSocket& sock = pair.second;
-			sock.Update(
-				FD_ISSET(sock.fd, &read_fds) != 0,
-				FD_ISSET(sock.fd, &write_fds) != 0,
-				FD_ISSET(sock.fd, &except_fds) != 0
-			);
-		}
-	}
-	else
+void WiiSockMan::PauseAndLock(bool doLock)
+{
+	// The network thread only touches the sockets and guest memory with the
+	// lock held, so it is idle once the lock is taken here.
+	std::lock_guard<std::recursive_mutex> lk(m_mutex);
+	m_paused = doLock;
+	if (!doLock)
 	{
-		for (auto& elem : WiiSockets)
-		{
-			elem.second.Update(false, false, false);
-		}
+		m_pause_cv.notify_all();
+		WakeNetworkThread();
 	}
 }
 
@@ -643,7 +973,10 @@ void WiiSockMan::EnqueueReply(u32 CommandAddress, s32 ReturnValue, IPCCommandTyp
 	// Return value
 	Memory::Write_U32(ReturnValue, CommandAddress + 4);
 
-	WII_IPC_HLE_Interface::EnqueueReply(CommandAddress);
+	if (Core::IsCPUThread())
+		WII_IPC_HLE_Interface::EnqueueReply(CommandAddress);
+	else
+		WII_IPC_HLE_Interface::EnqueueReply_Threadsafe(CommandAddress);
 }
 
 
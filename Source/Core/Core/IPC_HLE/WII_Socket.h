@@ -42,12 +42,18 @@ typedef struct pollfd pollfd_t;
 #endif
 
 #include <algorithm>
+#include <condition_variable>
 #include <cstdio>
 #include <list>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <unordered_set>
 
 #include "Common/CommonTypes.h"
+#include "Common/Flag.h"
 #include "Common/NonCopyable.h"
 #include "Core/IPC_HLE/WII_IPC_HLE.h"
 #include "Core/IPC_HLE/WII_IPC_HLE_Device_net.h"
@@ -176,10 +182,14 @@ class WiiSocket
 			NET_IOCTL net_type;
 			SSL_IOCTL ssl_type;
 		};
+		// What the socket has to become ready for before retrying a blocked operation.
+		bool wait_write;
 	};
 private:
 	s32 fd;
 	bool nonBlock;
+	// Result of the last call on the socket, for SO_ERROR.
+	s32 last_error;
 	std::list<sockop> pending_sockops;
 
 	friend class WiiSockMan;
@@ -189,10 +199,12 @@ private:
 
 	void DoSock(u32 _CommandAddress, NET_IOCTL type);
 	void DoSock(u32 _CommandAddress, SSL_IOCTL type);
-	void Update(bool read, bool write, bool except);
+	void Update();
+	void AbortPendingOps(int ssl_id = -1);
+	void GetWantedEvents(bool* read, bool* write) const;
 	bool IsValid() const { return fd >= 0; }
 public:
-	WiiSocket() : fd(-1), nonBlock(false) {}
+	WiiSocket() : fd(-1), nonBlock(false), last_error(0) {}
 	~WiiSocket();
 	void operator=(WiiSocket const&) = delete;
 
@@ -209,7 +221,7 @@ public:
 		static WiiSockMan instance; // Guaranteed to be destroyed.
 		return instance;            // Instantiated on first use.
 	}
-	void Update();
+	// Thread safe: the replies are completed from the network thread.
 	static void EnqueueReply(u32 CommandAddress, s32 ReturnValue, IPCCommandType CommandType);
 	static void Convert(WiiSockAddrIn const & from, sockaddr_in& to);
 	static void Convert(sockaddr_in const & from, WiiSockAddrIn& to, s32 addrlen = -1);
@@ -217,17 +229,18 @@ public:
 	s32 NewSocket(s32 af, s32 type, s32 protocol);
 	void AddSocket(s32 fd);
 	s32 DeleteSocket(s32 s);
-	s32 GetLastNetError() const { return errno_last; }
-	void SetLastNetError(s32 error) { errno_last = error; }
+	s32 GetLastNetError(s32 sock);
+	void SetLastNetError(s32 sock, s32 error);
 
-	void Clean()
-	{
-		WiiSockets.clear();
-	}
+	// Stops the network thread and closes all sockets.
+	void Clean();
 
+	// Queues the operation on the socket. The network thread tries it right
+	// away, and again every time the socket becomes ready, until it completes.
 	template <typename T>
 	void DoSock(s32 sock, u32 CommandAddress, T type)
 	{
+		std::lock_guard<std::recursive_mutex> lk(m_mutex);
 		auto socket_entry = WiiSockets.find(sock);
 		if (socket_entry == WiiSockets.end())
 		{
@@ -240,14 +253,47 @@ public:
 		else
 		{
 			socket_entry->second.DoSock(CommandAddress, type);
+			m_sockets_to_update.insert(sock);
+			WakeNetworkThread();
 		}
 	}
 
+	// Fails the operations queued on the SSL context, so that it can be freed.
+	void AbortSSLOps(int ssl_id);
+
+	// The network thread runs the SSL operations with this held, so it has to
+	// be held to touch an SSL context from anywhere else.
+	std::recursive_mutex& GetSSLMutex() { return m_mutex; }
+
+	// Keeps the network thread from completing operations, writing to guest
+	// memory or queueing replies until unlocked. Returns once it's idle.
+	void PauseAndLock(bool doLock);
+
 	void UpdateWantDeterminism(bool want);
 
 private:
-	WiiSockMan() = default;
+	class Poller;
+
+	WiiSockMan();
+	~WiiSockMan();
 
+	void StartNetworkThread();
+	void WakeNetworkThread();
+	void NetworkThread();
+	void UpdateSocket(WiiSocket& sock);
+
+	// Guards the sockets and their pending operations, which are shared with
+	// the network thread. Guest memory is only touched by the network thread
+	// for operations the guest is waiting on.
+	std::recursive_mutex m_mutex;
 	std::unordered_map<s32, WiiSocket> WiiSockets;
-	s32 errno_last;
+	// Sockets with new operations or readiness events, for the network thread.
+	std::unordered_set<s32> m_sockets_to_update;
+	// Set by PauseAndLock; the network thread waits on m_pause_cv while set.
+	bool m_paused = false;
+	std::condition_variable_any m_pause_cv;
+
+	std::unique_ptr<Poller> m_poller;
+	std::thread m_thread;
+	Common::Flag m_thread_running;
 };
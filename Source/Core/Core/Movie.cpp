@@ -2,7 +2,11 @@
 // Licensed under GPLv2+
 // Refer to the license.txt file included.
 
+#include <algorithm>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <vector>
 #include <mbedtls/config.h>
 #include <mbedtls/md.h>
 
@@ -24,6 +28,7 @@
 #include "Core/DSP/DSPCore.h"
 #include "Core/HW/DVDInterface.h"
 #include "Core/HW/EXI_Device.h"
+#include "Core/HW/Memmap.h"
 #include "Core/HW/ProcessorInterface.h"
 #include "Core/HW/SI.h"
 #include "Core/HW/Wiimote.h"
@@ -37,8 +42,6 @@
 #include "InputCommon/GCPadStatus.h"
 #include "VideoCommon/VideoConfig.h"
 
-// The chunk to allocate movie data in multiples of.
-#define DTM_BASE_LENGTH (1024)
 
 static std::mutex cs_frameSkip;
 
@@ -55,8 +58,6 @@ static u32 s_framesToSkip = 0, s_frameSkipCounter = 0;
 static u8 s_numPads = 0;
 static ControllerState s_padState;
 static DTMHeader tmpHeader;
-static u8* tmpInput = nullptr;
-static size_t tmpInputAllocated = 0;
 static u64 s_currentByte = 0, s_totalBytes = 0;
 u64 g_currentFrame = 0, g_totalFrames = 0; // VI
 u64 g_currentLagCount = 0;
@@ -67,6 +68,7 @@ static u64 s_recordingStartTime; // seconds since 1970 that recording started
 static bool s_bSaveConfig = false, s_bSkipIdle = false, s_bDualCore = false;
 static bool s_bProgressive = false, s_bPAL60 = false;
 static bool s_bDSPHLE = false, s_bFastDiscSpeed = false;
+static bool s_bDSPThread = false;
 static bool s_bSyncGPU = false, s_bNetPlay = false;
 static std::string s_videoBackend = "unknown";
 static int s_iCPUCore = 1;
@@ -90,25 +92,237 @@ static std::string s_InputDisplay[8];
 static GCManipFunction gcmfunc = nullptr;
 static WiiManipFunction wiimfunc = nullptr;
 
-static void EnsureTmpInputSize(size_t bound)
+// The input log is kept in fixed-size chunks, so that recording never has to
+// copy what is already there to grow it. A movie being played back is read from
+// its file a chunk at a time as playback gets there, instead of all at once.
+//
+// SaveRecording only writes what changed since the last time it saved to the
+// same file, so every file that has been saved to remembers how many of its
+// input bytes still match. Rewriting recorded input (after loading a state in
+// read-write mode) lowers that for all of them.
+static const size_t INPUT_CHUNK_SIZE = 1 << 20;
+static std::mutex s_input_mutex;
+static std::vector<std::unique_ptr<u8[]>> s_input_chunks;
+static bool s_has_input = false;
+static File::IOFile s_input_file;
+static std::string s_input_filename;
+static u64 s_input_file_bytes = 0;
+static std::map<std::string, u64> s_synced_bytes;
+
+// Must be called with s_input_mutex held.
+static u8* GetInputChunk(u64 offset)
+{
+	const size_t index = (size_t)(offset / INPUT_CHUNK_SIZE);
+	if (index >= s_input_chunks.size())
+		s_input_chunks.resize(index + 1);
+
+	std::unique_ptr<u8[]>& chunk = s_input_chunks[index];
+	if (!chunk)
+	{
+		chunk.reset(new u8[INPUT_CHUNK_SIZE]());
+		const u64 start = (u64)index * INPUT_CHUNK_SIZE;
+		if (start < s_input_file_bytes)
+		{
+			const size_t size = (size_t)std::min<u64>(INPUT_CHUNK_SIZE, s_input_file_bytes - start);
+			if (!s_input_file.Seek(256 + start, SEEK_SET) || !s_input_file.ReadBytes(chunk.get(), size))
+				PanicAlertT("Failed to read movie input from %s", s_input_filename.c_str());
+		}
+	}
+	return chunk.get();
+}
+
+static void ReadInputBytes(u64 offset, void* dst, size_t size)
+{
+	std::lock_guard<std::mutex> lk(s_input_mutex);
+	u8* out = static_cast<u8*>(dst);
+	while (size)
+	{
+		const size_t chunk_offset = (size_t)(offset % INPUT_CHUNK_SIZE);
+		const size_t count = std::min(size, INPUT_CHUNK_SIZE - chunk_offset);
+		memcpy(out, GetInputChunk(offset) + chunk_offset, count);
+		out += count;
+		offset += count;
+		size -= count;
+	}
+}
+
+static void WriteInputBytes(u64 offset, const void* src, size_t size)
+{
+	std::lock_guard<std::mutex> lk(s_input_mutex);
+	for (auto& synced : s_synced_bytes)
+		synced.second = std::min(synced.second, offset);
+
+	const u8* in = static_cast<const u8*>(src);
+	while (size)
+	{
+		const size_t chunk_offset = (size_t)(offset % INPUT_CHUNK_SIZE);
+		const size_t count = std::min(size, INPUT_CHUNK_SIZE - chunk_offset);
+		memcpy(GetInputChunk(offset) + chunk_offset, in, count);
+		in += count;
+		offset += count;
+		size -= count;
+	}
+}
+
+// Drops the input log. With a filename, the log becomes the input of that
+// movie, loaded lazily.
+static void ResetInput(const std::string& filename = "")
+{
+	std::lock_guard<std::mutex> lk(s_input_mutex);
+	s_input_chunks.clear();
+	s_input_file.Close();
+	s_input_filename = filename;
+	s_input_file_bytes = 0;
+	s_synced_bytes.clear();
+	if (!filename.empty() && s_input_file.Open(filename, "rb"))
+	{
+		s_input_file_bytes = s_input_file.GetSize() - 256;
+		s_synced_bytes[filename] = s_input_file_bytes;
+	}
+}
+
+// With a hash interval set, MEM1, MEM2 and the main CPU registers are hashed
+// every that many inputs while recording, and the hashes are saved next to the
+// movie. Playback hashes at the same inputs and remembers the first mismatch.
+// They are taken on the CPU thread when the input is polled, where the state
+// is the same every time the movie is played back.
+struct StateHashHeader
+{
+	u32 magic;
+	u32 interval;
+	u64 count;
+};
+
+static const u32 STATE_HASH_MAGIC = 0x48535444; // "DTSH"
+static std::vector<StateHash> s_state_hashes; // guarded by s_input_mutex
+static u32 s_state_hash_interval = 0;
+static bool s_diverged = false;
+static u64 s_divergent_frame = 0;
+static u64 s_checked_state_hashes = 0;
+
+std::string GetStateHashFilename(const std::string& movie_filename)
+{
+	return movie_filename + ".hashes";
+}
+
+bool ReadStateHashes(const std::string& filename, u32* interval, std::vector<StateHash>* hashes)
+{
+	File::IOFile file(filename, "rb");
+	StateHashHeader header;
+	if (!file.ReadArray(&header, 1) || header.magic != STATE_HASH_MAGIC || header.interval == 0 ||
+	    header.count > file.GetSize() / sizeof(StateHash))
+		return false;
+
+	std::vector<StateHash> entries((size_t)header.count);
+	if (!file.ReadArray(entries.data(), entries.size()))
+		return false;
+	*interval = header.interval;
+	*hashes = std::move(entries);
+	return true;
+}
+
+bool WriteStateHashes(const std::string& filename, u32 interval, const std::vector<StateHash>& hashes, u64 input_count)
 {
-	if (tmpInputAllocated >= bound)
+	auto end = std::upper_bound(hashes.begin(), hashes.end(), input_count,
+		[](u64 count, const StateHash& entry) { return count < entry.input_count; });
+	StateHashHeader header = { STATE_HASH_MAGIC, interval, (u64)(end - hashes.begin()) };
+
+	File::IOFile file(filename, "wb");
+	return file.WriteArray(&header, 1) && file.WriteArray(hashes.data(), (size_t)header.count);
+}
+
+void AddStateHash(std::vector<StateHash>* hashes, const StateHash& entry)
+{
+	// Anything at or after this input was recorded before a rerecord.
+	while (!hashes->empty() && hashes->back().input_count >= entry.input_count)
+		hashes->pop_back();
+	hashes->push_back(entry);
+}
+
+const StateHash* FindStateHash(const std::vector<StateHash>& hashes, u64 input_count)
+{
+	auto it = std::lower_bound(hashes.begin(), hashes.end(), input_count,
+		[](const StateHash& entry, u64 count) { return entry.input_count < count; });
+	if (it == hashes.end() || it->input_count != input_count)
+		return nullptr;
+	return &*it;
+}
+
+static void LoadStateHashes(const std::string& movie_filename)
+{
+	std::lock_guard<std::mutex> lk(s_input_mutex);
+	s_state_hashes.clear();
+	s_state_hash_interval = 0;
+	ReadStateHashes(GetStateHashFilename(movie_filename), &s_state_hash_interval, &s_state_hashes);
+}
+
+// Must be called with s_input_mutex held.
+static bool SaveStateHashes(const std::string& movie_filename)
+{
+	const std::string filename = GetStateHashFilename(movie_filename);
+	if (s_state_hash_interval == 0)
+		return !File::Exists(filename) || File::Delete(filename);
+	return WriteStateHashes(filename, s_state_hash_interval, s_state_hashes, g_totalInputCount);
+}
+
+u64 HashEmulatedState()
+{
+	// Not GetHash64, which depends on the host CPU.
+	u64 hash = GetMurmurHash3(Memory::m_pRAM, Memory::REALRAM_SIZE, 0);
+	if (SConfig::GetInstance().bWii)
+		hash = hash * 31 + GetMurmurHash3(Memory::m_pEXRAM, Memory::EXRAM_SIZE, 0);
+	hash = hash * 31 + GetMurmurHash3((const u8*)PowerPC::ppcState.gpr, sizeof(PowerPC::ppcState.gpr), 0);
+	hash = hash * 31 + GetMurmurHash3((const u8*)PowerPC::ppcState.ps, sizeof(PowerPC::ppcState.ps), 0);
+	hash = hash * 31 + PowerPC::ppcState.pc;
+	hash = hash * 31 + PowerPC::ppcState.msr;
+	return hash;
+}
+
+// Called on the CPU thread after g_currentInputCount has been incremented.
+static void CheckStateHash()
+{
+	if (IsRecordingInput() && s_state_hash_interval == 0)
+		s_state_hash_interval = SConfig::GetInstance().m_MovieStateHashInterval;
+	if (s_state_hash_interval == 0 || g_currentInputCount % s_state_hash_interval != 0)
 		return;
-	// The buffer expands in powers of two of DTM_BASE_LENGTH
-	// (standard exponential buffer growth).
-	size_t newAlloc = DTM_BASE_LENGTH;
-	while (newAlloc < bound)
-		newAlloc *= 2;
-
-	u8* newTmpInput = new u8[newAlloc];
-	tmpInputAllocated = newAlloc;
-	if (tmpInput != nullptr)
+
+	if (IsRecordingInput())
 	{
-		if (s_totalBytes > 0)
-			memcpy(newTmpInput, tmpInput, (size_t)s_totalBytes);
-		delete[] tmpInput;
+		const StateHash entry = { g_currentInputCount, g_currentFrame, HashEmulatedState() };
+		std::lock_guard<std::mutex> lk(s_input_mutex);
+		AddStateHash(&s_state_hashes, entry);
+	}
+	else if (IsPlayingInput() && !s_diverged)
+	{
+		std::unique_lock<std::mutex> lk(s_input_mutex);
+		const StateHash* found = FindStateHash(s_state_hashes, g_currentInputCount);
+		if (!found)
+			return;
+		const StateHash expected = *found;
+		lk.unlock();
+
+		s_checked_state_hashes++;
+		if (HashEmulatedState() != expected.hash)
+		{
+			s_diverged = true;
+			s_divergent_frame = expected.frame;
+			ERROR_LOG(COMMON, "Movie playback diverged from the recording at frame %llu (input %llu)",
+			          (unsigned long long)expected.frame, (unsigned long long)expected.input_count);
+			Core::DisplayMessage(StringFromFormat("Movie desynced at frame %llu", (unsigned long long)expected.frame), 5000);
+		}
 	}
-	tmpInput = newTmpInput;
+}
+
+bool GetFirstDivergence(u64* frame)
+{
+	if (s_diverged)
+		*frame = s_divergent_frame;
+	return s_diverged;
+}
+
+u64 GetCheckedStateHashCount()
+{
+	return s_checked_state_hashes;
 }
 
 static bool IsMovieHeader(u8 magic[4])
@@ -162,8 +376,15 @@ void FrameUpdate()
 
 	// ("framestop") the only purpose of this is to cause interpreter/jit Run() to return temporarily.
 	// after that we set it back to CPU_RUNNING and continue as normal.
+	// A Stop from the UI thread must not be overwritten.
 	if (s_bFrameStop)
-		*PowerPC::GetStatePtr() = PowerPC::CPU_STEPPING;
+	{
+		PowerPC::CPUState expected = PowerPC::GetState();
+		while (expected != PowerPC::CPU_POWERDOWN &&
+		       !PowerPC::GetStatePtr()->compare_exchange_weak(expected, PowerPC::CPU_STEPPING))
+		{
+		}
+	}
 
 	if (s_framesToSkip)
 		FrameSkipping();
@@ -228,6 +449,7 @@ void InputUpdate()
 		s_totalTickCount += CoreTiming::GetTicks() - s_tickCountAtLastInput;
 		s_tickCountAtLastInput = CoreTiming::GetTicks();
 	}
+	CheckStateHash();
 
 	if (IsPlayingInput() && g_currentInputCount == (g_totalInputCount - 1) && SConfig::GetInstance().m_PauseMovie)
 		Core::SetState(Core::CORE_PAUSE);
@@ -379,6 +601,11 @@ bool IsDSPHLE()
 	return s_bDSPHLE;
 }
 
+bool IsDSPThread()
+{
+	return s_bDSPThread;
+}
+
 bool IsFastDiscSpeed()
 {
 	return s_bFastDiscSpeed;
@@ -502,7 +729,13 @@ bool BeginRecordingInput(int controllers)
 	}
 	s_playMode = MODE_RECORDING;
 	s_author = SConfig::GetInstance().m_strMovieAuthor;
-	EnsureTmpInputSize(1);
+	ResetInput();
+	s_has_input = true;
+	{
+		std::lock_guard<std::mutex> lk(s_input_mutex);
+		s_state_hashes.clear();
+	}
+	s_state_hash_interval = SConfig::GetInstance().m_MovieStateHashInterval;
 
 	s_currentByte = s_totalBytes = 0;
 
@@ -757,8 +990,7 @@ void RecordInput(GCPadStatus* PadStatus, int controllerID)
 
 	CheckPadStatus(PadStatus, controllerID);
 
-	EnsureTmpInputSize((size_t)(s_currentByte + 8));
-	memcpy(&(tmpInput[s_currentByte]), &s_padState, 8);
+	WriteInputBytes(s_currentByte, &s_padState, 8);
 	s_currentByte += 8;
 	s_totalBytes = s_currentByte;
 }
@@ -777,9 +1009,8 @@ void RecordWiimote(int wiimote, u8 *data, u8 size)
 		return;
 
 	InputUpdate();
-	EnsureTmpInputSize((size_t)(s_currentByte + size + 1));
-	tmpInput[s_currentByte++] = size;
-	memcpy(&(tmpInput[s_currentByte]), data, size);
+	WriteInputBytes(s_currentByte++, &size, 1);
+	WriteInputBytes(s_currentByte, data, size);
 	s_currentByte += size;
 	s_totalBytes = s_currentByte;
 }
@@ -799,6 +1030,7 @@ void ReadHeader()
 		s_bProgressive = tmpHeader.bProgressive;
 		s_bPAL60 = tmpHeader.bPAL60;
 		s_bDSPHLE = tmpHeader.bDSPHLE;
+		s_bDSPThread = tmpHeader.bDSPThread;
 		s_bFastDiscSpeed = tmpHeader.bFastDiscSpeed;
 		s_iCPUCore = tmpHeader.CPUCore;
 		g_bClearSave = tmpHeader.bClearSave;
@@ -856,11 +1088,14 @@ bool PlayInput(const std::string& filename)
 
 	Core::UpdateWantDeterminism();
 
-	s_totalBytes = g_recordfd.GetSize() - 256;
-	EnsureTmpInputSize((size_t)s_totalBytes);
-	g_recordfd.ReadArray(tmpInput, (size_t)s_totalBytes);
-	s_currentByte = 0;
 	g_recordfd.Close();
+	ResetInput(filename);
+	s_has_input = true;
+	LoadStateHashes(filename);
+	s_diverged = false;
+	s_checked_state_hashes = 0;
+	s_totalBytes = s_input_file_bytes;
+	s_currentByte = 0;
 
 	// Load savestate (and skip to frame data)
 	if (tmpHeader.bFromSaveState)
@@ -929,16 +1164,39 @@ void LoadInput(const std::string& filename)
 		afterEnd = true;
 	}
 
-	if (!s_bReadOnly || tmpInput == nullptr)
+	if (!s_bReadOnly || !s_has_input)
 	{
 		g_totalFrames = tmpHeader.frameCount;
 		s_totalLagCount = tmpHeader.lagCount;
 		g_totalInputCount = tmpHeader.inputCount;
 		s_totalTickCount = s_tickCountAtLastInput = tmpHeader.tickCount;
 
-		EnsureTmpInputSize((size_t)totalSavedBytes);
+		// Only what differs from the current input gets replaced, so files
+		// saved earlier don't need to be written out again from the start.
+		std::vector<u8> saved(std::min<u64>(INPUT_CHUNK_SIZE, totalSavedBytes));
+		std::vector<u8> current(saved.size());
+		bool same = s_has_input;
+		for (u64 offset = 0; offset < totalSavedBytes; offset += saved.size())
+		{
+			const size_t size = (size_t)std::min<u64>(saved.size(), totalSavedBytes - offset);
+			t_record.ReadBytes(saved.data(), size);
+			if (same && offset + size <= s_totalBytes)
+			{
+				ReadInputBytes(offset, current.data(), size);
+				if (!memcmp(saved.data(), current.data(), size))
+					continue;
+			}
+			same = false;
+			WriteInputBytes(offset, saved.data(), size);
+		}
+		{
+			std::lock_guard<std::mutex> lk(s_input_mutex);
+			for (auto& synced : s_synced_bytes)
+				synced.second = std::min(synced.second, totalSavedBytes);
+			s_synced_bytes[filename] = totalSavedBytes;
+		}
 		s_totalBytes = totalSavedBytes;
-		t_record.ReadArray(tmpInput, (size_t)s_totalBytes);
+		s_has_input = true;
 	}
 	else if (s_currentByte > 0)
 	{
@@ -956,6 +1214,8 @@ void LoadInput(const std::string& filename)
 			u32 len = (u32)s_currentByte;
 			u8* movInput = new u8[len];
 			t_record.ReadArray(movInput, (size_t)len);
+			std::vector<u8> tmpInput(len);
+			ReadInputBytes(0, tmpInput.data(), len);
 			for (u32 i = 0; i < len; ++i)
 			{
 				if (movInput[i] != tmpInput[i])
@@ -966,7 +1226,7 @@ void LoadInput(const std::string& filename)
 					{
 						// TODO: more detail
 						PanicAlertT("Warning: You loaded a save whose movie mismatches on byte %d (0x%X). You should load another save before continuing, or load this state with read-only mode off. Otherwise you'll probably get a desync.", i+256, i+256);
-						memcpy(tmpInput, movInput, s_currentByte);
+						WriteInputBytes(0, movInput, (size_t)s_currentByte);
 					}
 					else
 					{
@@ -1037,7 +1297,7 @@ void PlayController(GCPadStatus* PadStatus, int controllerID)
 {
 	// Correct playback is entirely dependent on the emulator polling the controllers
 	// in the same order done during recording
-	if (!IsPlayingInput() || !IsUsingPad(controllerID) || tmpInput == nullptr)
+	if (!IsPlayingInput() || !IsUsingPad(controllerID) || !s_has_input)
 		return;
 
 	if (s_currentByte + 8 > s_totalBytes)
@@ -1053,7 +1313,7 @@ void PlayController(GCPadStatus* PadStatus, int controllerID)
 	PadStatus->err = e;
 
 
-	memcpy(&s_padState, &(tmpInput[s_currentByte]), 8);
+	ReadInputBytes(s_currentByte, &s_padState, 8);
 	s_currentByte += 8;
 
 	PadStatus->triggerLeft = s_padState.TriggerL;
@@ -1135,7 +1395,7 @@ void PlayController(GCPadStatus* PadStatus, int controllerID)
 
 bool PlayWiimote(int wiimote, u8 *data, const WiimoteEmu::ReportFeatures& rptf, int ext, const wiimote_key key)
 {
-	if (!IsPlayingInput() || !IsUsingWiimote(wiimote) || tmpInput == nullptr)
+	if (!IsPlayingInput() || !IsUsingWiimote(wiimote) || !s_has_input)
 		return false;
 
 	if (s_currentByte > s_totalBytes)
@@ -1147,7 +1407,8 @@ bool PlayWiimote(int wiimote, u8 *data, const WiimoteEmu::ReportFeatures& rptf,
 
 	u8 size = rptf.size;
 
-	u8 sizeInMovie = tmpInput[s_currentByte];
+	u8 sizeInMovie;
+	ReadInputBytes(s_currentByte, &sizeInMovie, 1);
 
 	if (size != sizeInMovie)
 	{
@@ -1166,10 +1427,11 @@ bool PlayWiimote(int wiimote, u8 *data, const WiimoteEmu::ReportFeatures& rptf,
 		return false;
 	}
 
-	memcpy(data, &(tmpInput[s_currentByte]), size);
+	ReadInputBytes(s_currentByte, data, size);
 	s_currentByte += size;
 
 	g_currentInputCount++;
+	CheckStateHash();
 
 	CheckInputEnd();
 	return true;
@@ -1192,14 +1454,53 @@ void EndPlayInput(bool cont)
 		s_bRecordingFromSaveState = false;
 		// we don't clear these things because otherwise we can't resume playback if we load a movie state later
 		//g_totalFrames = s_totalBytes = 0;
-		//delete tmpInput;
-		//tmpInput = nullptr;
+		//ResetInput();
 	}
 }
 
+// Writes the input in [start, end) at the current position of the file.
+// Must be called with s_input_mutex held.
+static bool WriteInputToFile(File::IOFile& file, u64 start, u64 end)
+{
+	bool good = true;
+	while (good && start < end)
+	{
+		const size_t chunk_offset = (size_t)(start % INPUT_CHUNK_SIZE);
+		const size_t count = (size_t)std::min<u64>(INPUT_CHUNK_SIZE - chunk_offset, end - start);
+		good = file.WriteBytes(GetInputChunk(start) + chunk_offset, count);
+		start += count;
+	}
+	return good;
+}
+
 void SaveRecording(const std::string& filename)
 {
-	File::IOFile save_record(filename, "wb");
+	std::unique_lock<std::mutex> lk(s_input_mutex);
+
+	// The movie being played back is about to be overwritten, so everything
+	// that hasn't been read from it yet has to be read now.
+	if (s_input_file.IsOpen() && File::GetSize(filename) && s_input_filename == filename)
+	{
+		for (u64 offset = 0; offset < s_input_file_bytes; offset += INPUT_CHUNK_SIZE)
+			GetInputChunk(offset);
+		s_input_file.Close();
+		s_input_file_bytes = 0;
+	}
+
+	// Only append to the file if its input still matches ours up to some point.
+	auto synced = s_synced_bytes.find(filename);
+	u64 start = 0;
+	File::IOFile save_record;
+	if (synced != s_synced_bytes.end() && File::GetSize(filename) >= 256 + synced->second &&
+	    save_record.Open(filename, "r+b"))
+	{
+		start = synced->second;
+	}
+	else
+	{
+		save_record.Open(filename, "wb");
+	}
+
 	// Create the real header now and write it
 	DTMHeader header;
 	memset(&header, 0, sizeof(DTMHeader));
@@ -1222,6 +1523,7 @@ void SaveRecording(const std::string& filename)
 	header.bProgressive = s_bProgressive;
 	header.bPAL60 = s_bPAL60;
 	header.bDSPHLE = s_bDSPHLE;
+	header.bDSPThread = s_bDSPThread;
 	header.bFastDiscSpeed = s_bFastDiscSpeed;
 	strncpy((char *)header.videoBackend, s_videoBackend.c_str(),ArraySize(header.videoBackend));
 	header.CPUCore = s_iCPUCore;
@@ -1251,7 +1553,17 @@ void SaveRecording(const std::string& filename)
 
 	save_record.WriteArray(&header, 1);
 
-	bool success = save_record.WriteArray(tmpInput, (size_t)s_totalBytes);
+	bool success = save_record.Seek(256 + start, SEEK_SET) && WriteInputToFile(save_record, start, s_totalBytes);
+	if (success && save_record.GetSize() > 256 + s_totalBytes)
+		success = save_record.Resize(256 + s_totalBytes);
+	save_record.Close();
+
+	if (success)
+		s_synced_bytes[filename] = s_totalBytes;
+	else
+		s_synced_bytes.erase(filename);
+	success = SaveStateHashes(filename) && success;
+	lk.unlock();
 
 	if (success && s_bRecordingFromSaveState)
 	{
@@ -1302,6 +1614,7 @@ void GetSettings()
 	s_bProgressive = SConfig::GetInstance().bProgressive;
 	s_bPAL60 = SConfig::GetInstance().bPAL60;
 	s_bDSPHLE = SConfig::GetInstance().bDSPHLE;
+	s_bDSPThread = SConfig::GetInstance().bDSPThread;
 	s_bFastDiscSpeed = SConfig::GetInstance().bFastDiscSpeed;
 	s_videoBackend = g_video_backend->GetName();
 	s_bSyncGPU = SConfig::GetInstance().bSyncGPU;
@@ -1385,8 +1698,12 @@ void GetMD5()
 void Shutdown()
 {
 	g_currentInputCount = g_totalInputCount = g_totalFrames = s_totalBytes = s_tickCountAtLastInput = 0;
-	delete [] tmpInput;
-	tmpInput = nullptr;
-	tmpInputAllocated = 0;
+	ResetInput();
+	s_has_input = false;
+	{
+		std::lock_guard<std::mutex> lk(s_input_mutex);
+		s_state_hashes.clear();
+	}
+	s_state_hash_interval = 0;
 }
 };
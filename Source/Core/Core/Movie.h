@@ -5,6 +5,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include "Common/CommonTypes.h"
 
@@ -102,7 +103,8 @@ struct DTMHeader
 	bool bSyncGPU;
 	bool bNetPlay;
 	bool bPAL60;
-	u8   reserved[12];      // Padding for any new config options
+	bool bDSPThread;        // DSP LLE ran on its own (lockstep) thread
+	u8   reserved[11];      // Padding for any new config options
 	u8   discChange[40];    // Name of iso file to switch to, for two disc games.
 	u8   revision[20];      // Git hash
 	u32  DSPiromHash;
@@ -135,6 +137,7 @@ bool IsProgressive();
 bool IsPAL60();
 bool IsSkipIdle();
 bool IsDSPHLE();
+bool IsDSPThread();
 bool IsFastDiscSpeed();
 int  GetCPUMode();
 bool IsStartingFromClearSave();
@@ -177,6 +180,32 @@ void CheckWiimoteStatus(int wiimote, u8* data, const struct WiimoteEmu::ReportFe
 
 std::string GetInputDisplay();
 
+// Returns true, and the frame it happened on, if playback no longer matches
+// the state hashes saved with the movie.
+bool GetFirstDivergence(u64* frame);
+// How many of those hashes have been compared so far during playback.
+u64 GetCheckedStateHashCount();
+// Hashes MEM1, MEM2 and the main CPU registers, the same way on every host.
+u64 HashEmulatedState();
+
+// The state hashes of a movie, sorted by input_count, are saved next to it.
+struct StateHash
+{
+	u64 input_count;
+	u64 frame;
+	u64 hash;
+};
+
+std::string GetStateHashFilename(const std::string& movie_filename);
+// Fails, and leaves the arguments alone, if the file is missing or damaged.
+bool ReadStateHashes(const std::string& filename, u32* interval, std::vector<StateHash>* hashes);
+// Only writes the hashes taken up to input_count.
+bool WriteStateHashes(const std::string& filename, u32 interval, const std::vector<StateHash>& hashes, u64 input_count);
+// Appends a new hash while recording, dropping those left over from before a rerecord.
+void AddStateHash(std::vector<StateHash>* hashes, const StateHash& entry);
+// Returns the hash taken at input_count, if there is one.
+const StateHash* FindStateHash(const std::vector<StateHash>& hashes, u64 input_count);
+
 // Done this way to avoid mixing of core and gui code
 typedef void(*GCManipFunction)(GCPadStatus*, int);
 typedef void(*WiiManipFunction)(u8*, WiimoteEmu::ReportFeatures, int, int, wiimote_key);
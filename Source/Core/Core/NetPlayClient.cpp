@@ -8,6 +8,7 @@
 #include "Core/Core.h"
 #include "Core/Movie.h"
 #include "Core/NetPlayClient.h"
+#include "Core/State.h"
 #include "Core/HW/EXI_DeviceIPL.h"
 #include "Core/HW/SI.h"
 #include "Core/HW/SI_DeviceDanceMat.h"
@@ -18,6 +19,7 @@
 #include "Core/HW/WiimoteReal/WiimoteReal.h"
 #include "Core/IPC_HLE/WII_IPC_HLE_Device_usb.h"
 #include "Core/IPC_HLE/WII_IPC_HLE_WiiMote.h"
+#include "Core/PowerPC/PowerPC.h"
 
 static std::mutex crit_netplay_client;
 static NetPlayClient * netplay_client = nullptr;
@@ -68,7 +70,15 @@ NetPlayClient::NetPlayClient(const std::string& address, const u16 port, NetPlay
 	, m_target_buffer_size()
 	, m_local_player(nullptr)
 	, m_current_game(0)
+	, m_pad_map()
+	, m_wiimote_map()
 	, m_is_recording(false)
+	, m_rollback(false)
+	, m_rollback_pending(false)
+	, m_rollback_unthrottled(false)
+	, m_rollback_verify(false)
+	, m_rollback_verifying(false)
+	, m_rollback_verify_hash(0)
 	, m_pid(0)
 	, m_connecting(false)
 	, m_traversal_client(nullptr)
@@ -386,7 +396,9 @@ unsigned int NetPlayClient::OnData(sf::Packet& packet)
 			packet >> g_NetPlaySettings.m_PAL60;
 			packet >> g_NetPlaySettings.m_DSPEnableJIT;
 			packet >> g_NetPlaySettings.m_DSPHLE;
+			packet >> g_NetPlaySettings.m_DSPThread;
 			packet >> g_NetPlaySettings.m_WriteToMemcard;
+			packet >> g_NetPlaySettings.m_Rollback;
 			packet >> g_NetPlaySettings.m_OCEnable;
 			packet >> g_NetPlaySettings.m_OCFactor;
 
@@ -688,9 +700,19 @@ bool NetPlayClient::StartGame(const std::string &path)
 	m_is_running.store(true);
 	NetPlay_Enable(this);
 
+	// Loading snapshots changes which blocks the JIT compiles, so either every
+	// player uses rollback or nobody does.
+	m_rollback = g_NetPlaySettings.m_Rollback;
+	m_rollback_verify = SConfig::GetInstance().bNetPlayVerifyRollback;
+
 	ClearBuffers();
 
-	if (m_dialog->IsRecording())
+	// Replaying polls would mess up a recording.
+	if (m_dialog->IsRecording() && m_rollback)
+	{
+		m_dialog->AppendChat(" -- Input is not recorded while the host uses rollback -- ");
+	}
+	else if (m_dialog->IsRecording())
 	{
 
 		if (Movie::IsReadOnly())
@@ -761,7 +783,88 @@ void NetPlayClient::ClearBuffers()
 
 		while (m_wiimote_buffer[i].Size())
 			m_wiimote_buffer[i].Pop();
+
+		m_rollback_pads[i].Reset();
 	}
+
+	m_pad_wait_histogram.clear();
+	m_wiimote_wait_histogram.clear();
+	for (unsigned int i = 0; i < 4; ++i)
+	{
+		if (m_pad_map[i] > 0)
+		{
+			for (auto& bucket : m_pad_wait_histogram[m_pad_map[i]])
+				bucket.store(0);
+		}
+		if (m_wiimote_map[i] > 0)
+		{
+			for (auto& bucket : m_wiimote_wait_histogram[m_wiimote_map[i]])
+				bucket.store(0);
+		}
+	}
+
+	m_rollback_pending = false;
+	m_rollback_verifying = false;
+	m_rollback_state.clear();
+}
+
+// called from ---CPU--- thread
+template <typename T>
+bool NetPlayClient::WaitForInput(NetInputBuffer<T>& buffer, T& value, InputWaitHistogram* histogram)
+{
+	const auto start = std::chrono::steady_clock::now();
+	while (!buffer.Pop(value))
+	{
+		if (!m_is_running.load())
+			return false;
+
+		// The timeout only matters for noticing that the game stopped.
+		buffer.WaitFor(std::chrono::milliseconds(10));
+	}
+
+	const auto waited = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+	int bucket = 0;
+	for (auto limit = 250; waited >= limit && bucket < INPUT_WAIT_BUCKETS - 1; limit *= 2)
+		++bucket;
+	if (histogram)
+		(*histogram)[bucket]++;
+	return true;
+}
+
+// called from ---CPU--- thread
+NetPlayClient::InputWaitHistogram* NetPlayClient::GetWaitHistogram(std::map<PlayerId, InputWaitHistogram>& histograms, PadMapping player)
+{
+	// Never inserts: the CPU thread must not change the map. Slots mapped
+	// after the game started have no histogram.
+	auto it = histograms.find(player);
+	return it != histograms.end() ? &it->second : nullptr;
+}
+
+void NetPlayClient::LogInputWaitHistograms()
+{
+	auto log = [this](const char* kind, PlayerId pid, const InputWaitHistogram& histogram)
+	{
+		std::ostringstream ss;
+		u32 total = 0;
+		for (int i = 0, limit = 250; i < INPUT_WAIT_BUCKETS; ++i, limit *= 2)
+		{
+			ss << (i == INPUT_WAIT_BUCKETS - 1 ? " >=" : " <") << (i == INPUT_WAIT_BUCKETS - 1 ? limit / 2 : limit)
+			   << "us: " << histogram[i].load();
+			total += histogram[i].load();
+		}
+		if (!total)
+			return;
+
+		std::lock_guard<std::recursive_mutex> lkp(m_crit.players);
+		const auto player = m_players.find(pid);
+		NOTICE_LOG(NETPLAY, "%s[%d] %s input waits:%s", player != m_players.end() ? player->second.name.c_str() : "",
+		           pid, kind, ss.str().c_str());
+	};
+
+	for (const auto& entry : m_pad_wait_histogram)
+		log("pad", entry.first, entry.second);
+	for (const auto& entry : m_wiimote_wait_histogram)
+		log("Wiimote", entry.first, entry.second);
 }
 
 // called from ---NETPLAY--- thread
@@ -842,9 +945,12 @@ bool NetPlayClient::GetNetPads(const u8 pad_nb, GCPadStatus* pad_status)
 
 	int in_game_num = LocalPadToInGamePad(pad_nb);
 
+	// Polls being replayed after a rollback were already sent and buffered.
+	const bool replaying = m_rollback_pads[pad_nb].IsReplaying(!m_rollback_state.empty());
+
 	// If this in-game pad is one of ours, then update from the
 	// information given.
-	if (in_game_num < 4)
+	if (in_game_num < 4 && !replaying)
 	{
 		// adjust the buffer either up or down
 		// inserting multiple padstates or dropping states
@@ -862,14 +968,24 @@ bool NetPlayClient::GetNetPads(const u8 pad_nb, GCPadStatus* pad_status)
 	// retrieved from NetPlay. This could be the value we pushed
 	// above if we're configured as P1 and the code is trying
 	// to retrieve data for slot 1.
-	while (!m_pad_buffer[pad_nb].Pop(*pad_status))
+	if (m_rollback)
 	{
-		if (!m_is_running.load())
+		auto source = [&](GCPadStatus* status, bool wait)
+		{
+			if (wait)
+				return WaitForInput(m_pad_buffer[pad_nb], *status, GetWaitHistogram(m_pad_wait_histogram, m_pad_map[pad_nb]));
+			return m_pad_buffer[pad_nb].Pop(*status);
+		};
+		if (!m_rollback_pads[pad_nb].GetRollbackPad(!m_rollback_state.empty(), source, pad_status, &m_rollback_pending))
 			return false;
-
-		// TODO: use a condition instead of sleeping
-		Common::SleepCurrentThread(1);
 	}
+	else if (!WaitForInput(m_pad_buffer[pad_nb], *pad_status, GetWaitHistogram(m_pad_wait_histogram, m_pad_map[pad_nb])))
+	{
+		return false;
+	}
+
+	if (replaying)
+		return true;
 
 	if (Movie::IsRecordingInput())
 	{
@@ -885,6 +1001,106 @@ bool NetPlayClient::GetNetPads(const u8 pad_nb, GCPadStatus* pad_status)
 }
 
 
+// called from ---CPU--- thread
+std::array<u64, 4> NetPlayClient::GetRollbackPolls() const
+{
+	std::array<u64, 4> polls;
+	for (u8 i = 0; i < 4; ++i)
+		polls[i] = m_rollback_pads[i].GetPolls();
+	return polls;
+}
+
+// called from ---CPU--- thread, at a safe point
+void NetPlayClient::LoadRollbackState()
+{
+	::State::LoadFromBuffer(m_rollback_state);
+	for (NetPlay::RollbackPad& pad : m_rollback_pads)
+		pad.OnSnapshotLoaded();
+	if (!m_rollback_unthrottled)
+	{
+		Core::SetIsFramelimiterTempDisabled(true);
+		m_rollback_unthrottled = true;
+	}
+}
+
+// called from ---CPU--- thread, at a safe point after the end of a field
+void NetPlayClient::UpdateRollbackOnCPUThread()
+{
+	if (!m_rollback || !m_is_running.load())
+		return;
+
+	if (m_rollback_pending)
+	{
+		m_rollback_pending = false;
+		LoadRollbackState();
+		return;
+	}
+
+	bool replaying = false;
+	bool settled = true;
+	for (const NetPlay::RollbackPad& pad : m_rollback_pads)
+	{
+		replaying |= pad.IsReplaying(!m_rollback_state.empty());
+		settled &= pad.IsSettled();
+	}
+	if (replaying)
+		return;
+
+	if (m_rollback_unthrottled)
+	{
+		Core::SetIsFramelimiterTempDisabled(false);
+		m_rollback_unthrottled = false;
+	}
+
+	if (!m_rollback_state.empty() && settled && m_rollback_verifying)
+	{
+		m_rollback_verifying = false;
+		if (GetRollbackPolls() != m_rollback_verify_polls)
+		{
+			WARN_LOG(NETPLAY, "Rollback check: the replay stopped at a different poll, not compared");
+		}
+		else if (Movie::HashEmulatedState() != m_rollback_verify_hash)
+		{
+			ERROR_LOG(NETPLAY, "Rollback check: loading a snapshot and running the same inputs again gave a different state");
+			Core::DisplayMessage("Netplay rollback is not deterministic", 5000);
+		}
+	}
+	else if (!m_rollback_state.empty() && settled && m_rollback_verify)
+	{
+		// Run the same inputs once more from the snapshot. Whatever isn't saved
+		// and loaded exactly shows up as a different hash at the same point.
+		m_rollback_verify_hash = Movie::HashEmulatedState();
+		m_rollback_verify_polls = GetRollbackPolls();
+		m_rollback_verifying = true;
+		LoadRollbackState();
+		return;
+	}
+
+	// Every prediction has been confirmed, so the snapshot isn't needed anymore.
+	if (!m_rollback_state.empty() && settled)
+	{
+		for (NetPlay::RollbackPad& pad : m_rollback_pads)
+			pad.OnSnapshotDropped();
+		m_rollback_state.clear();
+	}
+
+	// Snapshots are expensive, so only take one when a remote player's input is
+	// running late and the next frame would otherwise have to wait for it.
+	if (m_rollback_state.empty())
+	{
+		for (u8 i = 0; i < 4; ++i)
+		{
+			if (m_pad_map[i] > 0 && m_pad_map[i] != m_local_player->pid && m_pad_buffer[i].Size() == 0)
+			{
+				::State::SaveToBuffer(m_rollback_state);
+				for (NetPlay::RollbackPad& pad : m_rollback_pads)
+					pad.OnSnapshotSaved();
+				break;
+			}
+		}
+	}
+}
+
 // called from ---CPU--- thread
 bool NetPlayClient::WiimoteUpdate(int _number, u8* data, const u8 size)
 {
@@ -930,13 +1146,9 @@ bool NetPlayClient::WiimoteUpdate(int _number, u8* data, const u8 size)
 
 	} // unlock players
 
-	while (previousSize[_number] == size && !m_wiimote_buffer[_number].Pop(nw))
-	{
-		// wait for receiving thread to push some data
-		Common::SleepCurrentThread(1);
-		if (!m_is_running.load())
-			return false;
-	}
+	// wait for receiving thread to push some data
+	if (previousSize[_number] == size && !WaitForInput(m_wiimote_buffer[_number], nw, GetWaitHistogram(m_wiimote_wait_histogram, m_wiimote_map[_number])))
+		return false;
 
 	// Use a blank input, since we may not have any valid input.
 	if (previousSize[_number] != size)
@@ -956,12 +1168,8 @@ bool NetPlayClient::WiimoteUpdate(int _number, u8* data, const u8 size)
 		// Clear the buffer and wait for new input, since we probably just changed reporting mode.
 		while (nw.size() != size)
 		{
-			while (!m_wiimote_buffer[_number].Pop(nw))
-			{
-				Common::SleepCurrentThread(1);
-				if (!m_is_running.load())
-					return false;
-			}
+			if (!WaitForInput(m_wiimote_buffer[_number], nw, GetWaitHistogram(m_wiimote_wait_histogram, m_wiimote_map[_number])))
+				return false;
 			++tries;
 			if (tries > m_target_buffer_size * 200 / 120)
 				break;
@@ -997,6 +1205,14 @@ bool NetPlayClient::StopGame()
 	// stop game
 	m_dialog->StopGame();
 
+	if (m_rollback_unthrottled)
+	{
+		Core::SetIsFramelimiterTempDisabled(false);
+		m_rollback_unthrottled = false;
+	}
+
+	LogInputWaitHistograms();
+
 	return true;
 }
 
@@ -1100,6 +1316,26 @@ void NetPlayClient::SendTimeBase()
 	netplay_client->SendAsync(spac);
 }
 
+// called from ---CPU--- thread, at the end of each field
+void NetPlayClient::RequestRollbackUpdate()
+{
+	std::lock_guard<std::mutex> lk(crit_netplay_client);
+
+	// Snapshots can't be saved or loaded in the middle of CoreTiming::Advance,
+	// so UpdateRollback waits for the CPU core to leave it.
+	if (netplay_client && netplay_client->m_rollback)
+		PowerPC::RequestSafePoint();
+}
+
+// called from ---CPU--- thread, at a safe point
+void NetPlayClient::UpdateRollback()
+{
+	std::lock_guard<std::mutex> lk(crit_netplay_client);
+
+	if (netplay_client)
+		netplay_client->UpdateRollbackOnCPUThread();
+}
+
 // stuff hacked into dolphin
 
 // called from ---CPU--- thread
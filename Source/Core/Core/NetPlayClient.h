@@ -4,17 +4,22 @@
 
 #pragma once
 
+#include <array>
 #include <atomic>
+#include <chrono>
 #include <map>
 #include <mutex>
 #include <queue>
 #include <sstream>
 #include <thread>
+#include <vector>
 #include <SFML/Network/Packet.hpp>
 #include "Common/CommonTypes.h"
+#include "Common/Event.h"
 #include "Common/FifoQueue.h"
 #include "Common/TraversalClient.h"
 #include "Core/NetPlayProto.h"
+#include "Core/NetPlayRollback.h"
 #include "InputCommon/GCPadStatus.h"
 
 
@@ -44,6 +49,32 @@ public:
 	u32         ping;
 };
 
+// Inputs filled in by the netplay thread and drained by the CPU thread, which
+// can sleep until the next one arrives instead of polling.
+template <typename T>
+class NetInputBuffer
+{
+public:
+	template <typename Arg>
+	void Push(Arg&& t)
+	{
+		m_queue.Push(std::forward<Arg>(t));
+		m_arrived.Set();
+	}
+
+	void Pop() { m_queue.Pop(); }
+	bool Pop(T& t) { return m_queue.Pop(t); }
+	u32 Size() const { return m_queue.Size(); }
+
+	// Returns early if anything was pushed since the last wait.
+	template <class Rep, class Period>
+	void WaitFor(const std::chrono::duration<Rep, Period>& rel_time) { m_arrived.WaitFor(rel_time); }
+
+private:
+	Common::FifoQueue<T> m_queue;
+	Common::Event m_arrived;
+};
+
 class NetPlayClient : public TraversalClientClient
 {
 public:
@@ -78,6 +109,8 @@ public:
 	u8 LocalWiimoteToInGameWiimote(u8 local_pad);
 
 	static void SendTimeBase();
+	static void RequestRollbackUpdate();
+	static void UpdateRollback();
 
 	enum State
 	{
@@ -102,8 +135,17 @@ protected:
 
 	Common::FifoQueue<std::unique_ptr<sf::Packet>, false> m_async_queue;
 
-	Common::FifoQueue<GCPadStatus> m_pad_buffer[4];
-	Common::FifoQueue<NetWiimote>  m_wiimote_buffer[4];
+	NetInputBuffer<GCPadStatus> m_pad_buffer[4];
+	NetInputBuffer<NetWiimote>  m_wiimote_buffer[4];
+
+	// How long the CPU thread had to wait for each player's input, bucketed
+	// by powers of two from 250us up. Keyed by the player mapped to the
+	// slots, so a player with several controllers gets one histogram. Set up
+	// when the game starts and only read while it runs; logged when it stops.
+	static const int INPUT_WAIT_BUCKETS = 8;
+	using InputWaitHistogram = std::array<std::atomic<u32>, INPUT_WAIT_BUCKETS>;
+	std::map<PlayerId, InputWaitHistogram> m_pad_wait_histogram;
+	std::map<PlayerId, InputWaitHistogram> m_wiimote_wait_histogram;
 
 	NetPlayUI*   m_dialog;
 
@@ -126,7 +168,30 @@ protected:
 
 	bool m_is_recording;
 
+	// With rollback, remote inputs that haven't arrived yet are predicted
+	// instead of waited for. Once a prediction turns out wrong, the emulation
+	// goes back to a snapshot taken before it and replays the polls since,
+	// unthrottled. The host turns it on for every player (NetSettings).
+	bool m_rollback;
+	bool m_rollback_pending;
+	bool m_rollback_unthrottled;
+	// With bNetPlayVerifyRollback, every snapshot is run from once more with its
+	// final inputs before being dropped, and the state must come out the same.
+	bool m_rollback_verify;
+	bool m_rollback_verifying;
+	u64 m_rollback_verify_hash;
+	std::array<u64, 4> m_rollback_verify_polls;
+	std::vector<u8> m_rollback_state;
+	std::array<NetPlay::RollbackPad, 4> m_rollback_pads;
+
 private:
+	template <typename T>
+	bool WaitForInput(NetInputBuffer<T>& buffer, T& value, InputWaitHistogram* histogram);
+	static InputWaitHistogram* GetWaitHistogram(std::map<PlayerId, InputWaitHistogram>& histograms, PadMapping player);
+	void LogInputWaitHistograms();
+	std::array<u64, 4> GetRollbackPolls() const;
+	void LoadRollbackState();
+	void UpdateRollbackOnCPUThread();
 	void UpdateDevices();
 	void SendPadState(const PadMapping in_game_pad, const GCPadStatus& np);
 	void SendWiimoteState(const PadMapping in_game_pad, const NetWiimote& nw);
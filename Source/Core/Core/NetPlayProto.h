@@ -9,7 +9,7 @@
 #include "Common/CommonTypes.h"
 #include "Core/HW/EXI_Device.h"
 
-#define NETPLAY_VERSION  "Dolphin NetPlay 2015-06-24"
+#define NETPLAY_VERSION  "Dolphin NetPlay 2016-10-26"
 
 struct NetSettings
 {
@@ -21,7 +21,9 @@ struct NetSettings
 	bool m_PAL60;
 	bool m_DSPHLE;
 	bool m_DSPEnableJIT;
+	bool m_DSPThread;
 	bool m_WriteToMemcard;
+	bool m_Rollback;
 	bool m_OCEnable;
 	float m_OCFactor;
 	TEXIDevices m_EXIDevice[2];
@@ -0,0 +1,99 @@
+// Copyright 2016 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <algorithm>
+
+#include "Core/NetPlayRollback.h"
+
+namespace NetPlay
+{
+
+static bool SamePadInput(const GCPadStatus& a, const GCPadStatus& b)
+{
+	// Only what gets sent over the network.
+	return a.button == b.button && a.analogA == b.analogA && a.analogB == b.analogB &&
+	       a.stickX == b.stickX && a.stickY == b.stickY && a.substickX == b.substickX &&
+	       a.substickY == b.substickY && a.triggerLeft == b.triggerLeft && a.triggerRight == b.triggerRight;
+}
+
+void RollbackPad::Reset()
+{
+	m_polls = 0;
+	m_base = 0;
+	m_inputs.clear();
+	m_confirmed = 0;
+	m_last_input = {};
+}
+
+void RollbackPad::OnSnapshotDropped()
+{
+	if (!m_inputs.empty())
+		m_last_input = m_inputs.back();
+	m_inputs.clear();
+	m_confirmed = 0;
+}
+
+// Inputs arrive in order, so each one settles the oldest prediction.
+void RollbackPad::Confirm(const GCPadStatus& actual, bool* mispredicted)
+{
+	if (!SamePadInput(actual, m_inputs[m_confirmed]))
+	{
+		std::fill(m_inputs.begin() + m_confirmed, m_inputs.end(), actual);
+		*mispredicted = true;
+	}
+	++m_confirmed;
+}
+
+bool RollbackPad::GetRollbackPad(bool has_snapshot, const InputSource& source, GCPadStatus* status, bool* mispredicted)
+{
+	if (!has_snapshot)
+	{
+		// Without a snapshot to go back to, the input has to be waited for.
+		if (!source(status, true))
+			return false;
+		m_last_input = *status;
+		m_polls++;
+		return true;
+	}
+
+	GCPadStatus actual;
+	while (!IsSettled() && source(&actual, false))
+		Confirm(actual, mispredicted);
+
+	const size_t index = m_polls - m_base;
+	if (index < m_inputs.size())
+	{
+		*status = m_inputs[index];
+	}
+	else if (IsSettled() && source(status, false))
+	{
+		m_inputs.push_back(*status);
+		++m_confirmed;
+	}
+	else if (m_inputs.size() < MAX_POLLS)
+	{
+		// Guess that the player is still holding the same input.
+		*status = m_inputs.empty() ? m_last_input : m_inputs.back();
+		m_inputs.push_back(*status);
+	}
+	else
+	{
+		// Too far ahead of the snapshot, fall back to waiting.
+		while (!IsSettled())
+		{
+			if (!source(&actual, true))
+				return false;
+			Confirm(actual, mispredicted);
+		}
+		if (!source(status, true))
+			return false;
+		m_inputs.push_back(*status);
+		++m_confirmed;
+	}
+
+	m_polls++;
+	return true;
+}
+
+}
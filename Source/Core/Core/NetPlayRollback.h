@@ -0,0 +1,64 @@
+// Copyright 2016 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <functional>
+#include <vector>
+#include "Common/CommonTypes.h"
+#include "InputCommon/GCPadStatus.h"
+
+namespace NetPlay
+{
+
+// The inputs of one GameCube controller while netplay rollback is on.
+//
+// Without a snapshot, every poll waits for the real input. While there is a
+// snapshot, inputs that haven't arrived yet are predicted, and the real ones
+// settle the predictions in order once they do. Polls are counted, so that
+// after the snapshot is loaded, the same polls get the corrected inputs.
+class RollbackPad
+{
+public:
+	// Pops the next input that arrived for the pad. With wait set, blocks until
+	// one does. Returns false if there was none, or if waiting was given up.
+	using InputSource = std::function<bool(GCPadStatus* status, bool wait)>;
+
+	// A rollback reaches back at most this many polls. Past that, the inputs
+	// are waited for again.
+	static const size_t MAX_POLLS = 16;
+
+	void Reset();
+
+	// Input for the next poll. Sets *mispredicted if an input that arrived
+	// turned out different from its prediction, which means the snapshot has
+	// to be loaded. Returns false if no input could be had.
+	bool GetRollbackPad(bool has_snapshot, const InputSource& source, GCPadStatus* status, bool* mispredicted);
+
+	// A snapshot was taken before the next poll.
+	void OnSnapshotSaved() { m_base = m_polls; }
+	// The snapshot was loaded, so polling starts over from it.
+	void OnSnapshotLoaded() { m_polls = m_base; }
+	// The snapshot was dropped after every prediction was confirmed.
+	void OnSnapshotDropped();
+
+	// Whether the next poll is one that already happened before the snapshot
+	// was loaded.
+	bool IsReplaying(bool has_snapshot) const { return has_snapshot && m_polls - m_base < m_inputs.size(); }
+	bool IsSettled() const { return m_confirmed == m_inputs.size(); }
+	u64 GetPolls() const { return m_polls; }
+
+private:
+	void Confirm(const GCPadStatus& actual, bool* mispredicted);
+
+	u64 m_polls = 0;
+	u64 m_base = 0;
+	// Inputs used for each poll since the snapshot. The first m_confirmed of
+	// them are final, the rest are predictions.
+	std::vector<GCPadStatus> m_inputs;
+	size_t m_confirmed = 0;
+	GCPadStatus m_last_input = {};
+};
+
+}
@@ -719,7 +719,9 @@ bool NetPlayServer::StartGame()
 	*spac << m_settings.m_PAL60;
 	*spac << m_settings.m_DSPEnableJIT;
 	*spac << m_settings.m_DSPHLE;
+	*spac << m_settings.m_DSPThread;
 	*spac << m_settings.m_WriteToMemcard;
+	*spac << m_settings.m_Rollback;
 	*spac << m_settings.m_OCEnable;
 	*spac << m_settings.m_OCFactor;
 	*spac << m_settings.m_EXIDevice[0];
@@ -11,6 +11,7 @@ void CachedInterpreter::Init()
 	m_code.reserve(CODE_SIZE / sizeof(Instruction));
 
 	jo.enableBlocklink = false;
+	UpdateMemoryOptions();
 
 	JitBaseBlockCache::Init();
 
@@ -35,55 +36,94 @@ void CachedInterpreter::Run()
 	PowerPC::FinishStateMove();
 }
 
+// GCC and Clang can jump from one handler straight to the next through a
+// table of label addresses. That avoids the bounds check and the single,
+// badly predicted indirect jump a switch compiles to.
+#if defined(__GNUC__)
+#define CACHED_INTERPRETER_THREADED
+#endif
+
 void CachedInterpreter::SingleStep()
 {
 	int block = GetBlockNumberFromStartAddress(PC);
 	if (block >= 0)
 	{
-		Instruction* code = (Instruction*)GetCompiledCodeFromBlock(block);
-
+		const Instruction* code = (const Instruction*)GetCompiledCodeFromBlock(block);
+
+#ifdef CACHED_INTERPRETER_THREADED
+		// Same order as Instruction::Type.
+		static const void* const handlers[] = {
+			&&abort, &&common, &&conditional, &&fused, &&write_pc, &&end_block, &&check_dsi,
+		};
+#define HANDLER(label, type) label
+#define NEXT goto *handlers[code->type]
+		NEXT;
+#else
+#define HANDLER(label, type) case Instruction::type
+#define NEXT continue
 		while (true)
 		{
 			switch (code->type)
 			{
-			case Instruction::INSTRUCTION_ABORT:
+#endif
+			HANDLER(abort, INSTRUCTION_ABORT):
 				return;
 
-			case Instruction::INSTRUCTION_TYPE_COMMON:
+			HANDLER(common, INSTRUCTION_TYPE_COMMON):
 				code->common_callback(UGeckoInstruction(code->data));
 				code++;
-				break;
+				NEXT;
+
+			HANDLER(conditional, INSTRUCTION_TYPE_CONDITIONAL):
+				if (code->conditional_callback(code->data))
+					return;
+				code++;
+				NEXT;
 
-			case Instruction::INSTRUCTION_TYPE_CONDITIONAL:
-				bool ret = code->conditional_callback(code->data);
+			HANDLER(fused, INSTRUCTION_TYPE_FUSED):
+				code->fused_callback(UGeckoInstruction(code->data), UGeckoInstruction(code->data2));
 				code++;
-				if (ret)
+				NEXT;
+
+			HANDLER(write_pc, INSTRUCTION_TYPE_WRITE_PC):
+				PC = code->data;
+				NPC = code->data + 4;
+				code++;
+				NEXT;
+
+			HANDLER(end_block, INSTRUCTION_TYPE_END_BLOCK):
+				PC = NPC;
+				if (PowerPC::ppcState.Exceptions)
+					PowerPC::CheckExceptions();
+				PowerPC::ppcState.downcount -= code->data;
+				if (PowerPC::ppcState.downcount <= 0)
+					CoreTiming::Advance();
+				code++;
+				NEXT;
+
+			HANDLER(check_dsi, INSTRUCTION_TYPE_CHECK_DSI):
+				// A load or store faulted. Nothing after it in the block may run.
+				if (PowerPC::ppcState.Exceptions & EXCEPTION_DSI)
+				{
+					PC = code->data;
+					NPC = code->data + 4;
+					PowerPC::CheckExceptions();
+					PowerPC::ppcState.downcount -= code->data2;
 					return;
-				break;
+				}
+				code++;
+				NEXT;
+#ifndef CACHED_INTERPRETER_THREADED
 			}
 		}
+#endif
+#undef HANDLER
+#undef NEXT
 	}
 
 	Jit(PC);
 }
 
-static void EndBlock(UGeckoInstruction data)
-{
-	PC = NPC;
-	PowerPC::CheckExceptions();
-	PowerPC::ppcState.downcount -= data.hex;
-	if (PowerPC::ppcState.downcount <= 0)
-	{
-		CoreTiming::Advance();
-	}
-}
-
-static void WritePC(UGeckoInstruction data)
-{
-	PC = data.hex;
-	NPC = data.hex + 4;
-}
-
 static bool CheckFPU(u32 data)
 {
 	UReg_MSR& msr = (UReg_MSR&)MSR;
@@ -97,6 +137,51 @@ static bool CheckFPU(u32 data)
 	return false;
 }
 
+static void FusedLoadAdd(UGeckoInstruction load, UGeckoInstruction add)
+{
+	Interpreter::lwz(load);
+	if (!(PowerPC::ppcState.Exceptions & EXCEPTION_DSI))
+		Interpreter::addi(add);
+}
+
+static void FusedCompareBranch(UGeckoInstruction compare, UGeckoInstruction branch)
+{
+	Interpreter::cmpi(compare);
+	Interpreter::bcx(branch);
+}
+
+static void FusedCompareLogicalBranch(UGeckoInstruction compare, UGeckoInstruction branch)
+{
+	Interpreter::cmpli(compare);
+	Interpreter::bcx(branch);
+}
+
+static void FusedRotateStore(UGeckoInstruction rotate, UGeckoInstruction store)
+{
+	Interpreter::rlwinmx(rotate);
+	Interpreter::stw(store);
+}
+
+CachedInterpreter::Instruction::FusedCallback CachedInterpreter::GetFusedCallback(const PPCAnalyst::CodeOp& first, const PPCAnalyst::CodeOp& second) const
+{
+	if (first.skip || second.skip || HLE::GetFunctionIndex(second.address) != 0)
+		return nullptr;
+
+	const u32 first_op = first.inst.OPCD;
+	const u32 second_op = second.inst.OPCD;
+
+	if (first_op == 32 && second_op == 14) // lwz, addi
+		return FusedLoadAdd;
+	if (first_op == 11 && second_op == 16) // cmpi, bcx
+		return FusedCompareBranch;
+	if (first_op == 10 && second_op == 16) // cmpli, bcx
+		return FusedCompareLogicalBranch;
+	if (first_op == 21 && second_op == 36) // rlwinmx, stw
+		return FusedRotateStore;
+
+	return nullptr;
+}
+
 void CachedInterpreter::Jit(u32 address)
 {
 	if (m_code.size() >= CODE_SIZE / sizeof(Instruction) - 0x1000 || IsFull() || SConfig::GetInstance().bJITNoBlockCache)
@@ -143,11 +228,11 @@ void CachedInterpreter::Jit(u32 address)
 				int flags = HLE::GetFunctionFlagsByIndex(function);
 				if (HLE::IsEnabled(flags))
 				{
-					m_code.emplace_back(WritePC, ops[i].address);
+					m_code.emplace_back(Instruction::INSTRUCTION_TYPE_WRITE_PC, ops[i].address);
 					m_code.emplace_back(Interpreter::HLEFunction, ops[i].inst);
 					if (type == HLE::HLE_HOOK_REPLACE)
 					{
-						m_code.emplace_back(EndBlock, js.downcountAmount);
+						m_code.emplace_back(Instruction::INSTRUCTION_TYPE_END_BLOCK, js.downcountAmount);
 						m_code.emplace_back();
 						break;
 					}
@@ -163,17 +248,38 @@ void CachedInterpreter::Jit(u32 address)
 				js.firstFPInstructionFound = true;
 			}
 
-			if (ops[i].opinfo->flags & FL_ENDBLOCK)
-				m_code.emplace_back(WritePC, ops[i].address);
-			m_code.emplace_back(GetInterpreterOp(ops[i].inst), ops[i].inst);
-			if (ops[i].opinfo->flags & FL_ENDBLOCK)
-				m_code.emplace_back(EndBlock, js.downcountAmount);
+			Instruction::FusedCallback fused = nullptr;
+			if (i + 1 < code_block.m_num_instructions)
+				fused = GetFusedCallback(ops[i], ops[i + 1]);
+
+			// A fused pair ends the block where its second instruction would.
+			const PPCAnalyst::CodeOp& first = ops[i];
+			if (fused)
+			{
+				i++;
+				js.downcountAmount += ops[i].opinfo->numCycles;
+			}
+			const PPCAnalyst::CodeOp& last = ops[i];
+
+			if (last.opinfo->flags & FL_ENDBLOCK)
+				m_code.emplace_back(Instruction::INSTRUCTION_TYPE_WRITE_PC, last.address);
+			if (fused)
+				m_code.emplace_back(fused, first.inst, last.inst);
+			else
+				m_code.emplace_back(GetInterpreterOp(last.inst), last.inst);
+
+			const PPCAnalyst::CodeOp& memory_op = (first.opinfo->flags & FL_LOADSTORE) ? first : last;
+			if (jo.memcheck && (memory_op.opinfo->flags & FL_LOADSTORE))
+				m_code.emplace_back(Instruction::INSTRUCTION_TYPE_CHECK_DSI, memory_op.address, js.downcountAmount);
+
+			if (last.opinfo->flags & FL_ENDBLOCK)
+				m_code.emplace_back(Instruction::INSTRUCTION_TYPE_END_BLOCK, js.downcountAmount);
 		}
 	}
 	if (code_block.m_broken)
 	{
-		m_code.emplace_back(WritePC, nextPC);
-		m_code.emplace_back(EndBlock, js.downcountAmount);
+		m_code.emplace_back(Instruction::INSTRUCTION_TYPE_WRITE_PC, nextPC);
+		m_code.emplace_back(Instruction::INSTRUCTION_TYPE_END_BLOCK, js.downcountAmount);
 	}
 	m_code.emplace_back();
 
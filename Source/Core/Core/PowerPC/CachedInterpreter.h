@@ -46,26 +46,41 @@ private:
 	{
 		typedef void (*CommonCallback)(UGeckoInstruction);
 		typedef bool (*ConditionalCallback)(u32 data);
+		typedef void (*FusedCallback)(UGeckoInstruction, UGeckoInstruction);
 
-		Instruction() : type(INSTRUCTION_ABORT) {};
+		enum Type
+		{
+			INSTRUCTION_ABORT,
+			INSTRUCTION_TYPE_COMMON,
+			INSTRUCTION_TYPE_CONDITIONAL,
+			INSTRUCTION_TYPE_FUSED,
+			// Handled by the dispatcher itself, without a callback.
+			INSTRUCTION_TYPE_WRITE_PC,
+			INSTRUCTION_TYPE_END_BLOCK,
+			INSTRUCTION_TYPE_CHECK_DSI,
+		};
+
+		Instruction() : common_callback(nullptr), type(INSTRUCTION_ABORT) {};
 		Instruction(const CommonCallback c, UGeckoInstruction i) : common_callback(c), data(i.hex), type(INSTRUCTION_TYPE_COMMON) {};
 		Instruction(const ConditionalCallback c, u32 d) : conditional_callback(c), data(d), type(INSTRUCTION_TYPE_CONDITIONAL) {};
+		Instruction(const FusedCallback c, UGeckoInstruction a, UGeckoInstruction b) : fused_callback(c), data(a.hex), data2(b.hex), type(INSTRUCTION_TYPE_FUSED) {};
+		Instruction(Type t, u32 d, u32 d2 = 0) : common_callback(nullptr), data(d), data2(d2), type(t) {};
 
 		union
 		{
 			const CommonCallback common_callback;
 			const ConditionalCallback conditional_callback;
-
+			const FusedCallback fused_callback;
 		};
 		u32 data;
-		enum
-		{
-			INSTRUCTION_ABORT,
-			INSTRUCTION_TYPE_COMMON,
-			INSTRUCTION_TYPE_CONDITIONAL,
-		} type;
+		u32 data2;
+		Type type;
 	};
 
+	// Returns the handler for a pair of instructions that is common enough to
+	// be worth a single dispatch, or nullptr.
+	Instruction::FusedCallback GetFusedCallback(const PPCAnalyst::CodeOp& first, const PPCAnalyst::CodeOp& second) const;
+
 	const u8* GetCodePtr() { return (u8*)(m_code.data() + m_code.size()); }
 
 	std::vector<Instruction> m_code;
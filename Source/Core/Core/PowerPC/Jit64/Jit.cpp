@@ -2,6 +2,7 @@
 // Licensed under GPLv2+
 // Refer to the license.txt file included.
 
+#include <algorithm>
 #include <map>
 #include <string>
 
@@ -12,6 +13,7 @@
 
 #include "Common/CommonTypes.h"
 #include "Common/StringUtil.h"
+#include "Core/NetPlayProto.h"
 #include "Core/PatchEngine.h"
 #include "Core/HLE/HLE.h"
 #include "Core/HW/ProcessorInterface.h"
@@ -178,6 +180,10 @@ void Jit64::Init()
 
 	jo.optimizeGatherPipe = true;
 	jo.accurateSinglePrecision = true;
+	// Which blocks become hot depends on run counts that start over whenever a
+	// state is loaded, so netplay rollback would make players compile different
+	// blocks, and run CoreTiming events at different points.
+	jo.hotBlocks = !(NetPlay::IsNetPlayRunning() && g_NetPlaySettings.m_Rollback);
 	UpdateMemoryOptions();
 	js.fastmemLoadStore = nullptr;
 	js.compilerPC = 0;
@@ -278,6 +284,9 @@ void Jit64::DoNothing(UGeckoInstruction _inst)
 	// Yup, just don't do anything.
 }
 
+// Runs after which a block is recompiled with leaf functions inlined.
+static const u32 HOT_BLOCK_THRESHOLD = 1000;
+
 static const bool ImHereDebug = false;
 static const bool ImHereLog = false;
 static std::map<u32, int> been_here;
@@ -538,7 +547,19 @@ void Jit64::Jit(u32 em_address)
 
 	// Analyze the block, collect all instructions it is made of (including inlining,
 	// if that is enabled), reorder instructions for optimal performance, and join joinable instructions.
-	u32 nextPC = analyzer.Analyze(em_address, &code_block, &code_buffer, blockSize);
+	// Stored hints for the analyzed code can change the analysis, so it is redone until none apply.
+	u32 nextPC;
+	do
+	{
+		// Blocks that turned out to be hot get the leaf functions they call inlined,
+		// so the register cache and constant folding see across the call.
+		const bool hot = js.hotBlockAddresses.find(em_address) != js.hotBlockAddresses.end();
+		if (hot)
+			analyzer.SetOption(PPCAnalyst::PPCAnalyzer::OPTION_LEAF_INLINE);
+
+		nextPC = analyzer.Analyze(em_address, &code_block, &code_buffer, blockSize);
+		analyzer.ClearOption(PPCAnalyst::PPCAnalyzer::OPTION_LEAF_INLINE);
+	} while (!code_block.m_memory_exception && blocks.ApplyStoredHints(code_buffer, code_block.m_num_instructions));
 
 	if (code_block.m_memory_exception)
 	{
@@ -587,6 +608,27 @@ const u8* Jit64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer *code_buf, JitBloc
 		ABI_PopRegistersAndAdjustStack({}, 0);
 	}
 
+	// Count runs of blocks that recompiling as hot blocks would change, which
+	// are the ones calling a function the analyzer can inline.
+	if (code_block.m_has_inlinable_call && jo.hotBlocks &&
+	    !SConfig::GetInstance().bEnableDebugging && !Profiler::g_ProfileBlocks &&
+	    js.hotBlockAddresses.find(js.blockStart) == js.hotBlockAddresses.end())
+	{
+		b->hotCounter = HOT_BLOCK_THRESHOLD;
+		MOV(64, R(RSCRATCH), Imm64((u64)&b->hotCounter));
+		SUB(32, MatR(RSCRATCH), Imm8(1));
+		FixupBranch hot = J_CC(CC_Z, true);
+		SwitchToFarCode();
+			SetJumpTarget(hot);
+			MOV(32, PPCSTATE(pc), Imm32(js.blockStart));
+			ABI_PushRegistersAndAdjustStack({}, 0);
+			ABI_CallFunctionC((void *)&JitInterface::CompileExceptionCheck,
+			                  (u32)JitInterface::ExceptionType::EXCEPTIONS_HOT_BLOCK);
+			ABI_PopRegistersAndAdjustStack({}, 0);
+			JMP(asm_routines.dispatcher, true);
+		SwitchToNearCode();
+	}
+
 	// Conditionally add profiling code.
 	if (Profiler::g_ProfileBlocks)
 	{
@@ -615,25 +657,33 @@ const u8* Jit64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer *code_buf, JitBloc
 	js.skipInstructions = 0;
 	js.carryFlagSet = false;
 	js.carryFlagInverted = false;
-	js.assumeNoPairedQuantize = false;
-
-	// If the block only uses one GQR and the GQR is zero at compile time, make a guess that the block
-	// never uses quantized loads/stores. Many paired-heavy games use largely float loads and stores,
-	// which are significantly faster when inlined (especially in MMU mode, where this lets them use
-	// fastmem).
-	// Insert a check that the GQR is still zero at the start of the block in case our guess turns out
-	// wrong.
-	// TODO: support any other constant GQR value, not merely zero/unquantized: we can optimize quantized
-	// loadstores too, it'd just be more code.
-	if (code_block.m_gqr_used.Count() == 1 && js.pairedQuantizeAddresses.find(js.blockStart) == js.pairedQuantizeAddresses.end())
+	js.constantGqr = BitSet8(0);
+
+	// Assume the GQRs the block reads but never writes keep the values they have at compile time,
+	// so that every psq_l/psq_st can be specialized on its quantization type and scale. Float
+	// loads and stores, which many paired-heavy games use almost exclusively, are then inlined
+	// (in MMU mode this also lets them use fastmem), and the others call their conversion routine
+	// directly instead of going through the lookup table.
+	// Insert a check that the GQRs still have those values at the start of the block in case our
+	// guess turns out wrong.
+	if (code_block.m_gqr_used && js.pairedQuantizeAddresses.find(js.blockStart) == js.pairedQuantizeAddresses.end())
 	{
-		int gqr = *code_block.m_gqr_used.begin();
-		if (!code_block.m_gqr_modified[gqr] && !GQR(gqr))
+		std::vector<FixupBranch> failures;
+		for (int gqr : code_block.m_gqr_used)
+		{
+			if (code_block.m_gqr_modified[gqr])
+				continue;
+
+			CMP(32, PPCSTATE(spr[SPR_GQR0 + gqr]), Imm32(GQR(gqr)));
+			failures.push_back(J_CC(CC_NZ, true));
+			js.constantGqr[gqr] = true;
+		}
+
+		if (!failures.empty())
 		{
-			CMP(32, PPCSTATE(spr[SPR_GQR0 + gqr]), Imm8(0));
-			FixupBranch failure = J_CC(CC_NZ, true);
 			SwitchToFarCode();
-				SetJumpTarget(failure);
+				for (FixupBranch& failure : failures)
+					SetJumpTarget(failure);
 				MOV(32, PPCSTATE(pc), Imm32(js.blockStart));
 				ABI_PushRegistersAndAdjustStack({}, 0);
 				ABI_CallFunctionC((void *)&JitInterface::CompileExceptionCheck,
@@ -641,7 +691,6 @@ const u8* Jit64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer *code_buf, JitBloc
 				ABI_PopRegistersAndAdjustStack({}, 0);
 				JMP(asm_routines.dispatcher, true);
 			SwitchToNearCode();
-			js.assumeNoPairedQuantize = true;
 		}
 	}
 
@@ -876,6 +925,17 @@ const u8* Jit64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer *code_buf, JitBloc
 	b->codeSize = (u32)(GetCodePtr() - start);
 	b->originalSize = code_block.m_num_instructions;
 
+	// Inlined code has to invalidate this block too.
+	const u32 first_line = (em_address & 0x1FFFFFFF) / 32;
+	const u32 last_line = ((em_address & 0x1FFFFFFF) + (b->originalSize - 1) * 4) / 32;
+	for (u32 i = 0; i < code_block.m_num_instructions; i++)
+	{
+		const u32 line = (ops[i].address & 0x1FFFFFFF) / 32;
+		if ((line < first_line || line > last_line) &&
+		    std::find(b->inlinedLines.begin(), b->inlinedLines.end(), line) == b->inlinedLines.end())
+			b->inlinedLines.push_back(line);
+	}
+
 #ifdef JIT_LOG_X86
 	LogGeneratedX86(code_block.m_num_instructions, code_buf, start, b);
 #endif
@@ -100,6 +100,7 @@ public:
 	void WriteExit(u32 destination, bool bl = false, u32 after = 0);
 	void JustWriteExit(u32 destination, bool bl, u32 after);
 	void WriteExitDestInRSCRATCH(bool bl = false, u32 after = 0);
+	void WriteIdleSkip(u32 destination);
 	void WriteBLRExit();
 	void WriteExceptionExit();
 	void WriteExternalExceptionExit();
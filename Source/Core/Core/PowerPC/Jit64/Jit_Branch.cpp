@@ -2,7 +2,11 @@
 // Licensed under GPLv2+
 // Refer to the license.txt file included.
 
+#include <vector>
+
 #include "Common/CommonTypes.h"
+#include "Core/ConfigManager.h"
+#include "Core/CoreTiming.h"
 
 #include "Core/PowerPC/Jit64/Jit.h"
 #include "Core/PowerPC/Jit64/JitAsm.h"
@@ -92,9 +96,40 @@ void Jit64::bx(UGeckoInstruction inst)
 		// make idle loops go faster
 		js.downcountAmount += 8;
 	}
+	WriteIdleSkip(destination);
 	WriteExit(destination, inst.LK, js.compilerPC + 4);
 }
 
+// The analyzer flags blocks that only poll memory and loop back to their own
+// start. Another iteration cannot change anything until an event fires, so
+// give up the rest of the timeslice before jumping back.
+void Jit64::WriteIdleSkip(u32 destination)
+{
+	if (!code_block.m_idle_loop || destination != js.blockStart ||
+	    !SConfig::GetInstance().bSkipIdle || PowerPC::GetState() == PowerPC::CPU_STEPPING)
+		return;
+
+	// Don't skip when the loop polls a hardware register through a pointer
+	// (PPCAnalyst::IsHardwareAddress). The caller has flushed the registers.
+	std::vector<FixupBranch> polls_hardware;
+	for (const PPCAnalyst::IdleLoopLoad& load : code_block.m_idle_loop_loads)
+	{
+		MOV(32, R(RSCRATCH), PPCSTATE(gpr[load.reg]));
+		ADD(32, R(RSCRATCH), Imm32(load.offset));
+		AND(32, R(RSCRATCH), Imm32(0x18000000));
+		CMP(32, R(RSCRATCH), Imm32(0x08000000));
+		polls_hardware.push_back(J_CC(CC_E, true));
+	}
+
+	BitSet32 registersInUse = CallerSavedRegistersInUse();
+	ABI_PushRegistersAndAdjustStack(registersInUse, 0);
+	ABI_CallFunction((void *)&CoreTiming::Idle);
+	ABI_PopRegistersAndAdjustStack(registersInUse, 0);
+
+	for (const FixupBranch& branch : polls_hardware)
+		SetJumpTarget(branch);
+}
+
 // TODO - optimize to hell and beyond
 // TODO - make nice easy to optimize special cases for the most common
 // variants of this instruction.
@@ -133,6 +168,8 @@ void Jit64::bcx(UGeckoInstruction inst)
 
 	gpr.Flush(FLUSH_MAINTAIN_STATE);
 	fpr.Flush(FLUSH_MAINTAIN_STATE);
+	if (js.isLastInstruction && !inst.LK)
+		WriteIdleSkip(destination);
 	WriteExit(destination, inst.LK, js.compilerPC + 4);
 
 	if ((inst.BO & BO_DONT_CHECK_CONDITION) == 0)
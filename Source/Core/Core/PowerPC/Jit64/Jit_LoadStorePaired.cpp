@@ -17,6 +17,8 @@ using namespace Gen;
 
 // The big problem is likely instructions that set the quantizers in the same block.
 // We will have to break block after quantizers are written to.
+// GQRs that are only read in the block are checked once at its start (see DoJit), so the
+// loads and stores through them are specialized on the type and scale they have then.
 void Jit64::psq_stXX(UGeckoInstruction inst)
 {
 	INSTRUCTION_START
@@ -32,8 +34,11 @@ void Jit64::psq_stXX(UGeckoInstruction inst)
 	int w = indexed ? inst.Wx : inst.W;
 	FALLBACK_IF(!a);
 
+	const bool constant_gqr = js.constantGqr[i];
+	const UGQR gqr(GQR(i));
+
 	gpr.Lock(a, b);
-	if (js.assumeNoPairedQuantize)
+	if (constant_gqr && gqr.st_type == QUANTIZE_FLOAT)
 	{
 		int storeOffset = 0;
 		gpr.BindToRegister(a, true, update);
@@ -124,21 +129,34 @@ void Jit64::psq_stXX(UGeckoInstruction inst)
 	// Hence, we need to mask out the unused bits. The layout of the GQR register is
 	// UU[SCALE]UUUUU[TYPE] where SCALE is 6 bits and TYPE is 3 bits, so we have to AND with
 	// 0b0011111100000111, or 0x3F07.
-	MOV(32, R(RSCRATCH2), Imm32(0x3F07));
-	AND(32, R(RSCRATCH2), PPCSTATE(spr[SPR_GQR0 + i]));
-	MOVZX(32, 8, RSCRATCH, R(RSCRATCH2));
+	if (constant_gqr)
+	{
+		MOV(32, R(RSCRATCH2), Imm32(gqr.Hex & 0x3F07));
+	}
+	else
+	{
+		MOV(32, R(RSCRATCH2), Imm32(0x3F07));
+		AND(32, R(RSCRATCH2), PPCSTATE(spr[SPR_GQR0 + i]));
+		MOVZX(32, 8, RSCRATCH, R(RSCRATCH2));
+	}
 
 	if (w)
 	{
 		// One value
 		CVTSD2SS(XMM0, fpr.R(s));
-		CALLptr(MScaled(RSCRATCH, SCALE_8, (u32)(u64)asm_routines.singleStoreQuantized));
+		if (constant_gqr)
+			CALL(asm_routines.singleStoreQuantized[gqr.st_type]);
+		else
+			CALLptr(MScaled(RSCRATCH, SCALE_8, (u32)(u64)asm_routines.singleStoreQuantized));
 	}
 	else
 	{
 		// Pair of values
 		CVTPD2PS(XMM0, fpr.R(s));
-		CALLptr(MScaled(RSCRATCH, SCALE_8, (u32)(u64)asm_routines.pairedStoreQuantized));
+		if (constant_gqr)
+			CALL(asm_routines.pairedStoreQuantized[gqr.st_type]);
+		else
+			CALLptr(MScaled(RSCRATCH, SCALE_8, (u32)(u64)asm_routines.pairedStoreQuantized));
 	}
 
 	if (update && jo.memcheck)
@@ -168,8 +186,11 @@ void Jit64::psq_lXX(UGeckoInstruction inst)
 	int w = indexed ? inst.Wx : inst.W;
 	FALLBACK_IF(!a);
 
+	const bool constant_gqr = js.constantGqr[i];
+	const UGQR gqr(GQR(i));
+
 	gpr.Lock(a, b);
-	if (js.assumeNoPairedQuantize)
+	if (constant_gqr && gqr.ld_type == QUANTIZE_FLOAT)
 	{
 		s32 loadOffset = 0;
 		gpr.BindToRegister(a, true, update);
@@ -297,16 +318,24 @@ void Jit64::psq_lXX(UGeckoInstruction inst)
 	// In memcheck mode, don't update the address until the exception check
 	if (update && !jo.memcheck)
 		MOV(32, gpr.R(a), R(RSCRATCH_EXTRA));
-	MOV(32, R(RSCRATCH2), Imm32(0x3F07));
+	if (constant_gqr)
+	{
+		MOV(32, R(RSCRATCH2), Imm32((gqr.Hex >> 16) & 0x3F07));
+		CALL(asm_routines.pairedLoadQuantized[w * 8 + gqr.ld_type]);
+	}
+	else
+	{
+		MOV(32, R(RSCRATCH2), Imm32(0x3F07));
 
-	// Get the high part of the GQR register
-	OpArg gqr = PPCSTATE(spr[SPR_GQR0 + i]);
-	gqr.AddMemOffset(2);
+		// Get the high part of the GQR register
+		OpArg gqr_high = PPCSTATE(spr[SPR_GQR0 + i]);
+		gqr_high.AddMemOffset(2);
 
-	AND(32, R(RSCRATCH2), gqr);
-	MOVZX(32, 8, RSCRATCH, R(RSCRATCH2));
+		AND(32, R(RSCRATCH2), gqr_high);
+		MOVZX(32, 8, RSCRATCH, R(RSCRATCH2));
 
-	CALLptr(MScaled(RSCRATCH, SCALE_8, (u32)(u64)(&asm_routines.pairedLoadQuantized[w * 8])));
+		CALLptr(MScaled(RSCRATCH, SCALE_8, (u32)(u64)(&asm_routines.pairedLoadQuantized[w * 8])));
+	}
 
 	MemoryExceptionCheck();
 	CVTPS2PD(fpr.RX(s), R(XMM0));
@@ -485,6 +485,7 @@ void JitIL::Jit(u32 em_address)
 	// Analyze the block, collect all instructions it is made of (including inlining,
 	// if that is enabled), reorder instructions for optimal performance, and join joinable instructions.
 	u32 nextPC = analyzer.Analyze(em_address, &code_block, &code_buffer, blockSize);
+	blocks.ApplyStoredHints(code_buffer, code_block.m_num_instructions);
 
 	if (code_block.m_memory_exception)
 	{
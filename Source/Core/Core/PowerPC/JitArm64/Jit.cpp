@@ -399,6 +399,7 @@ const u8* JitArm64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer *code_buf, JitB
 	// Analyze the block, collect all instructions it is made of (including inlining,
 	// if that is enabled), reorder instructions for optimal performance, and join joinable instructions.
 	nextPC = analyzer.Analyze(em_address, &code_block, code_buf, blockSize);
+	blocks.ApplyStoredHints(*code_buf, code_block.m_num_instructions);
 
 	PPCAnalyst::CodeOp *ops = code_buf->codebuffer;
 
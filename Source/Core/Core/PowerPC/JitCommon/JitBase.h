@@ -64,6 +64,7 @@ protected:
 		bool fastmem;
 		bool memcheck;
 		bool alwaysUseMemFuncs;
+		bool hotBlocks;
 	};
 	struct JitState
 	{
@@ -86,6 +87,8 @@ protected:
 		int revertFprLoad;
 
 		bool assumeNoPairedQuantize;
+		// GQRs checked at the start of the block to still have their compile-time values.
+		BitSet8 constantGqr;
 		bool firstFPInstructionFound;
 		bool isLastInstruction;
 		int skipInstructions;
@@ -104,6 +107,7 @@ protected:
 
 		std::unordered_set<u32> fifoWriteAddresses;
 		std::unordered_set<u32> pairedQuantizeAddresses;
+		std::unordered_set<u32> hotBlockAddresses;
 	};
 
 	PPCAnalyst::CodeBlock code_block;
@@ -9,12 +9,17 @@
 // performance hit, it's not enabled by default, but it's useful for
 // locating performance issues.
 
+#include <algorithm>
 #include <cstring>
 #include "disasm.h"
 
 #include "Common/CommonTypes.h"
+#include "Common/FileUtil.h"
 #include "Common/JitRegister.h"
 #include "Common/MemoryUtil.h"
+#include "Common/StringUtil.h"
+#include "Core/Movie.h"
+#include "Core/NetPlayProto.h"
 #include "Core/PowerPC/JitInterface.h"
 #include "Core/PowerPC/JitCommon/JitBase.h"
 
@@ -24,9 +29,67 @@
 
 using namespace Gen;
 
+	// Range of 32-byte physical lines covered by a block.
+	static u32 FirstLine(const JitBlock& b)
+	{
+		return (b.originalAddress & 0x1FFFFFFF) / 32;
+	}
+
+	static u32 LastLine(const JitBlock& b)
+	{
+		return ((b.originalAddress & 0x1FFFFFFF) + (b.originalSize - 1) * 4) / 32;
+	}
+
+	static void EraseBlockNumber(std::vector<int>& list, int block_num)
+	{
+		list.erase(std::remove(list.begin(), list.end(), block_num), list.end());
+	}
+
+	static std::unordered_set<u32>* GetHintAddresses(u32 type)
+	{
+		switch (static_cast<JitInterface::ExceptionType>(type))
+		{
+		case JitInterface::ExceptionType::EXCEPTIONS_FIFO_WRITE:
+			return &jit->js.fifoWriteAddresses;
+		case JitInterface::ExceptionType::EXCEPTIONS_PAIRED_QUANTIZE:
+			return &jit->js.pairedQuantizeAddresses;
+		case JitInterface::ExceptionType::EXCEPTIONS_HOT_BLOCK:
+			return &jit->js.hotBlockAddresses;
+		}
+		return nullptr;
+	}
+
+	static bool ReadHintLine(u32 line, std::array<u32, 8>* code)
+	{
+		if (!PowerPC::HostIsRAMAddress(line))
+			return false;
+
+		for (u32 i = 0; i < code->size(); i++)
+			(*code)[i] = PowerPC::HostRead_U32(line + i * 4);
+		return true;
+	}
+
+	class JitHintReader : public LinearDiskCacheReader<JitHintKey, u32>
+	{
+	public:
+		std::vector<JitStoredHint> hints;
+
+		void Read(const JitHintKey& key, const u32* value, u32 value_size) override
+		{
+			JitStoredHint hint;
+			if (value_size != hint.code.size() || !GetHintAddresses(key.type))
+				return;
+
+			hint.key = key;
+			std::copy(value, value + value_size, hint.code.begin());
+			hints.push_back(hint);
+		}
+	};
+
 	bool JitBaseBlockCache::IsFull() const
 	{
-		return GetNumBlocks() >= MAX_NUM_BLOCKS - 1;
+		// Destroyed blocks give their numbers back, so only live blocks count.
+		return free_blocks.empty() && GetNumBlocks() >= MAX_NUM_BLOCKS - 1;
 	}
 
 	void JitBaseBlockCache::Init()
@@ -44,6 +107,24 @@ using namespace Gen;
 		iCacheVMEM.fill(JIT_ICACHE_INVALID_BYTE);
 		Clear();
 
+		hints_loaded = hints_applied = hints_outdated = hints_learnt = 0;
+		const std::string& game_id = SConfig::GetInstance().GetUniqueID();
+		if (!game_id.empty())
+		{
+			if (!File::Exists(File::GetUserPath(D_CACHE_IDX)))
+				File::CreateDir(File::GetUserPath(D_CACHE_IDX));
+
+			std::string cache_filename = StringFromFormat("%s%s-jit.cache", File::GetUserPath(D_CACHE_IDX).c_str(),
+			                                              game_id.c_str());
+			JitHintReader reader;
+			hint_disk_cache.OpenAndRead(cache_filename, reader);
+			for (const JitStoredHint& hint : reader.hints)
+			{
+				if (AddStoredHint(hint))
+					hints_loaded++;
+			}
+		}
+
 		m_initialized = true;
 	}
 
@@ -52,6 +133,19 @@ using namespace Gen;
 		num_blocks = 0;
 		m_initialized = false;
 
+		// An applied hint saves a recompile only if the block would have taken
+		// that exception check again; a learnt hint is a recompile that happened.
+		if (hints_loaded || hints_learnt)
+		{
+			NOTICE_LOG(DYNA_REC, "JIT hint cache: %u hints loaded, %u applied, %u outdated, %u learnt",
+			           hints_loaded, hints_applied, hints_outdated, hints_learnt);
+		}
+
+		hint_disk_cache.Sync();
+		hint_disk_cache.Close();
+		stored_hints.clear();
+		checked_hint_lines.clear();
+
 		JitRegister::Shutdown();
 	}
 
@@ -67,16 +161,19 @@ using namespace Gen;
 #endif
 		jit->js.fifoWriteAddresses.clear();
 		jit->js.pairedQuantizeAddresses.clear();
+		jit->js.hotBlockAddresses.clear();
+		checked_hint_lines.clear();
 		for (int i = 0; i < num_blocks; i++)
 		{
 			DestroyBlock(i, false);
 		}
 		links_to.clear();
-		block_map.clear();
+		block_lines.clear();
 
 		valid_block.ClearAll();
 
 		num_blocks = 0;
+		free_blocks.clear();
 		blockCodePointers.fill(nullptr);
 	}
 
@@ -98,12 +195,23 @@ using namespace Gen;
 
 	int JitBaseBlockCache::AllocateBlock(u32 em_address)
 	{
-		JitBlock &b = blocks[num_blocks];
+		int block_num;
+		if (!free_blocks.empty())
+		{
+			block_num = free_blocks.back();
+			free_blocks.pop_back();
+		}
+		else
+		{
+			block_num = num_blocks++; //commit the current block
+		}
+
+		JitBlock &b = blocks[block_num];
 		b.invalid = false;
 		b.originalAddress = em_address;
 		b.linkData.clear();
-		num_blocks++; //commit the current block
-		return num_blocks - 1;
+		b.inlinedLines.clear();
+		return block_num;
 	}
 
 	void JitBaseBlockCache::FinalizeBlock(int block_num, bool block_link, const u8 *code_ptr)
@@ -113,19 +221,22 @@ using namespace Gen;
 
 		std::memcpy(GetICachePtr(b.originalAddress), &block_num, sizeof(u32));
 
-		// Convert the logical address to a physical address for the block map
-		u32 pAddr = b.originalAddress & 0x1FFFFFFF;
-
-		for (u32 block = pAddr / 32; block <= (pAddr + (b.originalSize - 1) * 4) / 32; ++block)
-			valid_block.Set(block);
-
-		block_map[std::make_pair(pAddr + 4 * b.originalSize - 1, pAddr)] = block_num;
+		for (u32 line = FirstLine(b); line <= LastLine(b); ++line)
+		{
+			block_lines[line].push_back(block_num);
+			valid_block.Set(line);
+		}
+		for (u32 line : b.inlinedLines)
+		{
+			block_lines[line].push_back(block_num);
+			valid_block.Set(line);
+		}
 
 		if (block_link)
 		{
 			for (const auto& e : b.linkData)
 			{
-				links_to.emplace(e.exitAddress, block_num);
+				links_to[e.exitAddress].push_back(block_num);
 			}
 
 			LinkBlock(block_num);
@@ -206,38 +317,72 @@ using namespace Gen;
 	{
 		LinkBlockExits(i);
 		JitBlock &b = blocks[i];
-		// equal_range(b) returns pair<iterator,iterator> representing the range
-		// of element with key b
-		auto ppp = links_to.equal_range(b.originalAddress);
+		auto sources = links_to.find(b.originalAddress);
 
-		if (ppp.first == ppp.second)
+		if (sources == links_to.end())
 			return;
 
-		for (auto iter = ppp.first; iter != ppp.second; ++iter)
+		for (int source : sources->second)
 		{
-			// PanicAlert("Linking block %i to block %i", iter->second, i);
-			LinkBlockExits(iter->second);
+			// PanicAlert("Linking block %i to block %i", source, i);
+			LinkBlockExits(source);
 		}
 	}
 
 	void JitBaseBlockCache::UnlinkBlock(int i)
 	{
 		JitBlock &b = blocks[i];
-		auto ppp = links_to.equal_range(b.originalAddress);
-
-		if (ppp.first == ppp.second)
-			return;
 
-		for (auto iter = ppp.first; iter != ppp.second; ++iter)
+		// Blocks jumping here go back through the dispatcher until a new block
+		// at this address links them again, so they stay in links_to.
+		auto sources = links_to.find(b.originalAddress);
+		if (sources != links_to.end())
 		{
-			JitBlock &sourceBlock = blocks[iter->second];
-			for (auto& e : sourceBlock.linkData)
+			for (int source : sources->second)
 			{
-				if (e.exitAddress == b.originalAddress)
-					e.linkStatus = false;
+				for (auto& e : blocks[source].linkData)
+				{
+					if (e.exitAddress == b.originalAddress)
+						e.linkStatus = false;
+				}
 			}
 		}
-		links_to.erase(b.originalAddress);
+
+		// This block's own exits don't need relinking anymore, and its number
+		// is about to be reused.
+		for (const auto& e : b.linkData)
+		{
+			auto targets = links_to.find(e.exitAddress);
+			if (targets == links_to.end())
+				continue;
+
+			EraseBlockNumber(targets->second, i);
+			if (targets->second.empty())
+				links_to.erase(targets);
+		}
+	}
+
+	void JitBaseBlockCache::RemoveBlockFromLine(int i, u32 line)
+	{
+		auto it = block_lines.find(line);
+		if (it == block_lines.end())
+			return;
+
+		EraseBlockNumber(it->second, i);
+		if (it->second.empty())
+		{
+			block_lines.erase(it);
+			valid_block.Clear(line);
+		}
+	}
+
+	void JitBaseBlockCache::RemoveBlockFromLines(int i)
+	{
+		JitBlock &b = blocks[i];
+		for (u32 line = FirstLine(b); line <= LastLine(b); ++line)
+			RemoveBlockFromLine(i, line);
+		for (u32 line : b.inlinedLines)
+			RemoveBlockFromLine(i, line);
 	}
 
 	void JitBaseBlockCache::DestroyBlock(int block_num, bool invalidate)
@@ -258,46 +403,76 @@ using namespace Gen;
 		std::memcpy(GetICachePtr(b.originalAddress), &JIT_ICACHE_INVALID_WORD, sizeof(u32));
 
 		UnlinkBlock(block_num);
+		RemoveBlockFromLines(block_num);
 
 		// Send anyone who tries to run this block back to the dispatcher.
 		// Not entirely ideal, but .. pretty good.
 		// Spurious entrances from previously linked blocks can only come through checkedEntry
 		WriteDestroyBlock(b.checkedEntry, b.originalAddress);
+
+		// The code stays where it is, so only the number can be handed out again.
+		free_blocks.push_back(block_num);
 	}
 
 	void JitBaseBlockCache::InvalidateICache(u32 address, const u32 length, bool forced)
 	{
+		if (length == 0)
+			return;
+
+		if (!forced)
+			ForgetCheckedHintLines(address, length);
+
 		// Convert the logical address to a physical address for the block map
 		u32 pAddr = address & 0x1FFFFFFF;
+		const u64 pEnd = static_cast<u64>(pAddr) + length;
 
 		// Optimize the common case of length == 32 which is used by Interpreter::dcb*
 		bool destroy_block = true;
-		if (length == 32)
-		{
-			if (!valid_block.Test(pAddr / 32))
-				destroy_block = false;
-			else
-				valid_block.Clear(pAddr / 32);
-		}
+		if (length == 32 && !valid_block.Test(pAddr / 32))
+			destroy_block = false;
 
 		// destroy JIT blocks
-		// !! this works correctly under assumption that any two overlapping blocks end at the same address
 		if (destroy_block)
 		{
-			std::map<std::pair<u32,u32>, u32>::iterator it1 = block_map.lower_bound(std::make_pair(pAddr, 0)), it2 = it1;
-			while (it2 != block_map.end() && it2->first.second < pAddr + length)
+			std::vector<int> doomed;
+			if (length / 32 > static_cast<u32>(num_blocks))
 			{
-				JitBlock &b = blocks[it2->second];
-				std::memcpy(GetICachePtr(b.originalAddress), &JIT_ICACHE_INVALID_WORD, sizeof(u32));
-
-				DestroyBlock(it2->second, true);
-				++it2;
+				// Cheaper to look at every block than at every line in the range.
+				for (int i = 0; i < num_blocks; i++)
+				{
+					const JitBlock &b = blocks[i];
+					if (b.invalid)
+						continue;
+
+					const u32 start = b.originalAddress & 0x1FFFFFFF;
+					bool overlaps = start < pEnd && start + b.originalSize * 4 > pAddr;
+					for (u32 line : b.inlinedLines)
+						overlaps |= line * 32 < pEnd && line * 32 + 32 > pAddr;
+					if (overlaps)
+						doomed.push_back(i);
+				}
 			}
-			if (it1 != it2)
+			else
 			{
-				block_map.erase(it1, it2);
+				const u32 last_line = static_cast<u32>(std::min<u64>((pEnd - 1) / 32,
+					ValidBlockBitSet::VALID_BLOCK_MASK_SIZE - 1));
+				for (u32 line = pAddr / 32; line <= last_line; ++line)
+				{
+					if (!valid_block.Test(line))
+						continue;
+
+					const auto& line_blocks = block_lines.find(line)->second;
+					doomed.insert(doomed.end(), line_blocks.begin(), line_blocks.end());
+				}
+
+				// Blocks spanning several lines show up once per line.
+				std::sort(doomed.begin(), doomed.end());
+				doomed.erase(std::unique(doomed.begin(), doomed.end()), doomed.end());
 			}
 
+			for (int i : doomed)
+				DestroyBlock(i, true);
+
 			// If the code was actually modified, we need to clear the relevant entries from the
 			// FIFO write address cache, so we don't end up with FIFO checks in places they shouldn't
 			// be (this can clobber flags, and thus break any optimization that relies on flags
@@ -308,11 +483,114 @@ using namespace Gen;
 				{
 					jit->js.fifoWriteAddresses.erase(i);
 					jit->js.pairedQuantizeAddresses.erase(i);
+					jit->js.hotBlockAddresses.erase(i);
 				}
 			}
 		}
 	}
 
+	bool JitBaseBlockCache::AddStoredHint(const JitStoredHint& hint)
+	{
+		std::vector<JitStoredHint>& hints = stored_hints[hint.key.address & ~31];
+		for (const JitStoredHint& other : hints)
+		{
+			if (other.key.address == hint.key.address && other.key.type == hint.key.type && other.code == hint.code)
+				return false;
+		}
+		hints.push_back(hint);
+		return true;
+	}
+
+	// The code in the range may have changed, so its stored hints have to be
+	// compared against memory again before they're used.
+	void JitBaseBlockCache::ForgetCheckedHintLines(u32 address, u32 length)
+	{
+		if (checked_hint_lines.empty())
+			return;
+
+		const u64 end = static_cast<u64>(address) + length;
+		if (length / 32 > checked_hint_lines.size())
+		{
+			for (auto it = checked_hint_lines.begin(); it != checked_hint_lines.end();)
+			{
+				if (*it + 32 > address && *it < end)
+					it = checked_hint_lines.erase(it);
+				else
+					++it;
+			}
+		}
+		else
+		{
+			for (u64 line = address & ~31; line < end; line += 32)
+				checked_hint_lines.erase(static_cast<u32>(line));
+		}
+	}
+
+	bool JitBaseBlockCache::ApplyStoredHintLine(u32 line)
+	{
+		if (!checked_hint_lines.insert(line).second)
+			return false;
+
+		const auto it = stored_hints.find(line);
+		std::array<u32, 8> code;
+		if (it == stored_hints.end() || !ReadHintLine(line, &code))
+			return false;
+
+		bool applied = false;
+		for (const JitStoredHint& hint : it->second)
+		{
+			if (hint.code != code)
+			{
+				hints_outdated++;
+				continue;
+			}
+			if (!GetHintAddresses(hint.key.type)->insert(hint.key.address).second)
+				continue;
+
+			hints_applied++;
+			applied = true;
+
+			// A block compiled earlier may already contain the address, e.g. through
+			// inlining; it has to pick up the hint too.
+			InvalidateICache(hint.key.address, 4, true);
+		}
+		return applied;
+	}
+
+	bool JitBaseBlockCache::ApplyStoredHints(const PPCAnalyst::CodeBuffer& buffer, u32 num_instructions)
+	{
+		// Hints change which blocks get recompiled and where they end, so the
+		// emitted code would depend on the contents of the user's cache folder.
+		// NetPlay and movies need every machine to compile the same blocks.
+		if (stored_hints.empty() || NetPlay::IsNetPlayRunning() || Movie::IsMovieActive())
+			return false;
+
+		bool applied = false;
+		u32 last_line = 1;
+		for (u32 i = 0; i < num_instructions; i++)
+		{
+			const u32 line = buffer.codebuffer[i].address & ~31;
+			if (line == last_line)
+				continue;
+
+			last_line = line;
+			applied |= ApplyStoredHintLine(line);
+		}
+		return applied;
+	}
+
+	void JitBaseBlockCache::StoreHint(JitInterface::ExceptionType type, u32 address)
+	{
+		JitStoredHint hint;
+		hint.key.address = address;
+		hint.key.type = static_cast<u32>(type);
+		if (!ReadHintLine(address & ~31, &hint.code) || !AddStoredHint(hint))
+			return;
+
+		hints_learnt++;
+		hint_disk_cache.Append(hint.key, hint.code.data(), static_cast<u32>(hint.code.size()));
+	}
+
 	void JitBlockCache::WriteLinkBlock(u8* location, const u8* address)
 	{
 		XEmitter emit(location);
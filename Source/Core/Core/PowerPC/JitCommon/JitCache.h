@@ -6,11 +6,14 @@
 
 #include <array>
 #include <bitset>
-#include <map>
 #include <memory>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
+#include "Common/LinearDiskCache.h"
 #include "Core/PowerPC/Gekko.h"
+#include "Core/PowerPC/JitInterface.h"
 #include "Core/PowerPC/PPCAnalyst.h"
 
 static const u32 JIT_ICACHE_SIZE = 0x2000000;
@@ -33,6 +36,11 @@ struct JitBlock
 	u32 codeSize;
 	u32 originalSize;
 	int runCount;  // for profiling.
+	u32 hotCounter; // counts down to recompiling the block with inlining
+
+	// 32-byte physical lines of code inlined from outside
+	// [originalAddress, originalAddress + originalSize * 4).
+	std::vector<u32> inlinedLines;
 
 	bool invalid;
 
@@ -53,6 +61,25 @@ struct JitBlock
 
 typedef void (*CompiledCode)();
 
+// A compile hint learnt while running (see JitInterface::CompileExceptionCheck).
+// Hints are kept on disk per game, so that the next boot compiles the blocks
+// right the first time instead of recompiling them once the hint is learnt.
+// Only the hints are kept, not the emitted code: every block is still compiled
+// once per boot, the cache only saves the second compile of hinted blocks.
+struct JitHintKey
+{
+	u32 address;
+	u32 type;  // JitInterface::ExceptionType
+};
+
+struct JitStoredHint
+{
+	JitHintKey key;
+	// The 32-byte line holding the address when the hint was learnt. The hint
+	// is only used while the line still contains the same code.
+	std::array<u32, 8> code;
+};
+
 // This is essentially just an std::bitset, but Visual Studia 2013's
 // implementation of std::bitset is slow.
 class ValidBlockBitSet final
@@ -103,15 +130,33 @@ class JitBaseBlockCache
 	std::array<const u8*, MAX_NUM_BLOCKS> blockCodePointers;
 	std::array<JitBlock, MAX_NUM_BLOCKS> blocks;
 	int num_blocks;
-	std::multimap<u32, int> links_to;
-	std::map<std::pair<u32, u32>, u32> block_map; // (end_addr, start_addr) -> number
+	std::vector<int> free_blocks; // numbers of destroyed blocks, handed out again first
+	std::unordered_map<u32, std::vector<int>> links_to; // exit address -> blocks exiting there
+	std::unordered_map<u32, std::vector<int>> block_lines; // 32-byte physical line -> blocks overlapping it
+	// A bit is set exactly for the lines that have an entry in block_lines.
 	ValidBlockBitSet valid_block;
 
 	bool m_initialized;
 
+	LinearDiskCache<JitHintKey, u32> hint_disk_cache;
+	std::unordered_map<u32, std::vector<JitStoredHint>> stored_hints; // 32-byte effective line -> hints
+	// Lines whose hints have been compared against memory since the last time
+	// their code or the hint sets could have changed.
+	std::unordered_set<u32> checked_hint_lines;
+	// Reported on shutdown, to show how much the stored hints help a game.
+	u32 hints_loaded;
+	u32 hints_applied;
+	u32 hints_outdated;
+	u32 hints_learnt;
+
 	void LinkBlockExits(int i);
 	void LinkBlock(int i);
 	void UnlinkBlock(int i);
+	void RemoveBlockFromLine(int i, u32 line);
+	void RemoveBlockFromLines(int i);
+	bool AddStoredHint(const JitStoredHint& hint);
+	void ForgetCheckedHintLines(u32 address, u32 length);
+	bool ApplyStoredHintLine(u32 line);
 
 	u8* GetICachePtr(u32 addr);
 	void DestroyBlock(int block_num, bool invalidate);
@@ -155,6 +200,12 @@ public:
 	// DOES NOT WORK CORRECTLY WITH INLINING
 	void InvalidateICache(u32 address, const u32 length, bool forced);
 
+	// Called by the JITs after analyzing a block: puts the stored hints for the
+	// lines holding its instructions back into the JIT state. Returns true if a
+	// hint was applied, in which case the block has to be analyzed again.
+	bool ApplyStoredHints(const PPCAnalyst::CodeBuffer& buffer, u32 num_instructions);
+	void StoreHint(JitInterface::ExceptionType type, u32 address);
+
 	u32* GetBlockBitSet() const
 	{
 		return valid_block.m_valid_block.get();
@@ -3,12 +3,15 @@
 // Refer to the license.txt file included.
 
 #include <cinttypes>
+#include <cstddef>
+#include <initializer_list>
 #include <string>
 
 #include "Common/CommonTypes.h"
 #include "Common/JitRegister.h"
 #include "Common/StringUtil.h"
 #include "Common/x64ABI.h"
+#include "Core/ConfigManager.h"
 #include "Core/HW/Memmap.h"
 #include "Core/PowerPC/JitCommon/JitBase.h"
 #include "Core/PowerPC/JitCommon/TrampolineCache.h"
@@ -35,6 +38,182 @@ void TrampolineCache::Shutdown()
 	FreeCodeSpace();
 }
 
+// Returns a register that is none of the given ones.
+static X64Reg PickScratch(std::initializer_list<X64Reg> taken)
+{
+	for (X64Reg reg : {RSCRATCH, RSCRATCH2, RSCRATCH_EXTRA, RSI, RDI, R8, R9})
+	{
+		bool free = true;
+		for (X64Reg other : taken)
+			free &= reg != other;
+		if (free)
+			return reg;
+	}
+	return INVALID_REG;
+}
+
+// Expects the address in ABI_PARAM1. The scratch registers are saved on the
+// stack; the data register is the result and can be clobbered freely.
+// The cache only holds data translations, so with MSR.DR off the address is
+// physical and the probe is skipped; nothing flushes the cache on MSR writes.
+void TrampolineCache::GenerateTranslationCacheRead(const InstructionInfo &info, bool pushed_param1, u8* returnPtr)
+{
+	X64Reg dataReg = (X64Reg)info.regOperandReg;
+	if (dataReg == ABI_PARAM1)
+		return;
+
+	TEST(32, PPCSTATE(msr), Imm32(1 << (31 - 27)));
+	FixupBranch real_mode = J_CC(CC_Z);
+
+	const u32 page_mask = (1 << HW_PAGE_INDEX_SHIFT) - 1;
+	X64Reg index = PickScratch({ABI_PARAM1, dataReg});
+	X64Reg base = PickScratch({ABI_PARAM1, dataReg, index});
+	PUSH(index);
+	PUSH(base);
+
+	MOV(32, R(index), R(ABI_PARAM1));
+	SHR(32, R(index), Imm8(HW_PAGE_INDEX_SHIFT));
+	AND(32, R(index), Imm32(TRANSLATION_CACHE_SIZE - 1));
+	MOV(32, R(dataReg), R(ABI_PARAM1));
+	AND(32, R(dataReg), Imm32(~page_mask));
+	MOV(64, R(base), ImmPtr(&PowerPC::translation_cache));
+	CMP(32, R(dataReg), MComplex(base, index, SCALE_4, offsetof(PowerPC::TranslationCache, read_tag)));
+	FixupBranch wrong_page = J_CC(CC_NE);
+
+	// Accesses that straddle two pages take the slow path.
+	MOV(32, R(dataReg), R(ABI_PARAM1));
+	AND(32, R(dataReg), Imm32(page_mask));
+	CMP(32, R(dataReg), Imm32(page_mask + 1 - info.operandSize));
+	FixupBranch straddles = J_CC(CC_A);
+
+	MOV(64, R(base), MComplex(base, index, SCALE_8, offsetof(PowerPC::TranslationCache, read_page)));
+	switch (info.operandSize)
+	{
+	case 8:
+		MOV(64, R(dataReg), MRegSum(base, dataReg));
+		BSWAP(64, dataReg);
+		break;
+	case 4:
+		MOV(32, R(dataReg), MRegSum(base, dataReg));
+		BSWAP(32, dataReg);
+		break;
+	case 2:
+		MOVZX(32, 16, dataReg, MRegSum(base, dataReg));
+		ROL(16, R(dataReg), Imm8(8));
+		if (info.signExtend)
+			MOVSX(32, 16, dataReg, R(dataReg));
+		break;
+	case 1:
+		if (info.signExtend)
+			MOVSX(32, 8, dataReg, MRegSum(base, dataReg));
+		else
+			MOVZX(32, 8, dataReg, MRegSum(base, dataReg));
+		break;
+	}
+
+	POP(base);
+	POP(index);
+	if (pushed_param1)
+		POP(ABI_PARAM1);
+	JMP(returnPtr, true);
+
+	SetJumpTarget(wrong_page);
+	SetJumpTarget(straddles);
+	POP(base);
+	POP(index);
+	SetJumpTarget(real_mode);
+}
+
+// The data register holds the value in host byte order and has to be left
+// that way, so it is swapped around the store. Skipped with MSR.DR off, like
+// the read probe.
+void TrampolineCache::GenerateTranslationCacheWrite(const InstructionInfo &info, u8* returnPtr)
+{
+	X64Reg dataReg = (X64Reg)info.regOperandReg;
+	X64Reg addrReg = (X64Reg)info.scaledReg;
+	if (info.hasImmediate && info.operandSize == 8)
+		return;
+
+	TEST(32, PPCSTATE(msr), Imm32(1 << (31 - 27)));
+	FixupBranch real_mode = J_CC(CC_Z);
+
+	const u32 page_mask = (1 << HW_PAGE_INDEX_SHIFT) - 1;
+	X64Reg index = PickScratch({addrReg, dataReg});
+	X64Reg base = PickScratch({addrReg, dataReg, index});
+	X64Reg offset = PickScratch({addrReg, dataReg, index, base});
+	PUSH(index);
+	PUSH(base);
+	PUSH(offset);
+
+	LEA(32, offset, MDisp(addrReg, info.displacement));
+	MOV(32, R(index), R(offset));
+	SHR(32, R(index), Imm8(HW_PAGE_INDEX_SHIFT));
+	AND(32, R(index), Imm32(TRANSLATION_CACHE_SIZE - 1));
+	AND(32, R(offset), Imm32(~page_mask));
+	MOV(64, R(base), ImmPtr(&PowerPC::translation_cache));
+	CMP(32, R(offset), MComplex(base, index, SCALE_4, offsetof(PowerPC::TranslationCache, write_tag)));
+	FixupBranch wrong_page = J_CC(CC_NE);
+
+	LEA(32, offset, MDisp(addrReg, info.displacement));
+	AND(32, R(offset), Imm32(page_mask));
+	CMP(32, R(offset), Imm32(page_mask + 1 - info.operandSize));
+	FixupBranch straddles = J_CC(CC_A);
+
+	MOV(64, R(base), MComplex(base, index, SCALE_8, offsetof(PowerPC::TranslationCache, write_page)));
+	if (info.hasImmediate)
+	{
+		// The immediate is already in guest byte order.
+		switch (info.operandSize)
+		{
+		case 4:
+			MOV(32, MRegSum(base, offset), Imm32((u32)info.immediate));
+			break;
+		case 2:
+			MOV(16, MRegSum(base, offset), Imm16((u16)info.immediate));
+			break;
+		case 1:
+			MOV(8, MRegSum(base, offset), Imm8((u8)info.immediate));
+			break;
+		}
+	}
+	else
+	{
+		switch (info.operandSize)
+		{
+		case 8:
+			BSWAP(64, dataReg);
+			MOV(64, MRegSum(base, offset), R(dataReg));
+			BSWAP(64, dataReg);
+			break;
+		case 4:
+			BSWAP(32, dataReg);
+			MOV(32, MRegSum(base, offset), R(dataReg));
+			BSWAP(32, dataReg);
+			break;
+		case 2:
+			ROL(16, R(dataReg), Imm8(8));
+			MOV(16, MRegSum(base, offset), R(dataReg));
+			ROL(16, R(dataReg), Imm8(8));
+			break;
+		case 1:
+			MOV(8, MRegSum(base, offset), R(dataReg));
+			break;
+		}
+	}
+
+	POP(offset);
+	POP(base);
+	POP(index);
+	JMP(returnPtr, true);
+
+	SetJumpTarget(wrong_page);
+	SetJumpTarget(straddles);
+	POP(offset);
+	POP(base);
+	POP(index);
+	SetJumpTarget(real_mode);
+}
+
 const u8* TrampolineCache::GenerateReadTrampoline(const InstructionInfo &info, BitSet32 registersInUse, u8* exceptionHandler, u8* returnPtr)
 {
 	if (GetSpaceLeft() < 1024)
@@ -61,6 +240,9 @@ const u8* TrampolineCache::GenerateReadTrampoline(const InstructionInfo &info, B
 	else if (info.displacement)
 		ADD(32, R(ABI_PARAM1), Imm32(info.displacement));
 
+	if (SConfig::GetInstance().bMMU)
+		GenerateTranslationCacheRead(info, push_param1, returnPtr);
+
 	ABI_PushRegistersAndAdjustStack(registersInUse, stack_offset);
 
 	switch (info.operandSize)
@@ -117,6 +299,9 @@ const u8* TrampolineCache::GenerateWriteTrampoline(const InstructionInfo &info,
 	// PC is used by memory watchpoints (if enabled) or to print accurate PC locations in debug logs
 	MOV(32, PPCSTATE(pc), Imm32(pc));
 
+	if (SConfig::GetInstance().bMMU)
+		GenerateTranslationCacheWrite(info, returnPtr);
+
 	ABI_PushRegistersAndAdjustStack(registersInUse, 0);
 
 	if (info.hasImmediate)
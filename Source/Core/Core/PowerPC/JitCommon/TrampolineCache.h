@@ -23,4 +23,11 @@ public:
 	const u8* GenerateReadTrampoline(const InstructionInfo &info, BitSet32 registersInUse, u8* exceptionHandler, u8* returnPtr);
 	const u8* GenerateWriteTrampoline(const InstructionInfo &info, BitSet32 registersInUse, u8* exceptionHandler, u8* returnPtr, u32 pc);
 	void ClearCodeSpace();
+
+private:
+	// Inline probes of PowerPC::translation_cache for MMU games. A hit does
+	// the access on the host page and jumps back; a miss falls through to the
+	// generic call.
+	void GenerateTranslationCacheRead(const InstructionInfo &info, bool pushed_param1, u8* returnPtr);
+	void GenerateTranslationCacheWrite(const InstructionInfo &info, u8* returnPtr);
 };
@@ -5,6 +5,8 @@
 #include <algorithm>
 #include <cinttypes>
 #include <string>
+#include <unordered_set>
+#include <vector>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -12,6 +14,7 @@
 #include "Common/PerformanceCounter.h"
 #endif
 
+#include "Common/ChunkFile.h"
 #include "Core/ConfigManager.h"
 #include "Core/HW/Memmap.h"
 #include "Core/PowerPC/CachedInterpreter.h"
@@ -38,10 +41,31 @@ bool bMMU = false;
 
 namespace JitInterface
 {
+	// The exception check and hot block addresses decide where blocks end, and
+	// so where CoreTiming events run. They are saved with the state, so that a
+	// loaded state compiles the same blocks the saving machine had compiled,
+	// which netplay rollback relies on.
+	static void DoAddresses(PointerWrap &p, std::unordered_set<u32>* addresses)
+	{
+		std::vector<u32> sorted;
+		if (addresses && p.GetMode() != PointerWrap::MODE_READ)
+		{
+			sorted.assign(addresses->begin(), addresses->end());
+			std::sort(sorted.begin(), sorted.end());
+		}
+		p.Do(sorted);
+		if (addresses && p.GetMode() == PointerWrap::MODE_READ)
+			addresses->insert(sorted.begin(), sorted.end());
+	}
+
 	void DoState(PointerWrap &p)
 	{
 		if (jit && p.GetMode() == PointerWrap::MODE_READ)
 			jit->GetBlockCache()->Clear();
+
+		DoAddresses(p, jit ? &jit->js.fifoWriteAddresses : nullptr);
+		DoAddresses(p, jit ? &jit->js.pairedQuantizeAddresses : nullptr);
+		DoAddresses(p, jit ? &jit->js.hotBlockAddresses : nullptr);
 	}
 	CPUCoreBase *InitJitCore(int core)
 	{
@@ -256,6 +280,9 @@ namespace JitInterface
 		case ExceptionType::EXCEPTIONS_PAIRED_QUANTIZE:
 			exception_addresses = &jit->js.pairedQuantizeAddresses;
 			break;
+		case ExceptionType::EXCEPTIONS_HOT_BLOCK:
+			exception_addresses = &jit->js.hotBlockAddresses;
+			break;
 		}
 
 		if (PC != 0 && (exception_addresses->find(PC)) == (exception_addresses->end()))
@@ -268,8 +295,10 @@ namespace JitInterface
 					return;
 			}
 			exception_addresses->insert(PC);
+			jit->GetBlockCache()->StoreHint(type, PC);
 
-			// Invalidate the JIT block so that it gets recompiled with the external exception check included.
+			// Invalidate the JIT block so that it gets recompiled with the external exception check included,
+			// or with the options for hot blocks.
 			jit->GetBlockCache()->InvalidateICache(PC, 4, true);
 		}
 	}
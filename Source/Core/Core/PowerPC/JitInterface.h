@@ -15,7 +15,8 @@ namespace JitInterface
 	enum class ExceptionType
 	{
 		EXCEPTIONS_FIFO_WRITE,
-		EXCEPTIONS_PAIRED_QUANTIZE
+		EXCEPTIONS_PAIRED_QUANTIZE,
+		EXCEPTIONS_HOT_BLOCK
 	};
 
 	void DoState(PointerWrap &p);
@@ -63,6 +63,63 @@ enum XCheckTLBFlag
 };
 template <const XCheckTLBFlag flag> static u32 TranslateAddress(const u32 address);
 
+TranslationCache translation_cache;
+
+static u32 TranslationCacheIndex(u32 address)
+{
+	return (address >> HW_PAGE_INDEX_SHIFT) & (TRANSLATION_CACHE_SIZE - 1);
+}
+
+// Returns the host pointer for a page of physical RAM, or nullptr if the page
+// is backed by something else.
+static u8* GetPhysicalRAMPage(u32 physical_address)
+{
+	const u32 page = physical_address & ~(HW_PAGE_SIZE - 1);
+	if (page < Memory::REALRAM_SIZE)
+		return Memory::m_pRAM + page;
+	if (Memory::m_pEXRAM && (page >> 28) == 0x1 && (page & 0x0FFFFFFF) < Memory::EXRAM_SIZE)
+		return Memory::m_pEXRAM + (page & 0x0FFFFFFF);
+	return nullptr;
+}
+
+// Called after a successful data translation, which always leaves the page in
+// the data TLB.
+template <const XCheckTLBFlag flag>
+static void UpdateTranslationCache(u32 address, u32 physical_address)
+{
+	if (flag != FLAG_READ && flag != FLAG_WRITE)
+		return;
+
+	u8* page = GetPhysicalRAMPage(physical_address);
+	if (!page)
+		return;
+
+	const u32 index = TranslationCacheIndex(address);
+	if (flag == FLAG_READ)
+	{
+		translation_cache.read_tag[index] = address & ~(HW_PAGE_SIZE - 1);
+		translation_cache.read_page[index] = page;
+	}
+	else
+	{
+		// Writes only get here once the TLB entry has its C bit set.
+		translation_cache.write_tag[index] = address & ~(HW_PAGE_SIZE - 1);
+		translation_cache.write_page[index] = page;
+	}
+}
+
+static void InvalidateTranslationCacheEntry(u32 index)
+{
+	translation_cache.read_tag[index] = TRANSLATION_CACHE_INVALID;
+	translation_cache.write_tag[index] = TRANSLATION_CACHE_INVALID;
+}
+
+void ClearTranslationCache()
+{
+	for (u32 i = 0; i < TRANSLATION_CACHE_SIZE; ++i)
+		InvalidateTranslationCacheEntry(i);
+}
+
 // Nasty but necessary. Super Mario Galaxy pointer relies on this stuff.
 static u32 EFB_Read(const u32 addr)
 {
@@ -183,7 +240,15 @@ __forceinline static T ReadFromHardware(const u32 em_address)
 		return 0;
 	}
 
-	// MMU: Do page table translation
+	// MMU: Try the translation cache, then do page table translation
+	if (flag == FLAG_READ || flag == FLAG_NO_EXCEPTION)
+	{
+		const u32 index = TranslationCacheIndex(em_address);
+		const u32 offset = em_address & (HW_PAGE_SIZE - 1);
+		if (translation_cache.read_tag[index] == (em_address & ~(HW_PAGE_SIZE - 1)) && offset <= HW_PAGE_SIZE - sizeof(T))
+			return bswap(*(const T*)&translation_cache.read_page[index][offset]);
+	}
+
 	u32 tlb_addr = TranslateAddress<flag>(em_address);
 	if (tlb_addr == 0)
 	{
@@ -220,6 +285,7 @@ __forceinline static T ReadFromHardware(const u32 em_address)
 	}
 
 	// The easy case!
+	UpdateTranslationCache<flag>(em_address, tlb_addr);
 	return bswap(*(const T*)&Memory::physical_base[tlb_addr]);
 }
 
@@ -334,7 +400,18 @@ __forceinline static void WriteToHardware(u32 em_address, const T data)
 		return;
 	}
 
-	// MMU: Do page table translation
+	// MMU: Try the translation cache, then do page table translation
+	if (flag == FLAG_WRITE || flag == FLAG_NO_EXCEPTION)
+	{
+		const u32 index = TranslationCacheIndex(em_address);
+		const u32 offset = em_address & (HW_PAGE_SIZE - 1);
+		if (translation_cache.write_tag[index] == (em_address & ~(HW_PAGE_SIZE - 1)) && offset <= HW_PAGE_SIZE - sizeof(T))
+		{
+			*(T*)&translation_cache.write_page[index][offset] = bswap(data);
+			return;
+		}
+	}
+
 	u32 tlb_addr = TranslateAddress<flag>(em_address);
 	if (tlb_addr == 0)
 	{
@@ -367,6 +444,7 @@ __forceinline static void WriteToHardware(u32 em_address, const T data)
 	}
 
 	// The easy case!
+	UpdateTranslationCache<flag>(em_address, tlb_addr);
 	*(T*)&Memory::physical_base[tlb_addr] = bswap(data);
 }
 // =====================
@@ -946,6 +1024,7 @@ void SDRUpdated()
 	}
 	PowerPC::ppcState.pagetable_base = htaborg<<16;
 	PowerPC::ppcState.pagetable_hashmask = ((xx<<10)|0x3ff);
+	ClearTranslationCache();
 }
 
 enum TLBLookupResult
@@ -1015,6 +1094,8 @@ static __forceinline void UpdateTLBEntry(const XCheckTLBFlag flag, UPTE2 PTE2, c
 	PowerPC::tlb_entry *tlbe = &PowerPC::ppcState.tlb[flag == FLAG_OPCODE][tag & HW_PAGE_INDEX_MASK];
 	int index = tlbe->recent == 0 && tlbe->tag[0] != TLB_TAG_INVALID;
 	tlbe->recent = index;
+	if (flag != FLAG_OPCODE && tlbe->tag[index] != TLB_TAG_INVALID)
+		InvalidateTranslationCacheEntry(TranslationCacheIndex(tlbe->tag[index] << HW_PAGE_INDEX_SHIFT));
 	tlbe->paddr[index] = PTE2.RPN << HW_PAGE_INDEX_SHIFT;
 	tlbe->pte[index] = PTE2.Hex;
 	tlbe->tag[index] = tag;
@@ -1028,6 +1109,11 @@ void InvalidateTLBEntry(u32 address)
 	PowerPC::tlb_entry *tlbe_i = &PowerPC::ppcState.tlb[1][(address >> HW_PAGE_INDEX_SHIFT) & HW_PAGE_INDEX_MASK];
 	tlbe_i->tag[0] = TLB_TAG_INVALID;
 	tlbe_i->tag[1] = TLB_TAG_INVALID;
+
+	// tlbie drops the whole congruence class, whatever the tags.
+	const u32 set = (address >> HW_PAGE_INDEX_SHIFT) & HW_PAGE_INDEX_MASK;
+	for (u32 index = set; index < TRANSLATION_CACHE_SIZE; index += HW_PAGE_INDEX_MASK + 1)
+		InvalidateTranslationCacheEntry(index);
 }
 
 // Page Address Translation
@@ -34,6 +34,8 @@ namespace PPCAnalyst
 static const int CODEBUFFER_SIZE = 32000;
 // 0 does not perform block merging
 static const u32 FUNCTION_FOLLOWING_THRESHOLD = 16;
+// Longer loops are unlikely to be waiting for something.
+static const u32 IDLE_LOOP_MAX_INSTRUCTIONS = 10;
 
 CodeBuffer::CodeBuffer(int size)
 {
@@ -643,6 +645,9 @@ u32 PPCAnalyzer::Analyze(u32 address, CodeBlock *block, CodeBuffer *buffer, u32
 	block->m_memory_exception = false;
 	block->m_num_instructions = 0;
 	block->m_gqr_used = BitSet8(0);
+	block->m_idle_loop = false;
+	block->m_idle_loop_loads.clear();
+	block->m_has_inlinable_call = false;
 
 	CodeOp *code = buffer->codebuffer;
 
@@ -692,30 +697,43 @@ u32 PPCAnalyzer::Analyze(u32 address, CodeBlock *block, CodeBuffer *buffer, u32
 
 		bool conditional_continue = false;
 
+		// Is bl - could we inline?
+		// Plain b isn't followed: it isn't a call, and jumping ahead into
+		// another block only duplicates that block's code.
+		bool inlinable_call = false;
+		if (inst.OPCD == 18 && inst.LK && blockSize > 1)
+		{
+			if (inst.AA)
+				destination = SignExt26(inst.LI << 2);
+			else
+				destination = address + SignExt26(inst.LI << 2);
+			// Only inline one level of calls.
+			inlinable_call = destination != block->m_address && return_address == 0;
+			if (inlinable_call)
+				block->m_has_inlinable_call = true;
+		}
+
 		// Do we inline leaf functions?
 		if (HasOption(OPTION_LEAF_INLINE))
 		{
-			if (inst.OPCD == 18 && blockSize > 1)
+			if (inlinable_call)
 			{
-				//Is bx - should we inline? yes!
-				if (inst.AA)
-					destination = SignExt26(inst.LI << 2);
-				else
-					destination = address + SignExt26(inst.LI << 2);
-				if (destination != block->m_address)
-					follow = true;
+				follow = true;
 			}
 			else if (inst.OPCD == 19 && inst.SUBOP10 == 16 &&
 				(inst.BO & (1 << 4)) && (inst.BO & (1 << 2)) &&
-				return_address != 0)
+				!inst.LK && return_address != 0)
 			{
 				// bclrx with unconditional branch = return
 				follow = true;
 				destination = return_address;
 				return_address = 0;
-
-				if (inst.LK)
-					return_address = address + 4;
+			}
+			else if ((inst.OPCD == 16 || inst.OPCD == 19) && inst.LK)
+			{
+				// Any other branch that sets LR means we can't know where the
+				// return goes anymore.
+				return_address = 0;
 			}
 			else if (inst.OPCD == 31 && inst.SUBOP10 == 467)
 			{
@@ -737,6 +755,9 @@ u32 PPCAnalyzer::Analyze(u32 address, CodeBlock *block, CodeBuffer *buffer, u32
 			//       "0" is fastest in some games, MP2 for example.
 			if (numFollows > FUNCTION_FOLLOWING_THRESHOLD)
 				follow = false;
+
+			if (follow && inst.OPCD == 18 && inst.LK)
+				return_address = address + 4;
 		}
 
 		if (HasOption(OPTION_CONDITIONAL_CONTINUE))
@@ -777,18 +798,17 @@ u32 PPCAnalyzer::Analyze(u32 address, CodeBlock *block, CodeBuffer *buffer, u32
 				break;
 			}
 		}
-		// XXX: We don't support inlining yet.
-#if 0
 		else
 		{
 			numFollows++;
-			// We don't "code[i].skip = true" here
+			// We don't "code[i].skip = true" for bx
 			// because bx may store a certain value to the link register.
 			// Instead, we skip a part of bx in Jit**::bx().
+			// The return itself has nothing left to do, LR is already right.
+			if (inst.OPCD == 19)
+				code[i].skip = true;
 			address = destination;
-			merged_addresses[size_of_merged_addresses++] = address;
 		}
-#endif
 	}
 
 	block->m_num_instructions = num_inst;
@@ -900,8 +920,109 @@ u32 PPCAnalyzer::Analyze(u32 address, CodeBlock *block, CodeBuffer *buffer, u32
 	}
 	block->m_gqr_used = gqrUsed;
 	block->m_gqr_modified = gqrModified;
+	block->m_idle_loop = IsIdleLoop(block, code, block->m_num_instructions);
 	return address;
 }
 
+bool PPCAnalyzer::IsIdleLoop(CodeBlock *block, const CodeOp *code, u32 instructions) const
+{
+	if (instructions < 2 || instructions > IDLE_LOOP_MAX_INSTRUCTIONS || block->m_broken)
+		return false;
+
+	// The last instruction has to jump back to the start of the block, without
+	// touching CTR or LR.
+	const CodeOp &last = code[instructions - 1];
+	u32 destination;
+	if (last.inst.OPCD == 18 && !last.inst.LK)
+		destination = last.inst.AA ? SignExt26(last.inst.LI << 2) : last.address + SignExt26(last.inst.LI << 2);
+	else if (last.inst.OPCD == 16 && !last.inst.LK && (last.inst.BO & BO_DONT_DECREMENT_FLAG))
+		destination = last.inst.AA ? SignExt16(last.inst.BD << 2) : last.address + SignExt16(last.inst.BD << 2);
+	else
+		return false;
+
+	if (destination != block->m_address)
+		return false;
+
+	BitSet32 written;
+	for (u32 i = 0; i < instructions - 1; i++)
+		written |= code[i].regsOut;
+
+	// Everything else may only load and compute. Registers the loop writes have
+	// to be written before they are read, so that no state is carried from one
+	// iteration to the next: every iteration then computes the same thing from
+	// the same memory.
+	BitSet32 written_this_iteration;
+	// Registers set from constants this iteration (li, lis, addi, ori), and their values.
+	BitSet32 constant;
+	u32 values[32];
+	std::vector<IdleLoopLoad> loads;
+	for (u32 i = 0; i < instructions - 1; i++)
+	{
+		const CodeOp &op = code[i];
+		const GekkoOPInfo *info = op.opinfo;
+
+		if (info->type == OPTYPE_LOAD)
+		{
+			// Only D-form loads: an indexed address can't be told apart from a
+			// hardware register here.
+			if (op.inst.OPCD == 31)
+				return false;
+
+			const u32 ra = op.inst.RA;
+			if (ra == 0 || constant[ra])
+			{
+				if (IsHardwareAddress((ra ? values[ra] : 0) + op.inst.SIMM_16))
+					return false;
+			}
+			else if (written_this_iteration[ra])
+			{
+				return false;
+			}
+			else
+			{
+				loads.push_back({ ra, op.inst.SIMM_16 });
+			}
+		}
+
+		if (info->type == OPTYPE_BRANCH)
+		{
+			// Conditional exits out of the loop are fine.
+			if (op.inst.OPCD != 16 || op.inst.LK || !(op.inst.BO & BO_DONT_DECREMENT_FLAG))
+				return false;
+		}
+		else if (info->type != OPTYPE_INTEGER && info->type != OPTYPE_LOAD)
+		{
+			return false;
+		}
+
+		if (info->flags & (FL_READ_CA | FL_SET_OE | FL_TIMER | FL_EVIL | FL_USE_FPU))
+			return false;
+
+		if (op.regsIn & written & ~written_this_iteration)
+			return false;
+
+		written_this_iteration |= op.regsOut;
+
+		const u32 rd = op.inst.RD;
+		constant &= ~op.regsOut;
+		if ((op.inst.OPCD == 14 || op.inst.OPCD == 15) && (op.inst.RA == 0 || constant[op.inst.RA]))
+		{
+			// addi, addis (li, lis with rA = 0)
+			const u32 base = op.inst.RA ? values[op.inst.RA] : 0;
+			values[rd] = base + (op.inst.OPCD == 15 ? static_cast<u32>(op.inst.SIMM_16) << 16 : op.inst.SIMM_16);
+			constant[rd] = true;
+		}
+		else if (op.inst.OPCD == 24 && constant[op.inst.RS])
+		{
+			// ori
+			values[op.inst.RA] = values[op.inst.RS] | op.inst.UIMM;
+			constant[op.inst.RA] = true;
+		}
+	}
+
+	block->m_idle_loop_loads = std::move(loads);
+	return true;
+}
+
 
 }  // namespace
@@ -138,6 +138,20 @@ private:
 	int size_;
 };
 
+// A load of an idle loop from a register the loop doesn't change, plus an offset.
+struct IdleLoopLoad
+{
+	u32 reg;
+	s32 offset;
+};
+
+// Hardware registers (and the EFB) can change without an event, e.g. the VI
+// beam position or the AI sample counter, so polling them isn't idling.
+inline bool IsHardwareAddress(u32 address)
+{
+	return (address & 0x18000000) == 0x08000000;
+}
+
 struct CodeBlock
 {
 	// Beginning PPC address.
@@ -164,6 +178,18 @@ struct CodeBlock
 
 	// Which GQRs this block modifies, if any.
 	BitSet8 m_gqr_modified;
+
+	// Is the block a short loop back to its own start that only polls memory?
+	// Running it again changes nothing until an interrupt or another piece of
+	// hardware changes memory, so the JITs can skip to the next event.
+	bool m_idle_loop;
+
+	// Loads of the idle loop whose address is only known at runtime. The JITs
+	// may only skip if none of them reads a hardware register.
+	std::vector<IdleLoopLoad> m_idle_loop_loads;
+
+	// Does the block call a function that OPTION_LEAF_INLINE could follow?
+	bool m_has_inlinable_call;
 };
 
 class PPCAnalyzer
@@ -179,6 +205,7 @@ private:
 
 	void ReorderInstructionsCore(u32 instructions, CodeOp* code, bool reverse, ReorderType type);
 	void ReorderInstructions(u32 instructions, CodeOp *code);
+	bool IsIdleLoop(CodeBlock *block, const CodeOp *code, u32 instructions) const;
 	void SetInstructionStats(CodeBlock *block, CodeOp *code, GekkoOPInfo *opinfo, u32 index);
 
 	// Options
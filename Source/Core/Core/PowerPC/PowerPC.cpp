@@ -30,7 +30,11 @@ namespace PowerPC
 
 // STATE_TO_SAVE
 PowerPCState ppcState;
-static volatile CPUState state = CPU_POWERDOWN;
+// Written by the UI thread (Pause, Stop) as well as the CPU thread (safe points),
+// so every transition that depends on the old state has to be atomic.
+static std::atomic<CPUState> state(CPU_POWERDOWN);
+// The JITs test it with 32-bit loads.
+static_assert(sizeof(state) == sizeof(u32), "CPU state must be read with one 32-bit load");
 
 Interpreter * const interpreter = Interpreter::getInstance();
 static CoreMode mode;
@@ -70,6 +74,10 @@ void DoState(PointerWrap &p)
 
 	p.DoPOD(ppcState);
 
+	// The TLB may have changed under the cached translations.
+	if (p.GetMode() == PointerWrap::MODE_READ)
+		ClearTranslationCache();
+
 	// SystemTimers::DecrementerSet();
 	// SystemTimers::TimeBaseSet();
 
@@ -135,6 +143,7 @@ void Init(int cpu_core)
 			}
 		}
 	}
+	ClearTranslationCache();
 
 	ResetRegisters();
 	PPCTables::InitTables(cpu_core);
@@ -217,9 +226,12 @@ void SingleStep()
 
 void RunLoop()
 {
-	state = CPU_RUNNING;
+	// CPU::Run only gets here while running; writing the state again would
+	// drop a Pause or Stop that came in since.
 	cpu_core_base->Run();
-	Host_UpdateDisasmDialog();
+	// Stopping at a safe point doesn't change anything the debugger shows.
+	if (state != CPU_SAFE_POINT)
+		Host_UpdateDisasmDialog();
 }
 
 CPUState GetState()
@@ -227,7 +239,7 @@ CPUState GetState()
 	return state;
 }
 
-volatile CPUState *GetStatePtr()
+std::atomic<CPUState> *GetStatePtr()
 {
 	return &state;
 }
@@ -240,8 +252,7 @@ void Start()
 
 void Pause()
 {
-	volatile CPUState old_state = state;
-	state = CPU_STEPPING;
+	const CPUState old_state = state.exchange(CPU_STEPPING);
 
 	// Wait for the CPU core to leave
 	if (old_state == CPU_RUNNING)
@@ -251,8 +262,7 @@ void Pause()
 
 void Stop()
 {
-	volatile CPUState old_state = state;
-	state = CPU_POWERDOWN;
+	const CPUState old_state = state.exchange(CPU_POWERDOWN);
 
 	// Wait for the CPU core to leave
 	if (old_state == CPU_RUNNING)
@@ -265,6 +275,18 @@ void FinishStateMove()
 	s_state_change.Set();
 }
 
+void RequestSafePoint()
+{
+	CPUState expected = CPU_RUNNING;
+	state.compare_exchange_strong(expected, CPU_SAFE_POINT);
+}
+
+void LeaveSafePoint()
+{
+	CPUState expected = CPU_SAFE_POINT;
+	state.compare_exchange_strong(expected, CPU_RUNNING);
+}
+
 void UpdatePerformanceMonitor(u32 cycles, u32 num_load_stores, u32 num_fp_inst)
 {
 	switch (MMCR0.PMC1SELECT)
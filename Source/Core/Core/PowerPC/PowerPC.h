@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <tuple>
 
 #include "Common/BreakPoints.h"
@@ -131,6 +132,7 @@ static_assert(offsetof(PowerPC::PowerPCState, above_fits_in_first_0x100) <= 0x10
 enum CPUState
 {
 	CPU_RUNNING = 0,
+	CPU_SAFE_POINT = 1,
 	CPU_STEPPING = 2,
 	CPU_POWERDOWN = 3,
 };
@@ -158,8 +160,13 @@ void Start();
 void Pause();
 void Stop();
 void FinishStateMove();
+// Makes the CPU core leave its runloop once the current timing slice is done,
+// so CPU::Run can do work that isn't safe inside CoreTiming::Advance. Only
+// has an effect while running.
+void RequestSafePoint();
+void LeaveSafePoint();
 CPUState GetState();
-volatile CPUState *GetStatePtr();  // this oddity is here instead of an extern declaration to easily be able to find all direct accesses throughout the code.
+std::atomic<CPUState> *GetStatePtr();  // this oddity is here instead of an extern declaration to easily be able to find all direct accesses throughout the code.
 
 u32 CompactCR();
 void ExpandCR(u32 cr);
@@ -265,6 +272,25 @@ void ClearCacheLine(const u32 address); // Zeroes 32 bytes; address should be 32
 void SDRUpdated();
 void InvalidateTLBEntry(u32 address);
 
+// Direct-mapped cache of data translations that resolved to RAM, indexed by
+// virtual page. An entry only lives as long as the data TLB entry it was
+// filled from, so a hit behaves like a TLB hit. Tags are page-aligned virtual
+// addresses; the JIT's memory trampolines probe the cache inline.
+#define TRANSLATION_CACHE_SIZE 1024
+#define TRANSLATION_CACHE_INVALID 0xffffffff
+
+struct TranslationCache
+{
+	u32 read_tag[TRANSLATION_CACHE_SIZE];
+	u32 write_tag[TRANSLATION_CACHE_SIZE];
+	u8* read_page[TRANSLATION_CACHE_SIZE];
+	u8* write_page[TRANSLATION_CACHE_SIZE];
+};
+
+extern TranslationCache translation_cache;
+
+void ClearTranslationCache();
+
 // Result changes based on the BAT registers and MSR.DR.  Returns whether
 // it's safe to optimize a read or write to this address to an unguarded
 // memory access.  Does not consider page tables.
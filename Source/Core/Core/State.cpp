@@ -68,7 +68,7 @@ static Common::Event g_compressAndDumpStateSyncEvent;
 static std::thread g_save_thread;
 
 // Don't forget to increase this after doing changes on the savestate system
-static const u32 STATE_VERSION = 50; // Last changed in PR 3108
+static const u32 STATE_VERSION = 53; // Last changed for JIT exception check addresses
 
 // Maps savestate versions to Dolphin versions.
 // Versions after 42 don't need to be added to this list,
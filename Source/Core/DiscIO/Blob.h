@@ -15,6 +15,8 @@
 // automatically do the right thing.
 
 #include <string>
+#include <vector>
+
 #include "Common/CommonTypes.h"
 
 namespace DiscIO
@@ -80,8 +82,20 @@ IBlobReader* CreateBlobReader(const std::string& filename);
 
 typedef bool (*CompressCB)(const std::string& text, float percent, void* arg);
 
+// How long each stage of CompressFileToBlob was busy, and what went through it.
+struct CompressStats
+{
+	u64 input_bytes = 0;
+	u64 output_bytes = 0;
+	double read_seconds = 0;
+	double compress_seconds = 0; // summed over all compressing threads
+	double write_seconds = 0;
+	int compress_threads = 0;
+	std::vector<bool> scrubbed_blocks; // replaced by 0xFF bytes instead of being read
+};
+
 bool CompressFileToBlob(const std::string& infile, const std::string& outfile, u32 sub_type = 0, int sector_size = 16384,
-		CompressCB callback = nullptr, void *arg = nullptr);
+		CompressCB callback = nullptr, void *arg = nullptr, CompressStats* stats = nullptr);
 bool DecompressBlobToFile(const std::string& infile, const std::string& outfile,
 		CompressCB callback = nullptr, void *arg = nullptr);
 
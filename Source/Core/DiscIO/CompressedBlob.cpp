@@ -8,11 +8,15 @@
 #endif
 
 #include <algorithm>
+#include <chrono>
 #include <cinttypes>
+#include <condition_variable>
 #include <cstdio>
 #include <cstring>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 #include <zlib.h>
 
@@ -145,33 +149,53 @@ void CompressedBlobReader::GetBlock(u64 block_num, u8 *out_ptr)
 	}
 }
 
+namespace
+{
+// A block on its way through CompressFileToBlob. Block i uses slot
+// i % slots.size(), which is handed from the reading to a compressing and
+// then to the writing thread.
+struct CompressSlot
+{
+	enum State
+	{
+		FREE,
+		READ,
+		COMPRESSING,
+		COMPRESSED,
+	};
+
+	State state = FREE;
+	u32 block = 0;
+	std::vector<u8> in;
+	std::vector<u8> out;
+	bool stored = false;
+	int size = 0;
+	u32 hash = 0;
+};
+
+double SecondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+}  // namespace
+
+// Reading (and scrubbing), compressing and writing run at the same time. The
+// blocks are compressed on as many threads as there are cores, since deflate
+// at level 9 is by far the slowest part.
 bool CompressFileToBlob(const std::string& infile, const std::string& outfile, u32 sub_type,
-						int block_size, CompressCB callback, void* arg)
+						int block_size, CompressCB callback, void* arg, CompressStats* stats)
 {
 	bool scrubbing = false;
 
-	if (IsGCZBlob(infile))
-	{
-		PanicAlertT("\"%s\" is already compressed! Cannot compress it further.", infile.c_str());
-		return false;
-	}
-
-	File::IOFile inf(infile, "rb");
+	// Going through a blob reader means other compressed formats (and GCZ
+	// files with a different block size) can be converted too.
+	std::unique_ptr<IBlobReader> inf(CreateBlobReader(infile));
 	if (!inf)
 	{
 		PanicAlertT("Failed to open the input file \"%s\".", infile.c_str());
 		return false;
 	}
 
-	File::IOFile f(outfile, "wb");
-	if (!f)
-	{
-		PanicAlertT("Failed to open the output file \"%s\".\n"
-		            "Check that you have permissions to write the target folder and that the media can be written.",
-		            outfile.c_str());
-		return false;
-	}
-
 	if (sub_type == 1)
 	{
 		if (!DiscScrubber::SetupScrub(infile, block_size))
@@ -183,46 +207,182 @@ bool CompressFileToBlob(const std::string& infile, const std::string& outfile, u
 		scrubbing = true;
 	}
 
-	z_stream z = {};
-	if (deflateInit(&z, 9) != Z_OK)
+	// Only created once nothing else can fail before the loop below, which
+	// deletes it again on errors.
+	File::IOFile f(outfile, "wb");
+	if (!f)
 	{
+		PanicAlertT("Failed to open the output file \"%s\".\n"
+		            "Check that you have permissions to write the target folder and that the media can be written.",
+		            outfile.c_str());
 		DiscScrubber::Cleanup();
 		return false;
 	}
 
-	callback("Files opened, ready to compress.", 0, arg);
+	if (callback)
+		callback("Files opened, ready to compress.", 0, arg);
 
 	CompressedBlobHeader header;
 	header.magic_cookie = kBlobCookie;
 	header.sub_type   = sub_type;
 	header.block_size = block_size;
-	header.data_size  = File::GetSize(infile);
+	header.data_size  = inf->GetDataSize();
 
 	// round upwards!
 	header.num_blocks = (u32)((header.data_size + (block_size - 1)) / block_size);
 
-	u64* offsets = new u64[header.num_blocks];
-	u32* hashes = new u32[header.num_blocks];
-	u8* out_buf = new u8[block_size];
-	u8* in_buf = new u8[block_size];
+	std::vector<u64> offsets(header.num_blocks);
+	std::vector<u32> hashes(header.num_blocks);
+	std::vector<bool> scrubbed(header.num_blocks);
 
 	// seek past the header (we will write it at the end)
 	f.Seek(sizeof(CompressedBlobHeader), SEEK_CUR);
 	// seek past the offset and hash tables (we will write them at the end)
 	f.Seek((sizeof(u64) + sizeof(u32)) * header.num_blocks, SEEK_CUR);
 
+	const int thread_count = std::max<int>(1, std::thread::hardware_concurrency());
+	std::vector<CompressSlot> slots(thread_count * 4);
+	for (CompressSlot& slot : slots)
+	{
+		slot.in.resize(block_size);
+		slot.out.resize(block_size);
+	}
+
+	std::mutex mutex;
+	std::condition_variable cv;
+	bool stop = false;
+	bool deflate_failed = false;
+	bool read_failed = false;
+	u32 unreadable_block = 0;
+	u32 next_to_compress = 0;
+	double compress_seconds = 0;
+	double read_seconds = 0;
+
+	auto reader = [&] {
+		double busy = 0;
+		for (u32 i = 0; i < header.num_blocks; i++)
+		{
+			CompressSlot& slot = slots[i % slots.size()];
+			{
+				std::unique_lock<std::mutex> lk(mutex);
+				cv.wait(lk, [&] { return stop || slot.state == CompressSlot::FREE; });
+				if (stop)
+					break;
+			}
+
+			const auto start = std::chrono::steady_clock::now();
+			const u64 offset = (u64)i * header.block_size;
+			const size_t read_bytes = (size_t)std::min<u64>(header.block_size, header.data_size - offset);
+			bool good = true;
+			if (scrubbing && DiscScrubber::CanBlockBeScrubbed(offset))
+			{
+				std::fill(slot.in.begin(), slot.in.begin() + read_bytes, 0xFF);
+				scrubbed[i] = true;
+			}
+			else
+			{
+				good = inf->Read(offset, read_bytes, slot.in.data());
+			}
+			std::fill(slot.in.begin() + read_bytes, slot.in.end(), 0);
+			busy += SecondsSince(start);
+
+			std::lock_guard<std::mutex> lk(mutex);
+			if (!good)
+			{
+				read_failed = true;
+				unreadable_block = i;
+				cv.notify_all();
+				break;
+			}
+			slot.block = i;
+			slot.state = CompressSlot::READ;
+			cv.notify_all();
+		}
+		std::lock_guard<std::mutex> lk(mutex);
+		read_seconds = busy;
+	};
+
+	auto compressor = [&] {
+		z_stream z = {};
+		const bool initialized = deflateInit(&z, 9) == Z_OK;
+		double busy = 0;
+
+		std::unique_lock<std::mutex> lk(mutex);
+		while (true)
+		{
+			CompressSlot* slot = nullptr;
+			cv.wait(lk, [&] {
+				if (stop || next_to_compress >= header.num_blocks)
+					return true;
+				slot = &slots[next_to_compress % slots.size()];
+				return slot->state == CompressSlot::READ && slot->block == next_to_compress;
+			});
+			if (stop || next_to_compress >= header.num_blocks)
+				break;
+			slot->state = CompressSlot::COMPRESSING;
+			next_to_compress++;
+			lk.unlock();
+
+			const auto start = std::chrono::steady_clock::now();
+			int status = Z_STREAM_ERROR;
+			if (initialized && deflateReset(&z) == Z_OK)
+			{
+				z.next_in   = slot->in.data();
+				z.avail_in  = header.block_size;
+				z.next_out  = slot->out.data();
+				z.avail_out = block_size;
+				status = deflate(&z, Z_FINISH);
+			}
+			else
+			{
+				ERROR_LOG(DISCIO, "Deflate failed");
+			}
+
+			if ((status != Z_STREAM_END) || (z.avail_out < 10))
+			{
+				// let's store uncompressed
+				slot->stored = true;
+				slot->size = block_size;
+				slot->hash = HashAdler32(slot->in.data(), block_size);
+			}
+			else
+			{
+				// let's store compressed
+				slot->stored = false;
+				slot->size = block_size - z.avail_out;
+				slot->hash = HashAdler32(slot->out.data(), slot->size);
+			}
+			busy += SecondsSince(start);
+
+			lk.lock();
+			if (!initialized)
+				deflate_failed = true;
+			slot->state = CompressSlot::COMPRESSED;
+			cv.notify_all();
+		}
+		compress_seconds += busy;
+		lk.unlock();
+
+		if (initialized)
+			deflateEnd(&z);
+	};
+
+	std::thread read_thread(reader);
+	std::vector<std::thread> compress_threads;
+	for (int i = 0; i < thread_count; i++)
+		compress_threads.emplace_back(compressor);
+
 	// Now we are ready to write compressed data!
 	u64 position = 0;
-	int num_compressed = 0;
-	int num_stored = 0;
 	int progress_monitor = std::max<int>(1, header.num_blocks / 1000);
 	bool success = true;
+	double write_seconds = 0;
 
 	for (u32 i = 0; i < header.num_blocks; i++)
 	{
-		if (i % progress_monitor == 0)
+		if (callback && i % progress_monitor == 0)
 		{
-			const u64 inpos = inf.Tell();
+			const u64 inpos = (u64)i * block_size;
 			int ratio = 0;
 			if (inpos != 0)
 				ratio = (int)(100 * position / inpos);
@@ -236,53 +396,23 @@ bool CompressFileToBlob(const std::string& infile, const std::string& outfile, u
 			}
 		}
 
-		offsets[i] = position;
-
-		size_t read_bytes;
-		if (scrubbing)
-			read_bytes = DiscScrubber::GetNextBlock(inf, in_buf);
-		else
-			inf.ReadArray(in_buf, header.block_size, &read_bytes);
-		if (read_bytes < header.block_size)
-			std::fill(in_buf + read_bytes, in_buf + header.block_size, 0);
-
-		int retval = deflateReset(&z);
-		z.next_in   = in_buf;
-		z.avail_in  = header.block_size;
-		z.next_out  = out_buf;
-		z.avail_out = block_size;
-
-		if (retval != Z_OK)
+		CompressSlot& slot = slots[i % slots.size()];
 		{
-			ERROR_LOG(DISCIO, "Deflate failed");
-			success = false;
-			break;
+			std::unique_lock<std::mutex> lk(mutex);
+			cv.wait(lk, [&] { return read_failed || (slot.state == CompressSlot::COMPRESSED && slot.block == i); });
+			if (deflate_failed || read_failed)
+			{
+				success = false;
+				break;
+			}
 		}
 
-		int status = deflate(&z, Z_FINISH);
-		int comp_size = block_size - z.avail_out;
-
-		u8* write_buf;
-		int write_size;
-		if ((status != Z_STREAM_END) || (z.avail_out < 10))
-		{
-			//PanicAlert("%i %i Store %i", i*block_size, position, comp_size);
-			// let's store uncompressed
-			write_buf = in_buf;
+		const auto start = std::chrono::steady_clock::now();
+		offsets[i] = position;
+		if (slot.stored)
 			offsets[i] |= 0x8000000000000000ULL;
-			write_size = block_size;
-			num_stored++;
-		}
-		else
-		{
-			// let's store compressed
-			//PanicAlert("Comp %i to %i", block_size, comp_size);
-			write_buf = out_buf;
-			write_size = comp_size;
-			num_compressed++;
-		}
 
-		if (!f.WriteBytes(write_buf, write_size))
+		if (!f.WriteBytes(slot.stored ? slot.in.data() : slot.out.data(), slot.size))
 		{
 			PanicAlertT(
 				"Failed to write the output file \"%s\".\n"
@@ -292,9 +422,27 @@ bool CompressFileToBlob(const std::string& infile, const std::string& outfile, u
 			break;
 		}
 
-		position += write_size;
+		position += slot.size;
+		hashes[i] = slot.hash;
+		write_seconds += SecondsSince(start);
 
-		hashes[i] = HashAdler32(write_buf, write_size);
+		std::lock_guard<std::mutex> lk(mutex);
+		slot.state = CompressSlot::FREE;
+		cv.notify_all();
+	}
+
+	{
+		std::lock_guard<std::mutex> lk(mutex);
+		stop = true;
+		cv.notify_all();
+	}
+	read_thread.join();
+	for (std::thread& thread : compress_threads)
+		thread.join();
+
+	if (read_failed)
+	{
+		PanicAlertT("Failed to read block %u of the input file \"%s\".", unreadable_block, infile.c_str());
 	}
 
 	header.compressed_data_size = position;
@@ -308,22 +456,28 @@ bool CompressFileToBlob(const std::string& infile, const std::string& outfile, u
 	else
 	{
 		// Okay, go back and fill in headers
+		const auto start = std::chrono::steady_clock::now();
 		f.Seek(0, SEEK_SET);
 		f.WriteArray(&header, 1);
-		f.WriteArray(offsets, header.num_blocks);
-		f.WriteArray(hashes, header.num_blocks);
+		f.WriteArray(offsets.data(), header.num_blocks);
+		f.WriteArray(hashes.data(), header.num_blocks);
+		write_seconds += SecondsSince(start);
 	}
 
-	// Cleanup
-	delete[] in_buf;
-	delete[] out_buf;
-	delete[] offsets;
-	delete[] hashes;
-
-	deflateEnd(&z);
 	DiscScrubber::Cleanup();
 
-	if (success)
+	if (stats)
+	{
+		stats->input_bytes = header.data_size;
+		stats->output_bytes = sizeof(CompressedBlobHeader) + (sizeof(u64) + sizeof(u32)) * header.num_blocks + position;
+		stats->read_seconds = read_seconds;
+		stats->compress_seconds = compress_seconds;
+		stats->write_seconds = write_seconds;
+		stats->compress_threads = thread_count;
+		stats->scrubbed_blocks = std::move(scrubbed);
+	}
+
+	if (success && callback)
 	{
 		callback("Done compressing disc image.", 1.0f, arg);
 	}
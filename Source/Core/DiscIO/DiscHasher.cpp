@@ -0,0 +1,142 @@
+// Copyright 2016 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include <mbedtls/md5.h>
+#include <zlib.h>
+
+#include "Common/CommonTypes.h"
+#include "Common/Event.h"
+#include "Common/StringUtil.h"
+#include "Common/Crypto/SHA1.h"
+#include "DiscIO/Blob.h"
+#include "DiscIO/DiscHasher.h"
+
+namespace DiscIO
+{
+
+static const size_t HASH_CHUNK_SIZE = 8 * 1024 * 1024;
+
+static std::string BytesToHex(const u8* data, size_t size)
+{
+	std::string result;
+	result.reserve(size * 2);
+	for (size_t i = 0; i < size; ++i)
+		result += StringFromFormat("%02x", data[i]);
+	return result;
+}
+
+std::string DiscHashes::CRC32String() const
+{
+	return StringFromFormat("%08x", crc32);
+}
+
+std::string DiscHashes::MD5String() const
+{
+	return BytesToHex(md5, sizeof(md5));
+}
+
+std::string DiscHashes::SHA1String() const
+{
+	return BytesToHex(sha1, sizeof(sha1));
+}
+
+bool ComputeDiscHashes(IBlobReader& reader, DiscHashes* hashes, CompressCB callback, void* arg)
+{
+	const u64 size = reader.GetDataSize();
+
+	uLong crc = crc32(0L, Z_NULL, 0);
+	mbedtls_md5_context md5_ctx;
+	mbedtls_md5_init(&md5_ctx);
+	mbedtls_md5_starts(&md5_ctx);
+	Common::SHA1::Context sha1_ctx;
+
+	// Double buffered: the hashers consume one chunk while the next is read.
+	std::vector<u8> chunks[2];
+	chunks[0].resize(HASH_CHUNK_SIZE);
+	chunks[1].resize(HASH_CHUNK_SIZE);
+
+	size_t current = 0;
+	u64 offset = 0;
+	size_t chunk_size = static_cast<size_t>(std::min<u64>(HASH_CHUNK_SIZE, size));
+	bool success = reader.Read(0, chunk_size, chunks[current].data());
+
+	// One worker per digest, started once and handed every chunk in turn.
+	const u8* data = nullptr;
+	bool quit = false;
+	const std::function<void()> digests[] = {
+		[&] { mbedtls_md5_update(&md5_ctx, data, chunk_size); },
+		[&] { sha1_ctx.Update(data, chunk_size); },
+		[&] { crc = crc32(crc, data, static_cast<uInt>(chunk_size)); },
+	};
+	const size_t num_workers = sizeof(digests) / sizeof(digests[0]);
+	Common::Event start[num_workers];
+	Common::Event done[num_workers];
+	std::thread workers[num_workers];
+	for (size_t i = 0; i < num_workers; ++i)
+	{
+		workers[i] = std::thread([&, i] {
+			while (true)
+			{
+				start[i].Wait();
+				if (quit)
+					return;
+				digests[i]();
+				done[i].Set();
+			}
+		});
+	}
+
+	while (success && chunk_size != 0)
+	{
+		if (callback)
+		{
+			const float ratio = static_cast<float>(offset) / size;
+			if (!callback(StringFromFormat("%i of %i MB", (int)(offset >> 20), (int)(size >> 20)), ratio, arg))
+			{
+				success = false;
+				break;
+			}
+		}
+
+		data = chunks[current].data();
+		for (Common::Event& event : start)
+			event.Set();
+
+		const u64 next_offset = offset + chunk_size;
+		const size_t next_size = static_cast<size_t>(std::min<u64>(HASH_CHUNK_SIZE, size - next_offset));
+		if (next_size != 0)
+			success = reader.Read(next_offset, next_size, chunks[current ^ 1].data());
+
+		for (Common::Event& event : done)
+			event.Wait();
+
+		offset = next_offset;
+		chunk_size = next_size;
+		current ^= 1;
+	}
+
+	quit = true;
+	for (size_t i = 0; i < num_workers; ++i)
+	{
+		start[i].Set();
+		workers[i].join();
+	}
+
+	mbedtls_md5_finish(&md5_ctx, hashes->md5);
+	mbedtls_md5_free(&md5_ctx);
+	sha1_ctx.Finish(hashes->sha1);
+	hashes->crc32 = static_cast<u32>(crc);
+
+	if (success && callback)
+		callback("Done", 1.0f, arg);
+
+	return success;
+}
+
+}  // namespace
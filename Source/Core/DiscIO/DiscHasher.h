@@ -0,0 +1,36 @@
+// Copyright 2016 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+// Computes the checksums used by redump.org to identify good dumps. The
+// digests are calculated over the uncompressed disc data, so a GCZ, CISO or
+// WBFS image hashes the same as the plain ISO it was made from (as long as
+// the conversion didn't scrub it).
+
+#pragma once
+
+#include <string>
+#include "Common/CommonTypes.h"
+#include "DiscIO/Blob.h"
+
+namespace DiscIO
+{
+
+struct DiscHashes
+{
+	u32 crc32;
+	u8 md5[16];
+	u8 sha1[20];
+
+	std::string CRC32String() const;
+	std::string MD5String() const;
+	std::string SHA1String() const;
+};
+
+// Reads the whole disc and hashes it. The three digests run on worker threads
+// while the next chunk is being read. Returns false if a read fails or if the
+// callback asks to abort.
+bool ComputeDiscHashes(IBlobReader& reader, DiscHashes* hashes,
+		CompressCB callback = nullptr, void* arg = nullptr);
+
+}  // namespace
@@ -28,7 +28,6 @@ namespace DiscScrubber
 
 static u8* m_FreeTable = nullptr;
 static u64 m_FileSize;
-static u64 m_BlockCount;
 static u32 m_BlockSize;
 static int m_BlocksPerCluster;
 static bool m_isScrubbing = false;
@@ -115,7 +114,6 @@ bool SetupScrub(const std::string& filename, int block_size)
 	// Done with it; need it closed for the next part
 	delete m_Disc;
 	m_Disc = nullptr;
-	m_BlockCount = 0;
 
 	// Let's not touch the file if we've failed up to here :p
 	if (!success)
@@ -125,27 +123,14 @@ bool SetupScrub(const std::string& filename, int block_size)
 	return success;
 }
 
-size_t GetNextBlock(File::IOFile& in, u8* buffer)
+bool CanBlockBeScrubbed(u64 offset)
 {
-	u64 CurrentOffset = m_BlockCount * m_BlockSize;
-	u64 i = CurrentOffset / CLUSTER_SIZE;
-
-	size_t ReadBytes = 0;
-	if (m_isScrubbing && m_FreeTable[i])
-	{
-		DEBUG_LOG(DISCIO, "Freeing 0x%016" PRIx64, CurrentOffset);
-		std::fill(buffer, buffer + m_BlockSize, 0xFF);
-		in.Seek(m_BlockSize, SEEK_CUR);
-		ReadBytes = m_BlockSize;
-	}
-	else
-	{
-		DEBUG_LOG(DISCIO, "Used    0x%016" PRIx64, CurrentOffset);
-		in.ReadArray(buffer, m_BlockSize, &ReadBytes);
-	}
+	if (!m_isScrubbing || offset / CLUSTER_SIZE >= m_FileSize / CLUSTER_SIZE)
+		return false;
 
-	m_BlockCount++;
-	return ReadBytes;
+	const bool free = m_FreeTable[offset / CLUSTER_SIZE] != 0;
+	DEBUG_LOG(DISCIO, "%s 0x%016" PRIx64, free ? "Freeing" : "Used   ", offset);
+	return free;
 }
 
 void Cleanup()
@@ -153,7 +138,6 @@ void Cleanup()
 	if (m_FreeTable) delete[] m_FreeTable;
 	m_FreeTable = nullptr;
 	m_FileSize = 0;
-	m_BlockCount = 0;
 	m_BlockSize = 0;
 	m_BlocksPerCluster = 0;
 	m_isScrubbing = false;
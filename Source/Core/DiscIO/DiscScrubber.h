@@ -16,8 +16,6 @@
 #include <string>
 #include "Common/CommonTypes.h"
 
-namespace File { class IOFile; }
-
 namespace DiscIO
 {
 
@@ -25,7 +23,9 @@ namespace DiscScrubber
 {
 
 bool SetupScrub(const std::string& filename, int block_size);
-size_t GetNextBlock(File::IOFile& in, u8* buffer);
+// Returns true if the block at offset only holds garbage. Its data can then
+// be replaced by 0xFF bytes, which compress well.
+bool CanBlockBeScrubbed(u64 offset);
 void Cleanup();
 
 } // namespace DiscScrubber
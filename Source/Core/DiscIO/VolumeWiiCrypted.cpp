@@ -2,18 +2,23 @@
 // Licensed under GPLv2+
 // Refer to the license.txt file included.
 
+#include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <cstring>
 #include <map>
 #include <memory>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 #include <mbedtls/aes.h>
-#include <mbedtls/sha1.h>
 
 #include "Common/CommonFuncs.h"
 #include "Common/CommonTypes.h"
+#include "Common/CPUDetect.h"
+#include "Common/Event.h"
+#include "Common/Crypto/SHA1.h"
 #include "Common/MsgHandler.h"
 #include "Common/Logging/Log.h"
 #include "DiscIO/Blob.h"
@@ -36,7 +41,8 @@ CVolumeWiiCrypted::CVolumeWiiCrypted(std::unique_ptr<IBlobReader> reader, u64 _V
 	m_dataOffset(0x20000),
 	m_LastDecryptedBlockOffset(-1)
 {
-	mbedtls_aes_setkey_dec(m_AES_ctx.get(), _pVolumeKey, 128);
+	memcpy(m_VolumeKey, _pVolumeKey, sizeof(m_VolumeKey));
+	mbedtls_aes_setkey_dec(m_AES_ctx.get(), m_VolumeKey, 128);
 	m_pBuffer = new u8[s_block_total_size];
 }
 
@@ -45,9 +51,8 @@ bool CVolumeWiiCrypted::ChangePartition(u64 offset)
 	m_VolumeOffset = offset;
 	m_LastDecryptedBlockOffset = -1;
 
-	u8 volume_key[16];
-	DiscIO::VolumeKeyForPartition(*m_pReader, offset, volume_key);
-	mbedtls_aes_setkey_dec(m_AES_ctx.get(), volume_key, 128);
+	DiscIO::VolumeKeyForPartition(*m_pReader, offset, m_VolumeKey);
+	mbedtls_aes_setkey_dec(m_AES_ctx.get(), m_VolumeKey, 128);
 	return true;
 }
 
@@ -271,6 +276,59 @@ u64 CVolumeWiiCrypted::GetRawSize() const
 		return 0;
 }
 
+bool CVolumeWiiCrypted::CheckClusterIntegrity(const u8* volume_key, const u8* cluster, u32 cluster_id)
+{
+	// Every worker owns its AES context; mbed TLS picks AES-NI by itself when available.
+	mbedtls_aes_context aes_ctx;
+	mbedtls_aes_init(&aes_ctx);
+	mbedtls_aes_setkey_dec(&aes_ctx, volume_key, 128);
+
+	// Decrypt the cluster metadata
+	u8 clusterMD[s_block_header_size];
+	u8 IV[16] = { 0 };
+	mbedtls_aes_crypt_cbc(&aes_ctx, MBEDTLS_AES_DECRYPT, s_block_header_size, IV, cluster, clusterMD);
+
+	// Some clusters have invalid data and metadata because they aren't
+	// meant to be read by the game (for example, holes between files). To
+	// try to avoid reporting errors because of these clusters, we check
+	// the 0x00 paddings in the metadata.
+	//
+	// This may cause some false negatives though: some bad clusters may be
+	// skipped because they are *too* bad and are not even recognized as
+	// valid clusters. To be improved.
+	for (u32 idx = 0x26C; idx < 0x280; ++idx)
+	{
+		if (clusterMD[idx] != 0)
+		{
+			mbedtls_aes_free(&aes_ctx);
+			return true;
+		}
+	}
+
+	// The data IV is stored (encrypted) at 0x3D0 in the raw cluster header.
+	u8 clusterData[s_block_data_size];
+	memcpy(IV, cluster + 0x3D0, sizeof(IV));
+	mbedtls_aes_crypt_cbc(&aes_ctx, MBEDTLS_AES_DECRYPT, s_block_data_size, IV,
+	                      cluster + s_block_header_size, clusterData);
+	mbedtls_aes_free(&aes_ctx);
+
+	for (u32 hashID = 0; hashID < 31; ++hashID)
+	{
+		u8 hash[20];
+
+		Common::SHA1::Digest(clusterData + hashID * 0x400, 0x400, hash);
+
+		// Note that we do not use strncmp here
+		if (memcmp(hash, clusterMD + hashID * 20, 20))
+		{
+			NOTICE_LOG(DISCIO, "Integrity Check: fail at cluster %d: hash %d is invalid", cluster_id, hashID);
+			return false;
+		}
+	}
+
+	return true;
+}
+
 bool CVolumeWiiCrypted::CheckIntegrity() const
 {
 	// Get partition data size
@@ -278,62 +336,91 @@ bool CVolumeWiiCrypted::CheckIntegrity() const
 	Read(m_VolumeOffset + 0x2BC, 4, (u8*)&partSizeDiv4, false);
 	u64 partDataSize = (u64)Common::swap32(partSizeDiv4) * 4;
 
-	u32 nClusters = (u32)(partDataSize / 0x8000);
-	for (u32 clusterID = 0; clusterID < nClusters; ++clusterID)
-	{
-		u64 clusterOff = m_VolumeOffset + m_dataOffset + (u64)clusterID * 0x8000;
+	const u32 nClusters = (u32)(partDataSize / s_block_total_size);
+	const u32 num_threads = std::max(1, cpu_info.num_cores);
 
-		// Read and decrypt the cluster metadata
-		u8 clusterMDCrypted[0x400];
-		u8 clusterMD[0x400];
-		u8 IV[16] = { 0 };
-		if (!m_pReader->Read(clusterOff, 0x400, clusterMDCrypted))
-		{
-			NOTICE_LOG(DISCIO, "Integrity Check: fail at cluster %d: could not read metadata", clusterID);
-			return false;
-		}
-		mbedtls_aes_crypt_cbc(m_AES_ctx.get(), MBEDTLS_AES_DECRYPT, 0x400, IV, clusterMDCrypted, clusterMD);
-
-
-		// Some clusters have invalid data and metadata because they aren't
-		// meant to be read by the game (for example, holes between files). To
-		// try to avoid reporting errors because of these clusters, we check
-		// the 0x00 paddings in the metadata.
-		//
-		// This may cause some false negatives though: some bad clusters may be
-		// skipped because they are *too* bad and are not even recognized as
-		// valid clusters. To be improved.
-		bool meaningless = false;
-		for (u32 idx = 0x26C; idx < 0x280; ++idx)
-			if (clusterMD[idx] != 0)
-				meaningless = true;
-
-		if (meaningless)
-			continue;
-
-		u8 clusterData[0x7C00];
-		if (!Read((u64)clusterID * 0x7C00, 0x7C00, clusterData, true))
+	// Two batch buffers: the workers verify one while this thread reads
+	// the next one from the blob, which is not safe to share between threads.
+	std::vector<u8> batches[2];
+	batches[0].resize((size_t)s_integrity_batch_clusters * s_block_total_size);
+	batches[1].resize((size_t)s_integrity_batch_clusters * s_block_total_size);
+
+	auto read_batch = [&](u32 first_cluster, std::vector<u8>& buffer) -> bool {
+		const u32 count = std::min(s_integrity_batch_clusters, nClusters - first_cluster);
+		const u64 offset = m_VolumeOffset + m_dataOffset + (u64)first_cluster * s_block_total_size;
+		if (!m_pReader->Read(offset, (u64)count * s_block_total_size, buffer.data()))
 		{
-			NOTICE_LOG(DISCIO, "Integrity Check: fail at cluster %d: could not read data", clusterID);
+			NOTICE_LOG(DISCIO, "Integrity Check: fail at cluster %d: could not read data", first_cluster);
 			return false;
 		}
+		return true;
+	};
 
-		for (u32 hashID = 0; hashID < 31; ++hashID)
-		{
-			u8 hash[20];
-
-			mbedtls_sha1(clusterData + hashID * 0x400, 0x400, hash);
+	if (nClusters == 0)
+		return true;
+	if (!read_batch(0, batches[0]))
+		return false;
 
-			// Note that we do not use strncmp here
-			if (memcmp(hash, clusterMD + hashID * 20, 20))
+	// The workers are started once and handed every batch in turn.
+	std::atomic<bool> failed(false);
+	bool quit = false;
+	u32 batch_first_cluster = 0;
+	u32 batch_count = 0;
+	const u8* batch_data = nullptr;
+	std::vector<Common::Event> start(num_threads);
+	std::vector<Common::Event> done(num_threads);
+	std::vector<std::thread> workers;
+	workers.reserve(num_threads);
+	for (u32 t = 0; t < num_threads; ++t)
+	{
+		workers.emplace_back([&, t] {
+			while (true)
 			{
-				NOTICE_LOG(DISCIO, "Integrity Check: fail at cluster %d: hash %d is invalid", clusterID, hashID);
-				return false;
+				start[t].Wait();
+				if (quit)
+					return;
+				for (u32 i = t; i < batch_count && !failed.load(std::memory_order_relaxed); i += num_threads)
+				{
+					if (!CheckClusterIntegrity(m_VolumeKey, batch_data + (size_t)i * s_block_total_size,
+					                           batch_first_cluster + i))
+						failed.store(true);
+				}
+				done[t].Set();
 			}
+		});
+	}
+
+	bool success = true;
+	for (u32 first_cluster = 0, batch = 0; first_cluster < nClusters;
+	     first_cluster += s_integrity_batch_clusters, batch ^= 1)
+	{
+		batch_first_cluster = first_cluster;
+		batch_count = std::min(s_integrity_batch_clusters, nClusters - first_cluster);
+		batch_data = batches[batch].data();
+		for (Common::Event& event : start)
+			event.Set();
+
+		const u32 next_cluster = first_cluster + s_integrity_batch_clusters;
+		bool read_ok = next_cluster >= nClusters || read_batch(next_cluster, batches[batch ^ 1]);
+
+		for (Common::Event& event : done)
+			event.Wait();
+
+		if (!read_ok || failed.load())
+		{
+			success = false;
+			break;
 		}
 	}
 
-	return true;
+	quit = true;
+	for (u32 t = 0; t < num_threads; ++t)
+	{
+		start[t].Set();
+		workers[t].join();
+	}
+
+	return success;
 }
 
 } // namespace
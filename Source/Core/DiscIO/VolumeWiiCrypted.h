@@ -53,8 +53,15 @@ private:
 	static const unsigned int s_block_data_size   = 0x7C00;
 	static const unsigned int s_block_total_size  = s_block_header_size + s_block_data_size;
 
+	// Number of clusters read from the blob in one go by CheckIntegrity.
+	// Each batch is verified by worker threads while the next one is read.
+	static const unsigned int s_integrity_batch_clusters = 256;
+
+	static bool CheckClusterIntegrity(const u8* volume_key, const u8* cluster, u32 cluster_id);
+
 	std::unique_ptr<IBlobReader> m_pReader;
 	std::unique_ptr<mbedtls_aes_context> m_AES_ctx;
+	u8 m_VolumeKey[16];
 
 	u8* m_pBuffer;
 
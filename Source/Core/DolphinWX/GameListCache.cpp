@@ -0,0 +1,133 @@
+// Copyright 2016 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Common/ChunkFile.h"
+#include "Common/CommonPaths.h"
+#include "Common/CommonTypes.h"
+#include "Common/FileUtil.h"
+
+#include "DolphinWX/GameListCache.h"
+
+// Also has to change whenever GameListItem::DoState does.
+static const u32 CACHE_REVISION = 0x127; // Last changed when the per-file caches were merged
+
+static std::string GetCacheFilename()
+{
+	return File::GetUserPath(D_CACHE_IDX) + "gamelist.cache";
+}
+
+GameListCache::GameListCache()
+	: m_dirty(false)
+{
+}
+
+void GameListCache::Load()
+{
+	std::lock_guard<std::mutex> lk(m_mutex);
+	m_entries.clear();
+	if (!CChunkFileReader::Load<GameListCache>(GetCacheFilename(), CACHE_REVISION, *this))
+		m_entries.clear();
+	m_dirty = false;
+}
+
+void GameListCache::Save(bool prune)
+{
+	std::lock_guard<std::mutex> lk(m_mutex);
+	if (prune)
+	{
+		for (auto it = m_entries.begin(); it != m_entries.end();)
+		{
+			if (it->second.used)
+			{
+				++it;
+			}
+			else
+			{
+				it = m_entries.erase(it);
+				m_dirty = true;
+			}
+		}
+	}
+
+	if (!m_dirty)
+		return;
+
+	if (!File::IsDirectory(File::GetUserPath(D_CACHE_IDX)))
+		File::CreateDir(File::GetUserPath(D_CACHE_IDX));
+
+	if (CChunkFileReader::Save<GameListCache>(GetCacheFilename(), CACHE_REVISION, *this))
+		m_dirty = false;
+}
+
+bool GameListCache::Get(const std::string& path, std::vector<u8>* data)
+{
+	u64 size, mtime;
+	if (!File::GetSizeAndModificationTime(path, &size, &mtime))
+		return false;
+
+	std::lock_guard<std::mutex> lk(m_mutex);
+	auto it = m_entries.find(path);
+	if (it == m_entries.end())
+		return false;
+
+	it->second.used = true;
+	if (it->second.size != size || it->second.mtime != mtime)
+		return false;
+
+	*data = it->second.data;
+	return true;
+}
+
+void GameListCache::Set(const std::string& path, std::vector<u8> data)
+{
+	u64 size, mtime;
+	if (!File::GetSizeAndModificationTime(path, &size, &mtime))
+		return;
+
+	std::lock_guard<std::mutex> lk(m_mutex);
+	Entry& entry = m_entries[path];
+	entry.size = size;
+	entry.mtime = mtime;
+	entry.data = std::move(data);
+	entry.used = true;
+	m_dirty = true;
+}
+
+// Must be called with m_mutex held.
+void GameListCache::DoState(PointerWrap& p)
+{
+	u32 count = (u32)m_entries.size();
+	p.Do(count);
+
+	if (p.GetMode() == PointerWrap::MODE_READ)
+	{
+		for (; count != 0; --count)
+		{
+			std::string path;
+			Entry entry;
+			p.Do(path);
+			p.Do(entry.size);
+			p.Do(entry.mtime);
+			p.Do(entry.data);
+			entry.used = false;
+			m_entries.emplace(std::move(path), std::move(entry));
+		}
+	}
+	else
+	{
+		for (auto& it : m_entries)
+		{
+			std::string path = it.first;
+			p.Do(path);
+			p.Do(it.second.size);
+			p.Do(it.second.mtime);
+			p.Do(it.second.data);
+		}
+	}
+}
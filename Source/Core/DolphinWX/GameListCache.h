@@ -0,0 +1,45 @@
+// Copyright 2016 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+
+class PointerWrap;
+
+// The game list's metadata for all files in one file, indexed by path. An
+// entry is only used while the size and modification time of its file are
+// the same as when it was stored. Safe to use from several threads.
+class GameListCache
+{
+public:
+	GameListCache();
+
+	void Load();
+	// With prune, entries that weren't looked up since Load are dropped.
+	void Save(bool prune);
+
+	bool Get(const std::string& path, std::vector<u8>* data);
+	void Set(const std::string& path, std::vector<u8> data);
+
+	void DoState(PointerWrap& p);
+
+private:
+	struct Entry
+	{
+		u64 size;
+		u64 mtime;
+		std::vector<u8> data;
+		bool used;
+	};
+
+	std::mutex m_mutex;
+	std::unordered_map<std::string, Entry> m_entries;
+	bool m_dirty;
+};
@@ -3,12 +3,15 @@
 // Refer to the license.txt file included.
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cinttypes>
 #include <cstddef>
 #include <cstdio>
 #include <cstring>
 #include <memory>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 #include <wx/bitmap.h>
@@ -29,6 +32,7 @@
 #include "Common/CDUtils.h"
 #include "Common/CommonPaths.h"
 #include "Common/CommonTypes.h"
+#include "Common/Event.h"
 #include "Common/FileSearch.h"
 #include "Common/FileUtil.h"
 #include "Common/MathUtil.h"
@@ -44,6 +48,7 @@
 #include "DiscIO/Volume.h"
 #include "DiscIO/VolumeCreator.h"
 #include "DolphinWX/Frame.h"
+#include "DolphinWX/GameListCache.h"
 #include "DolphinWX/GameListCtrl.h"
 #include "DolphinWX/Globals.h"
 #include "DolphinWX/ISOFile.h"
@@ -497,20 +502,62 @@ void CGameListCtrl::ScanForISOs()
 			wxPD_SMOOTH // - makes updates as small as possible (down to 1px)
 			);
 
-		for (u32 i = 0; i < rFilenames.size(); i++)
+		// Reading the metadata is mostly waiting for the disk (or the network),
+		// so several files are scanned at once. Files that haven't changed
+		// since the last scan come from the cache instead. Banners are only
+		// turned into bitmaps when they are displayed.
+		GameListCache cache;
+		cache.Load();
+
+		std::vector<std::unique_ptr<GameListItem>> iso_files(rFilenames.size());
+		std::atomic<size_t> next_file(0);
+		std::atomic<size_t> scanned(0);
+		std::atomic<bool> cancelled(false);
+		Common::Event scanned_event;
+
+		auto scan = [&] {
+			size_t i;
+			while (!cancelled.load() && (i = next_file.fetch_add(1)) < rFilenames.size())
+			{
+				iso_files[i] = std::make_unique<GameListItem>(rFilenames[i], custom_title_map, &cache);
+				scanned.fetch_add(1);
+				scanned_event.Set();
+			}
+		};
+
+		const size_t thread_count = std::min<size_t>(rFilenames.size(),
+			std::max(4u, std::thread::hardware_concurrency()));
+		std::vector<std::thread> threads;
+		for (size_t i = 0; i < thread_count; i++)
+			threads.emplace_back(scan);
+
+		size_t done;
+		while ((done = scanned.load()) < rFilenames.size())
 		{
 			std::string FileName;
-			SplitPath(rFilenames[i], nullptr, &FileName, nullptr);
+			SplitPath(rFilenames[done], nullptr, &FileName, nullptr);
 
-			// Update with the progress (i) and the message
-			dialog.Update(i, wxString::Format(_("Scanning %s"),
+			// Update with the progress and the message
+			dialog.Update((int)done, wxString::Format(_("Scanning %s"),
 				StrToWxStr(FileName)));
 			if (dialog.WasCancelled())
+			{
+				cancelled.store(true);
 				break;
+			}
+
+			scanned_event.WaitFor(std::chrono::milliseconds(100));
+		}
 
-			auto iso_file = std::make_unique<GameListItem>(rFilenames[i], custom_title_map);
+		for (std::thread& thread : threads)
+			thread.join();
 
-			if (iso_file->IsValid())
+		// Only forget files that are gone if all of them were looked at.
+		cache.Save(!cancelled.load());
+
+		for (auto& iso_file : iso_files)
+		{
+			if (iso_file && iso_file->IsValid())
 			{
 				bool list = true;
 
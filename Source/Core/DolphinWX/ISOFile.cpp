@@ -3,7 +3,6 @@
 // Refer to the license.txt file included.
 
 #include <algorithm>
-#include <cinttypes>
 #include <cstdio>
 #include <cstring>
 #include <memory>
@@ -21,7 +20,6 @@
 #include "Common/CommonPaths.h"
 #include "Common/CommonTypes.h"
 #include "Common/FileUtil.h"
-#include "Common/Hash.h"
 #include "Common/IniFile.h"
 #include "Common/StringUtil.h"
 
@@ -33,11 +31,10 @@
 #include "DiscIO/Volume.h"
 #include "DiscIO/VolumeCreator.h"
 
+#include "DolphinWX/GameListCache.h"
 #include "DolphinWX/ISOFile.h"
 #include "DolphinWX/WxUtils.h"
 
-static const u32 CACHE_REVISION = 0x126; // Last changed in PR 3097
-
 #define DVD_BANNER_WIDTH 96
 #define DVD_BANNER_HEIGHT 32
 
@@ -63,19 +60,20 @@ static std::string GetLanguageString(DiscIO::IVolume::ELanguage language, std::m
 	return "";
 }
 
-GameListItem::GameListItem(const std::string& _rFileName, const std::unordered_map<std::string, std::string>& custom_titles)
+GameListItem::GameListItem(const std::string& _rFileName, const std::unordered_map<std::string, std::string>& custom_titles, GameListCache* cache)
 	: m_FileName(_rFileName)
 	, m_emu_state(0)
 	, m_FileSize(0)
 	, m_Country(DiscIO::IVolume::COUNTRY_UNKNOWN)
 	, m_Revision(0)
+	, m_bitmap_loaded(false)
 	, m_Valid(false)
 	, m_ImageWidth(0)
 	, m_ImageHeight(0)
 	, m_disc_number(0)
 	, m_has_custom_name(false)
 {
-	if (LoadFromCache())
+	if (LoadFromCache(cache))
 	{
 		m_Valid = true;
 
@@ -89,7 +87,7 @@ GameListItem::GameListItem(const std::string& _rFileName, const std::unordered_m
 			{
 				ReadVolumeBanner(*volume);
 				if (!m_pImage.empty())
-					SaveToCache();
+					SaveToCache(cache);
 			}
 		}
 	}
@@ -119,7 +117,7 @@ GameListItem::GameListItem(const std::string& _rFileName, const std::unordered_m
 			delete pVolume;
 
 			m_Valid = true;
-			SaveToCache();
+			SaveToCache(cache);
 		}
 	}
 
@@ -158,6 +156,17 @@ GameListItem::GameListItem(const std::string& _rFileName, const std::unordered_m
 		m_Platform = DiscIO::IVolume::ELF_DOL;
 		m_blob_type = DiscIO::BlobType::DIRECTORY;
 	}
+}
+
+GameListItem::~GameListItem()
+{
+}
+
+const wxBitmap& GameListItem::GetBitmap() const
+{
+	if (m_bitmap_loaded)
+		return m_Bitmap;
+	m_bitmap_loaded = true;
 
 	std::string path, name;
 	SplitPath(m_FileName, &path, &name, nullptr);
@@ -165,39 +174,51 @@ GameListItem::GameListItem(const std::string& _rFileName, const std::unordered_m
 	// A bit like the Homebrew Channel icon, except there can be multiple files in a folder with their own icons.
 	// Useful for those who don't want to have a Homebrew Channel-style folder structure.
 	if (ReadPNGBanner(path + name + ".png"))
-		return;
+		return m_Bitmap;
 
 	// Homebrew Channel icon. Typical for DOLs and ELFs, but can be also used with volumes.
 	if (ReadPNGBanner(path + "icon.png"))
-		return;
+		return m_Bitmap;
 
 	// Volume banner. Typical for everything that isn't a DOL or ELF.
 	if (!m_pImage.empty())
 	{
-		wxImage image(m_ImageWidth, m_ImageHeight, &m_pImage[0], true);
+		wxImage image(m_ImageWidth, m_ImageHeight, const_cast<u8*>(m_pImage.data()), true);
 		m_Bitmap = ScaleBanner(&image);
-		return;
+		return m_Bitmap;
 	}
 
 	// Fallback in case no banner is available.
 	ReadPNGBanner(File::GetThemeDir(SConfig::GetInstance().theme_name) + "nobanner.png");
+	return m_Bitmap;
 }
 
-GameListItem::~GameListItem()
+bool GameListItem::LoadFromCache(GameListCache* cache)
 {
-}
+	std::vector<u8> data;
+	if (!cache || !cache->Get(m_FileName, &data) || data.empty())
+		return false;
 
-bool GameListItem::LoadFromCache()
-{
-	return CChunkFileReader::Load<GameListItem>(CreateCacheFilename(), CACHE_REVISION, *this);
+	u8* ptr = data.data();
+	PointerWrap p(&ptr, PointerWrap::MODE_READ);
+	DoState(p);
+	return true;
 }
 
-void GameListItem::SaveToCache()
+void GameListItem::SaveToCache(GameListCache* cache)
 {
-	if (!File::IsDirectory(File::GetUserPath(D_CACHE_IDX)))
-		File::CreateDir(File::GetUserPath(D_CACHE_IDX));
+	if (!cache || m_FileName.empty())
+		return;
+
+	u8* ptr = nullptr;
+	PointerWrap p(&ptr, PointerWrap::MODE_MEASURE);
+	DoState(p);
+	std::vector<u8> data((size_t)ptr);
+	ptr = data.data();
+	p.SetMode(PointerWrap::MODE_WRITE);
+	DoState(p);
 
-	CChunkFileReader::Save<GameListItem>(CreateCacheFilename(), CACHE_REVISION, *this);
+	cache->Set(m_FileName, std::move(data));
 }
 
 void GameListItem::DoState(PointerWrap &p)
@@ -231,24 +252,6 @@ bool GameListItem::IsElfOrDol() const
 	return false;
 }
 
-std::string GameListItem::CreateCacheFilename() const
-{
-	std::string Filename, LegalPathname, extension;
-	SplitPath(m_FileName, &LegalPathname, &Filename, &extension);
-
-	if (Filename.empty()) return Filename; // Disc Drive
-
-	// Filename.extension_HashOfFolderPath_Size.cache
-	// Append hash to prevent ISO name-clashing in different folders.
-	Filename.append(StringFromFormat("%s_%x_%" PRIx64 ".cache",
-		extension.c_str(), HashFletcher((const u8 *)LegalPathname.c_str(), LegalPathname.size()),
-		File::GetSize(m_FileName)));
-
-	std::string fullname(File::GetUserPath(D_CACHE_IDX));
-	fullname += Filename;
-	return fullname;
-}
-
 // Outputs to m_pImage
 void GameListItem::ReadVolumeBanner(const DiscIO::IVolume& volume)
 {
@@ -265,7 +268,7 @@ void GameListItem::ReadVolumeBanner(const DiscIO::IVolume& volume)
 }
 
 // Outputs to m_Bitmap
-bool GameListItem::ReadPNGBanner(const std::string& path)
+bool GameListItem::ReadPNGBanner(const std::string& path) const
 {
 	if (!File::Exists(path))
 		return false;
@@ -18,11 +18,14 @@
 #include <wx/bitmap.h>
 #endif
 
+class GameListCache;
 class PointerWrap;
 class GameListItem
 {
 public:
-	GameListItem(const std::string& _rFileName, const std::unordered_map<std::string, std::string>& custom_titles);
+	// Can be constructed on any thread. Without a cache, the metadata is
+	// always read from the file.
+	GameListItem(const std::string& _rFileName, const std::unordered_map<std::string, std::string>& custom_titles, GameListCache* cache = nullptr);
 	~GameListItem();
 
 	bool IsValid() const {return m_Valid;}
@@ -52,7 +55,8 @@ public:
 	u8 GetDiscNumber() const { return m_disc_number; }
 
 #if defined(HAVE_WX) && HAVE_WX
-	const wxBitmap& GetBitmap() const {return m_Bitmap;}
+	// Loaded on first use, which has to be on the UI thread.
+	const wxBitmap& GetBitmap() const;
 #endif
 
 	void DoState(PointerWrap &p);
@@ -78,7 +82,8 @@ private:
 	u16 m_Revision;
 
 #if defined(HAVE_WX) && HAVE_WX
-	wxBitmap m_Bitmap;
+	mutable wxBitmap m_Bitmap;
+	mutable bool m_bitmap_loaded;
 #endif
 	bool m_Valid;
 	std::vector<u8> m_pImage;
@@ -88,16 +93,15 @@ private:
 	std::string m_custom_name;
 	bool m_has_custom_name;
 
-	bool LoadFromCache();
-	void SaveToCache();
+	bool LoadFromCache(GameListCache* cache);
+	void SaveToCache(GameListCache* cache);
 
 	bool IsElfOrDol() const;
-	std::string CreateCacheFilename() const;
 
 	// Outputs to m_pImage
 	void ReadVolumeBanner(const DiscIO::IVolume& volume);
 	// Outputs to m_Bitmap
-	bool ReadPNGBanner(const std::string& path);
+	bool ReadPNGBanner(const std::string& path) const;
 
 	static wxBitmap ScaleBanner(wxImage* image);
 };
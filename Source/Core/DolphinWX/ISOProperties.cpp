@@ -15,7 +15,6 @@
 #include <string>
 #include <type_traits>
 #include <vector>
-#include <mbedtls/md5.h>
 #include <wx/bitmap.h>
 #include <wx/button.h>
 #include <wx/checkbox.h>
@@ -52,12 +51,14 @@
 #include "Common/IniFile.h"
 #include "Common/StringUtil.h"
 #include "Common/SysConf.h"
+#include "Common/Logging/Log.h"
 #include "Core/ActionReplay.h"
 #include "Core/ConfigManager.h"
 #include "Core/GeckoCodeConfig.h"
 #include "Core/PatchEngine.h"
 #include "Core/Boot/Boot.h"
 #include "DiscIO/Blob.h"
+#include "DiscIO/DiscHasher.h"
 #include "DiscIO/Filesystem.h"
 #include "DiscIO/Volume.h"
 #include "DiscIO/VolumeCreator.h"
@@ -1235,19 +1236,19 @@ void CISOProperties::OnEditConfig(wxCommandEvent& WXUNUSED (event))
 	LoadGameConfig();
 }
 
-void CISOProperties::OnComputeMD5Sum(wxCommandEvent& WXUNUSED (event))
+static bool HashProgressCB(const std::string& text, float percent, void* arg)
 {
-	u8 output[16];
-	std::string output_string;
-	std::vector<u8> data(8 * 1024 * 1024);
-	u64 read_offset = 0;
-	mbedtls_md5_context ctx;
+	return ((wxProgressDialog*)arg)->Update((int)(percent * 1000), StrToWxStr(text));
+}
 
+void CISOProperties::OnComputeMD5Sum(wxCommandEvent& WXUNUSED (event))
+{
 	std::unique_ptr<DiscIO::IBlobReader> file(DiscIO::CreateBlobReader(OpenGameListItem.GetFileName()));
-	u64 game_size = file->GetDataSize();
+	if (!file)
+		return;
 
 	wxProgressDialog progressDialog(
-		_("Computing MD5 checksum"),
+		_("Computing checksums"),
 		_("Working..."),
 		1000,
 		this,
@@ -1256,28 +1257,17 @@ void CISOProperties::OnComputeMD5Sum(wxCommandEvent& WXUNUSED (event))
 		wxPD_SMOOTH
 		);
 
-	mbedtls_md5_starts(&ctx);
-
-	while(read_offset < game_size)
-	{
-		if (!progressDialog.Update((int)((double)read_offset / (double)game_size * 1000)))
-			return;
-
-		size_t read_size = std::min((u64)data.size(), game_size - read_offset);
-		if (!file->Read(read_offset, read_size, data.data()))
-			return;
-
-		mbedtls_md5_update(&ctx, data.data(), read_size);
-		read_offset += read_size;
-	}
-
-	mbedtls_md5_finish(&ctx, output);
-
-	// Convert to hex
-	for (int a = 0; a < 16; ++a)
-		output_string += StringFromFormat("%02x", output[a]);
+	// CRC32 and SHA-1 come for free alongside the MD5, so show all three:
+	// that is what redump.org lists for each verified dump.
+	DiscIO::DiscHashes hashes;
+	if (!DiscIO::ComputeDiscHashes(*file, &hashes, &HashProgressCB, &progressDialog))
+		return;
 
-	m_MD5Sum->SetValue(output_string);
+	m_MD5Sum->SetValue(StrToWxStr(hashes.MD5String()));
+	m_MD5Sum->SetToolTip(StrToWxStr(StringFromFormat("CRC32: %s\nMD5: %s\nSHA-1: %s",
+		hashes.CRC32String().c_str(), hashes.MD5String().c_str(), hashes.SHA1String().c_str())));
+	NOTICE_LOG(DISCIO, "%s: CRC32 %s MD5 %s SHA-1 %s", OpenGameListItem.GetFileName().c_str(),
+		hashes.CRC32String().c_str(), hashes.MD5String().c_str(), hashes.SHA1String().c_str());
 }
 
 // Opens all pre-defined INIs for the game. If there are multiple ones,
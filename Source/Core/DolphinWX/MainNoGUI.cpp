@@ -18,6 +18,7 @@
 #include "Core/ConfigManager.h"
 #include "Core/Core.h"
 #include "Core/Host.h"
+#include "Core/Movie.h"
 #include "Core/State.h"
 #include "Core/HW/Wiimote.h"
 #include "Core/IPC_HLE/WII_IPC_HLE_Device_usb.h"
@@ -31,6 +32,7 @@
 static bool rendererHasFocus = true;
 static bool rendererIsFullscreen = false;
 static bool running = true;
+static bool verifying_movie = false;
 
 class Platform
 {
@@ -271,6 +273,8 @@ class PlatformX11 : public Platform
 					     &borderDummy, &depthDummy);
 				rendererIsFullscreen = false;
 			}
+			if (verifying_movie && !Movie::IsPlayingInput())
+				running = false;
 			usleep(100000);
 		}
 	}
@@ -300,19 +304,29 @@ static Platform* GetPlatform()
 int main(int argc, char* argv[])
 {
 	int ch, help = 0;
+	std::string movie_to_verify;
+	bool skip_rendering = false;
 	struct option longopts[] = {
-		{ "exec",    no_argument, nullptr, 'e' },
-		{ "help",    no_argument, nullptr, 'h' },
-		{ "version", no_argument, nullptr, 'v' },
-		{ nullptr,      0,           nullptr,  0  }
+		{ "exec",         no_argument,       nullptr, 'e' },
+		{ "help",         no_argument,       nullptr, 'h' },
+		{ "verify-movie", required_argument, nullptr, 'm' },
+		{ "no-render",    no_argument,       nullptr, 'r' },
+		{ "version",      no_argument,       nullptr, 'v' },
+		{ nullptr,        0,                 nullptr,  0  }
 	};
 
-	while ((ch = getopt_long(argc, argv, "eh?v", longopts, 0)) != -1)
+	while ((ch = getopt_long(argc, argv, "eh?m:rv", longopts, 0)) != -1)
 	{
 		switch (ch)
 		{
 		case 'e':
 			break;
+		case 'm':
+			movie_to_verify = optarg;
+			break;
+		case 'r':
+			skip_rendering = true;
+			break;
 		case 'h':
 		case '?':
 			help = 1;
@@ -327,10 +341,16 @@ int main(int argc, char* argv[])
 	{
 		fprintf(stderr, "%s\n\n", scm_rev_str);
 		fprintf(stderr, "A multi-platform GameCube/Wii emulator\n\n");
-		fprintf(stderr, "Usage: %s [-e <file>] [-h] [-v]\n", argv[0]);
-		fprintf(stderr, "  -e, --exec     Load the specified file\n");
-		fprintf(stderr, "  -h, --help     Show this help message\n");
-		fprintf(stderr, "  -v, --version  Print version and exit\n");
+		fprintf(stderr, "Usage: %s [-e <file>] [-m <movie> [-r]] [-h] [-v]\n", argv[0]);
+		fprintf(stderr, "  -e, --exec                 Load the specified file\n");
+		fprintf(stderr, "  -m, --verify-movie <movie> Play the movie back as fast as possible, compare\n");
+		fprintf(stderr, "                             against its state hashes and exit at its end,\n");
+		fprintf(stderr, "                             with status 2 on a desync and 3 if there was\n");
+		fprintf(stderr, "                             no state hash to compare\n");
+		fprintf(stderr, "  -r, --no-render            Skip drawing while verifying (changes RAM in games\n");
+		fprintf(stderr, "                             that copy the EFB back to it)\n");
+		fprintf(stderr, "  -h, --help                 Show this help message\n");
+		fprintf(stderr, "  -v, --version              Print version and exit\n");
 		return 1;
 	}
 
@@ -346,6 +366,23 @@ int main(int argc, char* argv[])
 
 	platform->Init();
 
+	// Verification runs unthrottled and without sound. The user's settings are
+	// put back before they get saved on shutdown.
+	SConfig& config = SConfig::GetInstance();
+	const unsigned int saved_framelimit = config.m_Framelimit;
+	const std::string saved_audio_backend = config.sBackend;
+	if (!movie_to_verify.empty())
+	{
+		if (!Movie::PlayInput(movie_to_verify))
+		{
+			fprintf(stderr, "Could not play back %s\n", movie_to_verify.c_str());
+			return 1;
+		}
+		verifying_movie = true;
+		config.m_Framelimit = 0;
+		config.sBackend = BACKEND_NULLSOUND;
+	}
+
 	if (!BootManager::BootCore(argv[optind]))
 	{
 		fprintf(stderr, "Could not boot %s\n", argv[optind]);
@@ -355,16 +392,43 @@ int main(int argc, char* argv[])
 	while (!Core::IsRunning())
 		updateMainFrameEvent.Wait();
 
+	if (verifying_movie && skip_rendering)
+		g_video_backend->Video_SetRendering(false);
+
 	platform->MainLoop();
 	Core::Stop();
 	while (PowerPC::GetState() != PowerPC::CPU_POWERDOWN)
 		updateMainFrameEvent.Wait();
 
+	int result = 0;
+	if (verifying_movie)
+	{
+		u64 frame;
+		if (Movie::GetFirstDivergence(&frame))
+		{
+			printf("%s: desynced at frame %llu\n", movie_to_verify.c_str(), (unsigned long long)frame);
+			result = 2;
+		}
+		else if (Movie::GetCheckedStateHashCount() == 0)
+		{
+			// No .hashes file, or the movie ended before the first hash.
+			printf("%s: no state hashes to compare against, nothing was verified\n", movie_to_verify.c_str());
+			result = 3;
+		}
+		else
+		{
+			printf("%s: no desync found in %llu state hashes\n", movie_to_verify.c_str(),
+			       (unsigned long long)Movie::GetCheckedStateHashCount());
+		}
+		config.m_Framelimit = saved_framelimit;
+		config.sBackend = saved_audio_backend;
+	}
+
 	Core::Shutdown();
 	platform->Shutdown();
 	UICommon::Shutdown();
 
 	delete platform;
 
-	return 0;
+	return result;
 }
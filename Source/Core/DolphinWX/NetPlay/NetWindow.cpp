@@ -28,6 +28,7 @@
 #include "Common/IniFile.h"
 
 #include "Core/ConfigManager.h"
+#include "Core/Core.h"
 #include "Core/NetPlayClient.h"
 #include "Core/NetPlayProto.h"
 #include "Core/NetPlayServer.h"
@@ -204,6 +205,12 @@ NetPlayDialog::NetPlayDialog(wxWindow* const parent, const CGameListCtrl* const
 
 		m_memcard_write = new wxCheckBox(panel, wxID_ANY, _("Write memcards/SD"));
 		bottom_szr->Add(m_memcard_write, 0, wxCENTER);
+
+		m_rollback_chkbox = new wxCheckBox(panel, wxID_ANY, _("Rollback"));
+		m_rollback_chkbox->SetToolTip(_("Keep running when other players' inputs arrive late, and rewind to correct "
+			"mistakes once they do. Applies to every player. Only affects GameCube controllers, and input "
+			"can't be recorded with it."));
+		bottom_szr->Add(m_rollback_chkbox, 0, wxCENTER);
 	}
 
 	m_record_chkbox = new wxCheckBox(panel, wxID_ANY, _("Record input"));
@@ -264,7 +271,9 @@ void NetPlayDialog::GetNetSettings(NetSettings &settings)
 	settings.m_PAL60 = instance.bPAL60;
 	settings.m_DSPHLE = instance.bDSPHLE;
 	settings.m_DSPEnableJIT = instance.m_DSPEnableJIT;
+	settings.m_DSPThread = Core::ShouldUseDSPThread();
 	settings.m_WriteToMemcard = m_memcard_write->GetValue();
+	settings.m_Rollback = m_rollback_chkbox->GetValue();
 	settings.m_OCEnable = instance.m_OCEnable;
 	settings.m_OCFactor = instance.m_OCFactor;
 	settings.m_EXIDevice[0] = instance.m_EXIDevice[0];
@@ -329,6 +338,7 @@ void NetPlayDialog::OnMsgStartGame()
 	{
 		m_start_btn->Disable();
 		m_memcard_write->Disable();
+		m_rollback_chkbox->Disable();
 		m_game_btn->Disable();
 		m_player_config_btn->Disable();
 	}
@@ -344,6 +354,7 @@ void NetPlayDialog::OnMsgStopGame()
 	{
 		m_start_btn->Enable();
 		m_memcard_write->Enable();
+		m_rollback_chkbox->Enable();
 		m_game_btn->Enable();
 		m_player_config_btn->Enable();
 	}
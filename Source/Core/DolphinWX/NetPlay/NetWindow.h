@@ -84,6 +84,7 @@ private:
 	wxTextCtrl*   m_chat_msg_text;
 	wxCheckBox*   m_memcard_write;
 	wxCheckBox*   m_record_chkbox;
+	wxCheckBox*   m_rollback_chkbox;
 
 	std::string   m_selected_game;
 	wxButton*     m_player_config_btn;
@@ -0,0 +1,269 @@
+// Copyright 2016 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Common/FileUtil.h"
+#include "Common/MsgHandler.h"
+#include "Common/StringUtil.h"
+#include "DiscIO/Blob.h"
+#include "DiscIO/Volume.h"
+#include "DiscIO/VolumeCreator.h"
+
+// Converts disc images to GCZ without the GUI. For every image, reading (and
+// scrubbing), compressing and writing run at the same time inside
+// CompressFileToBlob. Verifying an image reads it back on another thread while
+// the next one is being compressed. Images are written to <output>.part and
+// only get their final name once they are complete (and verified).
+
+static const size_t VERIFY_CHUNK_SIZE = 1 << 20;
+
+struct Job
+{
+	std::string input;
+	std::string output;
+	std::string temp_output;
+	DiscIO::CompressStats stats;
+	bool verified = false;
+	double verify_seconds = 0;
+};
+
+static bool PrintAlert(const char* caption, const char* text, bool yes_no, int style)
+{
+	fprintf(stderr, "%s: %s\n", caption, text);
+	return false;
+}
+
+static double MiBPerSecond(u64 bytes, double seconds)
+{
+	return seconds > 0 ? bytes / seconds / (1024 * 1024) : 0;
+}
+
+// Reads the GCZ back through the same reader the emulator uses, and compares
+// it with the original image, which is read again for this. Blocks the
+// scrubber replaced have to hold 0xFF bytes instead.
+static void Verify(Job* job, int block_size)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	std::unique_ptr<DiscIO::IBlobReader> original(DiscIO::CreateBlobReader(job->input));
+	std::unique_ptr<DiscIO::IBlobReader> converted(DiscIO::CreateBlobReader(job->temp_output));
+	if (!original || !converted || converted->GetDataSize() != original->GetDataSize())
+		return;
+
+	const u64 data_size = original->GetDataSize();
+	const std::vector<bool>& scrubbed = job->stats.scrubbed_blocks;
+	const size_t chunk_size = std::max<size_t>(1, VERIFY_CHUNK_SIZE / block_size) * block_size;
+	std::vector<u8> expected(chunk_size);
+	std::vector<u8> actual(chunk_size);
+	for (u64 offset = 0; offset < data_size; offset += chunk_size)
+	{
+		const size_t size = (size_t)std::min<u64>(chunk_size, data_size - offset);
+		if (!original->Read(offset, size, expected.data()) || !converted->Read(offset, size, actual.data()))
+			return;
+
+		for (size_t block_offset = 0; block_offset < size; block_offset += block_size)
+		{
+			const u64 block = (offset + block_offset) / block_size;
+			if (block < scrubbed.size() && scrubbed[block])
+			{
+				const size_t count = std::min<size_t>(block_size, size - block_offset);
+				std::fill(expected.begin() + block_offset, expected.begin() + block_offset + count, 0xFF);
+			}
+		}
+		if (memcmp(expected.data(), actual.data(), size))
+			return;
+	}
+
+	job->verified = true;
+	job->verify_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Gives a finished image its final name.
+static bool Publish(const Job& job)
+{
+	if (File::Rename(job.temp_output, job.output))
+		return true;
+	printf("%s: could not be renamed\n", job.temp_output.c_str());
+	File::Delete(job.temp_output);
+	return false;
+}
+
+static void PrintStats(const Job& job, bool verify)
+{
+	const DiscIO::CompressStats& stats = job.stats;
+	const double compress_seconds = stats.compress_seconds / std::max(1, stats.compress_threads);
+	printf("  %" PRIu64 " -> %" PRIu64 " bytes (%i%%)\n", stats.input_bytes, stats.output_bytes,
+	       stats.input_bytes ? (int)(100 * stats.output_bytes / stats.input_bytes) : 0);
+	printf("  read %.1f MiB/s, compress %.1f MiB/s (%i threads), write %.1f MiB/s",
+	       MiBPerSecond(stats.input_bytes, stats.read_seconds),
+	       MiBPerSecond(stats.input_bytes, compress_seconds), stats.compress_threads,
+	       MiBPerSecond(stats.output_bytes, stats.write_seconds));
+	if (verify)
+		printf(", verify %.1f MiB/s", MiBPerSecond(stats.input_bytes, job.verify_seconds));
+	printf("\n");
+}
+
+// Usage:
+//   disctool [-s] [-v] [-b <block size>] [-o <directory>] [-l <list file>] <image>...
+int main(int argc, const char* argv[])
+{
+	if (argc == 1 || (argc == 2 && (!strcmp(argv[1], "--help") || (!strcmp(argv[1], "-?")))))
+	{
+		printf("USAGE: DiscTool [-?] [--help] [-s] [-v] [-b <SIZE>] [-o <DIRECTORY>] [-l <FILE>] <IMAGE>...\n");
+		printf("Compresses disc images (ISO, GCM, CISO, WBFS or GCZ) to GCZ.\n");
+		printf("-? / --help: Prints this message\n");
+		printf("-s: Scrub Wii discs\n");
+		printf("-v: Read every GCZ back and compare it with the image before renaming it\n");
+		printf("-b <SIZE>: GCZ block size (default 16384)\n");
+		printf("-o <DIRECTORY>: Write the GCZ files there instead of next to the images\n");
+		printf("-l <FILE>: Also convert the images listed in FILE, one per line\n");
+		return 0;
+	}
+
+	RegisterMsgAlertHandler(&PrintAlert);
+
+	bool scrub = false, verify = false;
+	int block_size = 16384;
+	std::string output_dir;
+	std::vector<std::string> inputs;
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "-s"))
+			scrub = true;
+		else if (!strcmp(argv[i], "-v"))
+			verify = true;
+		else if (!strcmp(argv[i], "-b") && i + 1 < argc)
+			block_size = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-o") && i + 1 < argc)
+			output_dir = argv[++i];
+		else if (!strcmp(argv[i], "-l") && i + 1 < argc)
+		{
+			std::string list;
+			if (!File::ReadFileToString(argv[++i], list))
+			{
+				printf("ERROR: Could not read %s.\n", argv[i]);
+				return 1;
+			}
+			std::istringstream stream(list);
+			std::string line;
+			while (std::getline(stream, line))
+			{
+				line = StripSpaces(line);
+				if (!line.empty())
+					inputs.push_back(line);
+			}
+		}
+		else
+		{
+			inputs.push_back(argv[i]);
+		}
+	}
+
+	if (block_size <= 0 || block_size % 512 != 0)
+	{
+		printf("ERROR: The block size has to be a multiple of 512.\n");
+		return 1;
+	}
+
+	if (!output_dir.empty() && output_dir.back() != '/' && output_dir.back() != '\\')
+		output_dir += '/';
+	if (!output_dir.empty())
+		File::CreateFullPath(output_dir);
+
+	std::vector<Job> jobs(inputs.size());
+	std::thread verify_thread;
+	int failed = 0;
+
+	auto finish_verify = [&](size_t index) {
+		if (verify_thread.joinable())
+			verify_thread.join();
+		Job& job = jobs[index];
+		printf("%s: %s\n", job.output.c_str(), job.verified ? "verified" : "VERIFICATION FAILED");
+		PrintStats(job, true);
+		if (!job.verified)
+		{
+			File::Delete(job.temp_output);
+			failed++;
+		}
+		else if (!Publish(job))
+		{
+			failed++;
+		}
+	};
+
+	size_t pending_verify = inputs.size();
+	for (size_t i = 0; i < inputs.size(); i++)
+	{
+		Job& job = jobs[i];
+		job.input = inputs[i];
+
+		std::string path, name;
+		SplitPath(job.input, &path, &name, nullptr);
+		job.output = (output_dir.empty() ? path : output_dir) + name + ".gcz";
+
+		u32 sub_type = 0;
+		std::unique_ptr<DiscIO::IVolume> volume(DiscIO::CreateVolumeFromFilename(job.input));
+		if (!volume)
+		{
+			printf("%s: not a disc image\n", job.input.c_str());
+			failed++;
+			continue;
+		}
+		if (scrub && volume->GetVolumeType() == DiscIO::IVolume::WII_DISC)
+			sub_type = 1;
+		volume.reset();
+
+		// Written next to the final file first, so that the input can also be
+		// the output, and nothing half done is left behind under that name.
+		job.temp_output = job.output + ".part";
+		printf("%s -> %s\n", job.input.c_str(), job.output.c_str());
+		if (!DiscIO::CompressFileToBlob(job.input, job.temp_output, sub_type, block_size, nullptr, nullptr, &job.stats))
+		{
+			printf("%s: conversion failed\n", job.input.c_str());
+			if (File::Exists(job.temp_output))
+				File::Delete(job.temp_output);
+			failed++;
+			continue;
+		}
+
+		// One image is verified at a time, while the next one is compressed.
+		if (pending_verify != inputs.size())
+		{
+			finish_verify(pending_verify);
+			pending_verify = inputs.size();
+		}
+
+		if (verify)
+		{
+			verify_thread = std::thread(Verify, &job, block_size);
+			pending_verify = i;
+		}
+		else if (Publish(job))
+		{
+			PrintStats(job, false);
+		}
+		else
+		{
+			failed++;
+		}
+	}
+
+	if (pending_verify != inputs.size())
+		finish_verify(pending_verify);
+
+	printf("%i of %i images converted\n", (int)inputs.size() - failed, (int)inputs.size());
+	return failed ? 1 : 0;
+}
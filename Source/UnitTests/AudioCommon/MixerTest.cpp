@@ -0,0 +1,136 @@
+// Copyright 2016 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "AudioCommon/Mixer.h"
+#include "Common/CommonFuncs.h"
+#include "Common/CommonTypes.h"
+#include "Common/StringUtil.h"
+#include "Core/ConfigManager.h"
+#include "Core/PowerPC/PowerPC.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+class MixerTest : public testing::Test
+{
+protected:
+	static void SetUpTestCase()
+	{
+		SConfig::Init();
+		SConfig::GetInstance().m_Framelimit = 0;
+		PowerPC::Start();
+	}
+
+	static void TearDownTestCase()
+	{
+		PowerPC::Stop();
+		SConfig::Shutdown();
+	}
+
+	static std::unique_ptr<CMixer> CreateMixer(bool sinc)
+	{
+		SConfig::GetInstance().m_SincResampling = sinc;
+		return std::make_unique<CMixer>(48000);
+	}
+
+	// Pushes 32kHz DMA audio with a different sine on each channel, mixes
+	// 480 frames of 48kHz output and compares them with the sines evaluated at
+	// the input positions the mixer should have used.
+	//
+	// center is the index of the input frame that sits at fraction 0 in the
+	// interpolation window. tolerance is relative to the amplitude.
+	static void CheckSineInput(bool sinc, double center, double tolerance)
+	{
+		static const u32 INPUT_RATE = 32000;
+		static const u32 NUM_INPUT = 1000;
+		static const u32 NUM_OUTPUT = 480;
+		static const double AMPLITUDE = 0x2000;
+		static const double FREQUENCY[2] = { 1000.0, 440.0 };
+
+		auto sine = [](int channel, double position) {
+			return AMPLITUDE * sin(2 * M_PI * FREQUENCY[channel] * position / INPUT_RATE);
+		};
+
+		std::unique_ptr<CMixer> mixer = CreateMixer(sinc);
+		std::vector<s16> input(NUM_INPUT * 2);
+		for (u32 i = 0; i < NUM_INPUT; ++i)
+		{
+			input[i * 2] = Common::swap16((s16)lround(sine(0, i)));
+			input[i * 2 + 1] = Common::swap16((s16)lround(sine(1, i)));
+		}
+		mixer->PushSamples(input.data(), NUM_INPUT);
+
+		s16 output[2 * NUM_OUTPUT];
+		mixer->Mix(output, NUM_OUTPUT);
+
+		// The FIFO starts far below its low watermark, so the rate control
+		// slows the input down by the largest allowed amount.
+		const float ratio = (INPUT_RATE - CMixer::MAX_FREQ_SHIFT) / 48000.0f;
+		const double volume = 255.0 / 256.0;
+
+		u32 index = 0;
+		float fraction = 0;
+		for (u32 n = 0; n < NUM_OUTPUT; ++n)
+		{
+			const double position = index + fraction + center;
+			// Mix() writes the channels in the opposite order of PushSamples().
+			EXPECT_NEAR(volume * sine(0, position), output[n * 2 + 1], tolerance * AMPLITUDE) << "frame " << n;
+			EXPECT_NEAR(volume * sine(1, position), output[n * 2], tolerance * AMPLITUDE) << "frame " << n;
+
+			fraction += ratio;
+			index += (s32)fraction;
+			fraction -= (s32)fraction;
+		}
+	}
+};
+
+TEST_F(MixerTest, SineInputCubic)
+{
+	// Catmull-Rom over frames 0 to 3, interpolating between 1 and 2.
+	CheckSineInput(false, 1, 0.001);
+}
+
+TEST_F(MixerTest, SineInputSinc)
+{
+	// 16 taps, interpolating between frames 7 and 8.
+	CheckSineInput(true, 7, 0.001);
+}
+
+// Measures the cost of the Mix(s16*) path used by the audio backends. Run
+// with --gtest_also_run_disabled_tests; the timings are recorded as test
+// properties (see --gtest_output=xml).
+TEST_F(MixerTest, DISABLED_MixBenchmark)
+{
+	for (bool sinc : { false, true })
+	{
+		std::unique_ptr<CMixer> mixer = CreateMixer(sinc);
+
+		std::vector<s16> input(2 * 320);
+		for (s16& sample : input)
+			sample = (s16)(rand() & 0xFFFF);
+		s16 output[2 * 480];
+
+		const int iterations = 20000;
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < iterations; ++i)
+		{
+			// 10ms of 32kHz DMA audio and 48kHz streaming audio.
+			mixer->PushSamples(input.data(), 320);
+			mixer->PushStreamingSamples(input.data(), 320);
+			mixer->Mix(output, 480);
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+
+		double ns = std::chrono::duration<double, std::nano>(end - start).count();
+		RecordProperty(sinc ? "SincNsPerFrame" : "CubicNsPerFrame",
+		               StringFromFormat("%.1f", ns / (iterations * 480.0)));
+	}
+}
@@ -0,0 +1,58 @@
+// Copyright 2016 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <cstring>
+#include <random>
+#include <vector>
+#include <gtest/gtest.h>
+#include <mbedtls/sha1.h>
+
+#include "Common/CommonTypes.h"
+#include "Common/Crypto/SHA1.h"
+
+TEST(SHA1, KnownVectors)
+{
+	static const u8 abc_hash[20] = {
+		0xa9, 0x99, 0x3e, 0x36, 0x47, 0x06, 0x81, 0x6a, 0xba, 0x3e,
+		0x25, 0x71, 0x78, 0x50, 0xc2, 0x6c, 0x9c, 0xd0, 0xd8, 0x9d };
+	static const u8 empty_hash[20] = {
+		0xda, 0x39, 0xa3, 0xee, 0x5e, 0x6b, 0x4b, 0x0d, 0x32, 0x55,
+		0xbf, 0xef, 0x95, 0x60, 0x18, 0x90, 0xaf, 0xd8, 0x07, 0x09 };
+
+	u8 hash[20];
+	Common::SHA1::Digest(reinterpret_cast<const u8*>("abc"), 3, hash);
+	EXPECT_EQ(0, memcmp(hash, abc_hash, sizeof(hash)));
+
+	Common::SHA1::Digest(nullptr, 0, hash);
+	EXPECT_EQ(0, memcmp(hash, empty_hash, sizeof(hash)));
+}
+
+TEST(SHA1, MatchesMbedTLS)
+{
+	std::mt19937 rng(0x5A1);
+	std::vector<u8> data(0x8000);
+	for (u8& byte : data)
+		byte = static_cast<u8>(rng());
+
+	for (size_t length : { 1, 55, 56, 63, 64, 65, 127, 0x400, 0x7C00, 0x8000 })
+	{
+		u8 expected[20];
+		mbedtls_sha1(data.data(), length, expected);
+
+		u8 hash[20];
+		Common::SHA1::Digest(data.data(), length, hash);
+		EXPECT_EQ(0, memcmp(hash, expected, sizeof(hash))) << "length " << length;
+
+		// Feed the same data in odd-sized pieces
+		Common::SHA1::Context context;
+		for (size_t offset = 0; offset < length;)
+		{
+			size_t piece = std::min<size_t>(length - offset, 1 + rng() % 100);
+			context.Update(data.data() + offset, piece);
+			offset += piece;
+		}
+		context.Finish(hash);
+		EXPECT_EQ(0, memcmp(hash, expected, sizeof(hash))) << "length " << length;
+	}
+}
@@ -0,0 +1,193 @@
+// Copyright 2016 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Common/MemoryUtil.h"
+#include "Common/MsgHandler.h"
+#include "Core/ConfigManager.h"
+#include "Core/DSP/DSPAnalyzer.h"
+#include "Core/DSP/DSPCodeUtil.h"
+#include "Core/DSP/DSPCore.h"
+#include "Core/DSP/DSPHWInterface.h"
+#include "Core/DSP/DSPInterpreter.h"
+#include "Core/DSP/DSPTables.h"
+
+// include order is important
+#include <gtest/gtest.h> // NOLINT
+
+namespace
+{
+// The tests run on zeroed ROMs; keep going when asked about them.
+bool IgnoreAlerts(const char*, const char*, bool, int)
+{
+	return false;
+}
+
+// Counts down from 0x40 through a self loop, a conditional branch into
+// another block and a call, then halts.
+const char s_loops[] =
+	"	clr	$acc0\n"
+	"	clr	$acc1\n"
+	"	jmp	start\n"
+	"step:\n"
+	"	addis	$ac0.m, #-1\n"
+	"	ret\n"
+	"start:\n"
+	"	lri	$ac1.m, #0x40\n"
+	"inner:\n"
+	"	addis	$ac0.m, #3\n"
+	"	decm	$ac1.m\n"
+	"	jnz	inner\n"
+	"	lri	$ac1.m, #0x20\n"
+	"outer:\n"
+	"	call	step\n"
+	"	decm	$ac1.m\n"
+	"	jnz	outer\n"
+	"	halt\n";
+
+// Waits for mail from the CPU. LRS addresses the page in $cr, which ucodes
+// point at the hardware registers.
+const char s_polling[] =
+	"	lri	$cr, #0x00ff\n"
+	"	lri	$ac0.m, #0x1234\n"
+	"wait:\n"
+	"	lrs	$ac1.m, @cmbh\n"
+	"	andcf	$ac1.m, #0x8000\n"
+	"	jlnz	wait\n"
+	"	halt\n";
+
+// Polls too, but counts iterations, so skipping them would be visible.
+const char s_counting[] =
+	"	lri	$cr, #0x00ff\n"
+	"wait:\n"
+	"	inc	$acc0\n"
+	"	lrs	$ac1.m, @cmbh\n"
+	"	andcf	$ac1.m, #0x8000\n"
+	"	jlnz	wait\n"
+	"	halt\n";
+
+class DSPJitTest : public testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		SConfig::Init();
+		RegisterMsgAlertHandler(&IgnoreAlerts);
+		InitInstructionTable();
+	}
+
+	void TearDown() override
+	{
+		DSPCore_Shutdown();
+		SConfig::Shutdown();
+	}
+
+	void Load(const char* source, DSPInitOptions::CoreType core_type)
+	{
+		std::vector<u16> code;
+		ASSERT_TRUE(Assemble(source, code));
+
+		DSPInitOptions opts;
+		opts.irom_contents.fill(0);
+		opts.coef_contents.fill(0);
+		opts.core_type = core_type;
+		ASSERT_TRUE(DSPCore_Init(opts));
+
+		UnWriteProtectMemory(g_dsp.iram, DSP_IRAM_BYTE_SIZE, false);
+		std::copy(code.begin(), code.end(), g_dsp.iram);
+		WriteProtectMemory(g_dsp.iram, DSP_IRAM_BYTE_SIZE, false);
+		DSPAnalyzer::Analyze();
+
+		g_dsp.pc = 0;
+		g_dsp.cr &= ~CR_HALT;
+	}
+
+	// Steps the interpreter until the ucode halts. Every instruction takes one
+	// cycle, so this returns the cycle count the JIT has to match.
+	int StepToHalt()
+	{
+		int cycles = 0;
+		while (!(g_dsp.cr & CR_HALT) && cycles < 0x10000)
+		{
+			DSPInterpreter::Step();
+			++cycles;
+		}
+		return cycles;
+	}
+
+	// Runs until the ucode halts. Returns the number of cycles it took.
+	int RunToHalt(int slice)
+	{
+		int cycles = 0;
+		for (int slices = 0; !(g_dsp.cr & CR_HALT) && slices < 1000; ++slices)
+		{
+			// The JIT finishes the block it is in when the slice runs out, and
+			// then returns a negative count.
+			cycles += slice - (s16)DSPCore_RunCycles(slice);
+		}
+		return cycles;
+	}
+};
+}  // namespace
+
+TEST_F(DSPJitTest, FindsMailboxPollingLoops)
+{
+	Load(s_polling, DSPInitOptions::CORE_INTERPRETER);
+	EXPECT_TRUE(DSPAnalyzer::code_flags[4] & DSPAnalyzer::CODE_IDLE_SKIP);
+	DSPCore_Shutdown();
+
+	Load(s_counting, DSPInitOptions::CORE_INTERPRETER);
+	EXPECT_FALSE(DSPAnalyzer::code_flags[2] & DSPAnalyzer::CODE_IDLE_SKIP);
+}
+
+TEST_F(DSPJitTest, LinkedBlocksMatchInterpreter)
+{
+	Load(s_loops, DSPInitOptions::CORE_INTERPRETER);
+	const int expected_cycles = StepToHalt();
+	const DSP_Regs expected = g_dsp.r;
+	DSPCore_Shutdown();
+
+	// Small and large slices, so that both the linked paths and the fallback
+	// through the dispatcher when a slice runs out get exercised.
+	for (int slice : {7, 0x40, 0x1000})
+	{
+		Load(s_loops, DSPInitOptions::CORE_JIT);
+		EXPECT_EQ(expected_cycles, RunToHalt(slice)) << "slice " << slice;
+		EXPECT_EQ(expected.ac[0].h, g_dsp.r.ac[0].h) << "slice " << slice;
+		EXPECT_EQ(expected.ac[0].m, g_dsp.r.ac[0].m) << "slice " << slice;
+		EXPECT_EQ(expected.ac[0].l, g_dsp.r.ac[0].l) << "slice " << slice;
+		EXPECT_EQ(expected.ac[1].m, g_dsp.r.ac[1].m) << "slice " << slice;
+		EXPECT_EQ(expected.sr, g_dsp.r.sr) << "slice " << slice;
+		DSPCore_Shutdown();
+	}
+}
+
+TEST_F(DSPJitTest, PollingLoopGivesUpSlice)
+{
+	Load(s_polling, DSPInitOptions::CORE_JIT);
+
+	// No mail: the DSP spins in the loop, and gives up the whole slice
+	// without changing any state.
+	DSPCore_RunCycles(0x100);
+	EXPECT_EQ(0, cyclesLeft);
+	EXPECT_EQ(4, g_dsp.pc);
+	const DSP_Regs idle = g_dsp.r;
+	DSPCore_RunCycles(0x4000);
+	EXPECT_EQ(0, cyclesLeft);
+	EXPECT_EQ(4, g_dsp.pc);
+	EXPECT_EQ(0, memcmp(&idle, &g_dsp.r, sizeof(idle)));
+
+	// Mail arrives: the loop exits after one more pass and the DSP reaches
+	// the halt.
+	gdsp_mbox_write_h(MAILBOX_CPU, 0x8000);
+	gdsp_mbox_write_l(MAILBOX_CPU, 0x0000);
+	EXPECT_EQ(4, RunToHalt(0x100));
+	EXPECT_TRUE(g_dsp.cr & CR_HALT);
+	EXPECT_EQ(0x1234, g_dsp.r.ac[0].m);
+}
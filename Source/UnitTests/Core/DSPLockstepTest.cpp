@@ -0,0 +1,151 @@
+// Copyright 2016 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "Common/CommonPaths.h"
+#include "Common/CommonTypes.h"
+#include "Common/FileUtil.h"
+#include "Common/MemoryUtil.h"
+#include "Common/MsgHandler.h"
+#include "Core/ConfigManager.h"
+#include "Core/Core.h"
+#include "Core/DSP/DSPAnalyzer.h"
+#include "Core/DSP/DSPCodeUtil.h"
+#include "Core/DSP/DSPCore.h"
+#include "Core/HW/Memmap.h"
+#include "Core/HW/DSPLLE/DSPLLE.h"
+
+// include order is important
+#include <gtest/gtest.h> // NOLINT
+
+namespace
+{
+// The tests run on zeroed ROMs; keep going when asked about them.
+bool IgnoreAlerts(const char*, const char*, bool, int)
+{
+	return false;
+}
+
+// Counts while it waits for mail, then keeps counting with the mail as the
+// step. Where the DSP is when the mail arrives shows up in the registers.
+const char s_mail_counter[] =
+	"	lri	$cr, #0x00ff\n"
+	"	clr	$acc0\n"
+	"	clr	$acc1\n"
+	"wait:\n"
+	"	inc	$acc0\n"
+	"	lrs	$ac1.m, @cmbh\n"
+	"	andcf	$ac1.m, #0x8000\n"
+	"	jlnz	wait\n"
+	"	lrs	$ax0.l, @cmbl\n"
+	"	lri	$ac1.m, #0x200\n"
+	"count:\n"
+	"	addaxl	$acc0, $ax0.l\n"
+	"	decm	$ac1.m\n"
+	"	jnz	count\n"
+	"	halt\n";
+
+struct DSPState
+{
+	DSP_Regs regs;
+	u16 pc;
+	u16 cr;
+	u64 step_counter;
+};
+
+class DSPLockstepTest : public testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		m_dir = File::CreateTempDir();
+		ASSERT_FALSE(m_dir.empty());
+		File::SetUserPath(D_USER_IDX, m_dir + DIR_SEP);
+		const std::string gc_dir = File::GetUserPath(D_GCUSER_IDX);
+		ASSERT_TRUE(File::CreateFullPath(gc_dir));
+		ASSERT_TRUE(File::WriteStringToFile(std::string(DSP_IROM_BYTE_SIZE, '\0'), gc_dir + DSP_IROM));
+		ASSERT_TRUE(File::WriteStringToFile(std::string(DSP_COEF_BYTE_SIZE, '\0'), gc_dir + DSP_COEF));
+
+		SConfig::Init();
+		SConfig::GetInstance().m_DSPEnableJIT = true;
+		RegisterMsgAlertHandler(&IgnoreAlerts);
+		Memory::Init();
+
+		// Makes the DSP thread run in lockstep.
+		Core::g_want_determinism = true;
+	}
+
+	void TearDown() override
+	{
+		Core::g_want_determinism = false;
+		Memory::Shutdown();
+		SConfig::Shutdown();
+		File::DeleteDirRecursively(m_dir);
+	}
+
+	// Runs the ucode for the given number of slices, mailing the DSP before
+	// slice mail_slice, and returns where it ended up.
+	DSPState Run(bool dsp_thread, int slices, int mail_slice)
+	{
+		DSPState state = {};
+		std::vector<u16> code;
+		EXPECT_TRUE(Assemble(s_mail_counter, code));
+
+		DSPLLE dsp;
+		EXPECT_TRUE(dsp.Initialize(false, dsp_thread));
+
+		UnWriteProtectMemory(g_dsp.iram, DSP_IRAM_BYTE_SIZE, false);
+		std::copy(code.begin(), code.end(), g_dsp.iram);
+		WriteProtectMemory(g_dsp.iram, DSP_IRAM_BYTE_SIZE, false);
+		DSPAnalyzer::Analyze();
+		g_dsp.pc = 0;
+		g_dsp.cr &= ~CR_HALT;
+
+		for (int slice = 0; slice < slices; ++slice)
+		{
+			if (slice == mail_slice)
+			{
+				dsp.DSP_WriteMailBoxHigh(true, 0x8000);
+				dsp.DSP_WriteMailBoxLow(true, 0x0003);
+			}
+			// 6 CPU cycles per DSP cycle; odd sizes so slices end mid-block.
+			dsp.DSP_Update(6 * (0x40 + 7 * slice));
+		}
+		dsp.DSP_Sync();
+
+		state.regs = g_dsp.r;
+		state.pc = g_dsp.pc;
+		state.cr = g_dsp.cr;
+		state.step_counter = g_dsp.step_counter;
+
+		dsp.DSP_StopSoundStream();
+		dsp.Shutdown();
+		return state;
+	}
+
+	std::string m_dir;
+};
+}  // namespace
+
+TEST_F(DSPLockstepTest, MatchesCPUThread)
+{
+	for (int mail_slice : {0, 3, 10})
+	{
+		const DSPState inline_state = Run(false, 40, mail_slice);
+		const DSPState thread_state = Run(true, 40, mail_slice);
+
+		EXPECT_EQ(inline_state.pc, thread_state.pc) << "mail at " << mail_slice;
+		EXPECT_EQ(inline_state.cr, thread_state.cr) << "mail at " << mail_slice;
+		EXPECT_EQ(inline_state.step_counter, thread_state.step_counter) << "mail at " << mail_slice;
+		EXPECT_EQ(inline_state.regs.ac[0].h, thread_state.regs.ac[0].h) << "mail at " << mail_slice;
+		EXPECT_EQ(inline_state.regs.ac[0].m, thread_state.regs.ac[0].m) << "mail at " << mail_slice;
+		EXPECT_EQ(inline_state.regs.ac[0].l, thread_state.regs.ac[0].l) << "mail at " << mail_slice;
+		EXPECT_EQ(inline_state.regs.ac[1].m, thread_state.regs.ac[1].m) << "mail at " << mail_slice;
+		EXPECT_EQ(inline_state.regs.ax[0].l, thread_state.regs.ax[0].l) << "mail at " << mail_slice;
+		EXPECT_EQ(inline_state.regs.sr, thread_state.regs.sr) << "mail at " << mail_slice;
+	}
+}
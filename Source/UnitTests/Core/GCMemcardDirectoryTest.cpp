@@ -0,0 +1,169 @@
+// Copyright 2016 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "Common/CommonPaths.h"
+#include "Common/CommonTypes.h"
+#include "Common/FileUtil.h"
+#include "Core/HW/GCMemcardDirectory.h"
+
+namespace
+{
+const u16 BLOCK_COUNT = 4;
+}
+
+class GCIJournalTest : public testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		m_dir = File::CreateTempDir();
+		ASSERT_FALSE(m_dir.empty());
+		m_filename = m_dir + DIR_SEP "test.gci";
+	}
+
+	void TearDown() override
+	{
+		File::DeleteDirRecursively(m_dir);
+	}
+
+	static DEntry Header(u8 tag)
+	{
+		DEntry header;
+		memset(header.Gamecode, tag, sizeof(header.Gamecode));
+		return header;
+	}
+
+	static GCMBlock Block(u8 fill)
+	{
+		GCMBlock block;
+		memset(block.block, fill, BLOCK_SIZE);
+		return block;
+	}
+
+	GCIFlush Rewrite(u8 tag, u8 fill) const
+	{
+		GCIFlush flush;
+		flush.filename = m_filename;
+		flush.remove = false;
+		flush.rewrite = true;
+		flush.header = Header(tag);
+		for (u16 i = 0; i < BLOCK_COUNT; ++i)
+		{
+			flush.indices.push_back(i);
+			flush.blocks.push_back(Block(fill));
+		}
+		return flush;
+	}
+
+	GCIFlush Patch(u8 tag, u16 index, u8 fill) const
+	{
+		GCIFlush flush;
+		flush.filename = m_filename;
+		flush.remove = false;
+		flush.rewrite = false;
+		flush.header = Header(tag);
+		flush.indices.push_back(index);
+		flush.blocks.push_back(Block(fill));
+		return flush;
+	}
+
+	// Checks the GCI holds the header and the blocks filled as given.
+	void ExpectContents(u8 tag, const std::vector<u8>& fills) const
+	{
+		std::string contents;
+		ASSERT_TRUE(File::ReadFileToString(m_filename, contents));
+		ASSERT_EQ(DENTRY_SIZE + fills.size() * BLOCK_SIZE, contents.size());
+
+		const DEntry header = Header(tag);
+		EXPECT_EQ(0, memcmp(&header, contents.data(), DENTRY_SIZE));
+		for (size_t i = 0; i < fills.size(); ++i)
+		{
+			const std::string expected(BLOCK_SIZE, (char)fills[i]);
+			EXPECT_EQ(expected, contents.substr(DENTRY_SIZE + i * BLOCK_SIZE, BLOCK_SIZE)) << "block " << i;
+		}
+	}
+
+	// Writes a journal the way a patch interrupted before touching the GCI
+	// leaves it.
+	void WriteJournal(const GCIFlush& flush) const
+	{
+		File::IOFile journal(m_filename + ".journal", "wb");
+		const u32 count = (u32)flush.indices.size();
+		ASSERT_TRUE(journal.WriteBytes(&flush.header, DENTRY_SIZE));
+		ASSERT_TRUE(journal.WriteArray(&count, 1));
+		ASSERT_TRUE(journal.WriteArray(flush.indices.data(), count));
+		ASSERT_TRUE(journal.WriteBytes(flush.blocks.data(), BLOCK_SIZE * count));
+	}
+
+	std::string m_dir;
+	std::string m_filename;
+};
+
+TEST_F(GCIJournalTest, PatchFailedPatchRewriteReload)
+{
+	ASSERT_TRUE(WriteGCI(Rewrite(0, 0x00)));
+
+	ASSERT_TRUE(WriteGCI(Patch(1, 1, 0x11)));
+	EXPECT_FALSE(File::Exists(m_filename + ".journal"));
+	ExpectContents(1, {0x00, 0x11, 0x00, 0x00});
+
+	// The GCI can't be opened; the flush thread rewrites it instead.
+	const std::string moved = m_dir + DIR_SEP "moved.gci";
+	ASSERT_TRUE(File::Rename(m_filename, moved));
+	EXPECT_FALSE(WriteGCI(Patch(2, 2, 0x55)));
+	EXPECT_FALSE(File::Exists(m_filename + ".journal"));
+	ASSERT_TRUE(File::Rename(moved, m_filename));
+	ASSERT_TRUE(WriteGCI(Rewrite(3, 0x22)));
+	EXPECT_FALSE(File::Exists(m_filename + ".journal"));
+
+	ReplayGCIJournal(m_filename);
+	ExpectContents(3, {0x22, 0x22, 0x22, 0x22});
+}
+
+TEST_F(GCIJournalTest, ReplaysInterruptedPatch)
+{
+	ASSERT_TRUE(WriteGCI(Rewrite(0, 0x00)));
+	WriteJournal(Patch(1, 2, 0x33));
+
+	ReplayGCIJournal(m_filename);
+	EXPECT_FALSE(File::Exists(m_filename + ".journal"));
+	ExpectContents(1, {0x00, 0x00, 0x33, 0x00});
+}
+
+TEST_F(GCIJournalTest, RewriteDropsJournal)
+{
+	ASSERT_TRUE(WriteGCI(Rewrite(0, 0x00)));
+	WriteJournal(Patch(1, 2, 0x33));
+
+	ASSERT_TRUE(WriteGCI(Rewrite(2, 0x44)));
+	EXPECT_FALSE(File::Exists(m_filename + ".journal"));
+	ReplayGCIJournal(m_filename);
+	ExpectContents(2, {0x44, 0x44, 0x44, 0x44});
+}
+
+TEST_F(GCIJournalTest, IgnoresStaleJournal)
+{
+	WriteJournal(Patch(1, 2, 0x33));
+
+	// Modification times only have a resolution of seconds.
+	std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+	{
+		// Written by something that doesn't know about journals.
+		const GCIFlush flush = Rewrite(2, 0x44);
+		File::IOFile GCI(m_filename, "wb");
+		ASSERT_TRUE(GCI.WriteBytes(&flush.header, DENTRY_SIZE));
+		ASSERT_TRUE(GCI.WriteBytes(flush.blocks.data(), BLOCK_SIZE * flush.blocks.size()));
+	}
+
+	ReplayGCIJournal(m_filename);
+	EXPECT_FALSE(File::Exists(m_filename + ".journal"));
+	ExpectContents(2, {0x44, 0x44, 0x44, 0x44});
+}
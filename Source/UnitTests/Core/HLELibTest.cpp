@@ -0,0 +1,327 @@
+// Copyright 2016 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <cstring>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "Common/CommonTypes.h"
+#include "Core/ConfigManager.h"
+#include "Core/HLE/HLE_Lib.h"
+#include "Core/HW/Memmap.h"
+#include "Core/PowerPC/PowerPC.h"
+#include "Core/PowerPC/Interpreter/Interpreter.h"
+
+namespace
+{
+// Encodings for the reference routines, which the interpreter runs the way
+// it would run the SDK's.
+u32 DForm(u32 opcd, u32 d, u32 a, s16 imm)
+{
+	return opcd << 26 | d << 21 | a << 16 | static_cast<u16>(imm);
+}
+
+u32 Addi(u32 d, u32 a, s16 imm) { return DForm(14, d, a, imm); }
+u32 Addis(u32 d, u32 a, s16 imm) { return DForm(15, d, a, imm); }
+u32 Cmpwi(u32 a, s16 imm) { return DForm(11, 0, a, imm); }
+u32 Lbzu(u32 d, s16 offset, u32 a) { return DForm(35, d, a, offset); }
+u32 Stbu(u32 s, s16 offset, u32 a) { return DForm(39, s, a, offset); }
+u32 Lwzu(u32 d, s16 offset, u32 a) { return DForm(33, d, a, offset); }
+u32 Stwu(u32 s, s16 offset, u32 a) { return DForm(37, s, a, offset); }
+u32 Stw(u32 s, s16 offset, u32 a) { return DForm(36, s, a, offset); }
+u32 Lfs(u32 d, s16 offset, u32 a) { return DForm(48, d, a, offset); }
+u32 Stfs(u32 s, s16 offset, u32 a) { return DForm(52, s, a, offset); }
+u32 Add(u32 d, u32 a, u32 b) { return 31u << 26 | d << 21 | a << 16 | b << 11 | 266 << 1; }
+u32 Cmplw(u32 a, u32 b) { return 31u << 26 | a << 16 | b << 11 | 32 << 1; }
+u32 Mtctr(u32 s) { return 31u << 26 | s << 21 | 9 << 16 | 467 << 1; }
+u32 Fadds(u32 d, u32 a, u32 b) { return 59u << 26 | d << 21 | a << 16 | b << 11 | 21 << 1; }
+u32 Fsubs(u32 d, u32 a, u32 b) { return 59u << 26 | d << 21 | a << 16 | b << 11 | 20 << 1; }
+u32 Fmuls(u32 d, u32 a, u32 c) { return 59u << 26 | d << 21 | a << 16 | c << 6 | 25 << 1; }
+// Branches take the offset in instructions from the branch.
+u32 Bdnz(int offset) { return 0x42000000 | (static_cast<u32>(offset * 4) & 0xFFFC); }
+u32 Blt(int offset) { return 0x41800000 | (static_cast<u32>(offset * 4) & 0xFFFC); }
+const u32 BEQLR = 0x4D820020;
+const u32 BLR = 0x4E800020;
+
+// memmove: forwards unless the destination is above the source.
+const std::vector<u32> s_memcpy = {
+	Cmpwi(5, 0),
+	BEQLR,
+	Mtctr(5),
+	Cmplw(4, 3),
+	Blt(7),
+	Addi(6, 3, -1),
+	Addi(4, 4, -1),
+	Lbzu(0, 1, 4),
+	Stbu(0, 1, 6),
+	Bdnz(-2),
+	BLR,
+	Add(6, 3, 5),
+	Add(4, 4, 5),
+	Lbzu(0, -1, 4),
+	Stbu(0, -1, 6),
+	Bdnz(-2),
+	BLR,
+};
+
+const std::vector<u32> s_memset = {
+	Cmpwi(5, 0),
+	BEQLR,
+	Mtctr(5),
+	Addi(6, 3, -1),
+	Stbu(4, 1, 6),
+	Bdnz(-1),
+	BLR,
+};
+
+const std::vector<u32> s_psmtx_copy = {
+	Addi(5, 0, 12),
+	Mtctr(5),
+	Addi(3, 3, -4),
+	Addi(4, 4, -4),
+	Lwzu(0, 4, 3),
+	Stwu(0, 4, 4),
+	Bdnz(-2),
+	BLR,
+};
+
+// Identity, with the diagonal taken from f1-f3 (PSMTXScale) or the last
+// column from f1-f3 (PSMTXTrans).
+std::vector<u32> MatrixRoutine(bool diagonal_args, bool column_args)
+{
+	std::vector<u32> code = { Addis(5, 0, 0x3F80), Addi(6, 0, 0) };
+	for (u32 i = 0; i < 12; ++i)
+	{
+		const s16 offset = static_cast<s16>(i * 4);
+		if (diagonal_args && i % 5 == 0)
+			code.push_back(Stfs(1 + i / 5, offset, 3));
+		else if (column_args && (i & 3) == 3)
+			code.push_back(Stfs(1 + i / 4, offset, 3));
+		else
+			code.push_back(Stw(i % 5 == 0 && !diagonal_args ? 5 : 6, offset, 3));
+	}
+	code.push_back(BLR);
+	return code;
+}
+
+// PSVECAdd/PSVECSubtract(a, b, out) and PSVECScale(src, dst, scale).
+std::vector<u32> VectorRoutine(u32 (*op)(u32, u32, u32), bool scale)
+{
+	std::vector<u32> code;
+	for (u32 i = 0; i < 3; ++i)
+	{
+		const s16 offset = static_cast<s16>(i * 4);
+		code.push_back(Lfs(2, offset, 3));
+		if (scale)
+		{
+			code.push_back(op(2, 2, 1));
+			code.push_back(Stfs(2, offset, 4));
+		}
+		else
+		{
+			code.push_back(Lfs(3, offset, 4));
+			code.push_back(op(2, 2, 3));
+			code.push_back(Stfs(2, offset, 5));
+		}
+	}
+	code.push_back(BLR);
+	return code;
+}
+
+const u32 CODE_ADDRESS = 0x80004000;
+const u32 RETURN_ADDRESS = 0x80003FFC;
+const u32 SOURCE = 0x80100000;
+const u32 REFERENCE_OUT = 0x80200000;
+const u32 HLE_OUT = 0x80300000;
+const u32 OUT_SIZE = 0x400;
+
+class HLELibTest : public testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		SConfig::Init();
+		Memory::Init();
+		PowerPC::Init(PowerPC::CORE_INTERPRETER);
+		// FP, IR and DR: the replacements take the fast path through RAM.
+		MSR = 0x2030;
+
+		for (u32 i = 0; i < OUT_SIZE; ++i)
+		{
+			Memory::Write_U8(static_cast<u8>(i * 7 + 3), SOURCE + i);
+			Memory::Write_U8(0xCD, REFERENCE_OUT + i);
+			Memory::Write_U8(0xCD, HLE_OUT + i);
+		}
+	}
+
+	void TearDown() override
+	{
+		PowerPC::Shutdown();
+		Memory::Shutdown();
+		SConfig::Shutdown();
+	}
+
+	static void SetArgs(u32 r3, u32 r4, u32 r5)
+	{
+		GPR(3) = r3;
+		GPR(4) = r4;
+		GPR(5) = r5;
+	}
+
+	static void SetFloatArgs(float f1, float f2, float f3)
+	{
+		rPS0(1) = f1;
+		rPS0(2) = f2;
+		rPS0(3) = f3;
+	}
+
+	static void WriteFloats(const std::vector<float>& values, u32 address)
+	{
+		for (float value : values)
+		{
+			u32 bits;
+			std::memcpy(&bits, &value, sizeof(bits));
+			Memory::Write_U32(bits, address);
+			address += 4;
+		}
+	}
+
+	void RunReference(const std::vector<u32>& code)
+	{
+		for (size_t i = 0; i < code.size(); ++i)
+			Memory::Write_U32(code[i], CODE_ADDRESS + static_cast<u32>(i) * 4);
+		PowerPC::ppcState.iCache.Reset();
+
+		PC = CODE_ADDRESS;
+		LR = RETURN_ADDRESS;
+		for (int steps = 0; PC != RETURN_ADDRESS && steps < 0x10000; ++steps)
+		{
+			Interpreter::getInstance()->SingleStepInner();
+			PC = NPC;
+		}
+		ASSERT_EQ(RETURN_ADDRESS, PC);
+	}
+
+	static void RunHLE(void (*function)())
+	{
+		PC = CODE_ADDRESS;
+		LR = RETURN_ADDRESS;
+		function();
+		EXPECT_EQ(RETURN_ADDRESS, NPC);
+	}
+
+	static bool SameOutput()
+	{
+		return std::memcmp(Memory::GetPointer(REFERENCE_OUT), Memory::GetPointer(HLE_OUT), OUT_SIZE) == 0;
+	}
+};
+}  // namespace
+
+TEST_F(HLELibTest, MemcpyMatchesInterpreter)
+{
+	for (u32 size : {0u, 1u, 3u, 37u, 256u})
+	{
+		for (u32 offset : {0u, 1u, 2u})
+		{
+			SetArgs(REFERENCE_OUT + offset, SOURCE + (offset * 3) % 4, size);
+			RunReference(s_memcpy);
+			EXPECT_EQ(REFERENCE_OUT + offset, GPR(3));
+
+			SetArgs(HLE_OUT + offset, SOURCE + (offset * 3) % 4, size);
+			RunHLE(HLE_Lib::HLE_memcpy);
+			EXPECT_EQ(HLE_OUT + offset, GPR(3));
+
+			EXPECT_TRUE(SameOutput()) << "size " << size << " offset " << offset;
+		}
+	}
+}
+
+TEST_F(HLELibTest, MemcpyOverlapping)
+{
+	std::memcpy(Memory::GetPointer(REFERENCE_OUT), Memory::GetPointer(SOURCE), OUT_SIZE);
+	std::memcpy(Memory::GetPointer(HLE_OUT), Memory::GetPointer(SOURCE), OUT_SIZE);
+
+	// Down, then up, by less than the size.
+	for (s32 distance : {-5, 9})
+	{
+		SetArgs(REFERENCE_OUT + 0x40 + distance, REFERENCE_OUT + 0x40, 0x81);
+		RunReference(s_memcpy);
+		SetArgs(HLE_OUT + 0x40 + distance, HLE_OUT + 0x40, 0x81);
+		RunHLE(HLE_Lib::HLE_memcpy);
+		EXPECT_TRUE(SameOutput()) << "distance " << distance;
+	}
+}
+
+TEST_F(HLELibTest, MemsetMatchesInterpreter)
+{
+	for (u32 size : {0u, 1u, 31u, 300u})
+	{
+		// Only the low byte of the value counts.
+		SetArgs(REFERENCE_OUT + 3, 0x1234, size);
+		RunReference(s_memset);
+		EXPECT_EQ(REFERENCE_OUT + 3, GPR(3));
+
+		SetArgs(HLE_OUT + 3, 0x1234, size);
+		RunHLE(HLE_Lib::HLE_memset);
+		EXPECT_EQ(HLE_OUT + 3, GPR(3));
+
+		EXPECT_TRUE(SameOutput()) << "size " << size;
+	}
+}
+
+TEST_F(HLELibTest, MatricesMatchInterpreter)
+{
+	SetArgs(REFERENCE_OUT, 0, 0);
+	RunReference(MatrixRoutine(false, false));
+	SetArgs(HLE_OUT, 0, 0);
+	RunHLE(HLE_Lib::HLE_PSMTXIdentity);
+	EXPECT_TRUE(SameOutput());
+
+	SetArgs(SOURCE, REFERENCE_OUT + 0x40, 0);
+	RunReference(s_psmtx_copy);
+	SetArgs(SOURCE, HLE_OUT + 0x40, 0);
+	RunHLE(HLE_Lib::HLE_PSMTXCopy);
+	EXPECT_TRUE(SameOutput());
+
+	// f1 holds a double that isn't a single, so the stores have to round it.
+	SetFloatArgs(0.1f, -2.5f, 1e30f);
+	rPS0(1) = 0.1;
+
+	SetArgs(REFERENCE_OUT + 0x80, 0, 0);
+	RunReference(MatrixRoutine(false, true));
+	SetArgs(HLE_OUT + 0x80, 0, 0);
+	RunHLE(HLE_Lib::HLE_PSMTXTrans);
+	EXPECT_TRUE(SameOutput());
+
+	SetArgs(REFERENCE_OUT + 0xC0, 0, 0);
+	RunReference(MatrixRoutine(true, false));
+	SetArgs(HLE_OUT + 0xC0, 0, 0);
+	RunHLE(HLE_Lib::HLE_PSMTXScale);
+	EXPECT_TRUE(SameOutput());
+}
+
+TEST_F(HLELibTest, VectorsMatchInterpreter)
+{
+	WriteFloats({ 1.5f, -3.25f, 3e38f }, SOURCE);
+	WriteFloats({ 1.0f / 3.0f, 7.0f, 3e38f }, SOURCE + 0x10);
+
+	SetArgs(SOURCE, SOURCE + 0x10, REFERENCE_OUT);
+	RunReference(VectorRoutine(Fadds, false));
+	SetArgs(SOURCE, SOURCE + 0x10, HLE_OUT);
+	RunHLE(HLE_Lib::HLE_PSVECAdd);
+	EXPECT_TRUE(SameOutput());
+
+	SetArgs(SOURCE, SOURCE + 0x10, REFERENCE_OUT + 0x10);
+	RunReference(VectorRoutine(Fsubs, false));
+	SetArgs(SOURCE, SOURCE + 0x10, HLE_OUT + 0x10);
+	RunHLE(HLE_Lib::HLE_PSVECSubtract);
+	EXPECT_TRUE(SameOutput());
+
+	SetFloatArgs(-0.75f, 0.0f, 0.0f);
+	SetArgs(SOURCE + 0x10, REFERENCE_OUT + 0x20, 0);
+	RunReference(VectorRoutine(Fmuls, true));
+	SetArgs(SOURCE + 0x10, HLE_OUT + 0x20, 0);
+	RunHLE(HLE_Lib::HLE_PSVECScale);
+	EXPECT_TRUE(SameOutput());
+}
@@ -0,0 +1,255 @@
+// Copyright 2016 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <array>
+#include <random>
+#include <gtest/gtest.h>
+
+#include "Common/CommonTypes.h"
+#include "Common/MathUtil.h"
+#include "Core/HW/DSPHLE/UCodes/Mixing.h"
+
+// Scalar reference implementations, as they were written in AXVoice.h and
+// Zelda.h before the SIMD kernels were introduced.
+namespace
+{
+void RefAXMixAdd(int* out, const s16* input, u32 count, u16* pvol, s16* dpop, bool ramp)
+{
+	u16& volume = pvol[0];
+	u16 volume_delta = ramp ? pvol[1] : 0;
+	for (u32 i = 0; i < count; ++i)
+	{
+		s64 sample = input[i];
+		sample *= volume;
+		sample >>= 15;
+		sample = MathUtil::Clamp((s32)sample, -32767, 32767);
+		out[i] += (s16)sample;
+		volume += volume_delta;
+		*dpop = (s16)sample;
+	}
+}
+
+s32 RefAddWithVolumeRamp(s16* dst, const s16* src, size_t count, s32 vol, s32 step)
+{
+	if (!vol && !step)
+		return vol;
+	for (size_t i = 0; i < count; ++i)
+	{
+		dst[i] += ((vol >> 16) * src[i]) >> 16;
+		vol += step;
+	}
+	return vol;
+}
+
+void RefAddWithVolume(s16* dst, const s16* src, size_t count, u16 vol)
+{
+	while (count--)
+	{
+		s32 vol_src = ((s32)*src++ * (s32)vol) >> 15;
+		*dst++ += MathUtil::Clamp(vol_src, -0x8000, 0x7FFF);
+	}
+}
+
+void RefApplyVolume(s16* buf, size_t count, u16 vol, int shift)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		s32 tmp = (u32)buf[i] * (u32)vol;
+		tmp >>= shift;
+		buf[i] = (s16)MathUtil::Clamp(tmp, -0x8000, 0x7FFF);
+	}
+}
+
+void RefInterpolateLinear(const s16* in, const u32* offsets, const u16* fracs, s16* output, u32 count)
+{
+	for (u32 i = 0; i < count; ++i)
+	{
+		s32 s0 = in[offsets[i]];
+		s32 s1 = in[offsets[i] + 1];
+		s32 frac = fracs[i];
+		output[i] = (s16)((s0 * (0x10000 - frac) + s1 * frac) >> 16);
+	}
+}
+
+template <typename T, size_t N>
+void Randomize(std::mt19937& rng, std::array<T, N>* arr)
+{
+	for (T& value : *arr)
+		value = (T)rng();
+}
+}
+
+TEST(Mixing, AXMixAddMatchesScalar)
+{
+	std::mt19937 rng(0xA8);
+	for (int iteration = 0; iteration < 2000; ++iteration)
+	{
+		std::array<s16, 96> input;
+		std::array<int, 96> expected, actual;
+		Randomize(rng, &input);
+		Randomize(rng, &expected);
+		actual = expected;
+
+		u32 count = 1 + rng() % 96;
+		bool ramp = (iteration & 1) != 0;
+		u16 pvol[2] = { (u16)rng(), (u16)rng() };
+		u16 volume = pvol[0];
+		s16 expected_dpop = 0, actual_dpop = 0;
+
+		RefAXMixAdd(expected.data(), input.data(), count, pvol, &expected_dpop, ramp);
+		Mixing::AXDestination dest = { actual.data(), &volume, ramp ? pvol[1] : (u16)0, &actual_dpop };
+		Mixing::AXMixAdd(input.data(), count, dest);
+
+		EXPECT_EQ(expected, actual);
+		EXPECT_EQ(pvol[0], volume);
+		EXPECT_EQ(expected_dpop, actual_dpop);
+	}
+}
+
+TEST(Mixing, InterpolateLinearMatchesScalar)
+{
+	std::mt19937 rng(0x11E4);
+	for (int iteration = 0; iteration < 2000; ++iteration)
+	{
+		std::array<s16, 260> input;
+		Randomize(rng, &input);
+		// Make sure the extremes, where the products are largest, show up.
+		input[rng() % input.size()] = -0x8000;
+		input[rng() % input.size()] = 0x7FFF;
+
+		u32 count = 1 + rng() % 96;
+		std::array<u32, 96> offsets;
+		std::array<u16, 96> fracs;
+		for (u32 i = 0; i < count; ++i)
+		{
+			offsets[i] = rng() % (input.size() - 1);
+			fracs[i] = (iteration & 1) ? (u16)rng() : (u16)(rng() % 4 == 0 ? 0 : rng());
+		}
+
+		std::array<s16, 96> expected, actual;
+		expected.fill(0);
+		actual.fill(0);
+		RefInterpolateLinear(input.data(), offsets.data(), fracs.data(), expected.data(), count);
+		Mixing::InterpolateLinear(input.data(), offsets.data(), fracs.data(), actual.data(), count);
+		EXPECT_EQ(expected, actual);
+
+#ifdef HAVE_SIMD_MIXING
+		if (Mixing::HasSIMD())
+		{
+			actual.fill(0);
+			Mixing::SIMD::InterpolateLinear(input.data(), offsets.data(), fracs.data(), actual.data(), count);
+			EXPECT_EQ(expected, actual);
+		}
+#endif
+	}
+}
+
+#ifdef HAVE_SIMD_MIXING
+TEST(Mixing, SIMDKernelsMatchScalar)
+{
+	if (!Mixing::HasSIMD())
+		return;
+
+	std::mt19937 rng(0x5E41);
+	for (int iteration = 0; iteration < 2000; ++iteration)
+	{
+		std::array<s16, 96> input;
+		Randomize(rng, &input);
+		u32 count = 1 + rng() % 96;
+
+		std::array<int, 96> expected_mix, actual_mix;
+		Randomize(rng, &expected_mix);
+		actual_mix = expected_mix;
+		bool ramp = (iteration & 1) != 0;
+		u16 pvol[2] = { (u16)rng(), (u16)rng() };
+		u16 volume = pvol[0];
+		s16 expected_dpop = 0, actual_dpop = 0;
+		RefAXMixAdd(expected_mix.data(), input.data(), count, pvol, &expected_dpop, ramp);
+		Mixing::AXDestination dest = { actual_mix.data(), &volume, ramp ? pvol[1] : (u16)0, &actual_dpop };
+		Mixing::SIMD::AXMixAddMulti(input.data(), count, &dest, 1);
+		EXPECT_EQ(expected_mix, actual_mix);
+		EXPECT_EQ(pvol[0], volume);
+		EXPECT_EQ(expected_dpop, actual_dpop);
+
+		std::array<s16, 96> expected, actual;
+		Randomize(rng, &expected);
+		actual = expected;
+		s32 vol = (s32)rng();
+		s32 step = (s32)(rng() % 0x20000) - 0x10000;
+		EXPECT_EQ(RefAddWithVolumeRamp(expected.data(), input.data(), count, vol, step),
+		          Mixing::SIMD::ZeldaAddWithVolumeRamp(actual.data(), input.data(), count, vol, step));
+		EXPECT_EQ(expected, actual);
+
+		u16 vol16 = (u16)rng();
+		RefAddWithVolume(expected.data(), input.data(), count, vol16);
+		Mixing::SIMD::ZeldaAddWithVolume(actual.data(), input.data(), count, vol16);
+		EXPECT_EQ(expected, actual);
+
+		int shift = (iteration & 2) ? 15 : 12;
+		RefApplyVolume(expected.data(), count, vol16, shift);
+		Mixing::SIMD::ZeldaApplyVolume(actual.data(), count, vol16, shift);
+		EXPECT_EQ(expected, actual);
+	}
+}
+#endif
+
+TEST(Mixing, AXMixAddMultiMatchesScalar)
+{
+	std::mt19937 rng(0xA9);
+	std::array<s16, 96> input;
+	Randomize(rng, &input);
+
+	std::array<std::array<int, 96>, 9> expected, actual;
+	u16 expected_vol[9][2], actual_vol[9];
+	s16 expected_dpop[9] = {}, actual_dpop[9] = {};
+	Mixing::AXDestination dests[9];
+	for (int d = 0; d < 9; ++d)
+	{
+		Randomize(rng, &expected[d]);
+		actual[d] = expected[d];
+		expected_vol[d][0] = actual_vol[d] = (u16)rng();
+		expected_vol[d][1] = (u16)rng();
+		dests[d] = { actual[d].data(), &actual_vol[d], expected_vol[d][1], &actual_dpop[d] };
+	}
+
+	for (int d = 0; d < 9; ++d)
+		RefAXMixAdd(expected[d].data(), input.data(), 93, expected_vol[d], &expected_dpop[d], true);
+	Mixing::AXMixAddMulti(input.data(), 93, dests, 9);
+
+	for (int d = 0; d < 9; ++d)
+	{
+		EXPECT_EQ(expected[d], actual[d]);
+		EXPECT_EQ(expected_vol[d][0], actual_vol[d]);
+		EXPECT_EQ(expected_dpop[d], actual_dpop[d]);
+	}
+}
+
+TEST(Mixing, ZeldaKernelsMatchScalar)
+{
+	std::mt19937 rng(0x2E1DA);
+	for (int iteration = 0; iteration < 2000; ++iteration)
+	{
+		std::array<s16, 0x50> src, expected, actual;
+		Randomize(rng, &src);
+		Randomize(rng, &expected);
+		size_t count = 1 + rng() % 0x50;
+
+		actual = expected;
+		s32 vol = (s32)rng();
+		s32 step = (s32)(rng() % 0x20000) - 0x10000;
+		EXPECT_EQ(RefAddWithVolumeRamp(expected.data(), src.data(), count, vol, step),
+		          Mixing::ZeldaAddWithVolumeRamp(actual.data(), src.data(), count, vol, step));
+		EXPECT_EQ(expected, actual);
+
+		u16 vol16 = (u16)rng();
+		RefAddWithVolume(expected.data(), src.data(), count, vol16);
+		Mixing::ZeldaAddWithVolume(actual.data(), src.data(), count, vol16);
+		EXPECT_EQ(expected, actual);
+
+		int shift = (iteration & 1) ? 15 : 12;
+		RefApplyVolume(expected.data(), count, vol16, shift);
+		Mixing::ZeldaApplyVolume(actual.data(), count, vol16, shift);
+		EXPECT_EQ(expected, actual);
+	}
+}
@@ -0,0 +1,144 @@
+// Copyright 2016 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "Common/CommonPaths.h"
+#include "Common/CommonTypes.h"
+#include "Common/FileUtil.h"
+#include "Core/Movie.h"
+
+class StateHashTest : public testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		m_dir = File::CreateTempDir();
+		ASSERT_FALSE(m_dir.empty());
+		m_filename = Movie::GetStateHashFilename(m_dir + DIR_SEP "test.dtm");
+	}
+
+	void TearDown() override
+	{
+		File::DeleteDirRecursively(m_dir);
+	}
+
+	// A recording hashed every 10 inputs, with 2 inputs per frame.
+	static std::vector<Movie::StateHash> Record(u64 input_count)
+	{
+		std::vector<Movie::StateHash> hashes;
+		for (u64 input = 10; input <= input_count; input += 10)
+			Movie::AddStateHash(&hashes, { input, input / 2, input * 0x9E3779B97F4A7C15ULL });
+		return hashes;
+	}
+
+	std::string m_dir;
+	std::string m_filename;
+};
+
+static bool SameHashes(const std::vector<Movie::StateHash>& a, const std::vector<Movie::StateHash>& b)
+{
+	return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(),
+		[](const Movie::StateHash& x, const Movie::StateHash& y)
+		{
+			return x.input_count == y.input_count && x.frame == y.frame && x.hash == y.hash;
+		});
+}
+
+TEST_F(StateHashTest, RoundTrip)
+{
+	const std::vector<Movie::StateHash> recorded = Record(100);
+	ASSERT_TRUE(Movie::WriteStateHashes(m_filename, 10, recorded, 100));
+
+	u32 interval = 0;
+	std::vector<Movie::StateHash> loaded;
+	ASSERT_TRUE(Movie::ReadStateHashes(m_filename, &interval, &loaded));
+	EXPECT_EQ(10u, interval);
+	EXPECT_TRUE(SameHashes(recorded, loaded));
+}
+
+TEST_F(StateHashTest, SavesOnlyUpToTheLastInput)
+{
+	// Saving after going back to input 55 through a savestate.
+	ASSERT_TRUE(Movie::WriteStateHashes(m_filename, 10, Record(100), 55));
+
+	u32 interval = 0;
+	std::vector<Movie::StateHash> loaded;
+	ASSERT_TRUE(Movie::ReadStateHashes(m_filename, &interval, &loaded));
+	ASSERT_EQ(5u, loaded.size());
+	EXPECT_EQ(50u, loaded.back().input_count);
+}
+
+TEST_F(StateHashTest, RerecordDropsLaterHashes)
+{
+	std::vector<Movie::StateHash> hashes = Record(100);
+	Movie::AddStateHash(&hashes, { 40, 20, 1234 });
+
+	ASSERT_EQ(4u, hashes.size());
+	EXPECT_EQ(1234u, hashes.back().hash);
+	EXPECT_EQ(nullptr, Movie::FindStateHash(hashes, 50));
+}
+
+TEST_F(StateHashTest, RejectsDamagedFiles)
+{
+	u32 interval = 7;
+	std::vector<Movie::StateHash> loaded = Record(20);
+
+	// Missing file.
+	EXPECT_FALSE(Movie::ReadStateHashes(m_filename, &interval, &loaded));
+
+	// Cut off in the middle of the hashes.
+	ASSERT_TRUE(Movie::WriteStateHashes(m_filename, 10, Record(100), 100));
+	u64 size = File::GetSize(m_filename);
+	{
+		File::IOFile file(m_filename, "r+b");
+		ASSERT_TRUE(file.Resize(size - sizeof(Movie::StateHash) / 2));
+	}
+	EXPECT_FALSE(Movie::ReadStateHashes(m_filename, &interval, &loaded));
+
+	// Not a hash file.
+	ASSERT_TRUE(File::WriteStringToFile(std::string(64, 'x'), m_filename));
+	EXPECT_FALSE(Movie::ReadStateHashes(m_filename, &interval, &loaded));
+
+	// Failed reads leave the previous hashes alone.
+	EXPECT_EQ(7u, interval);
+	EXPECT_TRUE(SameHashes(Record(20), loaded));
+}
+
+TEST_F(StateHashTest, FindsFirstDivergence)
+{
+	ASSERT_TRUE(Movie::WriteStateHashes(m_filename, 10, Record(100), 100));
+	u32 interval = 0;
+	std::vector<Movie::StateHash> recorded;
+	ASSERT_TRUE(Movie::ReadStateHashes(m_filename, &interval, &recorded));
+
+	// Play back the same inputs, with the state going wrong from input 63 on.
+	std::vector<Movie::StateHash> played = Record(100);
+	for (Movie::StateHash& entry : played)
+	{
+		if (entry.input_count >= 63)
+			entry.hash ^= 1;
+	}
+
+	u64 checked = 0;
+	u64 divergent_frame = 0;
+	for (u64 input = 1; input <= 100 && !divergent_frame; ++input)
+	{
+		const Movie::StateHash* expected = Movie::FindStateHash(recorded, input);
+		if (input % interval != 0)
+		{
+			EXPECT_EQ(nullptr, expected);
+			continue;
+		}
+		ASSERT_NE(nullptr, expected);
+		++checked;
+		if (Movie::FindStateHash(played, input)->hash != expected->hash)
+			divergent_frame = expected->frame;
+	}
+	EXPECT_EQ(7u, checked);
+	EXPECT_EQ(35u, divergent_frame);
+}
@@ -0,0 +1,185 @@
+// Copyright 2016 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+#ifndef _WIN32
+#include <csignal>
+#include <sys/resource.h>
+#endif
+
+#include "Common/CommonPaths.h"
+#include "Common/CommonTypes.h"
+#include "Common/FileUtil.h"
+#include "Core/IPC_HLE/NANDFile.h"
+
+namespace
+{
+const u32 PAGE_SIZE = NANDFile::PAGE_SIZE;
+const size_t MAX_CLEAN_PAGES = NANDFile::MAX_CLEAN_PAGES;
+}
+
+class NANDFileTest : public testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		m_dir = File::CreateTempDir();
+		ASSERT_FALSE(m_dir.empty());
+		m_filename = m_dir + DIR_SEP "test.bin";
+	}
+
+	void TearDown() override
+	{
+		File::DeleteDirRecursively(m_dir);
+	}
+
+	// Every byte is different from its neighbours, and from the bytes one page away.
+	static std::string Pattern(u64 offset, size_t size)
+	{
+		std::string data(size, '\0');
+		for (size_t i = 0; i < size; ++i)
+			data[i] = (char)((offset + i) * 7 + (offset + i) / PAGE_SIZE);
+		return data;
+	}
+
+	void CreateHostFile(u64 size)
+	{
+		ASSERT_TRUE(File::WriteStringToFile(Pattern(0, (size_t)size), m_filename));
+	}
+
+	std::string HostFile() const
+	{
+		std::string contents;
+		EXPECT_TRUE(File::ReadFileToString(m_filename, contents));
+		return contents;
+	}
+
+	static std::string Read(NANDFile* file, u64 offset, u32 size)
+	{
+		std::string data(size, '\0');
+		u32 bytes_read = 0;
+		EXPECT_TRUE(file->Read(offset, (u8*)&data[0], size, &bytes_read));
+		data.resize(bytes_read);
+		return data;
+	}
+
+	static bool Write(NANDFile* file, u64 offset, const std::string& data)
+	{
+		return file->Write(offset, (const u8*)data.data(), (u32)data.size());
+	}
+
+	std::string m_dir;
+	std::string m_filename;
+};
+
+TEST_F(NANDFileTest, ReadsAndWritesAcrossPages)
+{
+	const u64 size = PAGE_SIZE * 3 + PAGE_SIZE / 2;
+	CreateHostFile(size);
+	NANDFile file(m_filename);
+	ASSERT_TRUE(file.IsOpen());
+	EXPECT_EQ(size, file.GetSize());
+
+	EXPECT_EQ(Pattern(PAGE_SIZE - 5, PAGE_SIZE + 10), Read(&file, PAGE_SIZE - 5, PAGE_SIZE + 10));
+	// Cut short at the end of the file.
+	EXPECT_EQ(Pattern(size - 3, 3), Read(&file, size - 3, 16));
+	EXPECT_EQ("", Read(&file, size, 16));
+
+	// Writes stay in memory until flushed, but are seen by reads right away.
+	const std::string data(PAGE_SIZE * 2, 'x');
+	ASSERT_TRUE(Write(&file, PAGE_SIZE / 2, data));
+	ASSERT_TRUE(Write(&file, size + 10, "tail"));
+	EXPECT_TRUE(file.IsDirty());
+	EXPECT_EQ(size + 14, file.GetSize());
+	EXPECT_EQ(Pattern(0, (size_t)size), HostFile());
+	EXPECT_EQ(data, Read(&file, PAGE_SIZE / 2, (u32)data.size()));
+	EXPECT_EQ(std::string(10, '\0') + "tail", Read(&file, size, 14));
+
+	ASSERT_TRUE(file.Flush());
+	EXPECT_FALSE(file.IsDirty());
+	std::string expected = Pattern(0, (size_t)size) + std::string(10, '\0') + "tail";
+	expected.replace(PAGE_SIZE / 2, data.size(), data);
+	EXPECT_EQ(expected, HostFile());
+}
+
+TEST_F(NANDFileTest, TrimsCleanPages)
+{
+	const u32 pages = (u32)MAX_CLEAN_PAGES + 16;
+	CreateHostFile((u64)pages * PAGE_SIZE);
+	NANDFile file(m_filename);
+
+	// Dirty pages are never dropped.
+	for (u32 i = 0; i < 4; ++i)
+		ASSERT_TRUE(Write(&file, (u64)i * PAGE_SIZE, std::string(16, (char)('a' + i))));
+
+	for (u32 i = 0; i < pages; ++i)
+	{
+		EXPECT_EQ(Pattern((u64)i * PAGE_SIZE + 16, 16), Read(&file, (u64)i * PAGE_SIZE + 16, 16));
+		EXPECT_GE(MAX_CLEAN_PAGES + 4 + 1, file.GetCachedPages());
+	}
+	for (u32 i = 0; i < 4; ++i)
+		EXPECT_EQ(std::string(16, (char)('a' + i)), Read(&file, (u64)i * PAGE_SIZE, 16));
+
+	ASSERT_TRUE(file.Flush());
+	EXPECT_GE(MAX_CLEAN_PAGES, file.GetCachedPages());
+	EXPECT_EQ(std::string(16, 'c'), HostFile().substr(PAGE_SIZE * 2, 16));
+}
+
+TEST_F(NANDFileTest, InvalidateReloadsHostFile)
+{
+	CreateHostFile(PAGE_SIZE);
+	NANDFile file(m_filename);
+	ASSERT_TRUE(Write(&file, 0, "written"));
+
+	file.Invalidate();
+	EXPECT_FALSE(file.IsDirty());
+	EXPECT_EQ("written", HostFile().substr(0, 7));
+
+	// Replaced behind its back.
+	ASSERT_TRUE(File::WriteStringToFile("replaced", m_filename));
+	EXPECT_EQ(8u, file.GetSize());
+	EXPECT_EQ("replaced", Read(&file, 0, 16));
+
+	// Deleted, then created again.
+	file.Invalidate();
+	ASSERT_TRUE(File::Delete(m_filename));
+	EXPECT_FALSE(file.IsOpen());
+	EXPECT_EQ(0u, file.GetSize());
+	ASSERT_TRUE(File::WriteStringToFile("new", m_filename));
+	EXPECT_TRUE(file.IsOpen());
+	EXPECT_EQ("new", Read(&file, 0, 16));
+}
+
+#ifndef _WIN32
+TEST_F(NANDFileTest, RetriesFailedFlush)
+{
+	CreateHostFile(PAGE_SIZE);
+	NANDFile file(m_filename);
+	ASSERT_TRUE(Write(&file, PAGE_SIZE * 4, std::string(PAGE_SIZE, 'z')));
+
+	// Make writes past the second page fail with EFBIG.
+	rlimit old_limit;
+	ASSERT_EQ(0, getrlimit(RLIMIT_FSIZE, &old_limit));
+	rlimit limit = old_limit;
+	limit.rlim_cur = PAGE_SIZE * 2;
+	void (*old_handler)(int) = signal(SIGXFSZ, SIG_IGN);
+	ASSERT_EQ(0, setrlimit(RLIMIT_FSIZE, &limit));
+
+	EXPECT_FALSE(file.Flush());
+	EXPECT_TRUE(file.IsDirty());
+	EXPECT_EQ(std::string(PAGE_SIZE, 'z'), Read(&file, PAGE_SIZE * 4, PAGE_SIZE));
+
+	ASSERT_EQ(0, setrlimit(RLIMIT_FSIZE, &old_limit));
+	signal(SIGXFSZ, old_handler);
+
+	EXPECT_TRUE(file.Flush());
+	EXPECT_FALSE(file.IsDirty());
+	const std::string contents = HostFile();
+	ASSERT_EQ(PAGE_SIZE * 5u, contents.size());
+	EXPECT_EQ(std::string(PAGE_SIZE, 'z'), contents.substr(PAGE_SIZE * 4));
+}
+#endif
@@ -0,0 +1,178 @@
+// Copyright 2016 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <deque>
+#include <gtest/gtest.h>
+
+#include "Common/CommonTypes.h"
+#include "Core/NetPlayRollback.h"
+
+class RollbackPadTest : public testing::Test
+{
+protected:
+	static GCPadStatus Input(u16 button)
+	{
+		GCPadStatus status = {};
+		status.button = button;
+		return status;
+	}
+
+	// Polls the pad once, with the inputs that "arrived" so far.
+	u16 Poll()
+	{
+		GCPadStatus status = {};
+		EXPECT_TRUE(m_pad.GetRollbackPad(m_has_snapshot, m_source, &status, &m_mispredicted));
+		return status.button;
+	}
+
+	void Arrive(u16 button)
+	{
+		m_arrived.push_back(Input(button));
+	}
+
+	// An input that only shows up when the pad waits for it.
+	void ArriveLate(u16 button)
+	{
+		m_late.push_back(Input(button));
+	}
+
+	void Load()
+	{
+		m_pad.OnSnapshotLoaded();
+		m_mispredicted = false;
+	}
+
+	NetPlay::RollbackPad m_pad;
+	std::deque<GCPadStatus> m_arrived;
+	std::deque<GCPadStatus> m_late;
+	bool m_has_snapshot = false;
+	bool m_mispredicted = false;
+	u32 m_waits = 0;
+
+	NetPlay::RollbackPad::InputSource m_source = [this](GCPadStatus* status, bool wait)
+	{
+		if (wait)
+			m_waits++;
+		std::deque<GCPadStatus>& inputs = m_arrived.empty() && wait ? m_late : m_arrived;
+		if (inputs.empty())
+			return false;
+		*status = inputs.front();
+		inputs.pop_front();
+		return true;
+	};
+};
+
+TEST_F(RollbackPadTest, WaitsWithoutSnapshot)
+{
+	Arrive(1);
+	EXPECT_EQ(1, Poll());
+	EXPECT_EQ(1u, m_waits);
+
+	// Nothing arrived and nothing to go back to: the poll fails.
+	GCPadStatus status;
+	EXPECT_FALSE(m_pad.GetRollbackPad(false, m_source, &status, &m_mispredicted));
+	EXPECT_FALSE(m_mispredicted);
+}
+
+TEST_F(RollbackPadTest, PredictsLastInput)
+{
+	Arrive(5);
+	Poll();
+
+	m_has_snapshot = true;
+	m_pad.OnSnapshotSaved();
+	EXPECT_EQ(5, Poll());
+	EXPECT_EQ(5, Poll());
+	EXPECT_FALSE(m_pad.IsSettled());
+	EXPECT_EQ(1u, m_waits);
+
+	// Right guesses settle without a rollback.
+	Arrive(5);
+	Arrive(5);
+	Arrive(7);
+	EXPECT_EQ(7, Poll());
+	EXPECT_TRUE(m_pad.IsSettled());
+	EXPECT_FALSE(m_mispredicted);
+	EXPECT_EQ(4u, m_pad.GetPolls());
+}
+
+TEST_F(RollbackPadTest, ReplaysCorrectedInputs)
+{
+	m_has_snapshot = true;
+	m_pad.OnSnapshotSaved();
+	Arrive(1);
+	EXPECT_EQ(1, Poll());
+	EXPECT_EQ(1, Poll());
+	EXPECT_EQ(1, Poll());
+
+	// The second poll was really 2, and so is everything after it.
+	Arrive(2);
+	Arrive(2);
+	EXPECT_EQ(2, Poll());
+	EXPECT_TRUE(m_mispredicted);
+
+	Load();
+	EXPECT_TRUE(m_pad.IsReplaying(m_has_snapshot));
+	EXPECT_EQ(1, Poll());
+	EXPECT_EQ(2, Poll());
+	EXPECT_EQ(2, Poll());
+	EXPECT_EQ(2, Poll());
+	EXPECT_FALSE(m_pad.IsReplaying(m_has_snapshot));
+	EXPECT_FALSE(m_mispredicted);
+
+	// The last poll is still a guess until its input arrives.
+	EXPECT_FALSE(m_pad.IsSettled());
+	Arrive(2);
+	Arrive(3);
+	EXPECT_EQ(3, Poll());
+	EXPECT_TRUE(m_pad.IsSettled());
+	EXPECT_FALSE(m_mispredicted);
+}
+
+TEST_F(RollbackPadTest, WaitsPastMaxPolls)
+{
+	m_has_snapshot = true;
+	m_pad.OnSnapshotSaved();
+	for (size_t i = 0; i < NetPlay::RollbackPad::MAX_POLLS; i++)
+		EXPECT_EQ(0, Poll());
+	EXPECT_EQ(0u, m_waits);
+
+	// Too far ahead: the next poll waits for every prediction to be confirmed,
+	// then for its own input.
+	for (size_t i = 0; i < NetPlay::RollbackPad::MAX_POLLS; i++)
+		ArriveLate(i < 3 ? 0 : 9);
+	ArriveLate(4);
+	EXPECT_EQ(4, Poll());
+	EXPECT_TRUE(m_mispredicted);
+	EXPECT_TRUE(m_pad.IsSettled());
+	EXPECT_EQ(NetPlay::RollbackPad::MAX_POLLS + 1, m_waits);
+
+	Load();
+	for (size_t i = 0; i < 3; i++)
+		EXPECT_EQ(0, Poll());
+	for (size_t i = 3; i < NetPlay::RollbackPad::MAX_POLLS; i++)
+		EXPECT_EQ(9, Poll());
+	EXPECT_EQ(4, Poll());
+	EXPECT_FALSE(m_pad.IsReplaying(m_has_snapshot));
+	EXPECT_FALSE(m_mispredicted);
+}
+
+TEST_F(RollbackPadTest, DroppedSnapshotKeepsLastInput)
+{
+	m_has_snapshot = true;
+	m_pad.OnSnapshotSaved();
+	Arrive(6);
+	Poll();
+	EXPECT_TRUE(m_pad.IsSettled());
+
+	m_pad.OnSnapshotDropped();
+	m_pad.OnSnapshotSaved();
+	EXPECT_FALSE(m_pad.IsReplaying(m_has_snapshot));
+	EXPECT_EQ(6, Poll());
+	EXPECT_FALSE(m_pad.IsSettled());
+
+	m_pad.Reset();
+	EXPECT_EQ(0u, m_pad.GetPolls());
+	EXPECT_TRUE(m_pad.IsSettled());
+}
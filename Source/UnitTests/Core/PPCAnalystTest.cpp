@@ -0,0 +1,108 @@
+// Copyright 2016 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "Common/CommonTypes.h"
+#include "Core/ConfigManager.h"
+#include "Core/HW/Memmap.h"
+#include "Core/PowerPC/PowerPC.h"
+#include "Core/PowerPC/PPCAnalyst.h"
+#include "Core/PowerPC/PPCTables.h"
+
+class IdleLoopTest : public testing::Test
+{
+protected:
+	static const u32 LOOP_ADDRESS = 0x80003000;
+
+	void SetUp() override
+	{
+		SConfig::Init();
+		Memory::Init();
+		PPCTables::InitTables(PowerPC::CORE_INTERPRETER);
+
+		m_block.m_stats = &m_stats;
+		m_block.m_gpa = &m_gpa;
+		m_block.m_fpa = &m_fpa;
+	}
+
+	void TearDown() override
+	{
+		Memory::Shutdown();
+		SConfig::Shutdown();
+	}
+
+	void Analyze(const std::vector<u32>& code)
+	{
+		for (size_t i = 0; i < code.size(); i++)
+			Memory::Write_U32(code[i], LOOP_ADDRESS + static_cast<u32>(i) * 4);
+		m_analyzer.Analyze(LOOP_ADDRESS, &m_block, &m_buffer, m_buffer.GetSize());
+		ASSERT_EQ(code.size(), m_block.m_num_instructions);
+	}
+
+	PPCAnalyst::PPCAnalyzer m_analyzer;
+	PPCAnalyst::CodeBuffer m_buffer{32000};
+	PPCAnalyst::CodeBlock m_block;
+	PPCAnalyst::BlockStats m_stats;
+	PPCAnalyst::BlockRegStats m_gpa;
+	PPCAnalyst::BlockRegStats m_fpa;
+};
+
+TEST_F(IdleLoopTest, PollsRAM)
+{
+	Analyze({
+		0x800D0010, // lwz    r0, 0x10(r13)
+		0x2C000000, // cmpwi  r0, 0
+		0x4182FFF8, // beq    LOOP_ADDRESS
+	});
+	EXPECT_TRUE(m_block.m_idle_loop);
+
+	// r13 is only known at runtime, so the JIT has to check the address.
+	ASSERT_EQ(1u, m_block.m_idle_loop_loads.size());
+	EXPECT_EQ(13u, m_block.m_idle_loop_loads[0].reg);
+	EXPECT_EQ(0x10, m_block.m_idle_loop_loads[0].offset);
+}
+
+TEST_F(IdleLoopTest, PollsTimedRegister)
+{
+	// Waits for the VI beam to pass a line. The register changes without an
+	// event, so skipping to the next event would skip past the line.
+	Analyze({
+		0x3C60CC00, // lis    r3, 0xCC00
+		0xA003202C, // lhz    r0, VI_HORIZONTAL_BEAM_POSITION(r3)
+		0x28000100, // cmplwi r0, 0x100
+		0x4180FFF4, // blt    LOOP_ADDRESS
+	});
+	EXPECT_FALSE(m_block.m_idle_loop);
+}
+
+TEST_F(IdleLoopTest, PollsThroughPointer)
+{
+	// Could be the AI sample counter or a variable; that's up to the JIT.
+	Analyze({
+		0x801F0008, // lwz    r0, 8(r31)
+		0x7C00F000, // cmpw   r0, r30
+		0x4182FFF8, // beq    LOOP_ADDRESS
+	});
+	EXPECT_TRUE(m_block.m_idle_loop);
+	ASSERT_EQ(1u, m_block.m_idle_loop_loads.size());
+	EXPECT_EQ(31u, m_block.m_idle_loop_loads[0].reg);
+
+	EXPECT_TRUE(PPCAnalyst::IsHardwareAddress(0xCC006C00 + m_block.m_idle_loop_loads[0].offset));
+	EXPECT_TRUE(PPCAnalyst::IsHardwareAddress(0xCD006C00));
+	EXPECT_FALSE(PPCAnalyst::IsHardwareAddress(0x80001234));
+	EXPECT_FALSE(PPCAnalyst::IsHardwareAddress(0xC0001234));
+	EXPECT_FALSE(PPCAnalyst::IsHardwareAddress(0x90001234));
+}
+
+TEST_F(IdleLoopTest, PollsIndexed)
+{
+	Analyze({
+		0x7C03202E, // lwzx   r0, r3, r4
+		0x2C000000, // cmpwi  r0, 0
+		0x4182FFF8, // beq    LOOP_ADDRESS
+	});
+	EXPECT_FALSE(m_block.m_idle_loop);
+}
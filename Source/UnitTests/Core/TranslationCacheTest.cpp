@@ -0,0 +1,157 @@
+// Copyright 2016 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include "Common/CommonFuncs.h"
+#include "Common/CommonTypes.h"
+#include "Common/x64ABI.h"
+#include "Common/x64Analyzer.h"
+#include "Common/x64Emitter.h"
+#include "Core/ConfigManager.h"
+#include "Core/HW/Memmap.h"
+#include "Core/PowerPC/PowerPC.h"
+#include "Core/PowerPC/JitCommon/JitBase.h"
+#include "Core/PowerPC/JitCommon/TrampolineCache.h"
+
+// include order is important
+#include <gtest/gtest.h> // NOLINT
+
+#if _M_X86_64
+using namespace Gen;
+
+namespace
+{
+// A virtual page that the cache maps to a different physical page.
+const u32 VIRTUAL_PAGE = 0x00001000;
+const u32 PHYSICAL_PAGE = 0x00005000;
+const u32 MSR_DR = 1 << (31 - 27);
+
+const X64Reg ADDRESS_REG = RBX;
+const X64Reg DATA_REG = R12;
+}
+
+// Runs the trampolines the way backpatched JIT code does: jumped to with the
+// address and data in registers, jumping back when done.
+class TranslationCacheTest : public testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		SConfig::Init();
+		SConfig::GetInstance().bMMU = true;
+		Memory::Init();
+		PowerPC::ClearTranslationCache();
+
+		const u32 index = (VIRTUAL_PAGE >> HW_PAGE_INDEX_SHIFT) & (TRANSLATION_CACHE_SIZE - 1);
+		PowerPC::translation_cache.read_tag[index] = VIRTUAL_PAGE;
+		PowerPC::translation_cache.read_page[index] = Memory::m_pRAM + PHYSICAL_PAGE;
+		PowerPC::translation_cache.write_tag[index] = VIRTUAL_PAGE;
+		PowerPC::translation_cache.write_page[index] = Memory::m_pRAM + PHYSICAL_PAGE;
+
+		m_trampolines.Init(0x10000);
+		GenerateRead();
+		GenerateWrite();
+	}
+
+	void TearDown() override
+	{
+		m_trampolines.Shutdown();
+		PowerPC::ClearTranslationCache();
+		PowerPC::ppcState.msr = 0;
+		Memory::Shutdown();
+		SConfig::Shutdown();
+	}
+
+	static u32 RAM(u32 address)
+	{
+		return Common::swap32(*(u32*)&Memory::m_pRAM[address]);
+	}
+
+	static void SetRAM(u32 address, u32 value)
+	{
+		*(u32*)&Memory::m_pRAM[address] = Common::swap32(value);
+	}
+
+	u32 Read(u32 address)
+	{
+		return ((u32 (*)(u32))m_read)(address);
+	}
+
+	void Write(u32 address, u32 value)
+	{
+		((void (*)(u32, u32))m_write)(address, value);
+	}
+
+private:
+	static InstructionInfo Info(bool write)
+	{
+		InstructionInfo info = {};
+		info.operandSize = 4;
+		info.regOperandReg = DATA_REG;
+		info.scaledReg = ADDRESS_REG;
+		info.isMemoryWrite = write;
+		return info;
+	}
+
+	// Takes the arguments from the host ABI and sets up the JIT's registers.
+	void Enter(const u8* trampoline)
+	{
+		TrampolineCache& code = m_trampolines;
+		code.ABI_PushRegistersAndAdjustStack(ABI_ALL_CALLEE_SAVED, 8, 16);
+		code.MOV(64, R(RPPCSTATE), ImmPtr((u8*)&PowerPC::ppcState + 0x80));
+		code.MOV(32, R(ADDRESS_REG), R(ABI_PARAM1));
+		code.MOV(32, R(DATA_REG), R(ABI_PARAM2));
+		code.JMP(trampoline, true);
+	}
+
+	// The test code goes in the same block as the trampolines, so that all
+	// jumps are near.
+	void GenerateRead()
+	{
+		TrampolineCache& code = m_trampolines;
+		u8* done = code.GetWritableCodePtr();
+		code.MOV(32, R(ABI_RETURN), R(DATA_REG));
+		code.ABI_PopRegistersAndAdjustStack(ABI_ALL_CALLEE_SAVED, 8, 16);
+		code.RET();
+
+		const u8* trampoline = code.GenerateReadTrampoline(Info(false), {}, nullptr, done);
+		m_read = code.GetCodePtr();
+		Enter(trampoline);
+	}
+
+	void GenerateWrite()
+	{
+		TrampolineCache& code = m_trampolines;
+		u8* done = code.GetWritableCodePtr();
+		code.ABI_PopRegistersAndAdjustStack(ABI_ALL_CALLEE_SAVED, 8, 16);
+		code.RET();
+
+		const u8* trampoline = code.GenerateWriteTrampoline(Info(true), {}, nullptr, done, 0x80003000);
+		m_write = code.GetCodePtr();
+		Enter(trampoline);
+	}
+
+	TrampolineCache m_trampolines;
+	const u8* m_read;
+	const u8* m_write;
+};
+
+TEST_F(TranslationCacheTest, ProbesOnlyWithDataTranslation)
+{
+	SetRAM(VIRTUAL_PAGE + 0x10, 0x11111111);
+	SetRAM(PHYSICAL_PAGE + 0x10, 0x55555555);
+
+	PowerPC::ppcState.msr = MSR_DR;
+	EXPECT_EQ(0x55555555u, Read(VIRTUAL_PAGE + 0x10));
+	Write(VIRTUAL_PAGE + 0x20, 0x12345678);
+	EXPECT_EQ(0x12345678u, RAM(PHYSICAL_PAGE + 0x20));
+	EXPECT_EQ(0u, RAM(VIRTUAL_PAGE + 0x20));
+
+	// Real mode: the same address is physical, whatever the cache holds.
+	PowerPC::ppcState.msr = 0;
+	EXPECT_EQ(0x11111111u, Read(VIRTUAL_PAGE + 0x10));
+	Write(VIRTUAL_PAGE + 0x30, 0x9ABCDEF0);
+	EXPECT_EQ(0x9ABCDEF0u, RAM(VIRTUAL_PAGE + 0x30));
+	EXPECT_EQ(0u, RAM(PHYSICAL_PAGE + 0x30));
+}
+#endif